@@ -41,9 +41,10 @@ namespace android
 
         if (this->pbase() != this->pptr())
         {
-            const char *str = std::string(this->pbase(), this->pptr() - this->pbase()).c_str();
+            // The message has to outlive the call, so it isn't a temporary.
+            const std::string message(this->pbase(), this->pptr() - this->pbase());
 
-            __android_log_print(priority, tag, "%s", str);
+            __android_log_print(priority, tag, "%s", message.c_str());
 
             rc = 0;
 
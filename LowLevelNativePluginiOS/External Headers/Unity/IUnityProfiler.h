@@ -7,6 +7,7 @@
 #pragma once
 #include "IUnityInterface.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 // Unity Profiler Native plugin API provides an ability to register callbacks for Unity Profiler events.
@@ -249,3 +250,116 @@ UNITY_DECLARE_INTERFACE(IUnityProfiler)
     int(UNITY_INTERFACE_API * UnregisterThread)(UnityProfilerThreadId threadId);
 };
 UNITY_REGISTER_INTERFACE_GUID(0x2CE79ED8316A4833ULL, 0x87076B2013E1571FULL, IUnityProfiler)
+
+enum UnityProfilerMarkerDataUnit_
+{
+    kUnityProfilerMarkerDataUnitUndefined = 0,
+    kUnityProfilerMarkerDataUnitTimeNanoseconds = 1,
+    kUnityProfilerMarkerDataUnitBytes = 2,
+    kUnityProfilerMarkerDataUnitCount = 3,
+    kUnityProfilerMarkerDataUnitPercent = 4,
+    kUnityProfilerMarkerDataUnitFrequencyHz = 5,
+};
+typedef uint8_t UnityProfilerMarkerDataUnit;
+
+enum UnityProfilerCounterFlags_
+{
+    kUnityProfilerCounterFlagNone = 0,
+    // Sends the value to the Unity Profiler at the end of each frame, instead of only when FlushCounterValue is called.
+    kUnityProfilerCounterFlushOnEndOfFrame = 1 << 1,
+    // Resets the value to zero once it has been sent.
+    kUnityProfilerCounterFlagResetToZeroOnFlush = 1 << 2,
+    // The value is changed atomically.
+    kUnityProfilerCounterFlagAtomic = 1 << 3,
+    // The value is read through a getter.
+    kUnityProfilerCounterFlagGetter = 1 << 4
+};
+typedef uint16_t UnityProfilerCounterFlags;
+
+typedef void (UNITY_INTERFACE_API * UnityProfilerCounterStatePtrCallback)(void* userData);
+
+// Available since 2021.2
+UNITY_DECLARE_INTERFACE(IUnityProfilerV2)
+{
+    void BeginSample(const UnityProfilerMarkerDesc* markerDesc)
+    {
+        (this->EmitEvent)(markerDesc, kUnityProfilerMarkerEventTypeBegin, 0, NULL);
+    }
+
+    void BeginSample(const UnityProfilerMarkerDesc* markerDesc, uint16_t eventDataCount, const UnityProfilerMarkerData* eventData)
+    {
+        (this->EmitEvent)(markerDesc, kUnityProfilerMarkerEventTypeBegin, eventDataCount, eventData);
+    }
+
+    void EndSample(const UnityProfilerMarkerDesc* markerDesc)
+    {
+        (this->EmitEvent)(markerDesc, kUnityProfilerMarkerEventTypeEnd, 0, NULL);
+    }
+
+    // Create instrumentation event.
+    // \param markerDesc is a pointer to marker description struct.
+    // \param eventType is an event type - UnityProfilerMarkerEventType_.
+    // \param eventDataCount is an event metadata count passed in eventData. Must be less than eventDataCount specified in CreateMarker.
+    // \param eventData is a metadata array of eventDataCount elements.
+    void(UNITY_INTERFACE_API * EmitEvent)(const UnityProfilerMarkerDesc* markerDesc, UnityProfilerMarkerEventType eventType, uint16_t eventDataCount, const UnityProfilerMarkerData* eventData);
+
+    // Returns 1 if Unity Profiler is enabled, 0 overwise.
+    int(UNITY_INTERFACE_API * IsEnabled)();
+
+    // Returns 1 if Unity Profiler is available, 0 overwise.
+    int(UNITY_INTERFACE_API * IsAvailable)();
+
+    // Creates a new Unity Profiler marker.
+    // \param desc Pointer to the const UnityProfilerMarkerDesc* which is set to the created marker in a case of a succesful execution.
+    // \param name Marker name to be displayed in Unity Profiler.
+    // \param flags Marker flags. One of UnityProfilerMarkerFlag_ enum. Use kUnityProfilerMarkerFlagDefault if not sure.
+    // \param eventDataCount Maximum count of potential metadata parameters count.
+    // \return 0 on success and non-zero in case of error.
+    int(UNITY_INTERFACE_API * CreateMarker)(const UnityProfilerMarkerDesc** desc, const char* name, UnityProfilerCategoryId category, UnityProfilerMarkerFlags flags, int eventDataCount);
+
+    // Set a metadata description for the Unity Profiler marker.
+    // \param markerDesc is a pointer to marker description struct.
+    // \param index metadata index to set name for.
+    // \param metadataType Data type. Must be of UnityProfilerMarkerDataType_ enum.
+    // \param name Metadata name.
+    // \return 0 on success and non-zero in case of error.
+    int(UNITY_INTERFACE_API * SetMarkerMetadataName)(const UnityProfilerMarkerDesc* desc, int index, UnityProfilerMarkerEventType metadataType, const char* metadataName);
+
+    // Creates a new Unity Profiler category.
+    // \param category Pointer to the UnityProfilerCategoryId which is set to the created category in a case of a succesful execution.
+    // \param name Category name to be displayed in Unity Profiler.
+    // \param unused Reserved.
+    // \return 0 on success and non-zero in case of error.
+    int(UNITY_INTERFACE_API * CreateCategory)(UnityProfilerCategoryId* category, const char* name, uint32_t unused);
+
+    // Creates a new Unity Profiler counter, which the Profiler and the ProfilerRecorder API read.
+    // \param category Category the counter belongs to.
+    // \param name Counter name to be displayed in Unity Profiler.
+    // \param flags Marker flags. One of UnityProfilerMarkerFlag_ enum.
+    // \param valueType Value type. One of UnityProfilerMarkerDataType_ enum.
+    // \param valueUnit Value unit. One of UnityProfilerMarkerDataUnit_ enum.
+    // \param valueSize Value size in bytes, at most 8.
+    // \param counterFlags Counter flags. One of UnityProfilerCounterFlags_ enum.
+    // \param activateFunc Optional callback which is called when the counter is activated.
+    // \param deactivateFunc Optional callback which is called when the counter is deactivated.
+    // \param userData Optional data passed to the callbacks.
+    // \return A pointer to the value of the counter, which is written directly, or NULL in case of error.
+    void*(UNITY_INTERFACE_API * CreateCounterValue)(UnityProfilerCategoryId category, const char* name, UnityProfilerMarkerFlags flags, UnityProfilerMarkerDataType valueType, UnityProfilerMarkerDataUnit valueUnit, size_t valueSize, UnityProfilerCounterFlags counterFlags, UnityProfilerCounterStatePtrCallback activateFunc, UnityProfilerCounterStatePtrCallback deactivateFunc, void* userData);
+
+    // Sends the value of a counter to the Unity Profiler.
+    // \param counter Pointer to the value returned by CreateCounterValue.
+    void(UNITY_INTERFACE_API * FlushCounterValue)(void* counter);
+
+    // Registers current thread with Unity Profiler.
+    // \param threadId Optional Unity Profiler thread identifier which it written on successful method call. Can be used with UnregisterThread.
+    // \param groupName Thread group name. Unity Profiler aggregates threads with the same group.
+    // \param name Thread name.
+    // \return 0 on success and non-zero in case of error.
+    int(UNITY_INTERFACE_API * RegisterThread)(UnityProfilerThreadId* threadId, const char* groupName, const char* name);
+
+    // Unregisters current thread from Unity Profiler and cleans up all associated memory.
+    // \param threadId Unity Profiler thread identifier obtained with RegisterThread call. Use 0 to cleanup the current thread.
+    // \return 0 on success and non-zero in case of error.
+    int(UNITY_INTERFACE_API * UnregisterThread)(UnityProfilerThreadId threadId);
+};
+UNITY_REGISTER_INTERFACE_GUID(0xB957E0189CB6A30BULL, 0x83CE589AE85B9068ULL, IUnityProfilerV2)
@@ -0,0 +1,32 @@
+//
+//  RyzRefreshMonitor.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef RYZREFRESHMONITOR_H
+#define RYZREFRESHMONITOR_H
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+#include "ikin_ryz_displayer.h"
+
+/// @brief: Calls the displayer at every refresh of the Ryz display, from a thread of its own.
+/// @remarks: Unity's main thread is the one that runs late when a frame misses its deadline, so the refreshes can't be watched from it.
+@interface RyzRefreshMonitor : NSObject
+
+/// @brief: Initializes an instance of this class, and starts watching the refreshes of a screen.
+/// @param ryzDisplayer The displayer that is called at every refresh.
+/// @param screen The screen that the Ryz display is shown on.
+/// @param framesPerSecond The rate that Unity presents frames at, which the refreshes are limited to.
+/// @returns: A reference to the initialized instance of this class.
+- (id) initWith : (ikin_ryz_displayer*) ryzDisplayer screen : (UIScreen*) screen framesPerSecond : (NSInteger) framesPerSecond;
+
+/// @brief: Stops watching the refreshes. The thread exits shortly after.
+- (void) stop;
+
+@end
+
+#endif
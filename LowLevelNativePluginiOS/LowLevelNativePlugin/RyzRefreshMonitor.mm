@@ -0,0 +1,79 @@
+//
+//  RyzRefreshMonitor.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "RyzRefreshMonitor.h"
+
+@implementation RyzRefreshMonitor
+
+// Private Fields
+{
+    ikin_ryz_displayer* ryzDisplayer;
+    NSThread* thread;
+}
+
+/// @brief: Initializes an instance of this class, and starts watching the refreshes of a screen.
+/// @param ryzDisplayer The displayer that is called at every refresh.
+/// @param screen The screen that the Ryz display is shown on.
+/// @param framesPerSecond The rate that Unity presents frames at, which the refreshes are limited to.
+/// @returns: A reference to the initialized instance of this class.
+- (id) initWith : (ikin_ryz_displayer*) ryzDisplayer screen : (UIScreen*) screen framesPerSecond : (NSInteger) framesPerSecond
+{
+    if (self = [super init])
+    {
+        self->ryzDisplayer = ryzDisplayer;
+        
+        // The display link is created on the thread, so that it fires on the thread's run loop.
+        // The screen's own display link follows its refresh, which can differ from the phone's.
+        CADisplayLink* displayLink = [screen displayLinkWithTarget : self selector : @selector(handleRefresh:)];
+        displayLink.preferredFramesPerSecond = framesPerSecond;
+        
+        thread = [[NSThread alloc] initWithTarget : self selector : @selector(run:) object : displayLink];
+        thread.name = @"iKin Ryz Refresh Monitor";
+        thread.qualityOfService = NSQualityOfServiceUserInteractive;
+        
+        [thread start];
+    }
+    
+    return self;
+}
+
+/// @brief: Stops watching the refreshes. The thread exits shortly after.
+- (void) stop
+{
+    [thread cancel];
+}
+
+/// @brief: Runs the thread's run loop until the monitor is stopped.
+/// @param displayLink The display link that fires at every refresh.
+- (void) run : (CADisplayLink*) displayLink
+{
+    @autoreleasepool
+    {
+        [displayLink addToRunLoop : [NSRunLoop currentRunLoop] forMode : NSDefaultRunLoopMode];
+        
+        // Wake up now and then even without refreshes, so that a stop is noticed.
+        while (![[NSThread currentThread] isCancelled])
+        {
+            @autoreleasepool
+            {
+                [[NSRunLoop currentRunLoop] runMode : NSDefaultRunLoopMode beforeDate : [NSDate dateWithTimeIntervalSinceNow : 0.1]];
+            }
+        }
+        
+        // The display link holds on to this object, so it has to be invalidated to let go of it.
+        [displayLink invalidate];
+    }
+}
+
+/// @brief: Handles a refresh of the screen.
+/// @param displayLink The display link that fired.
+- (void) handleRefresh : (CADisplayLink*) displayLink
+{
+    ryzDisplayer->on_ryz_display_refresh();
+}
+
+@end
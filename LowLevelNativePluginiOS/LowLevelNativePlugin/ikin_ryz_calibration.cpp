@@ -0,0 +1,357 @@
+//
+//  ikin_ryz_calibration.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_calibration.h"
+
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The header of a color lookup table section, which is padded so that the entries start on a 16-byte boundary of the section.
+    struct calibration_color_lut_header
+    {
+        /// @brief: The number of entries along each axis.
+        uint32_t size;
+
+        /// @brief: Unused. Must be 0.
+        uint32_t reserved[3];
+    };
+
+    /// @brief: Guards the package path and the display geometry.
+    std::mutex calibrationMutex;
+
+    /// @brief: The path of the calibration package that was set, or empty.
+    std::string calibrationPackagePath;
+
+    /// @brief: A value indicating whether @see displayGeometry holds the size of the connected display.
+    bool hasDisplayGeometry = false;
+
+    /// @brief: The physical size of the connected display.
+    display_geometry displayGeometry;
+
+    /// @brief: Checks that a region lies within a mapping of a size.
+    /// @param offset The distance of the region from the start of the mapping, in bytes.
+    /// @param length The size of the region, in bytes.
+    /// @param size The size of the mapping, in bytes.
+    /// @returns: True if the region lies within the mapping, otherwise false.
+    bool is_within(uint64_t offset, uint64_t length, uint64_t size)
+    {
+        return offset <= size && length <= size - offset;
+    }
+
+    /// @brief: Checks that each of a number of floats is finite.
+    /// @param values The floats.
+    /// @param count The number of floats.
+    /// @returns: True if none of the floats is infinite or not a number, otherwise false.
+    bool are_finite(const float* values, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!std::isfinite(values[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+/// @brief: Maps a calibration package and checks that its tables are well formed.
+/// @param path The path of the package.
+/// @returns: The package, or null if it is missing or malformed.
+std::shared_ptr<calibration_package> calibration_package::open(const char* path)
+{
+    if (path == nullptr)
+    {
+        return nullptr;
+    }
+
+    const int file = ::open(path, O_RDONLY | O_CLOEXEC);
+
+    if (file < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat status;
+
+    if (fstat(file, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(calibration_package_header)))
+    {
+        close(file);
+        return nullptr;
+    }
+
+    const size_t size = static_cast<size_t>(status.st_size);
+
+    // The mapping stays valid once the file is closed.
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<calibration_package> package(new calibration_package(static_cast<const uint8_t*>(mapping), size));
+
+    // Check the header and that both tables lie within the file. The sections are checked as they are read.
+    const calibration_package_header* header = reinterpret_cast<const calibration_package_header*>(package->bytes);
+
+    const uint64_t modelsSize = static_cast<uint64_t>(header->modelCount) * sizeof(calibration_package_model);
+    const uint64_t sectionsSize = static_cast<uint64_t>(header->sectionCount) * sizeof(calibration_package_section);
+
+    if (std::memcmp(header->magic, "RYZC", sizeof(header->magic)) != 0 ||
+        header->version != calibrationPackageVersion ||
+        !is_within(sizeof(calibration_package_header), modelsSize + sectionsSize, size))
+    {
+        return nullptr;
+    }
+
+    return package;
+}
+
+/// @brief: Wraps a mapping. Use @see open.
+calibration_package::calibration_package(const uint8_t* bytes, size_t size) :
+    bytes(bytes),
+    size(size)
+{
+}
+
+/// @brief: Unmaps the package.
+calibration_package::~calibration_package()
+{
+    munmap(const_cast<uint8_t*>(bytes), size);
+}
+
+/// @brief: Reads the calibration data of the first model that matches a display.
+/// @param self The package, which the returned mesh and table keep mapped.
+/// @param width The width of the display in pixels. The width and height are also matched the other way around.
+/// @param height The height of the display in pixels.
+/// @param refreshRate The highest refresh rate of the display.
+/// @param calibration The calibration data of the model.
+/// @returns: True if a model matched and its sections are well formed, otherwise false.
+bool calibration_package::find_display(const std::shared_ptr<calibration_package>& self, int width, int height, int refreshRate, display_calibration& calibration)
+{
+    if (self == nullptr)
+    {
+        return false;
+    }
+
+    const uint8_t* bytes = self->bytes;
+    const calibration_package_header* header = reinterpret_cast<const calibration_package_header*>(bytes);
+    const calibration_package_model* models = reinterpret_cast<const calibration_package_model*>(bytes + sizeof(calibration_package_header));
+    const calibration_package_section* sections = reinterpret_cast<const calibration_package_section*>(models + header->modelCount);
+
+    // Find the first model that matches the display, whichever way around the display reports its size.
+    const calibration_package_model* model = nullptr;
+
+    for (uint32_t i = 0; i < header->modelCount && model == nullptr; ++i)
+    {
+        const calibration_package_model& candidate = models[i];
+
+        const bool sizeMatches = (static_cast<int>(candidate.width) == width && static_cast<int>(candidate.height) == height) ||
+            (static_cast<int>(candidate.width) == height && static_cast<int>(candidate.height) == width);
+        const bool rateMatches = candidate.refreshRate == 0 || static_cast<int>(candidate.refreshRate) == refreshRate;
+
+        if (sizeMatches && rateMatches)
+        {
+            model = &candidate;
+        }
+    }
+
+    if (model == nullptr || !is_within(model->firstSection, model->sectionCount, header->sectionCount))
+    {
+        return false;
+    }
+
+    display_calibration found = {};
+
+    for (uint32_t i = model->firstSection; i < model->firstSection + model->sectionCount; ++i)
+    {
+        const calibration_package_section& section = sections[i];
+
+        // If a section lies outside the file or its values aren't aligned, then the whole model is rejected rather than applying part of it.
+        if (!is_within(section.offset, section.size, self->size) || section.offset % alignof(float) != 0)
+        {
+            return false;
+        }
+
+        const uint8_t* data = bytes + section.offset;
+
+        switch (section.type)
+        {
+            case calibration_section_distortion_mesh:
+            {
+                if (section.size < 2 * sizeof(uint32_t))
+                {
+                    return false;
+                }
+
+                const uint32_t* dimensions = reinterpret_cast<const uint32_t*>(data);
+
+                if (dimensions[0] < 2 || dimensions[0] > maxDistortionMeshSize ||
+                    dimensions[1] < 2 || dimensions[1] > maxDistortionMeshSize)
+                {
+                    return false;
+                }
+
+                const size_t count = static_cast<size_t>(dimensions[0]) * dimensions[1] * 2;
+                const float* coordinates = reinterpret_cast<const float*>(dimensions + 2);
+
+                if (section.size != 2 * sizeof(uint32_t) + count * sizeof(float) || !are_finite(coordinates, count))
+                {
+                    return false;
+                }
+
+                // Point into the mapping, and share its ownership, instead of copying the vertices.
+                found.distortionMesh.columns = static_cast<int>(dimensions[0]);
+                found.distortionMesh.rows = static_cast<int>(dimensions[1]);
+                found.distortionMesh.coordinates = std::shared_ptr<const float>(self, coordinates);
+                break;
+            }
+
+            case calibration_section_color_lut:
+            {
+                if (section.size < sizeof(calibration_color_lut_header))
+                {
+                    return false;
+                }
+
+                const calibration_color_lut_header* lutHeader = reinterpret_cast<const calibration_color_lut_header*>(data);
+
+                if (lutHeader->size < 2 || lutHeader->size > maxColorLutSize)
+                {
+                    return false;
+                }
+
+                const size_t count = static_cast<size_t>(lutHeader->size) * lutHeader->size * lutHeader->size * 4;
+                const float* entries = reinterpret_cast<const float*>(lutHeader + 1);
+
+                if (section.size != sizeof(calibration_color_lut_header) + count * sizeof(float) || !are_finite(entries, count))
+                {
+                    return false;
+                }
+
+                found.colorLut.size = static_cast<int>(lutHeader->size);
+                found.colorLut.entries = std::shared_ptr<const float>(self, entries);
+                break;
+            }
+
+            case calibration_section_occlusion:
+            {
+                const float* radii = reinterpret_cast<const float*>(data);
+
+                if (section.size != 2 * sizeof(float) || !is_valid_occlusion_radius(radii[0]) || !is_valid_occlusion_radius(radii[1]))
+                {
+                    return false;
+                }
+
+                found.hasOcclusion = true;
+                found.occlusion.radiusX = radii[0];
+                found.occlusion.radiusY = radii[1];
+                break;
+            }
+
+            case calibration_section_display_geometry:
+            {
+                const float* millimetres = reinterpret_cast<const float*>(data);
+
+                if (section.size != 2 * sizeof(float) || !are_finite(millimetres, 2) || millimetres[0] <= 0.0f || millimetres[1] <= 0.0f)
+                {
+                    return false;
+                }
+
+                found.hasGeometry = true;
+                found.geometry.width = millimetres[0];
+                found.geometry.height = millimetres[1];
+                break;
+            }
+
+            default:
+                // Skip the kinds of data that later versions of the tools may add.
+                break;
+        }
+    }
+
+    calibration = std::move(found);
+
+    return true;
+}
+
+/// @brief: Gets the path of the calibration package that was set.
+/// @returns: The path, which is empty if there is none.
+std::string get_calibration_package_path()
+{
+    std::lock_guard<std::mutex> guard(calibrationMutex);
+
+    return calibrationPackagePath;
+}
+
+/// @brief: Sets the physical size of the connected Ryz display, which @see ikinRyzGetDisplayGeometry returns.
+/// @param geometry The size, or null if it isn't known.
+void set_display_geometry(const display_geometry* geometry)
+{
+    std::lock_guard<std::mutex> guard(calibrationMutex);
+
+    hasDisplayGeometry = geometry != nullptr;
+
+    if (geometry != nullptr)
+    {
+        displayGeometry = *geometry;
+    }
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Sets the calibration package that the Ryz display is calibrated from.
+    /// @param path The path of the package, or null to stop using one.
+    EXPORT_API void ikinRyzSetCalibrationPackage(const char* path)
+    {
+        std::lock_guard<std::mutex> guard(calibrationMutex);
+
+        calibrationPackagePath = path != nullptr ? path : "";
+    }
+
+    /// @brief Gets the physical size of the connected Ryz display, from its calibration package.
+    /// @param width The width of the display in millimetres.
+    /// @param height The height of the display in millimetres.
+    /// @returns: 1 if the size is known, 0 if no display is connected or its calibration has no size.
+    EXPORT_API int ikinRyzGetDisplayGeometry(float* width, float* height)
+    {
+        if (width == nullptr || height == nullptr)
+        {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> guard(calibrationMutex);
+
+        if (!hasDisplayGeometry)
+        {
+            return 0;
+        }
+
+        *width = displayGeometry.width;
+        *height = displayGeometry.height;
+
+        return 1;
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,193 @@
+//
+//  ikin_ryz_calibration.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_CALIBRATION_H
+#define IKIN_RYZ_CALIBRATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ikin_ryz_color_lut.h"
+#include "ikin_ryz_distortion.h"
+#include "ikin_ryz_settings.h"
+
+/// @brief: The version of the calibration package layout that this plugin reads.
+const uint32_t calibrationPackageVersion = 1;
+
+/// @brief: The kinds of calibration data a calibration package section holds.
+enum calibration_section_type
+{
+    /// @brief: A @see distortion_mesh. Two uint32 values, the columns and rows, followed by the float x and y image coordinates of each vertex.
+    calibration_section_distortion_mesh = 1,
+
+    /// @brief: A @see color_lut. A uint32 size and 12 bytes of padding, followed by the red, green, blue and an unused float of each entry, in the order of a .cube file.
+    calibration_section_color_lut = 2,
+
+    /// @brief: The visible region of the Ryz eye, as an @see eye_occlusion_settings. Two floats, the radii of the visible ellipse, each less than @see occlusionMeshOuterRadius.
+    calibration_section_occlusion = 3,
+
+    /// @brief: The physical size of the display, as a @see display_geometry. Two floats, its width and height in millimetres.
+    calibration_section_display_geometry = 4
+};
+
+/// @brief: The header at the start of a calibration package.
+/// @remarks: A calibration package holds the calibration data of one or more display models in a single binary file, which is memory-mapped rather than parsed.
+/// The header is followed by the model table, then the section table, then the section data.
+/// All values are little-endian, and every section starts on a 4-byte boundary, so its values can be read where they lie.
+struct calibration_package_header
+{
+    /// @brief: The characters RYZC.
+    char magic[4];
+
+    /// @brief: The layout version. Must be @see calibrationPackageVersion.
+    uint32_t version;
+
+    /// @brief: The number of entries in the model table.
+    uint32_t modelCount;
+
+    /// @brief: The number of entries in the section table.
+    uint32_t sectionCount;
+};
+
+/// @brief: An entry of the model table, which identifies a display model and the sections that hold its calibration data.
+struct calibration_package_model
+{
+    /// @brief: The width of the display in pixels.
+    uint32_t width;
+
+    /// @brief: The height of the display in pixels.
+    uint32_t height;
+
+    /// @brief: The highest refresh rate of the display, or 0 to match any rate.
+    uint32_t refreshRate;
+
+    /// @brief: The index of the model's first section in the section table.
+    uint32_t firstSection;
+
+    /// @brief: The number of sections the model has.
+    uint32_t sectionCount;
+
+    /// @brief: Unused. Must be 0.
+    uint32_t reserved;
+};
+
+/// @brief: An entry of the section table, which locates a piece of calibration data in the package.
+struct calibration_package_section
+{
+    /// @brief: The @see calibration_section_type of the data.
+    uint32_t type;
+
+    /// @brief: Unused. Must be 0.
+    uint32_t reserved;
+
+    /// @brief: The distance of the data from the start of the package, in bytes.
+    uint64_t offset;
+
+    /// @brief: The size of the data, in bytes.
+    uint64_t size;
+};
+
+/// @brief: The physical size of a display.
+struct display_geometry
+{
+    /// @brief: The width of the display in millimetres.
+    float width;
+
+    /// @brief: The height of the display in millimetres.
+    float height;
+};
+
+/// @brief: The calibration data of one display model, read from a calibration package.
+/// @remarks: The mesh and table point into the mapped package, which they keep mapped for as long as they are in use.
+struct display_calibration
+{
+    /// @brief: The distortion mesh of the optics. Has no coordinates if the package has none for the model.
+    distortion_mesh distortionMesh;
+
+    /// @brief: The color lookup table of the panel. Has no entries if the package has none for the model.
+    color_lut colorLut;
+
+    /// @brief: A value indicating whether @see occlusion holds the visible region of the Ryz eye.
+    bool hasOcclusion;
+
+    /// @brief: The visible region of the Ryz eye.
+    eye_occlusion_settings occlusion;
+
+    /// @brief: A value indicating whether @see geometry holds the physical size of the display.
+    bool hasGeometry;
+
+    /// @brief: The physical size of the display.
+    display_geometry geometry;
+};
+
+/// @brief: A calibration package that is mapped into memory, read only.
+/// @remarks: Only the pages that are read are loaded, so looking up one model of a package that holds many costs little more than the model's own data.
+class calibration_package
+{
+public:
+    /// @brief: Maps a calibration package and checks that its tables are well formed.
+    /// @param path The path of the package.
+    /// @returns: The package, or null if it is missing or malformed.
+    static std::shared_ptr<calibration_package> open(const char* path);
+
+    /// @brief: Unmaps the package.
+    ~calibration_package();
+
+    /// @brief: Reads the calibration data of the first model that matches a display.
+    /// @param self The package, which the returned mesh and table keep mapped.
+    /// @param width The width of the display in pixels. The width and height are also matched the other way around.
+    /// @param height The height of the display in pixels.
+    /// @param refreshRate The highest refresh rate of the display.
+    /// @param calibration The calibration data of the model.
+    /// @returns: True if a model matched and its sections are well formed, otherwise false.
+    static bool find_display(const std::shared_ptr<calibration_package>& self, int width, int height, int refreshRate, display_calibration& calibration);
+
+private:
+    /// @brief: Wraps a mapping. Use @see open.
+    calibration_package(const uint8_t* bytes, size_t size);
+
+    /// @brief: The start of the mapping.
+    const uint8_t* bytes;
+
+    /// @brief: The size of the mapping, in bytes.
+    size_t size;
+};
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Sets the calibration package that the Ryz display is calibrated from.
+    /// @param path The path of the package, or null to stop using one.
+    /// @remarks: Nothing is read until a Ryz display is connected. The package is then mapped, and the model that matches the display is applied.
+    /// Its distortion mesh, color lookup table and visible region replace any that were set before.
+    EXPORT_API void ikinRyzSetCalibrationPackage(const char* path);
+
+    /// @brief Gets the physical size of the connected Ryz display, from its calibration package.
+    /// @param width The width of the display in millimetres.
+    /// @param height The height of the display in millimetres.
+    /// @returns: 1 if the size is known, 0 if no display is connected or its calibration has no size.
+    EXPORT_API int ikinRyzGetDisplayGeometry(float* width, float* height);
+
+#ifdef __cplusplus
+}
+#endif
+
+/// @brief: Gets the path of the calibration package that was set.
+/// @returns: The path, which is empty if there is none.
+std::string get_calibration_package_path();
+
+/// @brief: Sets the physical size of the connected Ryz display, which @see ikinRyzGetDisplayGeometry returns.
+/// @param geometry The size, or null if it isn't known.
+void set_display_geometry(const display_geometry* geometry);
+
+#endif
@@ -0,0 +1,468 @@
+//
+//  ikin_ryz_capture.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_capture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ikin_ryz_frame_stats.h"
+#include "ikin_ryz_timeline.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: A capture sink, and the eyes it wants.
+    struct capture_sink
+    {
+        int eyeMask;
+        std::function<CaptureSinkDelegate> sink;
+    };
+
+    /// @brief: A captured frame that is waiting for the capture thread.
+    struct pending_frame
+    {
+        captured_frame frame;
+        std::function<void()> done;
+    };
+
+    /// @brief: Hands the captured frames to the sinks on a thread of its own, so that neither the render thread nor the GPU's completion handlers wait for them.
+    class capture_worker
+    {
+    public:
+        /// @brief: Stops the thread, once it has handed on the frames that are waiting.
+        ~capture_worker()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                stopping = true;
+            }
+
+            available.notify_one();
+
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+        }
+
+        /// @brief: Queues a frame for the sinks, starting the thread if it hasn't been started.
+        /// @param frame The frame and the function that gives its memory back.
+        void push(pending_frame frame)
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+
+                if (!thread.joinable())
+                {
+                    thread = std::thread(&capture_worker::run, this);
+                    threadId = thread.get_id();
+                }
+
+                frames.push_back(std::move(frame));
+            }
+
+            available.notify_one();
+        }
+
+        /// @brief: The sinks, indexed by their IDs. A removed sink is left empty so that the other IDs stay the same, until a new sink takes its slot.
+        std::vector<capture_sink> sinks;
+
+        /// @brief: Guards @see sinks.
+        std::mutex sinksMutex;
+
+        /// @brief: Held while the sinks run, so that a sink can be removed knowing it isn't running.
+        std::mutex dispatchMutex;
+
+        /// @brief: The ID of the capture thread, so that a sink that removes itself doesn't wait for itself.
+        std::atomic<std::thread::id> threadId;
+
+    private:
+        /// @brief: Hands each frame to the sinks that want it, then gives its memory back.
+        void run()
+        {
+            name_timeline_thread("Ryz capture");
+
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (true)
+            {
+                available.wait(lock, [this] { return stopping || !frames.empty(); });
+
+                if (frames.empty())
+                {
+                    return;
+                }
+
+                pending_frame pending = std::move(frames.front());
+                frames.pop_front();
+
+                lock.unlock();
+
+                const auto start = std::chrono::steady_clock::now();
+
+                std::unique_lock<std::mutex> dispatchLock(dispatchMutex);
+
+                // Copy the sinks that want the frame, so that a sink can remove itself, or another, while it runs.
+                std::vector<std::function<CaptureSinkDelegate>> frameSinks;
+
+                {
+                    std::lock_guard<std::mutex> guard(sinksMutex);
+
+                    for (const capture_sink& sink : sinks)
+                    {
+                        if (sink.sink != nullptr && (sink.eyeMask & (1 << pending.frame.eye)) != 0)
+                        {
+                            frameSinks.push_back(sink.sink);
+                        }
+                    }
+                }
+
+                timeline_begin("Deliver captured frame");
+
+                for (const std::function<CaptureSinkDelegate>& sink : frameSinks)
+                {
+                    sink(pending.frame);
+                }
+
+                timeline_end("Deliver captured frame");
+
+                // Release the copies before the lock, so that what a removed sink holds is released by the time it is removed.
+                frameSinks.clear();
+                dispatchLock.unlock();
+
+                pending.done();
+
+                const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                frameStatsCounters.captureWorkerMicrosecondsLastFrame.store(elapsed.count(), std::memory_order_relaxed);
+
+                lock.lock();
+            }
+        }
+
+        /// @brief: The frames that are waiting, oldest first. Never more than the staging buffers that hold them.
+        std::deque<pending_frame> frames;
+
+        /// @brief: A value indicating whether the thread has been asked to stop.
+        bool stopping = false;
+
+        /// @brief: Guards @see frames and @see stopping.
+        std::mutex mutex;
+
+        /// @brief: Signals the thread when a frame is queued or it is asked to stop.
+        std::condition_variable available;
+
+        /// @brief: The thread, which is started when the first frame is captured.
+        std::thread thread;
+    };
+
+    /// @brief: The capture thread and the sinks.
+    capture_worker captureWorker;
+
+    /// @brief: The eyes that the sinks want, which the render thread reads every frame.
+    std::atomic<int> captureEyeMask(0);
+
+    /// @brief: Works out the eyes the sinks want. The caller has to hold the sinks' mutex.
+    void update_capture_eye_mask()
+    {
+        int eyeMask = 0;
+
+        for (const capture_sink& sink : captureWorker.sinks)
+        {
+            if (sink.sink != nullptr)
+            {
+                eyeMask |= sink.eyeMask;
+            }
+        }
+
+        captureEyeMask.store(eyeMask, std::memory_order_relaxed);
+    }
+
+    /// @brief: Adds a sink in the first slot a removed sink left empty, or after the others if there is none. The caller has to hold the sinks' mutex.
+    /// @param sink The sink.
+    /// @returns: The ID of the sink, which is its slot.
+    /// @remarks: Reusing the slots keeps the sinks from growing with every screenshot or recording, which the capture thread walks for every frame.
+    int insert_capture_sink(capture_sink sink)
+    {
+        std::vector<capture_sink>& sinks = captureWorker.sinks;
+
+        const auto emptySlot = std::find_if(sinks.begin(), sinks.end(), [](const capture_sink& slot) { return slot.sink == nullptr; });
+
+        if (emptySlot != sinks.end())
+        {
+            *emptySlot = std::move(sink);
+            return (int)(emptySlot - sinks.begin());
+        }
+
+        sinks.push_back(std::move(sink));
+        return (int)sinks.size() - 1;
+    }
+
+    /// @brief: Writes a big-endian 32-bit value.
+    /// @param bytes The bytes it is appended to.
+    /// @param value The value.
+    void append_big_endian(std::vector<uint8_t>& bytes, uint32_t value)
+    {
+        bytes.push_back((uint8_t)(value >> 24));
+        bytes.push_back((uint8_t)(value >> 16));
+        bytes.push_back((uint8_t)(value >> 8));
+        bytes.push_back((uint8_t)value);
+    }
+
+    /// @brief: Updates the CRC-32 of a PNG chunk with some bytes.
+    /// @param crc The CRC so far, which starts at 0xFFFFFFFF.
+    /// @param bytes The bytes.
+    /// @param count The number of bytes.
+    /// @returns: The updated CRC.
+    uint32_t update_crc(uint32_t crc, const uint8_t* bytes, size_t count)
+    {
+        static const std::vector<uint32_t> table = []
+        {
+            std::vector<uint32_t> values(256);
+
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+
+                for (int k = 0; k < 8; ++k)
+                {
+                    c = (c & 1) != 0 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+
+                values[n] = c;
+            }
+
+            return values;
+        }();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return crc;
+    }
+
+    /// @brief: Writes a PNG chunk.
+    /// @param file The file.
+    /// @param type The four characters of the chunk type.
+    /// @param data The data of the chunk.
+    /// @returns: True if the chunk was written, otherwise false.
+    bool write_png_chunk(FILE* file, const char* type, const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> header;
+        append_big_endian(header, (uint32_t)data.size());
+        header.insert(header.end(), type, type + 4);
+
+        uint32_t crc = update_crc(0xFFFFFFFFu, header.data() + 4, 4);
+        crc = update_crc(crc, data.data(), data.size());
+
+        std::vector<uint8_t> footer;
+        append_big_endian(footer, crc ^ 0xFFFFFFFFu);
+
+        return fwrite(header.data(), 1, header.size(), file) == header.size() &&
+            fwrite(data.data(), 1, data.size(), file) == data.size() &&
+            fwrite(footer.data(), 1, footer.size(), file) == footer.size();
+    }
+}
+
+/// @brief: Adds a function that is handed the captured frames of some eyes.
+/// @param eyeMask The eyes the function is handed frames of, as a bit for each @see eye_index.
+/// @param sink The function. It runs on the capture thread, which it holds up while it runs, so it should hand slow work on.
+/// @returns: The ID of the sink, which removes it.
+int add_capture_sink(int eyeMask, std::function<CaptureSinkDelegate> sink)
+{
+    std::lock_guard<std::mutex> guard(captureWorker.sinksMutex);
+
+    const int sinkId = insert_capture_sink({ eyeMask & ((1 << eye_count) - 1), std::move(sink) });
+    update_capture_eye_mask();
+
+    return sinkId;
+}
+
+/// @brief: Removes a capture sink. It is not handed any frames once this returns, unless this is called from the sink itself.
+/// @param sinkId The ID of the sink.
+void remove_capture_sink(int sinkId)
+{
+    {
+        std::lock_guard<std::mutex> guard(captureWorker.sinksMutex);
+
+        if (sinkId < 0 || sinkId >= (int)captureWorker.sinks.size())
+        {
+            return;
+        }
+
+        captureWorker.sinks[sinkId] = {};
+        update_capture_eye_mask();
+    }
+
+    // Wait for the sinks that are running to return, unless this is one of them.
+    if (std::this_thread::get_id() != captureWorker.threadId.load())
+    {
+        std::lock_guard<std::mutex> guard(captureWorker.dispatchMutex);
+    }
+}
+
+/// @brief: Gets the eyes that capture sinks want frames of.
+/// @returns: A bit for each @see eye_index.
+int get_capture_eye_mask()
+{
+    return captureEyeMask.load(std::memory_order_relaxed);
+}
+
+/// @brief: Hands a captured frame to the capture thread, which hands it to the sinks.
+/// @param frame The frame.
+/// @param done Called on the capture thread once the sinks are done with the pixels, so that their memory can be used again.
+void deliver_captured_frame(const captured_frame& frame, std::function<void()> done)
+{
+    captureWorker.push({ frame, std::move(done) });
+}
+
+/// @brief: Writes an image to a PNG file.
+/// @param path The path of the file.
+/// @param pixels The 8-bit BGRA pixels, top row first. The alpha is left out, since what a display shows is opaque.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param bytesPerRow The distance between the starts of two rows of pixels, in bytes.
+/// @returns: True if the file was written, otherwise false.
+bool write_png(const char* path, const uint8_t* pixels, int width, int height, size_t bytesPerRow)
+{
+    if (path == nullptr || pixels == nullptr || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    FILE* file = fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    // 8-bit RGB, without interlacing.
+    std::vector<uint8_t> header;
+    append_big_endian(header, (uint32_t)width);
+    append_big_endian(header, (uint32_t)height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });
+
+    // Each row starts with its filter type, which is none, followed by its pixels in RGB order.
+    const size_t rowSize = 1 + (size_t)width * 3;
+    std::vector<uint8_t> raw(rowSize * height);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* source = pixels + y * bytesPerRow;
+        uint8_t* destination = raw.data() + y * rowSize;
+
+        *destination++ = 0;
+
+        for (int x = 0; x < width; ++x, source += 4)
+        {
+            *destination++ = source[2];
+            *destination++ = source[1];
+            *destination++ = source[0];
+        }
+    }
+
+    // Wrap the rows in a zlib stream of stored deflate blocks, each of which holds up to 65535 bytes.
+    std::vector<uint8_t> data = { 0x78, 0x01 };
+    data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+
+    for (size_t offset = 0; offset < raw.size() || offset == 0; )
+    {
+        const size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+        const bool lastBlock = offset + blockSize == raw.size();
+
+        data.push_back(lastBlock ? 1 : 0);
+        data.push_back((uint8_t)blockSize);
+        data.push_back((uint8_t)(blockSize >> 8));
+        data.push_back((uint8_t)~blockSize);
+        data.push_back((uint8_t)(~blockSize >> 8));
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+        for (size_t i = offset; i < offset + blockSize; ++i)
+        {
+            adlerA = (adlerA + raw[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+
+        offset += blockSize;
+
+        if (lastBlock)
+        {
+            break;
+        }
+    }
+
+    append_big_endian(data, (adlerB << 16) | adlerA);
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    const bool written = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+        write_png_chunk(file, "IHDR", header) &&
+        write_png_chunk(file, "IDAT", data) &&
+        write_png_chunk(file, "IEND", {});
+
+    return fclose(file) == 0 && written;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Saves the next frame of an eye to a PNG file.
+    /// @param eye The eye that is captured. @see eye_index.
+    /// @param path The path of the file.
+    /// @returns: 1 if the capture was requested, 0 if the eye doesn't exist or the path is empty.
+    EXPORT_API int ikinRyzCaptureScreenshot(int eye, const char* path)
+    {
+        // Ignore requests for eyes that don't exist.
+        if (eye < main_eye || eye >= eye_count || path == nullptr || path[0] == '\0')
+        {
+            return 0;
+        }
+
+        // The sink removes itself once it has written a frame. Frames that were already in flight by then are ignored.
+        std::shared_ptr<std::atomic<bool>> written = std::make_shared<std::atomic<bool>>(false);
+        std::shared_ptr<int> sinkId = std::make_shared<int>(-1);
+        const std::string filePath = path;
+
+        std::lock_guard<std::mutex> guard(captureWorker.sinksMutex);
+
+        *sinkId = insert_capture_sink({ 1 << eye, [=](const captured_frame& frame)
+        {
+            if (written->exchange(true))
+            {
+                return;
+            }
+
+            write_png(filePath.c_str(), frame.pixels, frame.width, frame.height, frame.bytesPerRow);
+
+            remove_capture_sink(*sinkId);
+        } });
+
+        update_capture_eye_mask();
+
+        return 1;
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,98 @@
+//
+//  ikin_ryz_capture.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_CAPTURE_H
+#define IKIN_RYZ_CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "ikin_ryz_settings.h"
+
+/// @brief: A frame that was copied off the GPU, which the capture sinks are handed on the capture thread.
+/// @remarks: The pixels are 8-bit BGRA, and are only valid until the sink returns.
+struct captured_frame
+{
+    /// @brief: The eye the frame was captured from. @see eye_index.
+    int eye;
+
+    /// @brief: The width of the frame in pixels.
+    int width;
+
+    /// @brief: The height of the frame in pixels.
+    int height;
+
+    /// @brief: The distance between the starts of two rows of pixels, in bytes.
+    size_t bytesPerRow;
+
+    /// @brief: The pixels, top row first.
+    const uint8_t* pixels;
+
+    /// @brief: The number of the submitted frame the pixels are from, which counts up from 1.
+    uint64_t frameIndex;
+
+    /// @brief: The time the GPU finished copying the frame, in seconds, on a steady clock.
+    double captureTime;
+};
+
+/// @brief: Handles a captured frame on the capture thread.
+typedef void CaptureSinkDelegate(const captured_frame& frame);
+
+/// @brief: Adds a function that is handed the captured frames of some eyes.
+/// @param eyeMask The eyes the function is handed frames of, as a bit for each @see eye_index.
+/// @param sink The function. It runs on the capture thread, which it holds up while it runs, so it should hand slow work on.
+/// @returns: The ID of the sink, which removes it.
+/// @remarks: The eyes are only copied off the GPU while a sink wants them, so capture costs nothing when no sink has been added.
+/// The ID of a removed sink is given to the next sink that is added, so a sink must only be removed once.
+int add_capture_sink(int eyeMask, std::function<CaptureSinkDelegate> sink);
+
+/// @brief: Removes a capture sink. It is not handed any frames once this returns, unless this is called from the sink itself.
+/// @param sinkId The ID of the sink.
+void remove_capture_sink(int sinkId);
+
+/// @brief: Gets the eyes that capture sinks want frames of.
+/// @returns: A bit for each @see eye_index.
+int get_capture_eye_mask();
+
+/// @brief: Hands a captured frame to the capture thread, which hands it to the sinks.
+/// @param frame The frame.
+/// @param done Called on the capture thread once the sinks are done with the pixels, so that their memory can be used again.
+/// @remarks: Called from the GPU's completion handlers, so this never waits for the capture thread.
+void deliver_captured_frame(const captured_frame& frame, std::function<void()> done);
+
+/// @brief: Writes an image to a PNG file.
+/// @param path The path of the file.
+/// @param pixels The 8-bit BGRA pixels, top row first. The alpha is left out, since what a display shows is opaque.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param bytesPerRow The distance between the starts of two rows of pixels, in bytes.
+/// @returns: True if the file was written, otherwise false.
+/// @remarks: The image data is stored rather than compressed, which is larger but fast enough to keep up with the display on the capture thread.
+bool write_png(const char* path, const uint8_t* pixels, int width, int height, size_t bytesPerRow);
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Saves the next frame of an eye to a PNG file.
+    /// @param eye The eye that is captured. @see eye_index.
+    /// @param path The path of the file.
+    /// @returns: 1 if the capture was requested, 0 if the eye doesn't exist or the path is empty.
+    /// @remarks: The Ryz eye is captured as it is presented, with its orientation, calibration and composition layers applied.
+    /// The main eye is captured as it was rendered, and only while it is rendered in an 8-bit format.
+    /// The frame is copied off the GPU without the render thread waiting for it, and is encoded on the capture thread.
+    EXPORT_API int ikinRyzCaptureScreenshot(int eye, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+//
+//  ikin_ryz_capture_ring.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_CAPTURE_RING_H
+#define IKIN_RYZ_CAPTURE_RING_H
+
+#import <Metal/Metal.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "ikin_ryz_capture.h"
+
+/// @brief: The number of staging buffers that captured frames are copied into.
+/// @remarks: One is written by the GPU while another is read by the capture thread, and a third covers a frame that completes before the thread is done.
+const int captureRingSize = 3;
+
+/// @brief: Copies the eyes that the capture sinks want off the GPU, without the render thread ever waiting for the copies.
+/// @remarks: Each captured frame is copied into a free staging buffer in Unity's command buffer.
+/// When the command buffer completes, the buffer is handed to the capture thread, and it is free again once the sinks are done with it.
+/// If no buffer is free, then the frame isn't captured, rather than the render thread waiting for one.
+class ikin_ryz_capture_ring
+{
+public:
+    /// @brief: Starts counting the capture cost of a new frame.
+    void begin_frame();
+
+    /// @brief: Encodes a copy of a texture into a free staging buffer, if a sink wants the eye it shows.
+    /// @param commandBuffer The command buffer the copy is encoded into. The texture has to be complete by the time the copy runs.
+    /// @param eye The eye the texture shows. @see eye_index.
+    /// @param source The texture, which has to be 8-bit BGRA.
+    /// @param region The region of the texture that shows the eye, in pixels.
+    /// @param frameIndex The number of the submitted frame.
+    void encode(id<MTLCommandBuffer> commandBuffer, int eye, id<MTLTexture> source, const MTLRegion& region, uint64_t frameIndex);
+
+    /// @brief: Releases the staging buffers. The buffers that are still in use are released once they are done with.
+    void release();
+
+    /// @brief: Gets the memory held by the staging buffers.
+    /// @returns: The size of the buffers in bytes, or zero if no frame has been captured.
+    uint64_t allocated_bytes() const;
+
+private:
+    /// @brief: The staging buffers, which are made or grown the first time a frame needs them.
+    id<MTLBuffer> stagingBuffers[captureRingSize];
+
+    /// @brief: A value indicating whether each staging buffer is waiting for the GPU or the capture thread.
+    std::atomic<bool> stagingBuffersBusy[captureRingSize];
+
+    /// @brief: The bytes copied off the GPU so far this frame.
+    uint64_t frameBytes;
+
+    /// @brief: The time the render thread spent encoding copies so far this frame, in microseconds.
+    uint64_t frameMicroseconds;
+};
+
+#endif
@@ -0,0 +1,155 @@
+//
+//  ikin_ryz_capture_ring.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_capture_ring.h"
+
+#include <chrono>
+
+#include "ikin_ryz_frame_stats.h"
+
+/// @brief: Starts counting the capture cost of a new frame.
+void ikin_ryz_capture_ring::begin_frame()
+{
+    frameBytes = 0;
+    frameMicroseconds = 0;
+
+    frameStatsCounters.captureBytesLastFrame.store(0, std::memory_order_relaxed);
+    frameStatsCounters.captureRenderMicrosecondsLastFrame.store(0, std::memory_order_relaxed);
+}
+
+/// @brief: Encodes a copy of a texture into a free staging buffer, if a sink wants the eye it shows.
+/// @param commandBuffer The command buffer the copy is encoded into. The texture has to be complete by the time the copy runs.
+/// @param eye The eye the texture shows. @see eye_index.
+/// @param source The texture, which has to be 8-bit BGRA.
+/// @param region The region of the texture that shows the eye, in pixels.
+/// @param frameIndex The number of the submitted frame.
+void ikin_ryz_capture_ring::encode(id<MTLCommandBuffer> commandBuffer, int eye, id<MTLTexture> source, const MTLRegion& region, uint64_t frameIndex)
+{
+    // If no sink wants the eye, then capturing it costs nothing.
+    if (source == nil || (get_capture_eye_mask() & (1 << eye)) == 0)
+    {
+        return;
+    }
+
+    // The sinks are handed 8-bit BGRA pixels, which is what the Ryz display presents and what the eyes are usually rendered in.
+    if (source.pixelFormat != MTLPixelFormatBGRA8Unorm && source.pixelFormat != MTLPixelFormatBGRA8Unorm_sRGB)
+    {
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    int slot = 0;
+
+    while (slot < captureRingSize && stagingBuffersBusy[slot].load(std::memory_order_acquire))
+    {
+        ++slot;
+    }
+
+    // If every buffer is still in use, then drop the frame rather than wait for one.
+    if (slot == captureRingSize)
+    {
+        frameStatsCounters.captureFramesDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const NSUInteger width = region.size.width;
+    const NSUInteger height = region.size.height;
+    const NSUInteger bytesPerRow = width * 4;
+    const NSUInteger length = bytesPerRow * height;
+
+    // The buffer is read by the CPU once the GPU is done with it, so it lives in shared memory.
+    if (stagingBuffers[slot] == nil || stagingBuffers[slot].length < length)
+    {
+        stagingBuffers[slot] = [commandBuffer.device newBufferWithLength : length
+                                                                 options : MTLResourceStorageModeShared];
+
+        if (stagingBuffers[slot] == nil)
+        {
+            return;
+        }
+    }
+
+    stagingBuffersBusy[slot].store(true, std::memory_order_relaxed);
+
+    id<MTLBuffer> stagingBuffer = stagingBuffers[slot];
+    std::atomic<bool>* busy = &stagingBuffersBusy[slot];
+
+    id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+
+    [blitEncoder copyFromTexture : source
+                     sourceSlice : 0
+                     sourceLevel : 0
+                    sourceOrigin : region.origin
+                      sourceSize : MTLSizeMake(width, height, 1)
+                        toBuffer : stagingBuffer
+               destinationOffset : 0
+          destinationBytesPerRow : bytesPerRow
+        destinationBytesPerImage : length];
+
+    [blitEncoder endEncoding];
+
+    // Hand the buffer to the capture thread once the copy is done. Nothing waits for it in the meantime.
+    [commandBuffer addCompletedHandler : ^(id<MTLCommandBuffer> completedBuffer)
+    {
+        if (completedBuffer.status != MTLCommandBufferStatusCompleted)
+        {
+            busy->store(false, std::memory_order_release);
+            return;
+        }
+
+        const captured_frame frame =
+        {
+            eye,
+            (int)width,
+            (int)height,
+            bytesPerRow,
+            static_cast<const uint8_t*>(stagingBuffer.contents),
+            frameIndex,
+            std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count()
+        };
+
+        // The closure keeps the buffer alive until the sinks are done, even if the ring has been released since.
+        deliver_captured_frame(frame, [stagingBuffer, busy]
+        {
+            busy->store(false, std::memory_order_release);
+        });
+    }];
+
+    frameBytes += length;
+    frameMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    frameStatsCounters.captureFrames.fetch_add(1, std::memory_order_relaxed);
+    frameStatsCounters.captureBytesLastFrame.store(frameBytes, std::memory_order_relaxed);
+    frameStatsCounters.captureRenderMicrosecondsLastFrame.store(frameMicroseconds, std::memory_order_relaxed);
+}
+
+/// @brief: Releases the staging buffers. The buffers that are still in use are released once they are done with.
+void ikin_ryz_capture_ring::release()
+{
+    for (int slot = 0; slot < captureRingSize; ++slot)
+    {
+        stagingBuffers[slot] = nil;
+    }
+}
+
+/// @brief: Gets the memory held by the staging buffers.
+/// @returns: The size of the buffers in bytes, or zero if no frame has been captured.
+uint64_t ikin_ryz_capture_ring::allocated_bytes() const
+{
+    uint64_t bytes = 0;
+
+    for (int slot = 0; slot < captureRingSize; ++slot)
+    {
+        if (stagingBuffers[slot] != nil)
+        {
+            bytes += stagingBuffers[slot].length;
+        }
+    }
+
+    return bytes;
+}
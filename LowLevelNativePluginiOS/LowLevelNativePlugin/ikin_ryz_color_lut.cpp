@@ -0,0 +1,200 @@
+//
+//  ikin_ryz_color_lut.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_color_lut.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ikin_ryz_pixel_simd.h"
+
+using namespace pixel_simd;
+
+/// @brief: Loads a color lookup table from a calibration file in the .cube format.
+/// @param path The path of the file.
+/// @param lut The table that is loaded. Left unchanged if the file can't be loaded.
+/// @returns: True if the table was loaded, false if the file is missing or malformed.
+bool load_color_lut(const char* path, color_lut& lut)
+{
+    std::ifstream file(path);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    color_lut loaded = {};
+    std::shared_ptr<std::vector<float>> entries = std::make_shared<std::vector<float>>();
+    size_t entryCount = 0;
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream values(line);
+        std::string keyword;
+
+        // Skip blank lines and comments.
+        if (!(values >> keyword) || keyword[0] == '#')
+        {
+            continue;
+        }
+
+        if (keyword == "TITLE")
+        {
+            continue;
+        }
+
+        if (keyword == "LUT_3D_SIZE")
+        {
+            if (!(values >> loaded.size) || loaded.size < 2 || loaded.size > maxColorLutSize)
+            {
+                return false;
+            }
+
+            entries->resize((size_t)loaded.size * loaded.size * loaded.size * 4);
+            continue;
+        }
+
+        if (keyword == "DOMAIN_MIN" || keyword == "DOMAIN_MAX")
+        {
+            // If the domain isn't the default, then the colors would have to be rescaled before they are looked up.
+            const float expected = keyword == "DOMAIN_MIN" ? 0.0f : 1.0f;
+            float bound[3];
+
+            if (!(values >> bound[0] >> bound[1] >> bound[2]) ||
+                bound[0] != expected || bound[1] != expected || bound[2] != expected)
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        // Anything else has to be an entry, after the size has been given. 1D tables and unknown keywords are rejected here.
+        const size_t entry = entryCount++;
+
+        if (entry >= entries->size() / 4)
+        {
+            return false;
+        }
+
+        float* output = entries->data() + entry * 4;
+
+        if (!(std::istringstream(keyword) >> output[0]) ||
+            !(values >> output[1] >> output[2]))
+        {
+            return false;
+        }
+
+        output[3] = 1.0f;
+    }
+
+    // If any entry is missing, then the whole file is rejected rather than tinting part of the image.
+    if (loaded.size == 0 || entryCount != entries->size() / 4)
+    {
+        return false;
+    }
+
+    loaded.entries = std::shared_ptr<const float>(entries, entries->data());
+
+    lut = std::move(loaded);
+
+    return true;
+}
+
+/// @brief: Maps each pixel of a BGRA image through a color lookup table.
+/// @param pixels The first row of the image, which is mapped in place.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param bytesPerRow The distance between the start of two rows of the image, in bytes.
+/// @param lut The color lookup table.
+void apply_color_lut(uint8_t* pixels, int width, int height, size_t bytesPerRow, const color_lut& lut)
+{
+    const float size = (float)lut.size;
+    const float* entries = lut.entries.get();
+
+    // The distance between neighbouring entries along the red, green and blue axes, and between the first and last corners of a cell.
+    const lanes redStride = splat(1.0f);
+    const lanes greenStride = splat(size);
+    const lanes blueStride = splat(size * size);
+    const lanes cellStride = splat(1.0f + size + size * size);
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            uint8_t* first = pixels + y * bytesPerRow + x * 4;
+            const int count = std::min(width - x, 4);
+            const pixel_lanes pixel = read_pixels(first, count);
+
+            // Find the cell of the table that holds each color, and where in the cell it is.
+            lanes base[3];
+            lanes fraction[3];
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const lanes position = multiply(pixel.channel[2 - axis], splat(size - 1.0f));
+
+                base[axis] = minimum(round_down(position), splat(size - 2.0f));
+                fraction[axis] = subtract(position, base[axis]);
+            }
+
+            const lanes& red = fraction[0];
+            const lanes& green = fraction[1];
+            const lanes& blue = fraction[2];
+
+            // Pick the tetrahedron of each cell that holds the color, from the order of its fractions.
+            // Each one runs from the first corner of the cell to the last, stepping along the axes from the largest fraction to the smallest.
+            const lanes largest = maximum(maximum(red, green), blue);
+            const lanes smallest = minimum(minimum(red, green), blue);
+            const lanes middle = maximum(minimum(red, green), minimum(maximum(red, green), blue));
+
+            const lane_mask redAtLeastGreen = greater_or_equal(red, green);
+            const lane_mask redLargest = both(redAtLeastGreen, greater_or_equal(red, blue));
+            const lanes largestStride = select(redLargest, redStride, select(greater(green, blue), greenStride, blueStride));
+
+            const lane_mask blueSmallest = either(both(redAtLeastGreen, greater_or_equal(green, blue)), both(less(red, green), less(blue, red)));
+            const lane_mask greenSmallest = both(redAtLeastGreen, greater(blue, green));
+            const lanes smallestStride = select(blueSmallest, blueStride, select(greenSmallest, greenStride, redStride));
+
+            // The corners are counted in entries, which stay well within the whole numbers a float holds exactly.
+            const lanes firstCorner = add(add(base[0], multiply(base[1], greenStride)), multiply(base[2], blueStride));
+            const lanes lastCorner = add(firstCorner, cellStride);
+
+            int32_t corners[4][4];
+            store_integers(multiply(firstCorner, splat(4.0f)), corners[0]);
+            store_integers(multiply(add(firstCorner, largestStride), splat(4.0f)), corners[1]);
+            store_integers(multiply(subtract(lastCorner, smallestStride), splat(4.0f)), corners[2]);
+            store_integers(multiply(lastCorner, splat(4.0f)), corners[3]);
+
+            // Blend the corners of the tetrahedrons.
+            const lanes weights[4] = { subtract(splat(1.0f), largest), subtract(largest, middle), subtract(middle, smallest), smallest };
+            lanes mapped[3] = { splat(0.0f), splat(0.0f), splat(0.0f) };
+
+            for (int corner = 0; corner < 4; ++corner)
+            {
+                // Load each pixel's entry for this corner, and transpose them into a vector of each of red, green and blue.
+                lanes entry[4] = { load(entries + corners[corner][0]), load(entries + corners[corner][1]),
+                                   load(entries + corners[corner][2]), load(entries + corners[corner][3]) };
+                transpose(entry[0], entry[1], entry[2], entry[3]);
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    mapped[axis] = add(mapped[axis], multiply(entry[axis], weights[corner]));
+                }
+            }
+
+            // Write the colors back in BGRA order, keeping the alpha.
+            const pixel_lanes output = { { mapped[2], mapped[1], mapped[0], pixel.channel[3] } };
+
+            write_pixels(first, output, count);
+        }
+    }
+}
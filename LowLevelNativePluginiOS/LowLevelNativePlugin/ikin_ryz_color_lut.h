@@ -0,0 +1,50 @@
+//
+//  ikin_ryz_color_lut.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_COLOR_LUT_H
+#define IKIN_RYZ_COLOR_LUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// @brief: The most entries a color lookup table can have along each axis.
+const int maxColorLutSize = 65;
+
+/// @brief: A 3D table that maps each color the Ryz image holds to the color the Ryz panel has to be driven with to show it accurately.
+/// @remarks: Measured for each device and loaded from its calibration file.
+/// Colors between the entries are interpolated tetrahedrally, which keeps greys grey and costs four entries rather than eight.
+struct color_lut
+{
+    /// @brief: The number of entries along each of the red, green and blue axes.
+    int size;
+
+    /// @brief: The output color of each entry, as red, green, blue and an unused fourth value that keeps the entries aligned for vector loads.
+    /// @remarks: Red changes fastest, then green, then blue, the same as in a .cube file. Values are normalized.
+    /// Shares ownership of whatever holds them, which is either the parsed file or the mapped calibration package, so they are never copied.
+    std::shared_ptr<const float> entries;
+};
+
+/// @brief: Loads a color lookup table from a calibration file in the .cube format.
+/// @param path The path of the file.
+/// @param lut The table that is loaded. Left unchanged if the file can't be loaded.
+/// @returns: True if the table was loaded, false if the file is missing or malformed.
+/// @remarks: Only 3D tables over the default domain of 0 to 1 are supported, from 2 to @see maxColorLutSize entries along each axis.
+bool load_color_lut(const char* path, color_lut& lut);
+
+/// @brief: Maps each pixel of a BGRA image through a color lookup table.
+/// @param pixels The first row of the image, which is mapped in place.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param bytesPerRow The distance between the start of two rows of the image, in bytes.
+/// @param lut The color lookup table.
+/// @remarks: This is the CPU reference of the color calibration the compose pass applies, and follows the same steps.
+/// BGRA is the layout of the Ryz drawables. Alpha is left as it is.
+/// Four pixels are mapped at a time, with a lane of an SSE2 or NEON vector for each when the compiler targets them.
+void apply_color_lut(uint8_t* pixels, int width, int height, size_t bytesPerRow, const color_lut& lut);
+
+#endif
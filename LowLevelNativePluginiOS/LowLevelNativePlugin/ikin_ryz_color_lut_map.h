@@ -0,0 +1,68 @@
+//
+//  ikin_ryz_color_lut_map.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_COLOR_LUT_MAP_H
+#define IKIN_RYZ_COLOR_LUT_MAP_H
+
+#import <Metal/Metal.h>
+
+#include "ikin_ryz_color_lut.h"
+#include "native_to_unity_notifiers.h"
+
+/// @brief: The Metal source of the function that maps a color through the color lookup table, which the compose shaders are compiled with.
+/// @remarks: The table is only read when the colorCalibration function constant is true, so each pass is compiled with and without it.
+extern const char* const colorLutShaderSource;
+
+/// @brief: Keeps the color lookup table of the Ryz panel in a 3D texture the compose passes can read.
+class ikin_ryz_color_lut_map
+{
+public:
+    /// @brief: Uploads the color lookup table if a different one has been loaded since it was last uploaded.
+    /// @param device The Metal device that Unity renders with.
+    /// @returns: The texture that holds the table, or nil if there is no table and the image is drawn without color calibration.
+    id<MTLTexture> update(id<MTLDevice> device);
+
+    /// @brief: Releases the texture, so that the table is uploaded again the next time it is needed.
+    void release();
+
+    /// @brief: Gets the memory held by the texture that holds the table.
+    /// @returns: The size of the texture in bytes, or zero if there is none.
+    uint64_t allocated_bytes() const;
+
+private:
+    /// @brief: The texture that holds the table, or nil if there is none.
+    id<MTLTexture> lutTexture;
+
+    /// @brief: The version of the loaded table that @see lutTexture holds.
+    int uploadedVersion;
+};
+
+/// @brief: Sets the color lookup table that the Ryz image is calibrated with from the next frame.
+/// @param lut The table, or a table without entries to stop calibrating colors.
+void set_color_lut(const color_lut& lut);
+
+/// @brief: Gets the color lookup table that the Ryz image is calibrated with.
+/// @returns: The table, which has no entries if colors aren't being calibrated.
+color_lut get_color_lut();
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Loads the color lookup table of the connected Ryz panel from a calibration file, and calibrates the Ryz image with it from the next frame.
+    /// @param path The path of the .cube calibration file. @see load_color_lut. Null or empty to stop calibrating colors.
+    /// @returns: 1 if the table was loaded or cleared, 0 if the file couldn't be loaded, in which case the current table is kept.
+    EXPORT_API int ikinRyzLoadColorLut(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
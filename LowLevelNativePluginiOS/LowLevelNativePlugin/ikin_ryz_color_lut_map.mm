@@ -0,0 +1,196 @@
+//
+//  ikin_ryz_color_lut_map.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_color_lut_map.h"
+
+#include <mutex>
+
+/// @brief: The Metal source of the function that maps a color through the color lookup table.
+/// @remarks: Matches @see apply_color_lut. The entries are read rather than sampled, since hardware filtering is trilinear rather than tetrahedral.
+const char* const colorLutShaderSource = R"(
+    #include <metal_stdlib>
+    using namespace metal;
+
+    constant bool colorCalibration [[function_constant(1)]];
+
+    float3 apply_color_lut(texture3d<float, access::read> lut, float3 color)
+    {
+        // Find the cell of the table that holds the color, and where in the cell it is.
+        const float size = float(lut.get_width());
+        const float3 position = saturate(color) * (size - 1.0);
+        const float3 base = min(floor(position), size - 2.0);
+        const float3 fraction = position - base;
+        const uint3 first = uint3(base);
+
+        // Pick the tetrahedron of the cell that holds the color, from the order of its fractions.
+        // Each one runs from the first corner of the cell to the last, stepping along the axes from the largest fraction to the smallest.
+        uint3 second;
+        uint3 third;
+        float3 ordered;
+
+        if (fraction.r >= fraction.g)
+        {
+            if (fraction.g >= fraction.b)
+            {
+                second = uint3(1, 0, 0); third = uint3(1, 1, 0); ordered = fraction.rgb;
+            }
+            else if (fraction.r >= fraction.b)
+            {
+                second = uint3(1, 0, 0); third = uint3(1, 0, 1); ordered = fraction.rbg;
+            }
+            else
+            {
+                second = uint3(0, 0, 1); third = uint3(1, 0, 1); ordered = fraction.brg;
+            }
+        }
+        else
+        {
+            if (fraction.b >= fraction.g)
+            {
+                second = uint3(0, 0, 1); third = uint3(0, 1, 1); ordered = fraction.bgr;
+            }
+            else if (fraction.b >= fraction.r)
+            {
+                second = uint3(0, 1, 0); third = uint3(0, 1, 1); ordered = fraction.gbr;
+            }
+            else
+            {
+                second = uint3(0, 1, 0); third = uint3(1, 1, 0); ordered = fraction.grb;
+            }
+        }
+
+        // Blend the corners of the tetrahedron.
+        return lut.read(first).rgb * (1.0 - ordered.x) +
+               lut.read(first + second).rgb * (ordered.x - ordered.y) +
+               lut.read(first + third).rgb * (ordered.y - ordered.z) +
+               lut.read(first + uint3(1, 1, 1)).rgb * ordered.z;
+    }
+)";
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The color lookup table that was last loaded. Has no entries when there is none.
+    color_lut loadedLut;
+
+    /// @brief: Counts the tables that have been loaded, so the render thread can tell when to upload a new one.
+    int loadedVersion;
+
+    /// @brief: Guards @see loadedLut and @see loadedVersion, which are loaded on the main thread and uploaded on the render thread.
+    std::mutex loadedLutMutex;
+}
+
+/// @brief: Uploads the color lookup table if a different one has been loaded since it was last uploaded.
+/// @param device The Metal device that Unity renders with.
+/// @returns: The texture that holds the table, or nil if there is no table and the image is drawn without color calibration.
+id<MTLTexture> ikin_ryz_color_lut_map::update(id<MTLDevice> device)
+{
+    std::lock_guard<std::mutex> guard(loadedLutMutex);
+
+    // If the texture holds the latest table, then there is nothing to do.
+    if (uploadedVersion == loadedVersion)
+    {
+        return lutTexture;
+    }
+
+    uploadedVersion = loadedVersion;
+    lutTexture = nil;
+
+    if (loadedLut.entries == nullptr)
+    {
+        return nil;
+    }
+
+    // Red runs along the width, green along the height and blue along the depth, which is the order the entries are in.
+    MTLTextureDescriptor* lutDescriptor = [[MTLTextureDescriptor alloc] init];
+    lutDescriptor.textureType = MTLTextureType3D;
+    lutDescriptor.pixelFormat = MTLPixelFormatRGBA32Float;
+    lutDescriptor.width = loadedLut.size;
+    lutDescriptor.height = loadedLut.size;
+    lutDescriptor.depth = loadedLut.size;
+    lutDescriptor.usage = MTLTextureUsageShaderRead;
+
+    lutTexture = [device newTextureWithDescriptor : lutDescriptor];
+
+    const NSUInteger bytesPerRow = loadedLut.size * 4 * sizeof(float);
+
+    [lutTexture replaceRegion : MTLRegionMake3D(0, 0, 0, loadedLut.size, loadedLut.size, loadedLut.size)
+                  mipmapLevel : 0
+                        slice : 0
+                    withBytes : loadedLut.entries.get()
+                  bytesPerRow : bytesPerRow
+                bytesPerImage : bytesPerRow * loadedLut.size];
+
+    return lutTexture;
+}
+
+/// @brief: Sets the color lookup table that the Ryz image is calibrated with from the next frame.
+/// @param lut The table, or a table without entries to stop calibrating colors.
+void set_color_lut(const color_lut& lut)
+{
+    std::lock_guard<std::mutex> guard(loadedLutMutex);
+
+    loadedLut = lut;
+    ++loadedVersion;
+}
+
+/// @brief: Gets the color lookup table that the Ryz image is calibrated with.
+/// @returns: The table, which has no entries if colors aren't being calibrated.
+color_lut get_color_lut()
+{
+    std::lock_guard<std::mutex> guard(loadedLutMutex);
+
+    return loadedLut;
+}
+
+/// @brief: Releases the texture, so that the table is uploaded again the next time it is needed.
+void ikin_ryz_color_lut_map::release()
+{
+    std::lock_guard<std::mutex> guard(loadedLutMutex);
+
+    lutTexture = nil;
+    uploadedVersion = loadedVersion - 1;
+}
+
+/// @brief: Gets the memory held by the texture that holds the table.
+/// @returns: The size of the texture in bytes, or zero if there is none.
+uint64_t ikin_ryz_color_lut_map::allocated_bytes() const
+{
+    if (@available(iOS 11.0, *))
+    {
+        return lutTexture != nil ? lutTexture.allocatedSize : 0;
+    }
+
+    return 0;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Loads the color lookup table of the connected Ryz panel from a calibration file, and calibrates the Ryz image with it from the next frame.
+    /// @param path The path of the .cube calibration file. Null or empty to stop calibrating colors.
+    /// @returns: 1 if the table was loaded or cleared, 0 if the file couldn't be loaded, in which case the current table is kept.
+    EXPORT_API int ikinRyzLoadColorLut(const char* path)
+    {
+        color_lut lut = {};
+
+        // Parse the file before taking the lock, so the render thread doesn't wait on it.
+        if (path != nullptr && path[0] != '\0' && !load_color_lut(path, lut))
+        {
+            return 0;
+        }
+
+        set_color_lut(lut);
+
+        return 1;
+    }
+
+#ifdef __cplusplus
+}
+#endif
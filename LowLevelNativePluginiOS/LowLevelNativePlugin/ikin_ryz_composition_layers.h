@@ -0,0 +1,132 @@
+//
+//  ikin_ryz_composition_layers.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_COMPOSITION_LAYERS_H
+#define IKIN_RYZ_COMPOSITION_LAYERS_H
+
+#import <Metal/Metal.h>
+
+#include <cstdint>
+
+#include "ikin_ryz_settings.h"
+
+/// @brief: The most composition layers that can exist at once.
+const int maxCompositionLayers = 8;
+
+/// @brief: The shapes a composition layer can have.
+/// @remarks: The values match the ikinRyzCompositionLayer.Shape enum on the C# side.
+enum composition_layer_shape
+{
+    /// @brief: The layer covers a region of the Ryz image.
+    layer_shape_quad = 0,
+
+    /// @brief: The layer covers the whole Ryz image, whatever its region is set to.
+    layer_shape_overlay = 1
+};
+
+/// @brief: An image that is blended over the Ryz eye as it is presented, instead of being rendered into it by Unity.
+/// @remarks: A layer is drawn from its own texture, which the application only redraws when its contents change,
+/// so UI that sits still costs nothing to render and can be updated at a different rate than the scene.
+struct composition_layer
+{
+    /// @brief: The ID the layer was created with. Zero for a free slot.
+    int id;
+
+    /// @brief: The shape of the layer.
+    composition_layer_shape shape;
+
+    /// @brief: The texture that the layer is drawn from, or nil if it has none yet and isn't drawn.
+    id<MTLTexture> texture;
+
+    /// @brief: The region of the Ryz image the layer covers, with its origin at the top left. Only used by quad layers.
+    normalized_rect rect;
+
+    /// @brief: How opaque the layer is, from 0 to 1. The alpha of the texture is multiplied by it.
+    float opacity;
+
+    /// @brief: The order the layers are drawn in, lowest first. Layers with the same order are drawn in the order they were created.
+    int order;
+};
+
+/// @brief: Copies the layers that are drawn, in the order they are drawn in.
+/// @param layers The layers that are drawn.
+/// @param version Counts the changes to the layers and their contents, so that a frame can tell whether they changed since another.
+/// @returns: The number of layers that are drawn.
+int get_composition_layers(composition_layer (&layers)[maxCompositionLayers], uint64_t& version);
+
+/// @brief: Gets the region of the Ryz image a layer covers.
+/// @param layer The layer.
+/// @returns: The region, with its origin at the top left.
+normalized_rect composition_layer_rect(const composition_layer& layer);
+
+/// @brief: Creates a composition layer.
+/// @param shape The shape of the layer.
+/// @returns: The ID of the layer, or 0 if @see maxCompositionLayers already exist or the shape isn't valid.
+int create_composition_layer(composition_layer_shape shape);
+
+/// @brief: Sets the texture that a composition layer is drawn from.
+/// @param layerId The ID of the layer.
+/// @param texture The texture, or nil to stop drawing the layer.
+/// @returns: False if there is no layer with the ID, otherwise true.
+bool set_composition_layer_texture(int layerId, id<MTLTexture> texture);
+
+/// @brief: Gets a value indicating whether a composition layer exists.
+/// @param layerId The ID of the layer.
+/// @returns: True if the layer has been created and not destroyed, otherwise false.
+bool composition_layer_exists(int layerId);
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Creates a composition layer, which is blended over the Ryz eye as it is presented.
+    /// @param shape The @see composition_layer_shape of the layer.
+    /// @returns: The ID of the layer, or 0 if no more layers can be created or the shape isn't valid.
+    /// @remarks: The layer isn't drawn until it has a texture. @see ikinRyzSetCompositionLayerTexture.
+    EXPORT_API int ikinRyzCreateCompositionLayer(int shape);
+
+    /// @brief Destroys a composition layer, which stops drawing it from the next frame.
+    /// @param layerId The ID of the layer.
+    EXPORT_API void ikinRyzDestroyCompositionLayer(int layerId);
+
+    /// @brief Sets the texture that a composition layer is drawn from.
+    /// @param layerId The ID of the layer.
+    /// @param texture The native texture, from Texture.GetNativeTexturePtr, or null to stop drawing the layer. Its alpha is blended over the Ryz eye.
+    EXPORT_API void ikinRyzSetCompositionLayerTexture(int layerId, void* texture);
+
+    /// @brief Sets the region of the Ryz image that a quad layer covers.
+    /// @param layerId The ID of the layer.
+    /// @param x The left edge of the region, from 0 to 1.
+    /// @param y The top edge of the region, from 0 to 1.
+    /// @param width The width of the region, from 0 to 1.
+    /// @param height The height of the region, from 0 to 1.
+    /// @remarks: The region follows the Ryz image, so it is flipped and undistorted along with it.
+    EXPORT_API void ikinRyzSetCompositionLayerRect(int layerId, float x, float y, float width, float height);
+
+    /// @brief Sets how opaque a composition layer is.
+    /// @param layerId The ID of the layer.
+    /// @param opacity The opacity, from 0 to 1.
+    EXPORT_API void ikinRyzSetCompositionLayerOpacity(int layerId, float opacity);
+
+    /// @brief Sets the order a composition layer is drawn in.
+    /// @param layerId The ID of the layer.
+    /// @param order The order. Layers are drawn lowest first, so a higher layer covers a lower one.
+    EXPORT_API void ikinRyzSetCompositionLayerOrder(int layerId, int order);
+
+    /// @brief Tells the plugin that the texture of a composition layer has been redrawn.
+    /// @param layerId The ID of the layer.
+    /// @remarks: The Ryz display is only presented again for a changed layer when static frames are skipped, so call this after every redraw.
+    EXPORT_API void ikinRyzUpdateCompositionLayer(int layerId);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
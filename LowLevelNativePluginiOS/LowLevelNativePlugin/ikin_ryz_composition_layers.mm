@@ -0,0 +1,275 @@
+//
+//  ikin_ryz_composition_layers.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_composition_layers.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The slots that the layers are kept in. A slot with an ID of zero is free.
+    composition_layer layerSlots[maxCompositionLayers];
+
+    /// @brief: The ID of the last layer that was created.
+    int lastLayerId;
+
+    /// @brief: Counts the changes to the layers and their contents.
+    uint64_t layersVersion;
+
+    /// @brief: Guards the layers, which are changed on the main thread and drawn on the render thread.
+    std::mutex layersMutex;
+
+    /// @brief: Finds the slot of a layer. The caller has to hold @see layersMutex.
+    /// @param layerId The ID of the layer.
+    /// @returns: The slot, or null if there is no layer with the ID.
+    composition_layer* find_layer(int layerId)
+    {
+        if (layerId <= 0)
+        {
+            return nullptr;
+        }
+
+        for (composition_layer& layer : layerSlots)
+        {
+            if (layer.id == layerId)
+            {
+                return &layer;
+            }
+        }
+
+        return nullptr;
+    }
+}
+
+/// @brief: Copies the layers that are drawn, in the order they are drawn in.
+/// @param layers The layers that are drawn.
+/// @param version Counts the changes to the layers and their contents, so that a frame can tell whether they changed since another.
+/// @returns: The number of layers that are drawn.
+int get_composition_layers(composition_layer (&layers)[maxCompositionLayers], uint64_t& version)
+{
+    std::lock_guard<std::mutex> guard(layersMutex);
+
+    int count = 0;
+
+    for (const composition_layer& layer : layerSlots)
+    {
+        // Layers without a texture, or that can't be seen, are left out.
+        const normalized_rect rect = composition_layer_rect(layer);
+
+        if (layer.id != 0 && layer.texture != nil && layer.opacity > 0.0f && rect.width > 0.0f && rect.height > 0.0f)
+        {
+            layers[count++] = layer;
+        }
+    }
+
+    // IDs only grow, so ordering by them keeps layers with the same order in the order they were created.
+    std::sort(layers, layers + count, [](const composition_layer& a, const composition_layer& b)
+    {
+        return a.order != b.order ? a.order < b.order : a.id < b.id;
+    });
+
+    version = layersVersion;
+
+    return count;
+}
+
+/// @brief: Gets the region of the Ryz image a layer covers.
+/// @param layer The layer.
+/// @returns: The region, with its origin at the top left.
+normalized_rect composition_layer_rect(const composition_layer& layer)
+{
+    return layer.shape == layer_shape_overlay ? normalized_rect{ 0.0f, 0.0f, 1.0f, 1.0f } : layer.rect;
+}
+
+/// @brief: Creates a composition layer.
+/// @param shape The shape of the layer.
+/// @returns: The ID of the layer, or 0 if @see maxCompositionLayers already exist or the shape isn't valid.
+int create_composition_layer(composition_layer_shape shape)
+{
+    // Ignore shapes that don't exist.
+    if (shape != layer_shape_quad && shape != layer_shape_overlay)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> guard(layersMutex);
+
+    for (composition_layer& layer : layerSlots)
+    {
+        if (layer.id == 0)
+        {
+            layer = {};
+            layer.id = ++lastLayerId;
+            layer.shape = shape;
+            layer.rect = { 0.0f, 0.0f, 1.0f, 1.0f };
+            layer.opacity = 1.0f;
+
+            ++layersVersion;
+
+            return layer.id;
+        }
+    }
+
+    return 0;
+}
+
+/// @brief: Sets the texture that a composition layer is drawn from.
+/// @param layerId The ID of the layer.
+/// @param texture The texture, or nil to stop drawing the layer.
+/// @returns: False if there is no layer with the ID, otherwise true.
+bool set_composition_layer_texture(int layerId, id<MTLTexture> texture)
+{
+    std::lock_guard<std::mutex> guard(layersMutex);
+
+    composition_layer* layer = find_layer(layerId);
+
+    if (layer == nullptr)
+    {
+        return false;
+    }
+
+    // Only 2D textures can be drawn as a layer.
+    if (texture != nil && texture.textureType != MTLTextureType2D)
+    {
+        return true;
+    }
+
+    layer->texture = texture;
+    ++layersVersion;
+
+    return true;
+}
+
+/// @brief: Gets a value indicating whether a composition layer exists.
+/// @param layerId The ID of the layer.
+/// @returns: True if the layer has been created and not destroyed, otherwise false.
+bool composition_layer_exists(int layerId)
+{
+    std::lock_guard<std::mutex> guard(layersMutex);
+
+    return find_layer(layerId) != nullptr;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Creates a composition layer, which is blended over the Ryz eye as it is presented.
+    /// @param shape The @see composition_layer_shape of the layer.
+    /// @returns: The ID of the layer, or 0 if no more layers can be created or the shape isn't valid.
+    EXPORT_API int ikinRyzCreateCompositionLayer(int shape)
+    {
+        return create_composition_layer(static_cast<composition_layer_shape>(shape));
+    }
+
+    /// @brief Destroys a composition layer, which stops drawing it from the next frame.
+    /// @param layerId The ID of the layer.
+    EXPORT_API void ikinRyzDestroyCompositionLayer(int layerId)
+    {
+        std::lock_guard<std::mutex> guard(layersMutex);
+
+        composition_layer* layer = find_layer(layerId);
+
+        if (layer != nullptr)
+        {
+            // Releases the texture too.
+            *layer = {};
+            ++layersVersion;
+        }
+    }
+
+    /// @brief Sets the texture that a composition layer is drawn from.
+    /// @param layerId The ID of the layer.
+    /// @param texture The native texture, from Texture.GetNativeTexturePtr, or null to stop drawing the layer.
+    EXPORT_API void ikinRyzSetCompositionLayerTexture(int layerId, void* texture)
+    {
+        set_composition_layer_texture(layerId, (__bridge id<MTLTexture>)texture);
+    }
+
+    /// @brief Sets the region of the Ryz image that a quad layer covers.
+    /// @param layerId The ID of the layer.
+    /// @param x The left edge of the region, from 0 to 1.
+    /// @param y The top edge of the region, from 0 to 1.
+    /// @param width The width of the region, from 0 to 1.
+    /// @param height The height of the region, from 0 to 1.
+    EXPORT_API void ikinRyzSetCompositionLayerRect(int layerId, float x, float y, float width, float height)
+    {
+        // Ignore regions that aren't numbers or have no area.
+        if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(width) || !std::isfinite(height) ||
+            width <= 0.0f || height <= 0.0f)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(layersMutex);
+
+        composition_layer* layer = find_layer(layerId);
+
+        if (layer != nullptr)
+        {
+            layer->rect = { x, y, width, height };
+            ++layersVersion;
+        }
+    }
+
+    /// @brief Sets how opaque a composition layer is.
+    /// @param layerId The ID of the layer.
+    /// @param opacity The opacity, from 0 to 1.
+    EXPORT_API void ikinRyzSetCompositionLayerOpacity(int layerId, float opacity)
+    {
+        // Ignore opacities that aren't numbers.
+        if (std::isnan(opacity))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(layersMutex);
+
+        composition_layer* layer = find_layer(layerId);
+
+        if (layer != nullptr)
+        {
+            layer->opacity = std::min(std::max(opacity, 0.0f), 1.0f);
+            ++layersVersion;
+        }
+    }
+
+    /// @brief Sets the order a composition layer is drawn in.
+    /// @param layerId The ID of the layer.
+    /// @param order The order. Layers are drawn lowest first, so a higher layer covers a lower one.
+    EXPORT_API void ikinRyzSetCompositionLayerOrder(int layerId, int order)
+    {
+        std::lock_guard<std::mutex> guard(layersMutex);
+
+        composition_layer* layer = find_layer(layerId);
+
+        if (layer != nullptr)
+        {
+            layer->order = order;
+            ++layersVersion;
+        }
+    }
+
+    /// @brief Tells the plugin that the texture of a composition layer has been redrawn.
+    /// @param layerId The ID of the layer.
+    EXPORT_API void ikinRyzUpdateCompositionLayer(int layerId)
+    {
+        std::lock_guard<std::mutex> guard(layersMutex);
+
+        if (find_layer(layerId) != nullptr)
+        {
+            ++layersVersion;
+        }
+    }
+
+#ifdef __cplusplus
+}
+#endif
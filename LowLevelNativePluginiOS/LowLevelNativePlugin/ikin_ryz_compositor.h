@@ -0,0 +1,96 @@
+//
+//  ikin_ryz_compositor.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_COMPOSITOR_H
+#define IKIN_RYZ_COMPOSITOR_H
+
+#import <Metal/Metal.h>
+#import <simd/simd.h>
+
+#include "ikin_ryz_settings.h"
+
+/// @brief: The optional steps that the compose shaders are compiled with, as flags. Each combination is compiled into its own pipeline.
+enum compose_variant
+{
+    /// @brief: The image is drawn as it is.
+    compose_variant_none = 0,
+
+    /// @brief: The image is warped through the distortion mesh. @see ikin_ryz_distortion_map.
+    compose_variant_distortion_correction = 1,
+
+    /// @brief: The image is mapped through the color lookup table. @see ikin_ryz_color_lut_map.
+    compose_variant_color_calibration = 2,
+
+    /// @brief: The number of combinations.
+    compose_variant_count = 4
+};
+
+/// @brief: Gets the compose variant that draws through the calibration textures that are set.
+/// @param distortionMesh The distortion mesh, or nil.
+/// @param colorLut The color lookup table, or nil.
+/// @returns: The combination of @see compose_variant flags.
+int compose_variant_for(id<MTLTexture> distortionMesh, id<MTLTexture> colorLut);
+
+/// @brief: Gets the function constants that compile the compose shaders for a variant.
+/// @param variant The combination of @see compose_variant flags.
+/// @returns: The values of the distortionCorrection and colorCalibration function constants.
+MTLFunctionConstantValues* compose_function_constants(int variant);
+
+/// @brief: Gets the Metal source that the compose shaders are compiled after, which declares their function constants and calibration functions.
+/// @returns: The source of the distortion mesh and color lookup table functions.
+NSString* compose_calibration_shader_source();
+
+/// @brief: Gets the transform that maps destination texture coordinates to source texture coordinates.
+/// @param orientation The orientation of the image on the display.
+/// @param sourceRect The region of the source that is drawn, with its origin at the top left.
+/// @returns: The scale of the texture coordinates in x and y, followed by their offset in z and w.
+simd_float4 uv_transform(eye_orientation orientation, const normalized_rect& sourceRect);
+
+/// @brief: Draws the Ryz eye texture into the drawable of the Ryz display with a full-screen pass.
+/// @remarks: A blit can only copy between textures of the same pixel format.
+/// The compose pass samples the eye texture instead, so the eye can be rendered in a format the display can't present directly,
+/// and can be flipped or rotated on its way to the display without the scene having to be rendered upside down.
+/// It also corrects the distortion of the Ryz optics and calibrates the colors of the Ryz panel,
+/// so that scenes don't have to pre-warp their image or post-process it with an extra full-screen pass.
+class ikin_ryz_compositor
+{
+public:
+    /// @brief: Compiles the shaders and creates the pipeline objects.
+    /// @param device The Metal device that Unity renders with.
+    /// @param destinationPixelFormat The pixel format of the textures the compose pass draws into.
+    /// @returns: True if the compositor is ready to encode compose passes, otherwise false.
+    bool initialize(id<MTLDevice> device, MTLPixelFormat destinationPixelFormat);
+
+    /// @brief: Releases the pipeline objects.
+    void release();
+
+    /// @brief: Gets a value indicating whether the compositor is ready to encode compose passes.
+    /// @returns: True if the compositor is ready, otherwise false.
+    bool is_initialized() const;
+
+    /// @brief: Encodes a pass that draws a region of the source texture over the whole destination texture.
+    /// @param commandBuffer The command buffer the pass is encoded into.
+    /// @param source The texture that is sampled.
+    /// @param sourceRect The region of the source that is drawn, in homogeneous coordinates with their origin at the top left.
+    /// @param destination The texture that is drawn into.
+    /// @param orientation How the source is flipped or rotated as it is drawn.
+    /// @param distortionMesh The distortion mesh of the display, from @see ikin_ryz_distortion_map, or nil to draw the source undistorted.
+    /// @param colorLut The color lookup table of the display, from @see ikin_ryz_color_lut_map, or nil to draw the source colors as they are.
+    void encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const normalized_rect& sourceRect, id<MTLTexture> destination, eye_orientation orientation, id<MTLTexture> distortionMesh, id<MTLTexture> colorLut);
+
+private:
+    /// @brief: The pipelines that run the compose shaders, indexed by @see compose_variant.
+    id<MTLRenderPipelineState> pipelineStates[compose_variant_count];
+
+    /// @brief: The sampler that reads the source texture.
+    id<MTLSamplerState> samplerState;
+
+    /// @brief: The pixel format that the pipeline was created for.
+    MTLPixelFormat pixelFormat;
+};
+
+#endif
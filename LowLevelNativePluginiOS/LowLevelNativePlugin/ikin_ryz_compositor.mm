@@ -0,0 +1,262 @@
+//
+//  ikin_ryz_compositor.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_compositor.h"
+
+#include "ikin_ryz_color_lut_map.h"
+#include "ikin_ryz_distortion_map.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The source of the compose shaders.
+    /// @remarks: The plugin is a static library, so the shaders are compiled at runtime instead of shipping a Metal library with it.
+    /// The vertex shader generates a triangle that covers the whole screen from the vertex index, so no vertex buffer is needed.
+    /// It is compiled after @see compose_calibration_shader_source, which it corrects distortion and calibrates colors with.
+    const char* const composeShaderSource = R"(
+        struct compose_vertex
+        {
+            float4 position [[position]];
+            float2 uv;
+            float2 screenUv;
+        };
+
+        vertex compose_vertex compose_vertex_main(uint vertexId [[vertex_id]],
+                                                  constant float4& uvTransform [[buffer(0)]])
+        {
+            float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+
+            compose_vertex out;
+            out.position = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+            out.uv = uv * uvTransform.xy + uvTransform.zw;
+            out.screenUv = uv;
+
+            return out;
+        }
+
+        fragment half4 compose_fragment_main(compose_vertex in [[stage_in]],
+                                             texture2d<half> source [[texture(0)]],
+                                             texture2d<float, access::read> distortionMesh [[texture(1), function_constant(distortionCorrection)]],
+                                             texture3d<float, access::read> colorLut [[texture(2), function_constant(colorCalibration)]],
+                                             sampler sourceSampler [[sampler(0)]],
+                                             constant float4& uvTransform [[buffer(0)]])
+        {
+            float2 uv = in.uv;
+
+            // If the optics distort the image, then draw the point of the image that looks right through them instead.
+            if (distortionCorrection)
+            {
+                const float2 imageUv = sample_distortion_mesh(distortionMesh, in.screenUv);
+
+                if (is_outside_image(imageUv))
+                {
+                    return half4(0.0, 0.0, 0.0, 1.0);
+                }
+
+                uv = imageUv * uvTransform.xy + uvTransform.zw;
+            }
+
+            half4 color = source.sample(sourceSampler, uv);
+
+            // If the panel's colors are off, then drive it with the colors that look right on it instead.
+            if (colorCalibration)
+            {
+                color.rgb = half3(apply_color_lut(colorLut, float3(color.rgb)));
+            }
+
+            return color;
+        }
+    )";
+
+    /// @brief: Gets the transform that maps destination texture coordinates to source texture coordinates for an orientation.
+    /// @param orientation The orientation of the image on the display.
+    /// @returns: The scale of the texture coordinates in x and y, followed by their offset in z and w.
+    simd_float4 orientation_uv_transform(eye_orientation orientation)
+    {
+        switch (orientation)
+        {
+            case orientation_flip_vertical:
+                return simd_make_float4(1.0f, -1.0f, 0.0f, 1.0f);
+
+            case orientation_flip_horizontal:
+                return simd_make_float4(-1.0f, 1.0f, 1.0f, 0.0f);
+
+            case orientation_rotate_180:
+                return simd_make_float4(-1.0f, -1.0f, 1.0f, 1.0f);
+
+            case orientation_none:
+            default:
+                return simd_make_float4(1.0f, 1.0f, 0.0f, 0.0f);
+        }
+    }
+}
+
+/// @brief: Gets the compose variant that draws through the calibration textures that are set.
+/// @param distortionMesh The distortion mesh, or nil.
+/// @param colorLut The color lookup table, or nil.
+/// @returns: The combination of @see compose_variant flags.
+int compose_variant_for(id<MTLTexture> distortionMesh, id<MTLTexture> colorLut)
+{
+    return (distortionMesh != nil ? compose_variant_distortion_correction : compose_variant_none) |
+        (colorLut != nil ? compose_variant_color_calibration : compose_variant_none);
+}
+
+/// @brief: Gets the function constants that compile the compose shaders for a variant.
+/// @param variant The combination of @see compose_variant flags.
+/// @returns: The values of the distortionCorrection and colorCalibration function constants.
+MTLFunctionConstantValues* compose_function_constants(int variant)
+{
+    const bool distortionCorrection = (variant & compose_variant_distortion_correction) != 0;
+    const bool colorCalibration = (variant & compose_variant_color_calibration) != 0;
+
+    MTLFunctionConstantValues* constantValues = [[MTLFunctionConstantValues alloc] init];
+
+    [constantValues setConstantValue : &distortionCorrection type : MTLDataTypeBool atIndex : 0];
+    [constantValues setConstantValue : &colorCalibration type : MTLDataTypeBool atIndex : 1];
+
+    return constantValues;
+}
+
+/// @brief: Gets the Metal source that the compose shaders are compiled after, which declares their function constants and calibration functions.
+/// @returns: The source of the distortion mesh and color lookup table functions.
+NSString* compose_calibration_shader_source()
+{
+    return [NSString stringWithFormat : @"%s%s", distortionShaderSource, colorLutShaderSource];
+}
+
+/// @brief: Gets the transform that maps destination texture coordinates to source texture coordinates.
+/// @param orientation The orientation of the image on the display.
+/// @param sourceRect The region of the source that is drawn, with its origin at the top left.
+/// @returns: The scale of the texture coordinates in x and y, followed by their offset in z and w.
+simd_float4 uv_transform(eye_orientation orientation, const normalized_rect& sourceRect)
+{
+    // Orient the coordinates over the whole source first, then squeeze them into the region.
+    const simd_float4 oriented = orientation_uv_transform(orientation);
+    const simd_float2 regionSize = simd_make_float2(sourceRect.width, sourceRect.height);
+    const simd_float2 regionOrigin = simd_make_float2(sourceRect.x, sourceRect.y);
+
+    return simd_make_float4(oriented.xy * regionSize, regionOrigin + oriented.zw * regionSize);
+}
+
+/// @brief: Compiles the shaders and creates the pipeline objects.
+/// @param device The Metal device that Unity renders with.
+/// @param destinationPixelFormat The pixel format of the textures the compose pass draws into.
+/// @returns: True if the compositor is ready to encode compose passes, otherwise false.
+bool ikin_ryz_compositor::initialize(id<MTLDevice> device, MTLPixelFormat destinationPixelFormat)
+{
+    // If the pipelines already target this format, then there is nothing to do.
+    if (pipelineStates[compose_variant_none] != nil && pixelFormat == destinationPixelFormat)
+    {
+        return true;
+    }
+
+    release();
+
+    NSError* error = nil;
+
+    // Compile the shaders.
+    NSString* shaderSource = [compose_calibration_shader_source() stringByAppendingString : [NSString stringWithUTF8String : composeShaderSource]];
+
+    id<MTLLibrary> library = [device newLibraryWithSource : shaderSource
+                                                  options : nil
+                                                    error : &error];
+
+    if (library == nil)
+    {
+        return false;
+    }
+
+    // Describe the pipelines that draw the full-screen triangle, one for each combination of calibration steps.
+    // The calibration textures are only read when their function constants are set, so the other pipelines don't need them bound.
+    MTLRenderPipelineDescriptor* pipelineDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
+    pipelineDescriptor.vertexFunction = [library newFunctionWithName : @"compose_vertex_main"];
+    pipelineDescriptor.colorAttachments[0].pixelFormat = destinationPixelFormat;
+
+    for (int variant = 0; variant < compose_variant_count; ++variant)
+    {
+        pipelineDescriptor.fragmentFunction = [library newFunctionWithName : @"compose_fragment_main"
+                                                             constantValues : compose_function_constants(variant)
+                                                                      error : &error];
+
+        pipelineStates[variant] = [device newRenderPipelineStateWithDescriptor : pipelineDescriptor
+                                                                          error : &error];
+
+        if (pipelineStates[variant] == nil)
+        {
+            release();
+            return false;
+        }
+    }
+
+    // Use bilinear filtering so that the source can be a different size than the destination.
+    MTLSamplerDescriptor* samplerDescriptor = [[MTLSamplerDescriptor alloc] init];
+    samplerDescriptor.minFilter = MTLSamplerMinMagFilterLinear;
+    samplerDescriptor.magFilter = MTLSamplerMinMagFilterLinear;
+    samplerDescriptor.sAddressMode = MTLSamplerAddressModeClampToEdge;
+    samplerDescriptor.tAddressMode = MTLSamplerAddressModeClampToEdge;
+
+    samplerState = [device newSamplerStateWithDescriptor : samplerDescriptor];
+
+    pixelFormat = destinationPixelFormat;
+
+    return true;
+}
+
+/// @brief: Releases the pipeline objects.
+void ikin_ryz_compositor::release()
+{
+    for (int variant = 0; variant < compose_variant_count; ++variant)
+    {
+        pipelineStates[variant] = nil;
+    }
+
+    samplerState = nil;
+    pixelFormat = MTLPixelFormatInvalid;
+}
+
+/// @brief: Gets a value indicating whether the compositor is ready to encode compose passes.
+/// @returns: True if the compositor is ready, otherwise false.
+bool ikin_ryz_compositor::is_initialized() const
+{
+    return pipelineStates[compose_variant_none] != nil;
+}
+
+/// @brief: Encodes a pass that draws a region of the source texture over the whole destination texture.
+/// @param commandBuffer The command buffer the pass is encoded into.
+/// @param source The texture that is sampled.
+/// @param sourceRect The region of the source that is drawn, in homogeneous coordinates with their origin at the top left.
+/// @param destination The texture that is drawn into.
+/// @param orientation How the source is flipped or rotated as it is drawn.
+/// @param distortionMesh The distortion mesh of the display, from @see ikin_ryz_distortion_map, or nil to draw the source undistorted.
+/// @param colorLut The color lookup table of the display, from @see ikin_ryz_color_lut_map, or nil to draw the source colors as they are.
+void ikin_ryz_compositor::encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const normalized_rect& sourceRect, id<MTLTexture> destination, eye_orientation orientation, id<MTLTexture> distortionMesh, id<MTLTexture> colorLut)
+{
+    const simd_float4 uvTransform = uv_transform(orientation, sourceRect);
+
+    // Every pixel of the destination is overwritten, so its previous contents don't need to be loaded.
+    MTLRenderPassDescriptor* renderPassDescriptor = [MTLRenderPassDescriptor renderPassDescriptor];
+    renderPassDescriptor.colorAttachments[0].texture = destination;
+    renderPassDescriptor.colorAttachments[0].loadAction = MTLLoadActionDontCare;
+    renderPassDescriptor.colorAttachments[0].storeAction = MTLStoreActionStore;
+
+    id<MTLRenderCommandEncoder> renderEncoder = [commandBuffer renderCommandEncoderWithDescriptor : renderPassDescriptor];
+
+    [renderEncoder setRenderPipelineState : pipelineStates[compose_variant_for(distortionMesh, colorLut)]];
+    [renderEncoder setVertexBytes : &uvTransform length : sizeof(uvTransform) atIndex : 0];
+    [renderEncoder setFragmentBytes : &uvTransform length : sizeof(uvTransform) atIndex : 0];
+    [renderEncoder setFragmentTexture : source atIndex : 0];
+    [renderEncoder setFragmentTexture : distortionMesh atIndex : 1];
+    [renderEncoder setFragmentTexture : colorLut atIndex : 2];
+    [renderEncoder setFragmentSamplerState : samplerState atIndex : 0];
+
+    // Draw the full-screen triangle.
+    [renderEncoder drawPrimitives : MTLPrimitiveTypeTriangle
+                      vertexStart : 0
+                      vertexCount : 3];
+
+    [renderEncoder endEncoding];
+}
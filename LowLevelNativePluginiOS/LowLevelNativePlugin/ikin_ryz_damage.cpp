@@ -0,0 +1,250 @@
+//
+//  ikin_ryz_damage.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_damage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#include "ikin_ryz_tile_hash.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The damage rectangles the application has reported since they were last taken.
+    std::vector<damage_rect> pendingDamageRects;
+
+    /// @brief: Guards @see pendingDamageRects, which is written by the main thread and taken by the render thread.
+    std::mutex pendingDamageRectsMutex;
+
+    /// @brief: Gets the smallest rectangle that covers two rectangles.
+    damage_rect bounds_of(const damage_rect& first, const damage_rect& second)
+    {
+        const int left = std::min(first.x, second.x);
+        const int top = std::min(first.y, second.y);
+        const int right = std::max(first.x + first.width, second.x + second.width);
+        const int bottom = std::max(first.y + first.height, second.y + second.height);
+
+        return { left, top, right - left, bottom - top };
+    }
+
+    /// @brief: Gets the number of pixels a rectangle covers.
+    int64_t area_of(const damage_rect& rect)
+    {
+        return (int64_t)rect.width * rect.height;
+    }
+
+    /// @brief: Gets a value indicating whether two rectangles overlap or share an edge.
+    bool overlaps_or_touches(const damage_rect& first, const damage_rect& second)
+    {
+        return first.x <= second.x + second.width && second.x <= first.x + first.width &&
+               first.y <= second.y + second.height && second.y <= first.y + first.height;
+    }
+}
+
+/// @brief: Clips rectangles to an image and drops the ones that end up empty.
+/// @param rects The rectangles to clip.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+void clip_damage_rects(std::vector<damage_rect>& rects, int width, int height)
+{
+    size_t kept = 0;
+
+    for (const damage_rect& rect : rects)
+    {
+        const int left = std::max(rect.x, 0);
+        const int top = std::max(rect.y, 0);
+        const int right = std::min(rect.x + rect.width, width);
+        const int bottom = std::min(rect.y + rect.height, height);
+
+        if (right > left && bottom > top)
+        {
+            rects[kept++] = { left, top, right - left, bottom - top };
+        }
+    }
+
+    rects.resize(kept);
+}
+
+/// @brief: Merges rectangles that overlap or touch, then merges the closest ones until there are few enough.
+/// @param rects The rectangles to merge.
+/// @param maxRects The most rectangles to leave.
+void merge_damage_rects(std::vector<damage_rect>& rects, int maxRects)
+{
+    // Merge rectangles that overlap or touch, until no two do.
+    // A merged rectangle can grow into others, so keep going until a pass merges nothing.
+    bool merged = true;
+
+    while (merged)
+    {
+        merged = false;
+
+        for (size_t first = 0; first < rects.size(); ++first)
+        {
+            for (size_t second = first + 1; second < rects.size(); )
+            {
+                if (overlaps_or_touches(rects[first], rects[second]))
+                {
+                    rects[first] = bounds_of(rects[first], rects[second]);
+                    rects[second] = rects.back();
+                    rects.pop_back();
+                    merged = true;
+                }
+                else
+                {
+                    ++second;
+                }
+            }
+        }
+    }
+
+    // While there are too many rectangles, merge the pair that adds the fewest undamaged pixels.
+    while ((int)rects.size() > std::max(maxRects, 1))
+    {
+        size_t bestFirst = 0;
+        size_t bestSecond = 1;
+        int64_t bestWaste = std::numeric_limits<int64_t>::max();
+
+        for (size_t first = 0; first < rects.size(); ++first)
+        {
+            for (size_t second = first + 1; second < rects.size(); ++second)
+            {
+                const int64_t waste = area_of(bounds_of(rects[first], rects[second])) - area_of(rects[first]) - area_of(rects[second]);
+
+                if (waste < bestWaste)
+                {
+                    bestWaste = waste;
+                    bestFirst = first;
+                    bestSecond = second;
+                }
+            }
+        }
+
+        rects[bestFirst] = bounds_of(rects[bestFirst], rects[bestSecond]);
+        rects[bestSecond] = rects.back();
+        rects.pop_back();
+    }
+}
+
+/// @brief: Finds the damage of an image by comparing the hashes of its tiles to those of the previous image.
+/// @param previousHashes The tile hashes of the previous image. @see hash_tiles.
+/// @param hashes The tile hashes of the image.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param rects Receives the merged damage rectangles.
+void damage_rects_from_tile_hashes(const uint32_t* previousHashes, const uint32_t* hashes, int width, int height, std::vector<damage_rect>& rects)
+{
+    rects.clear();
+
+    const int tilesAcross = (width + tileHashTileSize - 1) / tileHashTileSize;
+    const int tilesDown = (height + tileHashTileSize - 1) / tileHashTileSize;
+
+    // Each run of changed tiles along a row of tiles becomes one rectangle.
+    for (int tileY = 0; tileY < tilesDown; ++tileY)
+    {
+        const uint32_t* rowPreviousHashes = previousHashes + tileY * tilesAcross;
+        const uint32_t* rowHashes = hashes + tileY * tilesAcross;
+
+        for (int tileX = 0; tileX < tilesAcross; )
+        {
+            if (rowPreviousHashes[tileX] == rowHashes[tileX])
+            {
+                ++tileX;
+                continue;
+            }
+
+            const int firstTileX = tileX;
+
+            while (tileX < tilesAcross && rowPreviousHashes[tileX] != rowHashes[tileX])
+            {
+                ++tileX;
+            }
+
+            rects.push_back({
+                firstTileX * tileHashTileSize,
+                tileY * tileHashTileSize,
+                (tileX - firstTileX) * tileHashTileSize,
+                tileHashTileSize
+            });
+        }
+    }
+
+    // The tiles along the right and bottom edges can reach past the image.
+    clip_damage_rects(rects, width, height);
+    merge_damage_rects(rects, maxDamageRects);
+}
+
+/// @brief: Copies the damaged regions of an image into another image of the same size and format.
+/// @param source The first row of the image that is copied from.
+/// @param sourceBytesPerRow The distance between the start of two rows of the source, in bytes.
+/// @param destination The first row of the image that is copied into.
+/// @param destinationBytesPerRow The distance between the start of two rows of the destination, in bytes.
+/// @param bytesPerPixel The size of a pixel in bytes.
+/// @param rects The regions to copy. Must lie within both images.
+void copy_damage_rects(const uint8_t* source, size_t sourceBytesPerRow,
+                       uint8_t* destination, size_t destinationBytesPerRow,
+                       int bytesPerPixel, const std::vector<damage_rect>& rects)
+{
+    for (const damage_rect& rect : rects)
+    {
+        const size_t rowBytes = (size_t)rect.width * bytesPerPixel;
+        const size_t columnOffset = (size_t)rect.x * bytesPerPixel;
+
+        for (int row = rect.y; row < rect.y + rect.height; ++row)
+        {
+            memcpy(destination + row * destinationBytesPerRow + columnOffset,
+                   source + row * sourceBytesPerRow + columnOffset,
+                   rowBytes);
+        }
+    }
+}
+
+/// @brief: Takes the damage rectangles the application has reported since the last call.
+/// @param rects Receives the reported rectangles. Replaces its contents.
+void take_pending_damage_rects(std::vector<damage_rect>& rects)
+{
+    rects.clear();
+
+    std::lock_guard<std::mutex> guard(pendingDamageRectsMutex);
+
+    // Swap rather than copy, so that neither vector has to reallocate once they have grown.
+    rects.swap(pendingDamageRects);
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Reports a region of the Ryz eye that changed in the frame being rendered.
+    /// @param x The left edge of the region, in pixels of the Ryz eye texture.
+    /// @param y The top edge of the region, in pixels of the Ryz eye texture.
+    /// @param width The width of the region in pixels.
+    /// @param height The height of the region in pixels.
+    EXPORT_API void ikinRyzAddDamageRect(int x, int y, int width, int height)
+    {
+        if (width <= 0 || height <= 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(pendingDamageRectsMutex);
+
+        pendingDamageRects.push_back({ x, y, width, height });
+
+        // If the application reports more regions than is worth keeping apart, then merge them all into their bounds.
+        if ((int)pendingDamageRects.size() > maxPendingDamageRects)
+        {
+            merge_damage_rects(pendingDamageRects, 1);
+        }
+    }
+
+#ifdef __cplusplus
+}
+#endif
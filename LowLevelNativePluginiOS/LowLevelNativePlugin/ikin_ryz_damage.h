@@ -0,0 +1,90 @@
+//
+//  ikin_ryz_damage.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_DAMAGE_H
+#define IKIN_RYZ_DAMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "native_to_unity_notifiers.h"
+
+/// @brief: A region of the Ryz eye texture that changed since the last frame, in pixels from the top left.
+struct damage_rect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+/// @brief: The most rectangles that the damage of a frame is merged down to.
+/// @remarks: Each rectangle costs a copy, so a few slightly too large rectangles are cheaper than many exact ones.
+const int maxDamageRects = 8;
+
+/// @brief: The most rectangles the application can report in one frame before they are merged into their bounds.
+const int maxPendingDamageRects = 256;
+
+/// @brief: Clips rectangles to an image and drops the ones that end up empty.
+/// @param rects The rectangles to clip.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+void clip_damage_rects(std::vector<damage_rect>& rects, int width, int height);
+
+/// @brief: Merges rectangles that overlap or touch, then merges the closest ones until there are few enough.
+/// @param rects The rectangles to merge.
+/// @param maxRects The most rectangles to leave.
+/// @remarks: The merged rectangles cover every pixel the original rectangles did, and possibly some more.
+void merge_damage_rects(std::vector<damage_rect>& rects, int maxRects);
+
+/// @brief: Finds the damage of an image by comparing the hashes of its tiles to those of the previous image.
+/// @param previousHashes The tile hashes of the previous image. @see hash_tiles.
+/// @param hashes The tile hashes of the image.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param rects Receives the merged damage rectangles.
+/// @remarks: This is the CPU reference of the tile damage tracking that the tile hasher does on the GPU.
+void damage_rects_from_tile_hashes(const uint32_t* previousHashes, const uint32_t* hashes, int width, int height, std::vector<damage_rect>& rects);
+
+/// @brief: Copies the damaged regions of an image into another image of the same size and format.
+/// @param source The first row of the image that is copied from.
+/// @param sourceBytesPerRow The distance between the start of two rows of the source, in bytes.
+/// @param destination The first row of the image that is copied into.
+/// @param destinationBytesPerRow The distance between the start of two rows of the destination, in bytes.
+/// @param bytesPerPixel The size of a pixel in bytes.
+/// @param rects The regions to copy. Must lie within both images.
+/// @remarks: This is the CPU reference of the copies that update the Ryz presentation texture on the GPU.
+void copy_damage_rects(const uint8_t* source, size_t sourceBytesPerRow,
+                       uint8_t* destination, size_t destinationBytesPerRow,
+                       int bytesPerPixel, const std::vector<damage_rect>& rects);
+
+/// @brief: Takes the damage rectangles the application has reported since the last call.
+/// @param rects Receives the reported rectangles. Replaces its contents.
+void take_pending_damage_rects(std::vector<damage_rect>& rects);
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Reports a region of the Ryz eye that changed in the frame being rendered.
+    /// @param x The left edge of the region, in pixels of the Ryz eye texture.
+    /// @param y The top edge of the region, in pixels of the Ryz eye texture.
+    /// @param width The width of the region in pixels.
+    /// @param height The height of the region in pixels.
+    /// @remarks: Only used when damage tracking is set to @see damage_tracking_application.
+    /// Regions reported before a frame is submitted are copied for that frame.
+    EXPORT_API void ikinRyzAddDamageRect(int x, int y, int width, int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -27,6 +27,81 @@
 #include "../External Headers/Unity/XR/Subsystems/UnitySubsystemTypes.h"
 #include "../External Headers/Unity/XR/Subsystems/Display/IUnityXRDisplay.h"
 
+#include "ikin_ryz_calibration.h"
+#include "ikin_ryz_capture_ring.h"
+#include "ikin_ryz_color_lut_map.h"
+#include "ikin_ryz_compositor.h"
+#include "ikin_ryz_damage.h"
+#include "ikin_ryz_distortion_map.h"
+#include "ikin_ryz_frame_synthesizer.h"
+#include "ikin_ryz_layer_compositor.h"
+#include "ikin_ryz_occlusion_mesh.h"
+#include "ikin_ryz_tile_hasher.h"
+#include "ikin_ryz_upscaler.h"
+#include "ikin_ryz_settings.h"
+#include "ikin_ryz_surface_layers.h"
+
+@class RyzRefreshMonitor;
+
+/// @brief: Describes the native texture that an eye is rendered to, and how Unity refers to it.
+struct eye_render_target
+{
+    /// @brief: Unity XR SDK currently requires that you pass in an I/O Surface pointer.
+    /// @remarks: I/O Surfaces can be used to shared resources across multiple processes, making them more flexible. This is is why Unity uses them for iOS.
+    /// When Unity is ready to draw its image, it will treat this I/O Surface as if it were the actual screen.
+    IOSurfaceRef nativeColorRenderSurface;
+
+    /// @brief: The Metal texture that we are using to interface into Metal operations.
+    /// @remarks: This texture wraps around the I/O Surface.
+    /// The I/O Surface acts as the "meat" of the texture, aka when you read and write colors to the Metal texture,
+    /// you're actually reading and writing from the I/O Surface.
+    id<MTLTexture> nativeColorRenderTexture;
+
+    /// @brief: A view of the Metal texture in the format of the drawable it is presented to.
+    /// @remarks: For sRGB textures this reinterprets the encoded bytes as-is, so they can be copied without being converted.
+    /// Otherwise this is the Metal texture itself.
+    id<MTLTexture> nativeColorPresentTexture;
+
+    /// @brief: An ID that the XR SDK hands after you request that it create a XR Render Surface texture.
+    /// @remarks: This is just a small piece of the system in XR SDK that helps keep track of native textures, so that when rendering is called upon, it can pass the i/O Surface to the parts of Unity that do the screen rendering, and the surface can act as a surrogate for the screen.
+    UnityXRRenderTextureId unityColorRenderTextureId;
+
+    /// @brief: The formats that the texture was created with.
+    eye_format_settings formatSettings;
+
+    /// @brief: The region of the texture that the eye occupies, in pixels from the top left.
+    /// @remarks: The whole texture, unless the eyes share one, in which case each has its own half.
+    MTLRegion region;
+
+    /// @brief: The same region of the texture, from zero (bottom/left) to one (top/right).
+    UnityXRRectf textureRect;
+};
+
+/// @brief: Describes what decides how the Ryz display looks, apart from the contents of the Ryz eye texture.
+struct ryz_present_state
+{
+    /// @brief: The texture that was presented.
+    id<MTLTexture> sourceTexture;
+
+    /// @brief: The region of the texture that was presented.
+    normalized_rect sourceRect;
+
+    /// @brief: The orientation the texture was presented with.
+    eye_orientation orientation;
+
+    /// @brief: The distortion mesh the texture was presented through, or nil.
+    id<MTLTexture> distortionMesh;
+
+    /// @brief: The color lookup table the texture was presented through, or nil.
+    id<MTLTexture> colorLut;
+
+    /// @brief: The version of the composition layers that were blended over the texture. @see get_composition_layers.
+    uint64_t layersVersion;
+
+    /// @brief: The Metal Kit View that the texture was presented to.
+    MTKView* view;
+};
+
 /// @brief: Handles the how the iKin Ryz composes its frame buffer and displays it.
 class ikin_ryz_displayer
 {
@@ -45,8 +120,19 @@ public:
     
     /// @brief: Destroys and cleans up the Metal Kit View and the second window.
     void destroy_and_remove_second_window();
+
+    /// @brief: Handles a refresh of the Ryz display, and synthesizes a frame for it if Unity missed one.
+    /// @remarks: This function runs on the thread of the refresh monitor, separate from the main thread and the render thread.
+    void on_ryz_display_refresh();
     
 private:
+    /// @brief: Applies the calibration that the calibration package holds for a screen, if a package was set.
+    /// @param screen The screen of the Ryz display.
+    void load_calibration(UIScreen* screen);
+
+    /// @brief: Removes the calibration that was applied from the calibration package, unless it was replaced since.
+    void unload_calibration();
+
     /// @brief: Handles when the XR display subsystem is initialized.
     /// @param subsystemHandle A handle to the Unity subsystem.
     /// @returns: A error code that indicates success or failure of the function.
@@ -112,12 +198,83 @@ private:
     /// @brief: Creates the native textures and assigns them to the Unity texture representation.
     /// @param subsystemHandle A handle to the Unity subsystem.
     void create_textures(UnitySubsystemHandle subsystemHandle);
+
+    /// @brief: Creates the native texture for a single eye and assigns it to the Unity texture representation.
+    /// @param subsystemHandle A handle to the Unity subsystem.
+    /// @param renderTarget The render target that is populated.
+    /// @param formatSettings The formats the texture is created with.
+    /// @param renderScale The scale of the texture relative to the display, on top of Unity's eye texture resolution scale.
+    /// @param eyesAcross The number of eyes the texture holds side by side. The render target is given the first.
+    void create_eye_texture(UnitySubsystemHandle subsystemHandle, eye_render_target& renderTarget, const eye_format_settings& formatSettings, float renderScale, int eyesAcross);
+
+    /// @brief: Works out the formats that the eye textures are created in, and whether the eyes share one texture.
+    /// @param formatSettings Set to the formats of each eye texture, indexed by @see eye_index.
+    /// @returns: True if both eyes are rendered side by side into one texture in a single pass, otherwise false.
+    bool get_eye_texture_layout(eye_format_settings* formatSettings) const;
+
+    /// @brief: Destroys the native textures and their Unity texture representation.
+    /// @param subsystemHandle A handle to the Unity subsystem.
+    void destroy_textures(UnitySubsystemHandle subsystemHandle);
+
+    /// @brief: Copies the regions of the Ryz eye that changed this frame into the Ryz presentation texture.
+    /// @param commandBuffer The command buffer of the frame.
+    /// @param ryzRenderTarget The Ryz eye texture.
+    /// @param mode How the changed regions are found.
+    /// @param rendered A value indicating whether Unity rendered the Ryz eye this frame.
+    /// @param damaged Set to false if nothing changed this frame, as far as is known without waiting for the GPU, otherwise true.
+    /// @returns: The texture that the Ryz display is presented from. The eye texture itself if damage isn't being tracked.
+    id<MTLTexture> copy_ryz_damage(id<MTLCommandBuffer> commandBuffer,
+                                   const eye_render_target& ryzRenderTarget,
+                                   damage_tracking_mode mode,
+                                   bool rendered,
+                                   bool& damaged);
+
+    /// @brief: Decides whether the Ryz eye needs to be presented this frame.
+    /// @param commandBuffer The command buffer of the frame.
+    /// @param presentTexture The texture that the Ryz display is presented from.
+    /// @param sourceRect The region of the Ryz eye texture that is presented.
+    /// @param ryzOrientation The orientation that the Ryz eye is presented with.
+    /// @param distortionMesh The distortion mesh that the Ryz eye is presented through, or nil.
+    /// @param colorLut The color lookup table that the Ryz eye is presented through, or nil.
+    /// @param layersVersion The version of the composition layers that are blended over the Ryz eye.
+    /// @param mode How the changed regions of the Ryz eye are found.
+    /// @param rendered A value indicating whether Unity rendered the Ryz eye this frame.
+    /// @param damaged False if nothing changed this frame, as far as is known without waiting for the GPU, otherwise true.
+    /// @returns: False if static frames are being skipped and the frame looks the same as the last presented one, otherwise true.
+    bool should_present_ryz_frame(id<MTLCommandBuffer> commandBuffer,
+                                  id<MTLTexture> presentTexture,
+                                  const normalized_rect& sourceRect,
+                                  eye_orientation ryzOrientation,
+                                  id<MTLTexture> distortionMesh,
+                                  id<MTLTexture> colorLut,
+                                  uint64_t layersVersion,
+                                  damage_tracking_mode mode,
+                                  bool rendered,
+                                  bool damaged);
+
+    /// @brief: Builds the occlusion mesh of each eye from its visible region, and creates, updates or destroys its Unity representation to match.
+    /// @param subsystemHandle A handle to the Unity subsystem.
+    void update_occlusion_meshes(UnitySubsystemHandle subsystemHandle);
+    
+    /// @brief: Creates the Unity Profiler counters of the plugin's throughput, if this version of Unity has them.
+    /// @param unityInterfaces A registry of the low-level interfaces that Unity provides to low-level plugins.
+    void create_profiler_counters(IUnityInterfaces* unityInterfaces);
+    
+    /// @brief: Sets the Unity Profiler counters to this frame's values. Called from the render thread once the frame is submitted.
+    void update_profiler_counters();
+    
+    /// @brief: Adds up the memory held by the textures and buffers that the plugin allocates, for @see textureMemoryCounter.
+    /// @returns: The memory in bytes.
+    uint64_t get_texture_memory();
     
     /// @brief: An interface into the a logging/tracing system for XR.
     IUnityXRTrace* traceInterface;
 
     /// @brief: An interface into the Unity profiler.
     IUnityProfiler* profilingInterface;
+    
+    /// @brief: An interface into the Unity profiler that can create counters, or null before Unity 2021.2.
+    IUnityProfilerV2* profilerCountersInterface;
 
     /// @brief: An interface into the Metal device that Unity creates.
     /// @remarks: Unlike graphicsInterface, which provides higher-level operations that all Unity graphics backends share, this provides operations specific to Metal.
@@ -129,6 +286,41 @@ private:
     /// @brief: The resolution of the Unity screen.
     CGSize dimension;
 
+    /// @brief: The scale of the eye textures relative to the resolution of the Unity screen.
+    /// @remarks: Follows Unity's eye texture resolution scale. The textures are reallocated before the next frame when it changes.
+    float textureResolutionScale;
+
+    /// @brief: A value indicating whether the application renders to sRGB textures, as Unity last hinted.
+    bool appSRGB;
+
+    /// @brief: A value indicating whether the application renders to 16-bit color buffers where it can, as Unity last hinted.
+    bool app16BitColorBuffers;
+
+    /// @brief: The texture layout that Unity last hinted it renders the eyes with.
+    UnityXRTextureLayoutFlags appTextureLayout;
+
+    /// @brief: A value indicating whether the eyes share one texture, side by side.
+    bool eyeTexturesShared;
+
+    /// @brief: The region of each eye that Unity renders into, from zero (bottom/left) to one (top/right).
+    /// @remarks: Follows Unity's render viewport scale, which can change every frame without reallocating anything.
+    UnityXRRectf renderViewport;
+
+    /// @brief: The region of each eye that Unity last rendered into, indexed by @see eye_index.
+    /// @remarks: Only follows @see renderViewport on frames that render the eye, so an eye that isn't rendered keeps presenting the region its image is in.
+    UnityXRRectf eyeRenderViewports[eye_count];
+
+    /// @brief: The number of frames since the Ryz eye was last rendered.
+    int ryzFramesSinceRendered;
+
+    /// @brief: A value indicating whether each eye texture holds no image yet, indexed by @see eye_index.
+    /// @remarks: An empty texture is rendered by the next frame, whatever the Ryz frame rate divisor or Ryz-only mode would do.
+    bool eyeRenderTargetsEmpty[eye_count];
+
+    /// @brief: A value indicating whether the frame being rendered includes the Ryz eye.
+    /// @remarks: Decided when the frame descriptor is populated, and used when the frame is submitted.
+    bool ryzRenderedThisFrame;
+
 #if SECOND_UI_SCREEN
     /// @brief A reference to the second window.
     UIWindow* secondWindow;
@@ -139,20 +331,78 @@ private:
     MTKView* metalKitView;
 #endif
 
-    /// @brief: Unity XR SDK currently requires that you pass in an I/O Surface pointer.
-    /// @remarks: I/O Surfaces can be used to shared resources across multiple processes, making them more flexible. This is is why Unity uses them for iOS.
-    /// When Unity is ready to draw its image, it will treat this I/O Surface as if it were the actual screen.
-    IOSurfaceRef nativeColorRenderSurface;
+    /// @brief: The textures that each eye is rendered to, indexed by @see eye_index.
+    /// @remarks: The eyes share a double-wide texture and are rendered in a single pass when they can.
+    /// When they are rendered in different formats, sizes or at different rates, each eye has its own texture and pass.
+    eye_render_target eyeRenderTargets[eye_count];
 
-    /// @brief: The Metal texture that we are using to interface into Metal operations.
-    /// @remarks: This texture wraps around the I/O Surface.
-    /// The I/O Surface acts as the "meat" of the texture, aka when you read and write colors to the Metal texture,
-    /// you're actually reading and writing from the I/O Surface.
-    id<MTLTexture> nativeColorRenderTexture;
+    /// @brief: The meshes that cover the parts of each eye texture that can't be seen, indexed by @see eye_index.
+    occlusion_mesh occlusionMeshes[eye_count];
 
-    /// @brief: An ID that the XR SDK hands after you request that it create a XR Render Surface texture.
-    /// @remarks: This is just a small piece of the system in XR SDK that helps keep track of native textures, so that when rendering is called upon, it can pass the i/O Surface to the parts of Unity that do the screen rendering, and the surface can act as a surrogate for the screen.
-    UnityXRRenderTextureId unityColorRenderTextureId;
+    /// @brief: The IDs that the XR SDK hands back for the occlusion meshes, indexed by @see eye_index. Zero when an eye has no mesh.
+    UnityXROcclusionMeshId occlusionMeshIds[eye_count];
+
+    /// @brief: Draws the Ryz eye into the Metal Kit View when it can't be copied with a blit, such as when it has to be flipped.
+    ikin_ryz_compositor compositor;
+
+    /// @brief: Draws the Ryz eye into the Metal Kit View when it was rendered smaller than the display and upscaling is turned on.
+    ikin_ryz_upscaler upscaler;
+
+    /// @brief: Blends the composition layers over the Ryz eye once it has been drawn into the Metal Kit View.
+    ikin_ryz_layer_compositor layerCompositor;
+
+    /// @brief: Shows the frames that are queued on the composition layers from outside of Unity, such as decoded video, when they are due.
+    ikin_ryz_surface_layers surfaceLayers;
+
+    /// @brief: Copies the eyes that capture sinks want off the GPU, as screenshots and recordings.
+    ikin_ryz_capture_ring captureRing;
+
+    /// @brief: Keeps the distortion mesh of the Ryz optics in a texture, for the compose and upscale passes to correct the Ryz image with.
+    ikin_ryz_distortion_map distortionMap;
+
+    /// @brief: Keeps the color lookup table of the Ryz panel in a texture, for the compose and upscale passes to calibrate the Ryz image with.
+    ikin_ryz_color_lut_map colorLutMap;
+
+    /// @brief: The calibration that was applied to the connected Ryz display from the calibration package.
+    /// @remarks: Its mesh and table keep the package mapped until the display is disconnected.
+    display_calibration ryzCalibration;
+
+    /// @brief: The visible region of the Ryz eye before @see ryzCalibration replaced it, which is restored when the display is disconnected.
+    eye_occlusion_settings occlusionBeforeCalibration;
+
+    /// @brief: Hashes the Ryz eye every frame while static frames are being skipped, to tell whether it changed.
+    ikin_ryz_tile_hasher tileHasher;
+
+    /// @brief: What the Ryz display was showing when a frame was last presented while static frames were being skipped.
+    ryz_present_state lastPresentState;
+
+    /// @brief: A value indicating whether the next Ryz frame has to be presented, because the last one that should have been couldn't be.
+    bool forceRyzPresent;
+
+    /// @brief: The texture that keeps the last image of the Ryz eye while damage is being tracked. Only the changed regions are copied into it.
+    /// @remarks: Created the first time damage tracking is used, at the size and format of the Ryz eye texture. Only the GPU accesses it.
+    id<MTLTexture> ryzPresentationTexture;
+
+    /// @brief: A value indicating whether @see ryzPresentationTexture holds a whole image of the Ryz eye, so that application damage can be copied on top of it.
+    bool ryzPresentationTextureValid;
+
+    /// @brief: The damage rectangles the application reported for the current frame. Kept between frames to avoid reallocating.
+    std::vector<damage_rect> ryzDamageRects;
+
+    /// @brief: Keeps the last images presented on the Ryz display, and synthesizes frames from them when Unity misses one.
+    ikin_ryz_frame_synthesizer frameSynthesizer;
+
+    /// @brief: The command queue that synthesized frames are encoded into, since they are encoded outside of Unity's frames.
+    id<MTLCommandQueue> synthesisCommandQueue;
+
+    /// @brief: Calls @see on_ryz_display_refresh at every refresh of the Ryz display, while the Metal Kit View exists.
+    RyzRefreshMonitor* refreshMonitor;
+
+    /// @brief: The number of frames Unity had submitted at the last refresh of the Ryz display. Only used by the refresh monitor thread.
+    uint64_t framesSubmittedAtLastRefresh;
+
+    /// @brief: The number of frames synthesized since Unity last submitted one. Only used by the refresh monitor thread.
+    int synthesizedFramesInARow;
 
     /// @brief: A POSIX read/write thread lock for locking down resources shared by the main thread and the render thread.
     /// @remarks: These type of locks are specialized for when you have to read thread-shared a values very often but only change them once in a while.
@@ -192,6 +442,39 @@ private:
     
     /// @brief: An object that describes the profiler sample for the measuring presenting the image in the Metal Kit View to the screen.
     const UnityProfilerMarkerDesc* presentDrawableMarker;
+    
+    /// @brief: An object that describes the profiler sample for the measuring the copy of the damaged regions of the Ryz eye.
+    const UnityProfilerMarkerDesc* copyRyzDamageMarker;
+    
+    /// @brief: An object that describes the profiler sample for the measuring the copy of the main eye for the capture sinks.
+    const UnityProfilerMarkerDesc* captureMainEyeMarker;
+    
+    /// @brief: The Unity Profiler counter of the frames presented to the Ryz display in the last frame, or null if counters can't be created.
+    /// @remarks: Each counter points at a value that Unity owns, and which it reads at the end of each frame.
+    uint64_t* framesPresentedCounter;
+    
+    /// @brief: The Unity Profiler counter of the frames that weren't presented in the last frame because they looked the same as the last presented one.
+    uint64_t* framesSkippedCounter;
+    
+    /// @brief: The Unity Profiler counter of the bytes of the Ryz eye that were read to present the last frame.
+    uint64_t* ryzBlitBytesCounter;
+    
+    /// @brief: The Unity Profiler counter of the Ryz frames that have been presented but that the GPU hasn't finished.
+    int32_t* framesInFlightCounter;
+    
+    /// @brief: The Unity Profiler counter of Unity's eye texture resolution scale, which dynamic resolution changes.
+    float* resolutionScaleCounter;
+    
+    /// @brief: The Unity Profiler counter of the bytes held by the textures and buffers that the plugin allocates.
+    uint64_t* textureMemoryCounter;
+    
+    /// @brief: The Ryz frames that have been presented but that the GPU hasn't finished, which the GPU's completion handlers count down.
+    std::atomic<int> ryzFramesInFlight;
+    
+    /// @brief: The totals of the frame stats when the counters were last set, which this frame's values are the difference from.
+    uint64_t profiledFramesPresented;
+    uint64_t profiledFramesSkipped;
+    uint64_t profiledRyzBytesCopied;
 };
 
 #endif
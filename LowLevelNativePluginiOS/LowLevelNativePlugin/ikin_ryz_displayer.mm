@@ -7,6 +7,9 @@
 //
 
 #include "ikin_ryz_displayer.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <sstream>
 
 #import <IOSurface/IOSurfaceRef.h>
@@ -17,7 +20,13 @@
 #include "../External Headers/Unity/UnityAppController.h"
 #include "../External Headers/Unity/DisplayManager.h"
 #include "native_to_unity_notifiers.h"
+#include "ikin_ryz_flight_recorder.h"
+#include "ikin_ryz_frame_descriptor.h"
+#include "ikin_ryz_frame_stats.h"
+#include "ikin_ryz_input_trace.h"
+#include "ikin_ryz_timeline.h"
 #import "DisplayConnectionNotifier.h"
+#import "RyzRefreshMonitor.h"
 
 #undef XR_TRACE
 
@@ -29,12 +38,13 @@
 #endif
 
 // Macros that allow profile sampling to easily be stripped out. To include, PROFILE 1. To strip out, PROFILE 0
+// Either way, each sample is also a slice on the plugin's timeline while it is being recorded, which release builds can export too.
 #if PROFILE
-#define BEGIN_SAMPLE(identifier) if (isDevelopmentBuild) profilingInterface->BeginSample(identifier ## Marker)
-#define END_SAMPLE(identifier) if (isDevelopmentBuild) profilingInterface->EndSample(identifier ## Marker)
+#define BEGIN_SAMPLE(identifier) { if (isDevelopmentBuild) profilingInterface->BeginSample(identifier ## Marker); timeline_begin(#identifier); }
+#define END_SAMPLE(identifier) { timeline_end(#identifier); if (isDevelopmentBuild) profilingInterface->EndSample(identifier ## Marker); }
 #else
-#define BEGIN_SAMPLE(identifier)
-#define END_SAMPLE(identifier)
+#define BEGIN_SAMPLE(identifier) timeline_begin(#identifier)
+#define END_SAMPLE(identifier) timeline_end(#identifier)
 #endif
 
 // Placed in an anonymous namespace to avoid these functions being accessed outside this file
@@ -63,44 +73,158 @@ namespace
         return stringStream.str().c_str();
     }
 
-    /// @brief: Creates a description of the pose, which is a position that is an offset of the camera.
-    /// @returns: The description of the pose.
-    UnityXRPose get_pose()
+    /// @brief: Gets the Metal pixel format that matches a color format.
+    /// @param format The color format.
+    /// @returns: The Metal pixel format.
+    MTLPixelFormat metal_pixel_format(color_format format)
     {
-        UnityXRPose pose = { 0 };
-        
-        pose.position.x = 0.0;
-        pose.position.z = 0.0f;
-        pose.rotation.w = 1.0f;
-        
-        return pose;
+        switch (format)
+        {
+            case color_format_bgra8_srgb:
+                return MTLPixelFormatBGRA8Unorm_sRGB;
+
+            case color_format_rgb565:
+                return MTLPixelFormatB5G6R5Unorm;
+
+            case color_format_bgra8:
+            default:
+                return MTLPixelFormatBGRA8Unorm;
+        }
+    }
+
+    /// @brief: Gets the I/O Surface pixel format that matches a color format.
+    /// @param format The color format.
+    /// @returns: The four character code that describes the pixel format to the I/O Surface.
+    uint32_t iosurface_pixel_format(color_format format)
+    {
+        switch (format)
+        {
+            case color_format_rgb565:
+                // Same value as kCVPixelFormatType_16LE565.
+                return 'L565';
+
+            case color_format_bgra8:
+            case color_format_bgra8_srgb:
+            default:
+                // Same value as kCVPixelFormatType_32BGRA.
+                return 'BGRA';
+        }
     }
 
-    /// @brief: Creates a description of the projection matrix.
-    /// @returns: The description of the projection matrix.
-    UnityXRProjection get_projection(int targetEye, const CGSize& dimension)
+    /// @brief: Gets the Unity color format that matches a color format.
+    /// @param format The color format.
+    /// @returns: The Unity color format.
+    /// @remarks: sRGB is not a format in the XR SDK, it is requested with kUnityXRRenderTextureFlagsSRGB instead.
+    UnityXRRenderTextureFormat unity_color_format(color_format format)
     {
-        UnityXRProjection ret;
+        switch (format)
+        {
+            case color_format_rgb565:
+                return kUnityXRRenderTextureFormatRGB565;
 
-        ret.type = projectionType;
+            case color_format_bgra8:
+            case color_format_bgra8_srgb:
+            default:
+                return kUnityXRRenderTextureFormatBGRA32;
+        }
+    }
 
-        if (ret.type == kUnityXRProjectionTypeMatrix)
+    /// @brief: Gets the Unity depth format that matches a depth format.
+    /// @param format The depth format.
+    /// @returns: The Unity depth format.
+    UnityXRDepthTextureFormat unity_depth_format(depth_format format)
+    {
+        switch (format)
         {
-            ret.data.matrix = targetEye == 0 ? leftProjectionMatrix : rightProjectionMatrix;
+            case depth_format_16bit:
+                return kUnityXRDepthTextureFormat16bit;
+
+            case depth_format_none:
+                return kUnityXRDepthTextureFormatNone;
+
+            case depth_format_24bit:
+            default:
+                return kUnityXRDepthTextureFormat24bitOrGreater;
         }
-        else
+    }
+
+    /// @brief: Gets a value indicating whether an eye texture of the color format can be copied into a drawable with a blit.
+    /// @param format The color format.
+    /// @param orientation The orientation the texture is presented with.
+    /// @returns: True if the texture can be blitted, false if it needs to be drawn with the compositor.
+    bool can_blit_to_drawable(color_format format, eye_orientation orientation)
+    {
+        // A blit can't convert between pixel formats, and drawables can't be 16-bit.
+        // It also copies texels as they are, so it can't flip or rotate them.
+        return format != color_format_rgb565 && orientation == orientation_none;
+    }
+
+    /// @brief: Gets the region of an eye texture that is read so that the image comes out in the orientation.
+    /// @param orientation The orientation of the image on the display.
+    /// @returns: The homogeneous region to read. A negative width or height reads the texture backwards along that axis.
+    UnityXRRectf oriented_source_rect(eye_orientation orientation)
+    {
+        switch (orientation)
         {
-            float aspectRatio = (dimension.width * 0.5f) / dimension.height;
+            case orientation_flip_vertical:
+                return { 0.0f, 1.0f, 1.0f, -1.0f };
+
+            case orientation_flip_horizontal:
+                return { 1.0f, 0.0f, -1.0f, 1.0f };
 
-            ret.data.halfAngles.left = -aspectRatio;
-            ret.data.halfAngles.right = aspectRatio;
-            ret.data.halfAngles.top = 0.5;
-            ret.data.halfAngles.bottom = -0.5;
+            case orientation_rotate_180:
+                return { 1.0f, 1.0f, -1.0f, -1.0f };
+
+            case orientation_none:
+            default:
+                return { 0.0f, 0.0f, 1.0f, 1.0f };
         }
-        
-        return ret;
     }
 
+    /// @brief: Gets the region of a texture that a viewport covers, measured from the top left of the texture.
+    /// @param viewport The homogeneous viewport, measured from the bottom left.
+    /// @returns: The homogeneous region of the texture, measured from the top left.
+    /// @remarks: The eye textures are top to bottom, so the bottom of the viewport is the last row of the region.
+    normalized_rect viewport_texture_rect(const UnityXRRectf& viewport)
+    {
+        return { viewport.x, 1.0f - viewport.y - viewport.height, viewport.width, viewport.height };
+    }
+
+    /// @brief: Maps a region of the rendered image to the region of the texture that it occupies.
+    /// @param viewport The homogeneous viewport the image was rendered into.
+    /// @param rect The homogeneous region of the rendered image.
+    /// @returns: The homogeneous region of the texture.
+    UnityXRRectf viewport_rect(const UnityXRRectf& viewport, const UnityXRRectf& rect)
+    {
+        return {
+            viewport.x + rect.x * viewport.width,
+            viewport.y + rect.y * viewport.height,
+            rect.width * viewport.width,
+            rect.height * viewport.height
+        };
+    }
+
+    /// @brief: Adds a blit to the description of the mirror view.
+    /// @param blitDescriptor The description of the mirror view.
+    /// @param textureId The eye texture that is read.
+    /// @param sourceRect The homogeneous region of the eye texture that is read.
+    /// @param destinationRect The homogeneous region of the mirror view that is written to.
+    void add_mirror_blit(UnityXRMirrorViewBlitDesc* blitDescriptor,
+                         UnityXRRenderTextureId textureId,
+                         const UnityXRRectf& sourceRect,
+                         const UnityXRRectf& destinationRect)
+    {
+        UnityXRMirrorViewBlitDesc::UnityXRBlitParams& blitParam = blitDescriptor->blitParams[blitDescriptor->blitParamsCount++];
+
+        blitParam.srcTexId = textureId;
+        blitParam.srcTexArraySlice = 0;
+        blitParam.srcRect = sourceRect;
+        blitParam.destRect = destinationRect;
+    }
+
+    /// @brief: The pixel format of the Metal Kit View drawables.
+    const MTLPixelFormat drawablePixelFormat = MTLPixelFormatBGRA8Unorm;
+
     /// @brief: A singleton reference to the DisplayConnectionNotifier
     static ikin_ryz_displayer ryzDisplayer;
 
@@ -156,6 +280,10 @@ void ikin_ryz_displayer::subscribe_unity_events(IUnityInterfaces* unityInterface
         profilingInterface->CreateMarker(&blitCommandEncoderMarker, "Blit Command Encoding", kUnityProfilerCategoryRender, kUnityProfilerMarkerFlagDefault, 0);
         
         profilingInterface->CreateMarker(&presentDrawableMarker, "Present Drawable", kUnityProfilerCategoryRender, kUnityProfilerMarkerFlagDefault, 0);
+        
+        profilingInterface->CreateMarker(&copyRyzDamageMarker, "Copy Ryz Damage", kUnityProfilerCategoryRender, kUnityProfilerMarkerFlagDefault, 0);
+        
+        profilingInterface->CreateMarker(&captureMainEyeMarker, "Capture Main Eye", kUnityProfilerCategoryRender, kUnityProfilerMarkerFlagDefault, 0);
     }
     else
     {
@@ -170,8 +298,12 @@ void ikin_ryz_displayer::subscribe_unity_events(IUnityInterfaces* unityInterface
         getCurrentCommandBufferMarker = nullptr;
         blitCommandEncoderMarker = nullptr;
         presentDrawableMarker = nullptr;
+        copyRyzDamageMarker = nullptr;
+        captureMainEyeMarker = nullptr;
     }
     
+    create_profiler_counters(unityInterfaces);
+    
     // Create the read/write lock.
     if (pthread_rwlockattr_init(&lockAttribute) != 0)
     {
@@ -210,6 +342,120 @@ void ikin_ryz_displayer::subscribe_unity_events(IUnityInterfaces* unityInterface
     
     // Subscribe to notifications of changes in the lifecycle of a XR display subsystem.
     subscribe_to_lifecycle_notifications();
+    
+    // The display subsystem isn't always shut down before the app is, so keep the flight recorder's last seconds when it terminates too.
+    [[NSNotificationCenter defaultCenter] addObserverForName : UIApplicationWillTerminateNotification
+                                                      object : nil
+                                                       queue : nil
+                                                  usingBlock : ^(NSNotification*)
+    {
+        dump_flight_recorder_on_shutdown();
+    }];
+}
+
+// The second version of the profiler interface keeps the functions of the first in the same slots, and adds the category and counter functions
+// between them and the thread functions. Check the vendored declarations against the first version, which is Unity's own header,
+// so that a slip in them fails the build rather than calling into the wrong slot of Unity's interface.
+static_assert(offsetof(IUnityProfilerV2, EmitEvent) == offsetof(IUnityProfiler, EmitEvent), "IUnityProfilerV2::EmitEvent is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, IsEnabled) == offsetof(IUnityProfiler, IsEnabled), "IUnityProfilerV2::IsEnabled is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, IsAvailable) == offsetof(IUnityProfiler, IsAvailable), "IUnityProfilerV2::IsAvailable is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, CreateMarker) == offsetof(IUnityProfiler, CreateMarker), "IUnityProfilerV2::CreateMarker is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, SetMarkerMetadataName) == offsetof(IUnityProfiler, SetMarkerMetadataName), "IUnityProfilerV2::SetMarkerMetadataName is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, CreateCategory) == offsetof(IUnityProfiler, RegisterThread), "IUnityProfilerV2::CreateCategory is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, CreateCounterValue) == offsetof(IUnityProfilerV2, CreateCategory) + sizeof(void*), "IUnityProfilerV2::CreateCounterValue is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, FlushCounterValue) == offsetof(IUnityProfilerV2, CreateCounterValue) + sizeof(void*), "IUnityProfilerV2::FlushCounterValue is in the wrong slot");
+static_assert(offsetof(IUnityProfilerV2, RegisterThread) == offsetof(IUnityProfilerV2, FlushCounterValue) + sizeof(void*), "IUnityProfilerV2::RegisterThread is in the wrong slot");
+static_assert(sizeof(IUnityProfilerV2) == sizeof(IUnityProfiler) + 3 * sizeof(void*), "IUnityProfilerV2 has the wrong number of functions");
+
+/// @brief: Creates the Unity Profiler counters of the plugin's throughput, if this version of Unity has them.
+/// @param unityInterfaces A registry of the low-level interfaces that Unity provides to low-level plugins.
+/// @remarks: The counters show in the Profiler next to the game's own, and can be read with the ProfilerRecorder API.
+/// They are available in release builds too, so a game can watch them without a development build.
+void ikin_ryz_displayer::create_profiler_counters(IUnityInterfaces* unityInterfaces)
+{
+    // Counters came with the second version of the profiler interface, in Unity 2021.2.
+    profilerCountersInterface = unityInterfaces->Get<IUnityProfilerV2>();
+    
+    UnityProfilerCategoryId category = kUnityProfilerCategoryRender;
+    
+    // If the profiler can't create counters, then only the markers are shown.
+    if (profilerCountersInterface == nullptr || profilerCountersInterface->CreateCategory(&category, "iKin Ryz", 0) != 0)
+    {
+        profilerCountersInterface = nullptr;
+        framesPresentedCounter = nullptr;
+        framesSkippedCounter = nullptr;
+        ryzBlitBytesCounter = nullptr;
+        framesInFlightCounter = nullptr;
+        resolutionScaleCounter = nullptr;
+        textureMemoryCounter = nullptr;
+        
+        return;
+    }
+    
+    // Unity reads each value at the end of each frame, so the render thread only has to write it.
+    const UnityProfilerMarkerFlags flags = kUnityProfilerMarkerFlagAvailabilityNonDev;
+    const UnityProfilerCounterFlags counterFlags = kUnityProfilerCounterFlushOnEndOfFrame;
+    
+    framesPresentedCounter = (uint64_t*)profilerCountersInterface->CreateCounterValue(category, "Ryz Frames Presented", flags, kUnityProfilerMarkerDataTypeUInt64, kUnityProfilerMarkerDataUnitCount, sizeof(uint64_t), counterFlags, nullptr, nullptr, nullptr);
+    
+    framesSkippedCounter = (uint64_t*)profilerCountersInterface->CreateCounterValue(category, "Ryz Frames Skipped", flags, kUnityProfilerMarkerDataTypeUInt64, kUnityProfilerMarkerDataUnitCount, sizeof(uint64_t), counterFlags, nullptr, nullptr, nullptr);
+    
+    ryzBlitBytesCounter = (uint64_t*)profilerCountersInterface->CreateCounterValue(category, "Ryz Blit Bytes", flags, kUnityProfilerMarkerDataTypeUInt64, kUnityProfilerMarkerDataUnitBytes, sizeof(uint64_t), counterFlags, nullptr, nullptr, nullptr);
+    
+    framesInFlightCounter = (int32_t*)profilerCountersInterface->CreateCounterValue(category, "Ryz Frames In Flight", flags, kUnityProfilerMarkerDataTypeInt32, kUnityProfilerMarkerDataUnitCount, sizeof(int32_t), counterFlags, nullptr, nullptr, nullptr);
+    
+    resolutionScaleCounter = (float*)profilerCountersInterface->CreateCounterValue(category, "Ryz Resolution Scale", flags, kUnityProfilerMarkerDataTypeFloat, kUnityProfilerMarkerDataUnitUndefined, sizeof(float), counterFlags, nullptr, nullptr, nullptr);
+    
+    textureMemoryCounter = (uint64_t*)profilerCountersInterface->CreateCounterValue(category, "Ryz Texture Memory", flags, kUnityProfilerMarkerDataTypeUInt64, kUnityProfilerMarkerDataUnitBytes, sizeof(uint64_t), counterFlags, nullptr, nullptr, nullptr);
+}
+
+/// @brief: Sets the Unity Profiler counters to this frame's values.
+/// @remarks: This function runs on the Unity render thread, once the frame is submitted.
+void ikin_ryz_displayer::update_profiler_counters()
+{
+    if (profilerCountersInterface == nullptr)
+    {
+        return;
+    }
+    
+    // The counts are this frame's share of the totals the frame stats keep.
+    const uint64_t framesPresented = frameStatsCounters.framesPresented.load(std::memory_order_relaxed);
+    const uint64_t framesSkipped = frameStatsCounters.framesSkipped.load(std::memory_order_relaxed);
+    const uint64_t ryzBytesCopied = frameStatsCounters.ryzBytesCopied.load(std::memory_order_relaxed);
+    
+    if (framesPresentedCounter != nullptr)
+    {
+        *framesPresentedCounter = framesPresented - profiledFramesPresented;
+    }
+    
+    if (framesSkippedCounter != nullptr)
+    {
+        *framesSkippedCounter = framesSkipped - profiledFramesSkipped;
+    }
+    
+    if (ryzBlitBytesCounter != nullptr)
+    {
+        *ryzBlitBytesCounter = ryzBytesCopied - profiledRyzBytesCopied;
+    }
+    
+    if (framesInFlightCounter != nullptr)
+    {
+        *framesInFlightCounter = ryzFramesInFlight.load(std::memory_order_relaxed);
+    }
+    
+    if (resolutionScaleCounter != nullptr)
+    {
+        *resolutionScaleCounter = textureResolutionScale;
+    }
+    
+    if (textureMemoryCounter != nullptr)
+    {
+        *textureMemoryCounter = get_texture_memory();
+    }
+    
+    profiledFramesPresented = framesPresented;
+    profiledFramesSkipped = framesSkipped;
+    profiledRyzBytesCopied = ryzBytesCopied;
 }
 
 #if SECOND_UI_VIEW
@@ -219,41 +465,56 @@ void ikin_ryz_displayer::subscribe_unity_events(IUnityInterfaces* unityInterface
 /// If it is parented to the window created when the display connects, then it is drawn to the second screen.
 void ikin_ryz_displayer::create_and_add_metalkitview_to_window(UIWindow* window)
 {
-    // Lock the usage of the Metal Kit View.
-    if (pthread_rwlock_trywrlock(&lock) != 0)
-    {
-        XR_TRACE("Failed to lock Read/Write lock\n");
-    }
-    
     // Get a reference to the metal device.
     id<MTLDevice> device = metalInterface->MetalDevice();
 
+    // The view is set up before it is published to the render thread and the refresh thread, so that they only wait for the swap.
     // Create a Metal Kit UI View, and make match the window bounds. Tell it which
-    metalKitView = [[MTKView alloc] initWithFrame : window.bounds
-                                           device : device];
+    MTKView* view = [[MTKView alloc] initWithFrame : window.bounds
+                                            device : device];
     
     // Get the FPS of the Metal Kit View to match the one coming from Unity.
     NSInteger framesPerSecond = GetAppController().unityDisplayLink.preferredFramesPerSecond;
-    [metalKitView setPreferredFramesPerSecond : framesPerSecond];
+    [view setPreferredFramesPerSecond : framesPerSecond];
     
     // Set the view’s autoresizing mask so that it is not translated into Auto Layout constraints.
-    metalKitView.translatesAutoresizingMaskIntoConstraints = false;
+    view.translatesAutoresizingMaskIntoConstraints = false;
     
     // Set the size of the drawable texture to match the window bounds.
-    [metalKitView setDrawableSize : window.bounds.size];
+    [view setDrawableSize : window.bounds.size];
     
     // Notify the Metal Kit View that the frame buffer isn't just read-only.
-    metalKitView.framebufferOnly = NO;
+    view.framebufferOnly = NO;
+    
+    // The eye textures are copied or drawn into drawables of this format.
+    view.colorPixelFormat = drawablePixelFormat;
     
     // Add this as a sub-view of the window.
-    [window addSubview : metalKitView];
+    [window addSubview : view];
     [window sizeToFit];
+    
+    // Lock the usage of the Metal Kit View, waiting for a frame that is being presented or synthesized into it.
+    const bool locked = pthread_rwlock_wrlock(&lock) == 0;
+    
+    if (!locked)
+    {
+        XR_TRACE("Failed to lock Read/Write lock\n");
+    }
+    
+    metalKitView = view;
+    
+    // Images presented to a previous view can't be synthesized from.
+    frameSynthesizer.clear();
 
-    // Unlock usage of the Metal Kit View.
-    if (pthread_rwlock_unlock(&lock) != 0)
+    // Unlock usage of the Metal Kit View, if this thread locked it.
+    if (locked && pthread_rwlock_unlock(&lock) != 0)
     {
         XR_TRACE("Failed to unlock Read/Write lock\n");
     }
+    
+    // Watch the refreshes of the screen the view is shown on, so that frames Unity misses can be synthesized.
+    [refreshMonitor stop];
+    refreshMonitor = [[RyzRefreshMonitor alloc] initWith : this screen : window.screen framesPerSecond : framesPerSecond];
 }
 #endif
 
@@ -308,6 +569,79 @@ void ikin_ryz_displayer::subscribe_to_lifecycle_notifications()
 }
 
 #if SECOND_UI_SCREEN
+/// @brief: Applies the calibration that the calibration package holds for a screen, if a package was set.
+/// @param screen The screen of the Ryz display.
+void ikin_ryz_displayer::load_calibration(UIScreen* screen)
+{
+    unload_calibration();
+
+    const std::string path = get_calibration_package_path();
+
+    // If no package was set, then the display keeps whatever calibration was set by hand.
+    if (path.empty())
+    {
+        return;
+    }
+
+    // The package is only mapped now that a display is connected, and only the pages of its model are read.
+    std::shared_ptr<calibration_package> package = calibration_package::open(path.c_str());
+
+    const CGSize nativeSize = screen.nativeBounds.size;
+
+    if (!calibration_package::find_display(package, static_cast<int>(nativeSize.width), static_cast<int>(nativeSize.height), static_cast<int>(screen.maximumFramesPerSecond), ryzCalibration))
+    {
+        XR_TRACE("[ikin_ryz_displayer]: No calibration for a %.0fx%.0f display in %s\n", nativeSize.width, nativeSize.height, path.c_str());
+        return;
+    }
+
+    if (ryzCalibration.distortionMesh.coordinates != nullptr)
+    {
+        set_distortion_mesh(ryzCalibration.distortionMesh);
+    }
+
+    if (ryzCalibration.colorLut.entries != nullptr)
+    {
+        set_color_lut(ryzCalibration.colorLut);
+    }
+
+    if (ryzCalibration.hasOcclusion)
+    {
+        occlusionBeforeCalibration = eyeOcclusionSettings[ryz_eye];
+        ikinRyzSetEyeOcclusion(ryz_eye, ryzCalibration.occlusion.radiusX, ryzCalibration.occlusion.radiusY);
+    }
+
+    set_display_geometry(ryzCalibration.hasGeometry ? &ryzCalibration.geometry : nullptr);
+}
+
+/// @brief: Removes the calibration that was applied from the calibration package, unless it was replaced since.
+void ikin_ryz_displayer::unload_calibration()
+{
+    // If the mesh or table was replaced through the plugin API since, then the replacement is kept.
+    if (ryzCalibration.distortionMesh.coordinates != nullptr &&
+        get_distortion_mesh().coordinates == ryzCalibration.distortionMesh.coordinates)
+    {
+        set_distortion_mesh(distortion_mesh());
+    }
+
+    if (ryzCalibration.colorLut.entries != nullptr &&
+        get_color_lut().entries == ryzCalibration.colorLut.entries)
+    {
+        set_color_lut(color_lut());
+    }
+
+    // Likewise, if the visible region was set through the plugin API since, then it is kept.
+    if (ryzCalibration.hasOcclusion &&
+        eyeOcclusionSettings[ryz_eye].radiusX == ryzCalibration.occlusion.radiusX &&
+        eyeOcclusionSettings[ryz_eye].radiusY == ryzCalibration.occlusion.radiusY)
+    {
+        ikinRyzSetEyeOcclusion(ryz_eye, occlusionBeforeCalibration.radiusX, occlusionBeforeCalibration.radiusY);
+    }
+
+    set_display_geometry(nullptr);
+
+    ryzCalibration = display_calibration();
+}
+
 /// @brief: Creates the second window and parents the Metal Kit View to it.
 /// @param screen The screen that the window will be shown on.
 void ikin_ryz_displayer::create_and_add_second_window(UIScreen* screen)
@@ -334,6 +668,9 @@ void ikin_ryz_displayer::create_and_add_second_window(UIScreen* screen)
         [secondWindow makeKeyAndVisible];
     }
     
+    // Calibrate the display before the C# layer hears of it, so that its first frame is already calibrated.
+    load_calibration(screen);
+
     // Notify the C# layer than the display has been connected.
     ikinRyzOnDisplayEvent(display_event::connected);
 }
@@ -343,29 +680,39 @@ void ikin_ryz_displayer::destroy_and_remove_second_window()
 {
     // Notify the C# layer than the display has been disconnected.
     ikinRyzOnDisplayEvent(display_event::disconnected);
+
+    // Drop the calibration of the display, which lets its package be unmapped.
+    unload_calibration();
     
 #if SECOND_UI_VIEW
-    // Lock the usage of the Metal Kit View.
-    if (pthread_rwlock_trywrlock(&lock) != 0)
+    // Stop watching the refreshes of the display, since there is nothing left to present to.
+    [refreshMonitor stop];
+    refreshMonitor = nil;
+    
+    // Lock the usage of the Metal Kit View, waiting for a frame that is being presented or synthesized into it.
+    const bool locked = pthread_rwlock_wrlock(&lock) == 0;
+    
+    if (!locked)
     {
         XR_TRACE("Failed to lock Read/Write lock\n");
     }
 
-    if (metalKitView != nil)
-    {
-
-        [metalKitView releaseDrawables];
-        
-        [metalKitView removeFromSuperview];
-
-        metalKitView = nil;
-    }
+    // Only take the view away from the render thread and the refresh thread here, and tear it down once they can't reach it.
+    MTKView* view = metalKitView;
+    metalKitView = nil;
     
-    // Unlock the usage of the Metal Kit View.
-    if (pthread_rwlock_unlock(&lock) != 0)
+    // Unlock the usage of the Metal Kit View, if this thread locked it.
+    if (locked && pthread_rwlock_unlock(&lock) != 0)
     {
         XR_TRACE("Failed to unlock Read/Write lock\n");
     }
+
+    if (view != nil)
+    {
+        [view releaseDrawables];
+        
+        [view removeFromSuperview];
+    }
 #endif
     
     if (secondWindow != nil)
@@ -412,6 +759,64 @@ void ikin_ryz_displayer::destroy_and_remove_second_window()
 }
 #endif
 
+/// @brief: Handles a refresh of the Ryz display, and synthesizes a frame for it if Unity missed one.
+/// @remarks: This function runs on the thread of the refresh monitor, separate from the main thread and the render thread.
+void ikin_ryz_displayer::on_ryz_display_refresh()
+{
+    // If Unity submitted a frame since the last refresh, then it made the deadline.
+    const uint64_t framesSubmitted = frameStatsCounters.framesSubmitted.load(std::memory_order_relaxed);
+    
+    if (framesSubmitted != framesSubmittedAtLastRefresh)
+    {
+        framesSubmittedAtLastRefresh = framesSubmitted;
+        synthesizedFramesInARow = 0;
+        
+        return;
+    }
+    
+    // If frames aren't synthesized, or the last ones have been extrapolated as far as they reasonably can be, then let the display show the last frame again.
+    if (!frameSynthesis.load(std::memory_order_relaxed) ||
+        !frameSynthesizer.is_initialized() ||
+        synthesisCommandQueue == nil ||
+        synthesizedFramesInARow >= maxSynthesizedFrames)
+    {
+        return;
+    }
+    
+    // If the render thread holds the lock, then it is presenting a frame right now, so the deadline wasn't missed after all.
+    if (pthread_rwlock_trywrlock(&lock) != 0)
+    {
+        return;
+    }
+    
+#if SECOND_UI_VIEW
+    // Adding an auto-release pool here to free-up the command buffer and the drawable
+    @autoreleasepool
+    {
+        id<CAMetalDrawable> drawable = metalKitView.currentDrawable;
+        
+        if (drawable != nil)
+        {
+            id<MTLCommandBuffer> commandBuffer = [synthesisCommandQueue commandBuffer];
+            
+            // Each frame in a row is extrapolated one frame further from the last presented one.
+            if (frameSynthesizer.encode(commandBuffer, drawable.texture, synthesizedFramesInARow + 1))
+            {
+                [commandBuffer presentDrawable : drawable];
+                [commandBuffer commit];
+                
+                ++synthesizedFramesInARow;
+                
+                frameStatsCounters.framesSynthesized.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+#endif
+    
+    // Unlock the usage of the Metal Kit View.
+    pthread_rwlock_unlock(&lock);
+}
+
 /// @brief: Handles when the XR display subsystem is initialized.
 /// @param subsystemHandle A handle to the Unity subsystem.
 /// @returns: A error code that indicates success or failure of the function.
@@ -483,16 +888,102 @@ UnitySubsystemErrorCode ikin_ryz_displayer::on_display_subsystem_initialized(Uni
 /// @param subsystemHandle A handle to the Unity subsystem.
 void ikin_ryz_displayer::create_textures(UnitySubsystemHandle subsystemHandle)
 {
-    // This texture is twice as wide as the original resolution so that it can store left eye and right eye at the dimension of a full screen each.
-    const int width = (int)(dimension.width * 2);
-    const int height = (int)(dimension.height);
+    eye_format_settings formatSettings[eye_count];
+    eyeTexturesShared = get_eye_texture_layout(formatSettings);
+    
+    // If the eyes can share a texture, then they are rendered side by side into a double-wide one, the main eye on the left.
+    if (eyeTexturesShared)
+    {
+        create_eye_texture(subsystemHandle, eyeRenderTargets[main_eye], formatSettings[main_eye], 1.0f, eye_count);
+        
+        // The Ryz eye refers to the same texture, and holds its own reference to the surface.
+        eye_render_target& ryzRenderTarget = eyeRenderTargets[ryz_eye];
+        ryzRenderTarget = eyeRenderTargets[main_eye];
+        
+        if (ryzRenderTarget.nativeColorRenderSurface != nullptr)
+        {
+            CFRetain(ryzRenderTarget.nativeColorRenderSurface);
+        }
+        
+        ryzRenderTarget.region.origin.x = ryzRenderTarget.region.size.width;
+        ryzRenderTarget.textureRect.x = ryzRenderTarget.textureRect.width;
+    }
+    else
+    {
+        // Otherwise, each eye gets its own texture, in the formats that have been configured for it.
+        // The Ryz eye can be rendered smaller than its display, and scaled up as it is presented.
+        for (int eye = 0; eye < eye_count; ++eye)
+        {
+            const float renderScale = eye == ryz_eye ? ryzRenderScale.load(std::memory_order_relaxed) : 1.0f;
+            
+            create_eye_texture(subsystemHandle, eyeRenderTargets[eye], formatSettings[eye], renderScale, 1);
+        }
+    }
+    
+    // The new textures hold nothing to repeat, so the next frame has to render them.
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        eyeRenderTargetsEmpty[eye] = true;
+    }
+    
+    // The orientation of the Ryz eye can change at any time, and most orientations can't be blitted into the drawable.
+    // So compile the compose pass now rather than while presenting.
+    if (!compositor.initialize(metalInterface->MetalDevice(), drawablePixelFormat))
+    {
+        XR_TRACE("Failed to create the compose pass.\n");
+    }
+    
+    // Upscaling can be turned on at any time as well.
+    if (!upscaler.initialize(metalInterface->MetalDevice(), drawablePixelFormat))
+    {
+        XR_TRACE("Failed to create the upscale passes.\n");
+    }
+    
+    // Composition layers can be created at any time too.
+    if (!layerCompositor.initialize(metalInterface->MetalDevice(), drawablePixelFormat))
+    {
+        XR_TRACE("Failed to create the layer pass.\n");
+    }
+    
+    // Skipping static frames can be turned on at any time, so compile the hash kernel now too.
+    if (!tileHasher.initialize(metalInterface->MetalDevice()))
+    {
+        XR_TRACE("Failed to create the tile hash pass.\n");
+    }
+    
+    // Frame synthesis can be turned on at any time too. Its frames are encoded outside of Unity's frames, so they need their own queue.
+    if (!frameSynthesizer.initialize(metalInterface->MetalDevice(), drawablePixelFormat))
+    {
+        XR_TRACE("Failed to create the frame synthesis pass.\n");
+    }
+    
+    if (synthesisCommandQueue == nil)
+    {
+        synthesisCommandQueue = [metalInterface->MetalDevice() newCommandQueue];
+    }
+}
+
+/// @brief: Creates the native texture for a single eye and assigns it to the Unity texture representation.
+/// @param subsystemHandle A handle to the Unity subsystem.
+/// @param renderTarget The render target that is populated.
+/// @param formatSettings The formats the texture is created with.
+/// @param renderScale The scale of the texture relative to the display, on top of Unity's eye texture resolution scale.
+/// @param eyesAcross The number of eyes the texture holds side by side. The render target is given the first.
+void ikin_ryz_displayer::create_eye_texture(UnitySubsystemHandle subsystemHandle, eye_render_target& renderTarget, const eye_format_settings& formatSettings, float renderScale, int eyesAcross)
+{
+    // Each eye is rendered at the dimension of a full screen, scaled by Unity's eye texture resolution scale and the eye's own scale.
+    const int eyeWidth = std::max(1, (int)(dimension.width * textureResolutionScale * renderScale));
+    const int width = eyeWidth * eyesAcross;
+    const int height = std::max(1, (int)(dimension.height * textureResolutionScale * renderScale));
+    
+    const bool isSRGB = formatSettings.colorFormat == color_format_bgra8_srgb;
     
     // Get a reference to the metal device.
     id<MTLDevice> device = metalInterface->MetalDevice();
     
     // Create an object that describes a render texture to the Metal.
     // When the Metal needs to create the render texture, this should have all the information the GPU needs to generate and store it in GPU RAM.
-    MTLTextureDescriptor* nativeColorRenderTextureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat : MTLPixelFormatBGRA8Unorm
+    MTLTextureDescriptor* nativeColorRenderTextureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat : metal_pixel_format(formatSettings.colorFormat)
                                                                                                                   width : width
                                                                                                                  height : height
                                                                                                               mipmapped : NO];
@@ -500,25 +991,33 @@ void ikin_ryz_displayer::create_textures(UnitySubsystemHandle subsystemHandle)
     nativeColorRenderTextureDescriptor.usage = MTLTextureUsageRenderTarget | MTLTextureUsageShaderRead;
     nativeColorRenderTextureDescriptor.arrayLength = 1;
     
+    // sRGB textures are viewed as linear textures when they are copied, so the view needs to be allowed up front.
+    if (isSRGB)
+    {
+        nativeColorRenderTextureDescriptor.usage |= MTLTextureUsagePixelFormatView;
+    }
+    
     XR_TRACE("Created the native color buffer descriptor.\n");
     
-    const NSInteger PixelByteSize = 4;
+    const NSInteger PixelByteSize = color_format_byte_size(formatSettings.colorFormat);
     
     NSDictionary *surfaceDefinition = @{
                                         (id)kIOSurfaceWidth: @(nativeColorRenderTextureDescriptor.width),
                                         (id)kIOSurfaceHeight: @(nativeColorRenderTextureDescriptor.height),
                                         (id)kIOSurfaceBytesPerElement: @(PixelByteSize),
+                                        (id)kIOSurfaceBytesPerRow: @(IOSurfaceAlignProperty(kIOSurfaceBytesPerRow, width * PixelByteSize)),
+                                        (id)kIOSurfacePixelFormat: @(iosurface_pixel_format(formatSettings.colorFormat)),
                                         };
     
     XR_TRACE("Created the definition for the I/O surfaces.\n");
     
-    nativeColorRenderSurface = IOSurfaceCreate((CFDictionaryRef) surfaceDefinition);
+    renderTarget.nativeColorRenderSurface = IOSurfaceCreate((CFDictionaryRef) surfaceDefinition);
     
     // This operation is only available in iOS 11 or later. Check it and make sure its available. If it is, then:
     if (@available(iOS 11.0, *))
     {
         // Create a Metal texture that is backed by the I/O Surface.
-        nativeColorRenderTexture = [device newTextureWithDescriptor : nativeColorRenderTextureDescriptor iosurface : nativeColorRenderSurface plane : 0];
+        renderTarget.nativeColorRenderTexture = [device newTextureWithDescriptor : nativeColorRenderTextureDescriptor iosurface : renderTarget.nativeColorRenderSurface plane : 0];
     }
     else
     {
@@ -526,6 +1025,11 @@ void ikin_ryz_displayer::create_textures(UnitySubsystemHandle subsystemHandle)
         XR_TRACE("Did not create Metal texture with I/O Surface backing.\n");
     }
     
+    // Copies into the drawable read the encoded sRGB bytes as they are, instead of decoding and re-encoding them.
+    renderTarget.nativeColorPresentTexture = isSRGB
+        ? [renderTarget.nativeColorRenderTexture newTextureViewWithPixelFormat : drawablePixelFormat]
+        : renderTarget.nativeColorRenderTexture;
+    
     // Create an object that describes a render texture to the Unity XR SDK. When the XR system needs to use the render texture, this should have all the information needed.
     UnityXRRenderTextureDesc unityRenderTextureDescriptor;
     memset(&unityRenderTextureDescriptor, 0, sizeof(UnityXRRenderTextureDesc));
@@ -535,44 +1039,460 @@ void ikin_ryz_displayer::create_textures(UnitySubsystemHandle subsystemHandle)
     unityRenderTextureDescriptor.width = width;
     unityRenderTextureDescriptor.height = height;
     unityRenderTextureDescriptor.textureArrayLength = 1;
-    unityRenderTextureDescriptor.colorFormat = kUnityXRRenderTextureFormatBGRA32;
+    unityRenderTextureDescriptor.colorFormat = unity_color_format(formatSettings.colorFormat);
+    
+    if (isSRGB)
+    {
+        unityRenderTextureDescriptor.flags |= kUnityXRRenderTextureFlagsSRGB;
+    }
+    
+    // Unity allocates the depth texture itself, or none at all.
+    unityRenderTextureDescriptor.depthFormat = unity_depth_format(formatSettings.depthFormat);
+    unityRenderTextureDescriptor.depth.nativePtr = (void*)kUnityXRRenderTextureIdDontCare;
     
     // Tell Unity to create a texture on the Unity side using the description from the descriptor.
     // Since we passed the native pointer over in this descriptor, this is how Unity knows that is should be rendering everything to this particular buffer instead of to the screen.
-    unityRenderTextureDescriptor.color.nativePtr = nativeColorRenderSurface;
-    displayInterface->CreateTexture(subsystemHandle, &unityRenderTextureDescriptor, &unityColorRenderTextureId);
-}
-
-// @brief: Handles when graphics thread starts.
-/// @param subsystemHandle A handle to the Unity subsystem.
-/// @param renderingCaps The rendering capabilities.
-/// @returns: A error code that indicates success or failure of the function.
-/// @remarks This function runs on the Unity render thread, separate from the main thread.
-UnitySubsystemErrorCode ikin_ryz_displayer::start_in_graphics_thread(UnitySubsystemHandle subsystemHandle, UnityXRRenderingCapabilities *renderingCaps)
-{
-    create_textures(subsystemHandle);
-
-    return kUnitySubsystemErrorCodeSuccess;
+    unityRenderTextureDescriptor.color.nativePtr = renderTarget.nativeColorRenderSurface;
+    displayInterface->CreateTexture(subsystemHandle, &unityRenderTextureDescriptor, &renderTarget.unityColorRenderTextureId);
+    
+    renderTarget.formatSettings = formatSettings;
+    
+    // The render target is the first eye across the texture.
+    renderTarget.region = MTLRegionMake2D(0, 0, eyeWidth, height);
+    renderTarget.textureRect = { 0.0f, 0.0f, 1.0f / eyesAcross, 1.0f };
 }
 
-/// @brief: Handles when the XR display subsystem is started.
-/// @param subsystemHandle A handle to the Unity subsystem.
-/// @returns: A error code that indicates success or failure of the function.
-UnitySubsystemErrorCode ikin_ryz_displayer::on_display_subsystem_started(UnitySubsystemHandle subsystemHandle)
+/// @brief: Works out the formats that the eye textures are created in, and whether the eyes share one texture.
+/// @param formatSettings Set to the formats of each eye texture, indexed by @see eye_index.
+/// @returns: True if both eyes are rendered side by side into one texture in a single pass, otherwise false.
+bool ikin_ryz_displayer::get_eye_texture_layout(eye_format_settings* formatSettings) const
 {
-    XR_TRACE("A display's subsystem has been started!\n");
-    XR_TRACE([[[NSThread currentThread] description] UTF8String]);
-
-    return kUnitySubsystemErrorCodeSuccess;
+    // The eyes that follow the application's formats take them from Unity's hints.
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        formatSettings[eye].colorFormat = resolve_color_format(eyeFormatSettings[eye].colorFormat, appSRGB, app16BitColorBuffers);
+        formatSettings[eye].depthFormat = eyeFormatSettings[eye].depthFormat;
+    }
+    
+    // A texture has one format and one size, and a single pass renders all of it.
+    // So the eyes can only share one if they are in the same formats, at the same scale, and rendered on the same frames.
+    // Unity can also be set to render each eye in a pass of its own.
+    return formatSettings[main_eye].colorFormat == formatSettings[ryz_eye].colorFormat &&
+        formatSettings[main_eye].depthFormat == formatSettings[ryz_eye].depthFormat &&
+        ryzRenderScale.load(std::memory_order_relaxed) == 1.0f &&
+        ryzFrameRateDivisor.load(std::memory_order_relaxed) <= 1 &&
+        !ryzOnly.load(std::memory_order_relaxed) &&
+        appTextureLayout != kUnityXRTextureLayoutFlagsSeparateTexture2Ds;
 }
 
-/// @brief: Handles when the XR display subsystem is stopped.
+/// @brief: Destroys the native textures and their Unity texture representation.
 /// @param subsystemHandle A handle to the Unity subsystem.
-void ikin_ryz_displayer::on_display_subsystem_stopped(UnitySubsystemHandle subsystemHandle)
+void ikin_ryz_displayer::destroy_textures(UnitySubsystemHandle subsystemHandle)
 {
-    XR_TRACE("A display's subsystem has been stopped!\n");
-    XR_TRACE([[[NSThread currentThread] description] UTF8String]);
-}
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        eye_render_target& renderTarget = eyeRenderTargets[eye];
+        
+        // Release the Unity representation first, since it refers to the I/O Surface.
+        if (renderTarget.unityColorRenderTextureId != 0)
+        {
+            const UnityXRRenderTextureId textureId = renderTarget.unityColorRenderTextureId;
+            
+            displayInterface->DestroyTexture(subsystemHandle, textureId);
+            
+            // The eyes that share the texture lose it too, so it is only destroyed once.
+            for (eye_render_target& sharingRenderTarget : eyeRenderTargets)
+            {
+                if (sharingRenderTarget.unityColorRenderTextureId == textureId)
+                {
+                    sharingRenderTarget.unityColorRenderTextureId = 0;
+                }
+            }
+        }
+        
+        renderTarget.nativeColorPresentTexture = nil;
+        renderTarget.nativeColorRenderTexture = nil;
+        
+        if (renderTarget.nativeColorRenderSurface != nullptr)
+        {
+            CFRelease(renderTarget.nativeColorRenderSurface);
+            renderTarget.nativeColorRenderSurface = nullptr;
+        }
+    }
+    
+    // The presentation texture matches the size of the Ryz eye, so it goes with it.
+    ryzPresentationTexture = nil;
+    ryzPresentationTextureValid = false;
+}
+
+/// @brief: Adds up the memory held by the textures and buffers that the plugin allocates, for the texture memory counter.
+/// @returns: The memory in bytes.
+/// @remarks: Covers the eye textures, the Ryz presentation texture, the upscaler's intermediate texture, the images the synthesizer keeps,
+/// the distortion mesh and color lookup table, and the capture staging buffers.
+uint64_t ikin_ryz_displayer::get_texture_memory()
+{
+    uint64_t bytes = 0;
+    
+    // The eye textures are backed by I/O Surfaces, which hold their memory. A surface the eyes share is counted once.
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        if (eyeRenderTargets[eye].nativeColorRenderSurface != nullptr &&
+            (eye == main_eye || eyeRenderTargets[eye].nativeColorRenderSurface != eyeRenderTargets[main_eye].nativeColorRenderSurface))
+        {
+            bytes += IOSurfaceGetAllocSize(eyeRenderTargets[eye].nativeColorRenderSurface);
+        }
+    }
+    
+    if (ryzPresentationTexture != nil)
+    {
+        if (@available(iOS 11.0, *))
+        {
+            bytes += ryzPresentationTexture.allocatedSize;
+        }
+    }
+    
+    bytes += upscaler.allocated_bytes();
+    bytes += frameSynthesizer.allocated_bytes();
+    bytes += distortionMap.allocated_bytes();
+    bytes += colorLutMap.allocated_bytes();
+    bytes += captureRing.allocated_bytes();
+    
+    return bytes;
+}
+
+/// @brief: Builds the occlusion mesh of each eye from its visible region, and creates, updates or destroys its Unity representation to match.
+/// @param subsystemHandle A handle to the Unity subsystem.
+void ikin_ryz_displayer::update_occlusion_meshes(UnitySubsystemHandle subsystemHandle)
+{
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        occlusion_mesh& mesh = occlusionMeshes[eye];
+        UnityXROcclusionMeshId& meshId = occlusionMeshIds[eye];
+        
+        // If the whole eye texture can be seen, then:
+        if (!mesh.build(eyeOcclusionSettings[eye].radiusX, eyeOcclusionSettings[eye].radiusY))
+        {
+            // Release the mesh Unity holds for it, if any.
+            if (meshId != 0)
+            {
+                displayInterface->DestroyOcclusionMesh(subsystemHandle, meshId);
+                meshId = 0;
+            }
+            
+            continue;
+        }
+        
+        // Every mesh has the same number of vertices and indices, so an existing Unity mesh can be refilled in place.
+        if (meshId == 0 &&
+            displayInterface->CreateOcclusionMesh(subsystemHandle, (uint32_t)mesh.vertices.size(), (uint32_t)mesh.indices.size(), &meshId) != kUnitySubsystemErrorCodeSuccess)
+        {
+            XR_TRACE("Failed to create an occlusion mesh.\n");
+            meshId = 0;
+            continue;
+        }
+        
+        displayInterface->SetOcclusionMesh(subsystemHandle,
+                                           meshId,
+                                           mesh.vertices.data(),
+                                           (uint32_t)mesh.vertices.size(),
+                                           mesh.indices.data(),
+                                           (uint32_t)mesh.indices.size());
+    }
+}
+
+/// @brief: Copies the regions of the Ryz eye that changed this frame into the Ryz presentation texture.
+/// @param commandBuffer The command buffer of the frame.
+/// @param ryzRenderTarget The Ryz eye texture.
+/// @param mode How the changed regions are found.
+/// @param rendered A value indicating whether Unity rendered the Ryz eye this frame.
+/// @param damaged Set to false if nothing changed this frame, as far as is known without waiting for the GPU, otherwise true.
+/// @returns: The texture that the Ryz display is presented from. The eye texture itself if damage isn't being tracked.
+id<MTLTexture> ikin_ryz_displayer::copy_ryz_damage(id<MTLCommandBuffer> commandBuffer,
+                                                   const eye_render_target& ryzRenderTarget,
+                                                   damage_tracking_mode mode,
+                                                   bool rendered,
+                                                   bool& damaged)
+{
+    id<MTLTexture> eyeTexture = ryzRenderTarget.nativeColorPresentTexture;
+    
+    // The part of the eye texture that the Ryz eye occupies, which is all of it unless it shares the texture with the main eye.
+    const MTLRegion& region = ryzRenderTarget.region;
+    const NSUInteger regionWidth = region.size.width;
+    const NSUInteger regionHeight = region.size.height;
+    
+    // A frame that repeats the last Ryz image can't have changed.
+    damaged = rendered;
+    
+    // If damage isn't being tracked, or can't be for this eye, then present straight from the eye texture.
+    // The tile kernels and the partial copies only handle 32-bit pixels.
+    if (mode == damage_tracking_off ||
+        eyeTexture == nil ||
+        color_format_byte_size(ryzRenderTarget.formatSettings.colorFormat) != 4 ||
+        (mode == damage_tracking_tiles && !tileHasher.is_initialized()))
+    {
+        // Throw the reported regions away, so they don't pile up while they aren't being used.
+        take_pending_damage_rects(ryzDamageRects);
+        
+        ryzPresentationTexture = nil;
+        ryzPresentationTextureValid = false;
+        
+        return eyeTexture;
+    }
+    
+    // If the Ryz eye wasn't rendered and the presentation texture already holds its image, then there is nothing to copy.
+    // Regions the application reports meanwhile belong to the next rendered frame, so they are left pending.
+    if (!rendered &&
+        ryzPresentationTexture != nil &&
+        ryzPresentationTexture.width == regionWidth &&
+        ryzPresentationTexture.height == regionHeight &&
+        ryzPresentationTexture.pixelFormat == eyeTexture.pixelFormat &&
+        (mode == damage_tracking_tiles || ryzPresentationTextureValid))
+    {
+        return ryzPresentationTexture;
+    }
+    
+    // The reported regions only describe a frame that Unity rendered.
+    if (rendered)
+    {
+        take_pending_damage_rects(ryzDamageRects);
+    }
+    else
+    {
+        ryzDamageRects.clear();
+    }
+    
+    // The presentation texture is about to change, even if it only catches up with a repeated image.
+    damaged = true;
+    
+    // If there is no presentation texture yet, or it doesn't match the eye, then create one the size of the eye.
+    if (ryzPresentationTexture == nil ||
+        ryzPresentationTexture.width != regionWidth ||
+        ryzPresentationTexture.height != regionHeight ||
+        ryzPresentationTexture.pixelFormat != eyeTexture.pixelFormat)
+    {
+        MTLTextureDescriptor* presentationTextureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat : eyeTexture.pixelFormat
+                                                                                                                 width : regionWidth
+                                                                                                                height : regionHeight
+                                                                                                             mipmapped : NO];
+        presentationTextureDescriptor.storageMode = MTLStorageModePrivate;
+        presentationTextureDescriptor.usage = MTLTextureUsageShaderRead | MTLTextureUsageShaderWrite;
+        
+        ryzPresentationTexture = [metalInterface->MetalDevice() newTextureWithDescriptor : presentationTextureDescriptor];
+        ryzPresentationTextureValid = false;
+        
+        if (ryzPresentationTexture == nil)
+        {
+            XR_TRACE("Failed to create the Ryz presentation texture.\n");
+            return eyeTexture;
+        }
+    }
+    
+    const uint64_t tileBytes = (uint64_t)tileHashTileSize * tileHashTileSize * 4;
+    const uint64_t textureBytes = (uint64_t)regionWidth * regionHeight * 4;
+    
+    // If the tiles are compared, then the GPU finds and copies the changed ones itself.
+    if (mode == damage_tracking_tiles)
+    {
+        tileHasher.encode_with_damage_copy(commandBuffer, eyeTexture, region, ryzPresentationTexture);
+        
+        // The application's reports only count in application mode, so a switch back to it starts from a whole image.
+        ryzPresentationTextureValid = false;
+        
+        // The number of copied tiles is only known once the GPU is done, so this counts the last completed frame.
+        const uint64_t bytesCopied = std::min(textureBytes, (uint64_t)tileHasher.last_changed_tile_count() * tileBytes);
+        
+        frameStatsCounters.ryzBytesCopied.fetch_add(bytesCopied, std::memory_order_relaxed);
+        frameStatsCounters.ryzBytesLastFrame.fetch_add(bytesCopied, std::memory_order_relaxed);
+        
+        return ryzPresentationTexture;
+    }
+    
+    // If the presentation texture doesn't hold a whole image yet, then the first copy has to be all of it.
+    if (!ryzPresentationTextureValid)
+    {
+        ryzDamageRects.assign(1, { 0, 0, (int)regionWidth, (int)regionHeight });
+        ryzPresentationTextureValid = true;
+    }
+    else
+    {
+        clip_damage_rects(ryzDamageRects, (int)regionWidth, (int)regionHeight);
+        merge_damage_rects(ryzDamageRects, maxDamageRects);
+    }
+    
+    uint64_t bytesCopied = 0;
+    
+    // If the application reported changes, then copy just those regions. They are measured from the top left of the eye.
+    if (!ryzDamageRects.empty())
+    {
+        id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+        
+        for (const damage_rect& rect : ryzDamageRects)
+        {
+            [blitEncoder copyFromTexture : eyeTexture
+                             sourceSlice : 0
+                             sourceLevel : 0
+                            sourceOrigin : MTLOriginMake(region.origin.x + rect.x, region.origin.y + rect.y, 0)
+                              sourceSize : MTLSizeMake(rect.width, rect.height, 1)
+                               toTexture : ryzPresentationTexture
+                        destinationSlice : 0
+                        destinationLevel : 0
+                       destinationOrigin : MTLOriginMake(rect.x, rect.y, 0)];
+            
+            bytesCopied += (uint64_t)rect.width * rect.height * 4;
+        }
+        
+        [blitEncoder endEncoding];
+    }
+    else
+    {
+        // Otherwise, the presentation texture already shows this frame.
+        damaged = false;
+    }
+    
+    frameStatsCounters.ryzBytesCopied.fetch_add(bytesCopied, std::memory_order_relaxed);
+    frameStatsCounters.ryzBytesLastFrame.fetch_add(bytesCopied, std::memory_order_relaxed);
+    
+    return ryzPresentationTexture;
+}
+
+/// @brief: Decides whether the Ryz eye needs to be presented this frame.
+/// @param commandBuffer The command buffer of the frame.
+/// @param presentTexture The texture that the Ryz display is presented from.
+/// @param sourceRect The region of the Ryz eye texture that is presented.
+/// @param ryzOrientation The orientation that the Ryz eye is presented with.
+/// @param distortionMesh The distortion mesh that the Ryz eye is presented through, or nil.
+/// @param colorLut The color lookup table that the Ryz eye is presented through, or nil.
+/// @param layersVersion The version of the composition layers that are blended over the Ryz eye.
+/// @param mode How the changed regions of the Ryz eye are found.
+/// @param rendered A value indicating whether Unity rendered the Ryz eye this frame.
+/// @param damaged False if nothing changed this frame, as far as is known without waiting for the GPU, otherwise true.
+/// @returns: False if static frames are being skipped and the frame looks the same as the last presented one, otherwise true.
+bool ikin_ryz_displayer::should_present_ryz_frame(id<MTLCommandBuffer> commandBuffer,
+                                                  id<MTLTexture> presentTexture,
+                                                  const normalized_rect& sourceRect,
+                                                  eye_orientation ryzOrientation,
+                                                  id<MTLTexture> distortionMesh,
+                                                  id<MTLTexture> colorLut,
+                                                  uint64_t layersVersion,
+                                                  damage_tracking_mode mode,
+                                                  bool rendered,
+                                                  bool damaged)
+{
+    // A frame that should have been presented but couldn't be is owed to the display, whatever this frame looks like.
+    const bool forcePresent = forceRyzPresent;
+    forceRyzPresent = false;
+    
+    // The application's damage reports are exact and current, so they decide on their own, without waiting for the GPU.
+    const bool applicationDamage = mode == damage_tracking_application && presentTexture == ryzPresentationTexture;
+    
+    // If static frames aren't being skipped, or can't be detected, then present every frame.
+    if (!skipStaticFrames.load(std::memory_order_relaxed) || presentTexture == nil || (!applicationDamage && !tileHasher.is_initialized()))
+    {
+        // Forget what was presented, so that detection starts over when it is turned back on.
+        lastPresentState = {};
+        
+        return true;
+    }
+    
+    // Hash this frame, so that the following frames can be compared to it.
+    // The tile damage copy has already hashed it, and a repeated Ryz image hashes the same as when it was rendered.
+    // Only the Ryz eye's part of a texture it shares with the main eye is hashed.
+    if (rendered && !applicationDamage && !(mode == damage_tracking_tiles && presentTexture == ryzPresentationTexture))
+    {
+        tileHasher.encode(commandBuffer,
+                          presentTexture,
+                          presentTexture == ryzPresentationTexture
+                              ? MTLRegionMake2D(0, 0, presentTexture.width, presentTexture.height)
+                              : eyeRenderTargets[ryz_eye].region);
+    }
+    
+    // The contents of the texture aren't all that decide what the display shows.
+    const ryz_present_state presentState =
+    {
+        presentTexture,
+        sourceRect,
+        ryzOrientation,
+        distortionMesh,
+        colorLut,
+        layersVersion,
+        metalKitView
+    };
+    
+    // If anything else changed since the last presented frame, then the frame has to be presented regardless of its contents.
+    bool changed = forcePresent ||
+        presentState.sourceTexture != lastPresentState.sourceTexture ||
+        presentState.view != lastPresentState.view ||
+        presentState.orientation != lastPresentState.orientation ||
+        presentState.distortionMesh != lastPresentState.distortionMesh ||
+        presentState.colorLut != lastPresentState.colorLut ||
+        presentState.layersVersion != lastPresentState.layersVersion ||
+        memcmp(&presentState.sourceRect, &lastPresentState.sourceRect, sizeof(normalized_rect)) != 0;
+    
+    if (applicationDamage)
+    {
+        changed |= damaged;
+    }
+    else
+    {
+        // The hasher's latch has to be cleared either way, so that a change it already reported isn't presented twice.
+        changed |= tileHasher.consume_changed();
+    }
+    
+    // If no frame has changed since the last one presented, then skip this one.
+    if (!changed)
+    {
+        return false;
+    }
+    
+    lastPresentState = presentState;
+    
+    return true;
+}
+
+// @brief: Handles when graphics thread starts.
+/// @param subsystemHandle A handle to the Unity subsystem.
+/// @param renderingCaps The rendering capabilities.
+/// @returns: A error code that indicates success or failure of the function.
+/// @remarks This function runs on the Unity render thread, separate from the main thread.
+UnitySubsystemErrorCode ikin_ryz_displayer::start_in_graphics_thread(UnitySubsystemHandle subsystemHandle, UnityXRRenderingCapabilities *renderingCaps)
+{
+    // The eyes are rendered side by side into one texture when they can be, and into textures of their own otherwise.
+    renderingCaps->supportedTextureLayoutFlags = kUnityXRTextureLayoutFlagsSingleTexture2D | kUnityXRTextureLayoutFlagsSeparateTexture2Ds;
+    
+    // Start at full resolution and render into the whole texture until Unity hints otherwise.
+    textureResolutionScale = 1.0f;
+    renderViewport = { 0.0f, 0.0f, 1.0f, 1.0f };
+    eyeRenderViewports[main_eye] = eyeRenderViewports[ryz_eye] = renderViewport;
+    ryzFramesSinceRendered = 0;
+    
+    // Until Unity hints otherwise, the eyes that follow the application's formats are 8-bit linear, and may share a texture.
+    appSRGB = false;
+    app16BitColorBuffers = false;
+    appTextureLayout = kUnityXRTextureLayoutFlagsSingleTexture2D;
+    
+    create_textures(subsystemHandle);
+
+    return kUnitySubsystemErrorCodeSuccess;
+}
+
+/// @brief: Handles when the XR display subsystem is started.
+/// @param subsystemHandle A handle to the Unity subsystem.
+/// @returns: A error code that indicates success or failure of the function.
+UnitySubsystemErrorCode ikin_ryz_displayer::on_display_subsystem_started(UnitySubsystemHandle subsystemHandle)
+{
+    XR_TRACE("A display's subsystem has been started!\n");
+    XR_TRACE([[[NSThread currentThread] description] UTF8String]);
+
+    return kUnitySubsystemErrorCodeSuccess;
+}
+
+/// @brief: Handles when the XR display subsystem is stopped.
+/// @param subsystemHandle A handle to the Unity subsystem.
+void ikin_ryz_displayer::on_display_subsystem_stopped(UnitySubsystemHandle subsystemHandle)
+{
+    XR_TRACE("A display's subsystem has been stopped!\n");
+    XR_TRACE([[[NSThread currentThread] description] UTF8String]);
+}
 
 /// @brief: Handles when the XR display subsystem is shut down.
 /// @param subsystemHandle A handle to the Unity subsystem.
@@ -580,6 +1500,17 @@ void ikin_ryz_displayer::on_display_subsystem_shutdown(UnitySubsystemHandle subs
 {
     XR_TRACE("A display's subsystem has been shutdown!\n");
     XR_TRACE([[[NSThread currentThread] description] UTF8String]);
+
+    // Unity cleans up the occlusion meshes on shut down, so rebuild them if the subsystem starts again.
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        occlusionMeshIds[eye] = 0;
+    }
+    
+    eyeOcclusionSettingsChanged = true;
+    
+    // Keep what led up to the shut down, if the app set where to.
+    dump_flight_recorder_on_shutdown();
 }
 
 /// @brief: Populates the description of the next XR frame.
@@ -597,6 +1528,7 @@ UnitySubsystemErrorCode ikin_ryz_displayer::on_populate_next_frame_descriptor(Un
 
     BEGIN_SAMPLE(onPopulateNextFrameDescriptor);
     
+    record_input(input_trace_frame_hints, frameHints, sizeof(*frameHints));
     
 #if TRACE
     {
@@ -606,127 +1538,145 @@ UnitySubsystemErrorCode ikin_ryz_displayer::on_populate_next_frame_descriptor(Un
     }
 #endif
 
-    // If the frame hint should not use single pass rendering, then:
-    if (/* DISABLES CODE */ (false))
+    // The textures need to be recreated if the eye formats were changed since they were created.
+    bool recreateTextures = eyeFormatSettingsChanged.exchange(false);
+    
+    // They also need to be recreated if Unity asks for a different resolution scale.
+    const float requestedResolutionScale = frameHints->appSetup.textureResolutionScale;
+    
+    if (requestedResolutionScale > 0.0f && requestedResolutionScale != textureResolutionScale)
     {
-        XR_TRACE("Performing multi pass rendering.\n");
-        
-        // Use multi-pass rendering to render.
-
-        // Can increase render pass count to do wide FOV or to have a separate view into scene.
-        nextFrame->renderPassesCount = 2;
-
-#if TRACE
+        textureResolutionScale = requestedResolutionScale;
+        recreateTextures = true;
+    }
+    
+    // And if the application asks for other color formats or another texture layout,
+    // or the eyes start or stop being able to share a texture, such as when the Ryz eye starts being rendered at another rate.
+    appSRGB = frameHints->appSetup.sRGB;
+    app16BitColorBuffers = frameHints->appSetup.use16BitColorBuffers;
+    appTextureLayout = frameHints->appSetup.selectedTextureLayoutFlag;
+    
+    eye_format_settings formatSettings[eye_count];
+    
+    if (get_eye_texture_layout(formatSettings) != eyeTexturesShared)
+    {
+        recreateTextures = true;
+    }
+    
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        if (formatSettings[eye].colorFormat != eyeRenderTargets[eye].formatSettings.colorFormat ||
+            formatSettings[eye].depthFormat != eyeRenderTargets[eye].formatSettings.depthFormat)
         {
-            std::stringstream stringStream;
-            stringStream << "Number of render passes: " << nextFrame->renderPassesCount << "\n";
-            XR_TRACE(stringStream.str().c_str());
+            recreateTextures = true;
         }
-#endif
-
-        // For each pass in the render passes, do the following:
-        for (int pass = 0; pass < nextFrame->renderPassesCount; ++pass)
-        {
-            // Retrieve the render pass.
-            auto& renderPass = nextFrame->renderPasses[pass];
-
-            XR_TRACE("The render pass has a texture that is the same for both eyes.\n");
-
-            // They will be drawn side by side, so just use the one Unity texture for both render passes.
-            renderPass.textureId = unityColorRenderTextureId;
-
-            // For this pass there is one set of render params.
-            renderPass.renderParamsCount = 1;
-
-            // Note: culling is shared between multiple passes by setting this to the same index.
-            renderPass.cullingPassIndex = pass;
-
-            // Get the culling pass.
-            auto& cullingPass = nextFrame->cullingPasses[pass];
-            
-            // Fill out the culling pass' separation.
-            cullingPass.separation = 0.0;
-
-            // Fill out render params. View, projection, viewport for pass.
-            auto& renderParams = renderPass.renderParams[0];
-
-            // Set the pose for each pass.
-            renderParams.deviceAnchorToEyePose = cullingPass.deviceAnchorToCullingPose = get_pose();
-
-            // Set the projection matrix for each pass.
-            renderParams.projection = cullingPass.projection = get_projection(pass, dimension);
-
-            XR_TRACE("Viewport for each eye is in the same texture, so the viewport is in different sections of the texture.\n");
+    }
+    
+    // If the textures are out of date, then:
+    if (recreateTextures)
+    {
+        XR_TRACE("Recreating the eye textures.\n");
+        
+        // Recreate them now, before Unity is told which textures to render the next frame to.
+        destroy_textures(subsystemHandle);
+        create_textures(subsystemHandle);
+    }
+    
+    // Render into the part of each texture that Unity asks for. Shrinking it costs nothing, since nothing is reallocated.
+    const UnityXRRectf& requestedViewport = frameHints->appSetup.renderViewport;
+    
+    if (requestedViewport.width > 0.0f && requestedViewport.height > 0.0f)
+    {
+        renderViewport = requestedViewport;
+    }
 
-            XR_TRACE(rect_description(frameHints->appSetup.renderViewport));
-            
-            renderParams.viewportRect = {
-                pass == 0 ? 0.0f : 0.5f,    // x
-                0.0f,                       // y
-                0.5f,                       // width
-                1.0f                        // height
-            };
-        }
+    // If the visible regions of the eyes were changed since the occlusion meshes were built, then rebuild them.
+    if (eyeOcclusionSettingsChanged.exchange(false))
+    {
+        XR_TRACE("Rebuilding the occlusion meshes.\n");
+        
+        update_occlusion_meshes(subsystemHandle);
+    }
+    
+    // Render the Ryz eye on every divisor-th frame, or whenever its texture has nothing in it to repeat.
+    // Leaving its pass out of the descriptor is what keeps Unity from culling and rendering the scene for it.
+    ryzRenderedThisFrame = eyeRenderTargetsEmpty[ryz_eye] || ryzFramesSinceRendered + 1 >= ryzFrameRateDivisor.load(std::memory_order_relaxed);
+    
+    if (ryzRenderedThisFrame)
+    {
+        ryzFramesSinceRendered = 0;
     }
     else
     {
-        XR_TRACE("Performing single-pass rendering.\n");
-
-        // Otherwise, they are using single pass rendering.
-
-        // Example of using single-pass stereo to combine the first two render passes.
-        nextFrame->renderPassesCount = 1;
-
-#if TRACE
-        {
-            std::stringstream stringStream;
-            stringStream << "Number of render passes: " << nextFrame->renderPassesCount << "\n";
-            XR_TRACE(stringStream.str().c_str());
-        }
-#endif
-
-        UnityXRNextFrameDesc::UnityXRRenderPass& renderPass = nextFrame->renderPasses[0];
-
-        // Texture that unity will render to next frame.  We created it above.
-        // You might want to change this dynamically to double / triple buffer.
-        renderPass.textureId = unityColorRenderTextureId;
-
-        // Two sets of render params for first pass, view / projection for each eye.  Fill them out next.
-        renderPass.renderParamsCount = 2;
+        ++ryzFramesSinceRendered;
+        
+        frameStatsCounters.ryzFramesRepeated.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // In Ryz-only mode the main eye is left out too, once it has an image for the mirror view to keep showing.
+    const bool mainRenderedThisFrame = eyeRenderTargetsEmpty[main_eye] || !ryzOnly.load(std::memory_order_relaxed);
+    
+    if (!mainRenderedThisFrame)
+    {
+        frameStatsCounters.mainFramesDropped.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        for (int eye = 0; eye < renderPass.renderParamsCount; ++eye)
-        {
-            UnityXRNextFrameDesc::UnityXRRenderPass::UnityXRRenderParams& renderParams = renderPass.renderParams[eye];
+    XR_TRACE(eyeTexturesShared ? "Performing single pass rendering.\n" : "Performing multi pass rendering.\n");
+    
+    // Eyes that share a texture are rendered in a single pass, and eyes with their own texture, which can be in its own format, in a pass each.
+    // The eyes that aren't rendered this frame get no pass. If neither is, then Unity renders nothing for the frame.
+    int passEyes[eye_count];
+    int passEyeCount = 0;
+    
+    if (mainRenderedThisFrame)
+    {
+        passEyes[passEyeCount++] = main_eye;
+    }
+    
+    if (ryzRenderedThisFrame)
+    {
+        passEyes[passEyeCount++] = ryz_eye;
+    }
 
-            renderParams.deviceAnchorToEyePose = get_pose();
-            renderParams.projection = get_projection(eye, dimension);
+    // Describe the texture and occlusion mesh of each eye to the passes.
+    // Unity's viewport is relative to each eye, so within the eye's half of a texture that the eyes share.
+    eye_pass_target targets[eye_count];
+    
+    for (int eye = 0; eye < eye_count; ++eye)
+    {
+        id<MTLTexture> texture = eyeRenderTargets[eye].nativeColorRenderTexture;
+        
+        targets[eye].textureId = eyeRenderTargets[eye].unityColorRenderTextureId;
+        targets[eye].occlusionMeshId = occlusionMeshIds[eye];
+        targets[eye].occludedFraction = occlusionMeshes[eye].occludedFraction;
+        targets[eye].viewport = viewport_rect(eyeRenderTargets[eye].textureRect, renderViewport);
+        targets[eye].textureWidth = (uint32_t)texture.width;
+        targets[eye].textureHeight = (uint32_t)texture.height;
+    }
+    
+    // The eyes that are rendered this frame will have an image, in the part of their texture that Unity asked for.
+    for (int index = 0; index < passEyeCount; ++index)
+    {
+        eyeRenderTargetsEmpty[passEyes[index]] = false;
+        eyeRenderViewports[passEyes[index]] = renderViewport;
+    }
+    
+    XR_TRACE(rect_description(frameHints->appSetup.renderViewport));
+    
+    // The number of pixels that the occlusion meshes keep from being shaded this frame.
+    const uint64_t occludedPixels = populate_render_passes(passEyes, passEyeCount, targets,
+                                                           (float)dimension.width, (float)dimension.height, nextFrame);
 
 #if TRACE
-            {
-                std::stringstream stringStream;
-                stringStream << "Viewport for eye " << eye << "shares in the same texture for all eyes, so the viewport is in different sections of the texture.\n";
-                XR_TRACE(stringStream.str().c_str());
-            }
+    {
+        std::stringstream stringStream;
+        stringStream << "Number of render passes: " << nextFrame->renderPassesCount << "\n";
+        XR_TRACE(stringStream.str().c_str());
+    }
 #endif
-            
-            XR_TRACE(rect_description(renderParams.viewportRect));
-            XR_TRACE(rect_description(frameHints->appSetup.renderViewport));
-            
-            renderParams.viewportRect =
-            {
-                eye == 0 ? 0.0f : 0.5f, // x
-                0.0f,                   // y
-                0.5f,                   // width
-                1.0f                    // height
-            };
-        }
 
-        renderPass.cullingPassIndex = 0;
-        UnityXRNextFrameDesc::UnityXRCullingPass& cullingPass = nextFrame->cullingPasses[0];
-        cullingPass.deviceAnchorToCullingPose = get_pose();
-        cullingPass.projection = get_projection(0, dimension);
-        cullingPass.separation = 0.625f;
-    }
+    frameStatsCounters.occludedPixels.fetch_add(occludedPixels, std::memory_order_relaxed);
+    frameStatsCounters.occludedPixelsLastFrame.store(occludedPixels, std::memory_order_relaxed);
 
     END_SAMPLE(onPopulateNextFrameDescriptor);
     
@@ -745,45 +1695,58 @@ UnitySubsystemErrorCode ikin_ryz_displayer::on_populate_mirror_view_descriptor(U
     XR_TRACE("Handling population of mirror view descriptor.\n");
     XR_TRACE([[[NSThread currentThread] description] UTF8String]);
 
-    // If we are not displaying the left eye, then:
-    if (blitInfo->mirrorBlitMode != kUnityXRMirrorBlitLeftEye)
-    {
-        // Do not map the texture to any area on the main screen.
-        return kUnitySubsystemErrorCodeFailure;
-    }
-    
     BEGIN_SAMPLE(onPopulateMirrorViewDescriptor);
     
-    blitDescriptor->nativeBlitAvailable = true;
+    // Unity does every copy described here itself, so no native blit callback is registered.
+    blitDescriptor->nativeBlitAvailable = false;
     blitDescriptor->nativeBlitInvalidStates = false;
-
-    // Describe that we are only going to be performing one blit.
-    blitDescriptor->blitParamsCount = 1;
-
-    // Get a reference to the object that describes out blit.
-    UnityXRMirrorViewBlitDesc::UnityXRBlitParams& blitParam = blitDescriptor->blitParams[0];
-
-    // Define which texture is the one we are blitting from.
-    blitParam.srcTexId = unityColorRenderTextureId;
-
-    blitParam.srcTexArraySlice = 0;
-
-    // Define the homogeneous region that the blit is reading from.
-    blitParam.srcRect =
+    blitDescriptor->blitParamsCount = 0;
+    
+    // The mirror view is shown on the main screen, so the main eye is read in the orientation of the main screen.
+    // The Ryz eye is read as it was rendered, since its orientation only applies to the Ryz display.
+    // Only the part of each eye that was rendered into is read, from the eye's half of the texture if the eyes share one.
+    const UnityXRRectf mainSourceRect = viewport_rect(viewport_rect(eyeRenderTargets[main_eye].textureRect, eyeRenderViewports[main_eye]),
+                                                      oriented_source_rect(eyeOrientations[main_eye].load(std::memory_order_relaxed)));
+    const UnityXRRectf ryzSourceRect = viewport_rect(viewport_rect(eyeRenderTargets[ryz_eye].textureRect, eyeRenderViewports[ryz_eye]),
+                                                     oriented_source_rect(orientation_none));
+    
+    const UnityXRRenderTextureId mainTextureId = eyeRenderTargets[main_eye].unityColorRenderTextureId;
+    const UnityXRRenderTextureId ryzTextureId = eyeRenderTargets[ryz_eye].unityColorRenderTextureId;
+    
+    switch (blitInfo->mirrorBlitMode)
     {
-        0.0f,
-        0.0f,
-        0.5f,
-        1.0f
-    };
-
-    // Define the homogeneous region that the blit is writing from.
-    blitParam.destRect = {
-        0.0f,
-        0.0f,
-        1.0f,
-        1.0f
-    };
+        case kUnityXRMirrorBlitLeftEye:
+            // Fill the mirror view with the main eye.
+            add_mirror_blit(blitDescriptor, mainTextureId, mainSourceRect, { 0.0f, 0.0f, 1.0f, 1.0f });
+            break;
+            
+        case kUnityXRMirrorBlitRightEye:
+            // Fill the mirror view with the Ryz eye.
+            add_mirror_blit(blitDescriptor, ryzTextureId, ryzSourceRect, { 0.0f, 0.0f, 1.0f, 1.0f });
+            break;
+            
+        case kUnityXRMirrorBlitSideBySide:
+            // Put the main eye on the left half of the mirror view and the Ryz eye on the right half.
+            add_mirror_blit(blitDescriptor, mainTextureId, mainSourceRect, { 0.0f, 0.0f, 0.5f, 1.0f });
+            add_mirror_blit(blitDescriptor, ryzTextureId, ryzSourceRect, { 0.5f, 0.0f, 0.5f, 1.0f });
+            break;
+            
+        case mirror_blit_picture_in_picture:
+        {
+            // Fill the mirror view with the main eye, then draw the Ryz eye over the inset region.
+            const normalized_rect insetRect = mirrorPictureInPictureRect.load(std::memory_order_relaxed);
+            
+            add_mirror_blit(blitDescriptor, mainTextureId, mainSourceRect, { 0.0f, 0.0f, 1.0f, 1.0f });
+            add_mirror_blit(blitDescriptor, ryzTextureId, ryzSourceRect, { insetRect.x, insetRect.y, insetRect.width, insetRect.height });
+            break;
+        }
+            
+        default:
+            END_SAMPLE(onPopulateMirrorViewDescriptor);
+            
+            // Do not map the texture to any area on the main screen.
+            return kUnitySubsystemErrorCodeFailure;
+    }
 
     END_SAMPLE(onPopulateMirrorViewDescriptor);
 
@@ -800,22 +1763,70 @@ UnitySubsystemErrorCode ikin_ryz_displayer::on_submit_current_frame_in_graphics_
 
     XR_TRACE([[[NSThread currentThread] description] UTF8String]);
 
+    name_timeline_thread("Unity render thread");
+    
     BEGIN_SAMPLE(onSubmitCurrentFrameInGraphicsThread);
+    
+    // The flight recorder keeps the time each frame took, and the interval between them.
+    const uint64_t flightFrameStart = flight_recorder_now();
+    
+    const uint64_t frameIndex = frameStatsCounters.framesSubmitted.fetch_add(1, std::memory_order_relaxed) + 1;
+    
+    record_input(input_trace_submit, &frameIndex, sizeof(frameIndex));
+    
+    // The frame's flow on the timeline starts where it is submitted, and is followed to the display.
+    timeline_flow(timeline_flow_start, frameIndex);
+    
+    BEGIN_SAMPLE(captureMainEye);
+    
+    // If the main eye is being captured, then copy it whether or not a Ryz display is connected.
+    // The copy is queued behind Unity's rendering of the eye, in Unity's own command buffer.
+    captureRing.begin_frame();
+    
+    if ((get_capture_eye_mask() & (1 << main_eye)) != 0)
+    {
+        metalInterface->EndCurrentCommandEncoder();
+        captureRing.encode(metalInterface->CurrentCommandBuffer(),
+                           main_eye,
+                           eyeRenderTargets[main_eye].nativeColorPresentTexture,
+                           eyeRenderTargets[main_eye].region,
+                           frameIndex);
+    }
+    
+    END_SAMPLE(captureMainEye);
 
     BEGIN_SAMPLE(posixRWLock);
     
+    const uint64_t lockStart = flight_recorder_now();
+    
     // Lock the usage of the Metal Kit View.
-    if (pthread_rwlock_trywrlock(&lock) != 0)
+    const bool locked = pthread_rwlock_trywrlock(&lock) == 0;
+    
+    if (!locked)
     {
         XR_TRACE("Failed to lock Read/Write lock\n");
     }
     
+    record_flight_wait(flight_lock_wait, lockStart, locked ? 0 : 1);
+    
     END_SAMPLE(posixRWLock);
     
-#if SECOND_UI_SCREEN
-    if (metalKitView != nil)
+    // If the lock wasn't taken, then the view is being created or a frame is being synthesized into it, so this frame isn't presented.
+    // A later frame is presented in its place.
+    if (!locked)
     {
+        forceRyzPresent = true;
+        
+        timeline_mark("Ryz view busy");
+        timeline_flow(timeline_flow_end, frameIndex);
+    }
+    
+#if SECOND_UI_SCREEN
+    if (locked && metalKitView != nil)
+#else
+    if (locked)
 #endif
+    {
         
     #if SECOND_UI_VIEW
         
@@ -832,76 +1843,254 @@ UnitySubsystemErrorCode ikin_ryz_displayer::on_submit_current_frame_in_graphics_
         
         END_SAMPLE(getCurrentCommandBuffer);
          
-        // The source texture of the blit is the left eye texture.
-        __unsafe_unretained id<MTLTexture> sourceRenderTexture = nativeColorRenderTexture;
+        // The source of the copy is the Ryz eye texture.
+        eye_render_target& ryzRenderTarget = eyeRenderTargets[ryz_eye];
+        
+        const eye_orientation ryzOrientation = eyeOrientations[ryz_eye].load(std::memory_order_relaxed);
+        
+        const damage_tracking_mode damageMode = damageTrackingMode.load(std::memory_order_relaxed);
+        
+        // If a distortion mesh has been loaded for the Ryz optics, then the image is warped through it as it is presented.
+        id<MTLTexture> distortionMesh = distortionMap.update(metalInterface->MetalDevice());
+        
+        // Likewise, if a color lookup table has been loaded for the Ryz panel, then the image is mapped through it in the same pass.
+        id<MTLTexture> colorLut = colorLutMap.update(metalInterface->MetalDevice());
+        
+        // Frames queued on the layers from outside of Unity, such as decoded video, replace their textures once they are due.
+        // They are due if their presentation time comes before this frame is expected on the display, one refresh from now.
+        const NSInteger framesPerSecond = std::max<NSInteger>(metalKitView.preferredFramesPerSecond, 1);
+        surfaceLayers.update(commandBuffer, metalInterface->MetalDevice(), CACurrentMediaTime() + 1.0 / framesPerSecond);
+        
+        // The composition layers are blended over the eye in their own pass, after it is drawn.
+        composition_layer layers[maxCompositionLayers];
+        uint64_t layersVersion = 0;
+        const int layerCount = get_composition_layers(layers, layersVersion);
+        
+        BEGIN_SAMPLE(copyRyzDamage);
+        
+        // The bytes read this frame are added up by the damage copy and the present, whichever of them happen.
+        frameStatsCounters.ryzBytesLastFrame.store(0, std::memory_order_relaxed);
+        
+        // If damage is being tracked, then only the changed regions of the eye are copied, and the display is presented from their copy.
+        bool damaged = true;
+        id<MTLTexture> presentTexture = copy_ryz_damage(commandBuffer, ryzRenderTarget, damageMode, ryzRenderedThisFrame, damaged);
+        const bool presentFromDamageCopy = presentTexture != ryzRenderTarget.nativeColorPresentTexture;
+        
+        END_SAMPLE(copyRyzDamage);
+        
+        // The region of the Ryz eye that Unity last rendered into, which is this frame's unless the Ryz eye is being repeated.
+        // The damage copy holds just the Ryz eye, while the eye texture can hold the main eye beside it.
+        const normalized_rect sourceRect = viewport_texture_rect(presentFromDamageCopy
+                                                                     ? eyeRenderViewports[ryz_eye]
+                                                                     : viewport_rect(ryzRenderTarget.textureRect, eyeRenderViewports[ryz_eye]));
+        
+        // Frames that look the same as the last presented frame don't need to be presented again, if they are being skipped.
+        const bool presentFrame = should_present_ryz_frame(commandBuffer, presentTexture, sourceRect, ryzOrientation, distortionMesh, colorLut, layersVersion, damageMode, ryzRenderedThisFrame, damaged);
         
         // Adding an auto-release pool here to free-up the blit encoder and the drawable
         @autoreleasepool
         {
-            BEGIN_SAMPLE(blitCommandEncoder);
-//
-            // Request the current command buffer from the Metal interface. Request the command encoder for blitting.
-            id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
-//
-#if SECOND_UI_SCREEN
             // These may not be ready or free due to the fact that Metal Kit View is created in a different thread.
-            if (metalKitView.currentDrawable != nil && metalKitView.currentDrawable.texture != nil)
+            // A skipped frame leaves the last presented image on the display, so it doesn't need a drawable.
+            // Getting one blocks when every drawable is still on its way to the display, which the flight recorder keeps.
+            const uint64_t drawableStart = flight_recorder_now();
+            
+            id<CAMetalDrawable> drawable = presentFrame ? metalKitView.currentDrawable : nil;
+            
+            if (presentFrame)
             {
-#endif
-//
-                NSInteger width = sourceRenderTexture.width / 2;
-                // Use the blit command encoder to copy the texture from the source to the destination texture.
-                [blitEncoder copyFromTexture : sourceRenderTexture
-                                 sourceSlice : 0
-                                 sourceLevel : 0
-                                sourceOrigin : MTLOriginMake(width, 0, 0)
-                                  sourceSize : MTLSizeMake(width, sourceRenderTexture.height, 1)
-                                   toTexture : metalKitView.currentDrawable.texture
-                            destinationSlice : 0
-                            destinationLevel : 0
-                           destinationOrigin : MTLOriginMake(0, 0, 0)];
-//
-                XR_TRACE("Blitting source texture to the destination texture.\n");
+                record_flight_wait(flight_drawable_wait, drawableStart);
+            }
+            
+            // If the frame should have been presented but can't be, then make sure a later frame is presented in its place.
+            if (presentFrame && drawable == nil)
+            {
+                forceRyzPresent = true;
                 
-#if SECOND_UI_SCREEN
+                record_flight(flight_frame_dropped, 0);
+            }
+            
+            if (drawable != nil && drawable.texture != nil && ryzRenderTarget.nativeColorRenderTexture != nil)
+            {
+                BEGIN_SAMPLE(blitCommandEncoder);
+                
+                // The pixels of the eye texture that are presented, which are fewer than the drawable's when the eye is rendered at a reduced scale.
+                const double sourceWidth = presentTexture.width * sourceRect.width;
+                const double sourceHeight = presentTexture.height * sourceRect.height;
+                
+                // If the eye texture can be copied straight into the drawable, then:
+                // A region smaller than the drawable would not fill it, so it is scaled up by the compose or upscale passes instead.
+                // A blit can't warp the image or map its colors either.
+                if (can_blit_to_drawable(ryzRenderTarget.formatSettings.colorFormat, ryzOrientation) &&
+                    distortionMesh == nil &&
+                    colorLut == nil &&
+                    (NSUInteger)sourceWidth == drawable.texture.width &&
+                    (NSUInteger)sourceHeight == drawable.texture.height)
+                {
+                    __unsafe_unretained id<MTLTexture> sourceRenderTexture = presentTexture;
+                    
+                    // Request the current command buffer from the Metal interface. Request the command encoder for blitting.
+                    id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+                    
+                    // Use the blit command encoder to copy the region from the source to the destination texture.
+                    [blitEncoder copyFromTexture : sourceRenderTexture
+                                     sourceSlice : 0
+                                     sourceLevel : 0
+                                    sourceOrigin : MTLOriginMake((NSUInteger)(sourceRenderTexture.width * sourceRect.x),
+                                                                 (NSUInteger)(sourceRenderTexture.height * sourceRect.y),
+                                                                 0)
+                                      sourceSize : MTLSizeMake(drawable.texture.width, drawable.texture.height, 1)
+                                       toTexture : drawable.texture
+                                destinationSlice : 0
+                                destinationLevel : 0
+                               destinationOrigin : MTLOriginMake(0, 0, 0)];
+                    
+                    // End the encoding of the bit encoder.
+                    [blitEncoder endEncoding];
+                    
+                    XR_TRACE("Blitting source texture to the destination texture.\n");
+                }
+                else if (ryzUpscaling.load(std::memory_order_relaxed) &&
+                         upscaler.is_initialized() &&
+                         (sourceWidth < drawable.texture.width || sourceHeight < drawable.texture.height))
+                {
+                    // Otherwise, if the eye is smaller than the drawable and upscaling is on, then reconstruct its edges as it is scaled up.
+                    upscaler.encode(commandBuffer,
+                                    presentFromDamageCopy ? presentTexture : ryzRenderTarget.nativeColorPresentTexture,
+                                    sourceRect,
+                                    drawable.texture,
+                                    ryzOrientation,
+                                    ryzUpscaleSharpness.load(std::memory_order_relaxed),
+                                    distortionMesh,
+                                    colorLut);
+                    
+                    XR_TRACE("Upscaling source texture into the destination texture.\n");
+                }
+                else if (compositor.is_initialized())
+                {
+                    // Otherwise, sample the eye texture in a compose pass, which converts it to the drawable format, orients it, and applies the calibration.
+                    // The damage copy keeps the encoded bytes of sRGB eyes, the same as a blit into the drawable would.
+                    compositor.encode(commandBuffer,
+                                      presentFromDamageCopy ? presentTexture : ryzRenderTarget.nativeColorPresentTexture,
+                                      sourceRect,
+                                      drawable.texture,
+                                      ryzOrientation,
+                                      distortionMesh,
+                                      colorLut);
+                    
+                    XR_TRACE("Composing source texture into the destination texture.\n");
+                }
+                
+                // Blend the layers over the eye, whichever way it was drawn.
+                if (layerCount > 0 && layerCompositor.is_initialized())
+                {
+                    layerCompositor.encode(commandBuffer, drawable.texture, layers, layerCount, ryzOrientation, distortionMesh, colorLut);
+                    
+                    XR_TRACE("Blending composition layers into the destination texture.\n");
+                }
+                
+                END_SAMPLE(blitCommandEncoder);
+                
+                // If the Ryz eye is being captured, then copy what the display shows, with its calibration and layers.
+                captureRing.encode(commandBuffer, ryz_eye, drawable.texture, MTLRegionMake2D(0, 0, drawable.texture.width, drawable.texture.height), frameIndex);
+                
+                // If frames are synthesized when Unity misses one, then keep a copy of what is presented to synthesize them from.
+                if (frameSynthesis.load(std::memory_order_relaxed) && frameSynthesizer.is_initialized())
+                {
+                    frameSynthesizer.record(commandBuffer, drawable.texture, uv_transform(ryzOrientation, sourceRect));
+                }
+                else
+                {
+                    frameSynthesizer.clear();
+                }
+                
+                // Keep count of how many bytes are read to present the eye, whether from the eye texture or its damage copy.
+                // The damage copy has counted the bytes it read from the eye texture, and these are read on top of them.
+                const uint64_t bytesCopied = (uint64_t)sourceWidth * (uint64_t)sourceHeight *
+                    color_format_byte_size(ryzRenderTarget.formatSettings.colorFormat);
+                
+                frameStatsCounters.ryzBytesCopied.fetch_add(bytesCopied, std::memory_order_relaxed);
+                frameStatsCounters.ryzBytesLastFrame.fetch_add(bytesCopied, std::memory_order_relaxed);
             }
-#endif
-//
-            // End the encoding of the bit encoder.
-            [blitEncoder endEncoding];
-//
-            END_SAMPLE(blitCommandEncoder);
          
             // These may not be ready or free due to the fact that Metal Kit View is created in a different thread.
-            if (metalKitView.currentDrawable != nil)
+            if (drawable != nil)
             {
                 BEGIN_SAMPLE(presentDrawable);
-//
+                
+                timeline_flow(timeline_flow_step, frameIndex);
+                
+                // If the counters are shown, then count the frame as in flight until the GPU finishes it.
+                if (profilerCountersInterface != nullptr)
+                {
+                    ryzFramesInFlight.fetch_add(1, std::memory_order_relaxed);
+                    
+                    std::atomic<int>* framesInFlight = &ryzFramesInFlight;
+                    
+                    [commandBuffer addCompletedHandler : ^(id<MTLCommandBuffer>)
+                    {
+                        framesInFlight->fetch_sub(1, std::memory_order_relaxed);
+                    }];
+                }
+                
+                // If the timeline is being recorded, then follow the frame onto the GPU and the display.
+                if (timelineRecording.load(std::memory_order_relaxed))
+                {
+                    [commandBuffer addCompletedHandler : ^(id<MTLCommandBuffer>)
+                    {
+                        name_timeline_thread("Metal completion");
+                        timeline_milestone("GPU complete", timeline_flow_step, frameIndex);
+                    }];
+                    
+                    [drawable addPresentedHandler : ^(id<MTLDrawable>)
+                    {
+                        name_timeline_thread("Drawable presentation");
+                        timeline_milestone("On Ryz display", timeline_flow_end, frameIndex);
+                    }];
+                }
+
                 // Schedule a presention once the framebuffer is complete using the current drawable.
-                [commandBuffer presentDrawable : metalKitView.currentDrawable];
-//
+                [commandBuffer presentDrawable : drawable];
+
                 END_SAMPLE(presentDrawable);
+                
+                frameStatsCounters.framesPresented.fetch_add(1, std::memory_order_relaxed);
+                
+                record_flight(flight_frame_presented, 0);
+                
+                XR_TRACE("Presenting drawable surface to the screen.\n");
+            }
+            else if (!presentFrame)
+            {
+                frameStatsCounters.framesSkipped.fetch_add(1, std::memory_order_relaxed);
+                
+                timeline_mark("Ryz frame skipped");
+                timeline_flow(timeline_flow_end, frameIndex);
+                
+                record_flight(flight_frame_skipped, 0);
+                
+                XR_TRACE("Skipping a frame that looks the same as the last presented frame.\n");
             }
-        
-            XR_TRACE("Presenting drawable surface to the screen.\n");
             
         } // end of auto-release pool
     #endif
         
-#if SECOND_UI_SCREEN
     }
-#endif
     
     BEGIN_SAMPLE(posixRWUnlock);
     
-    // Unlock the usage of the Metal Kit View.
-    if (pthread_rwlock_unlock(&lock) != 0)
+    // Unlock the usage of the Metal Kit View, if this thread locked it.
+    if (locked && pthread_rwlock_unlock(&lock) != 0)
     {
         XR_TRACE("Failed to unlock Read/Write lock\n");
     }
     
     END_SAMPLE(posixRWUnlock);
     
+    record_flight_frame(flightFrameStart);
+    
+    update_profiler_counters();
+    
     END_SAMPLE(onSubmitCurrentFrameInGraphicsThread);
 
     return kUnitySubsystemErrorCodeSuccess;
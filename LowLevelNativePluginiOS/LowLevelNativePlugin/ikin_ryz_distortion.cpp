@@ -0,0 +1,217 @@
+//
+//  ikin_ryz_distortion.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_distortion.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ikin_ryz_pixel_simd.h"
+
+using namespace pixel_simd;
+
+/// @brief: Loads a distortion mesh from a calibration file.
+/// @param path The path of the file.
+/// @param mesh The mesh that is loaded. Left unchanged if the file can't be loaded.
+/// @returns: True if the mesh was loaded, false if the file is missing or malformed.
+bool load_distortion_mesh(const char* path, distortion_mesh& mesh)
+{
+    std::ifstream file(path);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    // Gather the values, leaving out the comments.
+    std::stringstream values;
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] != '#')
+        {
+            values << line << '\n';
+        }
+    }
+
+    distortion_mesh loaded;
+
+    if (!(values >> loaded.columns >> loaded.rows) ||
+        loaded.columns < 2 || loaded.columns > maxDistortionMeshSize ||
+        loaded.rows < 2 || loaded.rows > maxDistortionMeshSize)
+    {
+        return false;
+    }
+
+    std::shared_ptr<std::vector<float>> coordinates = std::make_shared<std::vector<float>>(loaded.columns * loaded.rows * 2);
+
+    for (float& coordinate : *coordinates)
+    {
+        // If a vertex is missing or isn't a number, then the whole file is rejected rather than drawing a torn image.
+        if (!(values >> coordinate) || !std::isfinite(coordinate))
+        {
+            return false;
+        }
+    }
+
+    loaded.coordinates = std::shared_ptr<const float>(coordinates, coordinates->data());
+
+    mesh = std::move(loaded);
+
+    return true;
+}
+
+/// @brief: Gets the point of the image that is drawn at a point of the display.
+/// @param mesh The distortion mesh.
+/// @param x The horizontal position on the display, from 0 at its left edge to 1 at its right edge.
+/// @param y The vertical position on the display, from 0 at its top edge to 1 at its bottom edge.
+/// @param imageX The horizontal image coordinate.
+/// @param imageY The vertical image coordinate.
+void sample_distortion_mesh(const distortion_mesh& mesh, float x, float y, float& imageX, float& imageY)
+{
+    // Find the cell the point is in, and where in the cell it is.
+    const float gridX = std::min(std::max(x, 0.0f), 1.0f) * (mesh.columns - 1);
+    const float gridY = std::min(std::max(y, 0.0f), 1.0f) * (mesh.rows - 1);
+    const int column = std::min((int)gridX, mesh.columns - 2);
+    const int row = std::min((int)gridY, mesh.rows - 2);
+    const float fractionX = gridX - column;
+    const float fractionY = gridY - row;
+
+    const float* topLeft = mesh.coordinates.get() + (row * mesh.columns + column) * 2;
+    const float* bottomLeft = topLeft + mesh.columns * 2;
+
+    // Blend the corners of the cell.
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        const float top = topLeft[axis] + (topLeft[axis + 2] - topLeft[axis]) * fractionX;
+        const float bottom = bottomLeft[axis] + (bottomLeft[axis + 2] - bottomLeft[axis]) * fractionX;
+
+        (axis == 0 ? imageX : imageY) = top + (bottom - top) * fractionY;
+    }
+}
+
+/// @brief: Draws a 32-bit image through a distortion mesh, so that it looks undistorted through the optics.
+/// @param source The first row of the image.
+/// @param sourceWidth The width of the image in pixels.
+/// @param sourceHeight The height of the image in pixels.
+/// @param sourceBytesPerRow The distance between the start of two rows of the image, in bytes.
+/// @param destination The first row of the warped image.
+/// @param destinationWidth The width of the warped image in pixels.
+/// @param destinationHeight The height of the warped image in pixels.
+/// @param destinationBytesPerRow The distance between the start of two rows of the warped image, in bytes.
+/// @param mesh The distortion mesh.
+void warp_image(const uint8_t* source, int sourceWidth, int sourceHeight, size_t sourceBytesPerRow,
+                uint8_t* destination, int destinationWidth, int destinationHeight, size_t destinationBytesPerRow,
+                const distortion_mesh& mesh)
+{
+    // Every row of pixels crosses the same columns of the mesh, so find the column each pixel is in, and where in it, once.
+    // The last group of pixels is padded to four, past the right edge of the display, which clamps to the last column.
+    const int paddedWidth = (destinationWidth + 3) & ~3;
+    std::vector<int32_t> meshColumns((size_t)paddedWidth);
+    std::vector<float> meshFractionsX((size_t)paddedWidth);
+
+    for (int x = 0; x < paddedWidth; ++x)
+    {
+        const float gridX = std::min(std::max((x + 0.5f) / destinationWidth, 0.0f), 1.0f) * (mesh.columns - 1);
+        const int column = std::min((int)gridX, mesh.columns - 2);
+
+        meshColumns[x] = column * 2;
+        meshFractionsX[x] = gridX - column;
+    }
+
+    const float* coordinates = mesh.coordinates.get();
+
+    for (int y = 0; y < destinationHeight; ++y)
+    {
+        // The whole row of pixels is in the same row of cells of the mesh.
+        const float gridY = std::min(std::max((y + 0.5f) / destinationHeight, 0.0f), 1.0f) * (mesh.rows - 1);
+        const int row = std::min((int)gridY, mesh.rows - 2);
+        const lanes meshFractionY = splat(gridY - row);
+        const float* topCoordinates = coordinates + row * mesh.columns * 2;
+        const float* bottomCoordinates = topCoordinates + mesh.columns * 2;
+
+        for (int x = 0; x < destinationWidth; x += 4)
+        {
+            // Load the top and bottom edges of each pixel's cell, which are the x and y of their left and right corners.
+            // Transposing them gives a vector of each corner coordinate, with a lane for each pixel: 0 and 1 are the left corner's x and y, 2 and 3 the right corner's.
+            lanes top[4];
+            lanes bottom[4];
+
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                top[lane] = load(topCoordinates + meshColumns[x + lane]);
+                bottom[lane] = load(bottomCoordinates + meshColumns[x + lane]);
+            }
+
+            transpose(top[0], top[1], top[2], top[3]);
+            transpose(bottom[0], bottom[1], bottom[2], bottom[3]);
+
+            // Blend the corners of the cells, the same as @see sample_distortion_mesh does.
+            const lanes meshFractionX = load(&meshFractionsX[x]);
+            const lanes imageX = mix(mix(top[0], top[2], meshFractionX), mix(bottom[0], bottom[2], meshFractionX), meshFractionY);
+            const lanes imageY = mix(mix(top[1], top[3], meshFractionX), mix(bottom[1], bottom[3], meshFractionX), meshFractionY);
+
+            // If the optics show a pixel a point outside of the image, then it is black.
+            const lane_mask outside = either(either(less(imageX, splat(0.0f)), greater(imageX, splat(1.0f))),
+                                             either(less(imageY, splat(0.0f)), greater(imageY, splat(1.0f))));
+
+            // Filter the image bilinearly around each point, clamping to its edges.
+            const lanes positionX = subtract(multiply(imageX, splat((float)sourceWidth)), splat(0.5f));
+            const lanes positionY = subtract(multiply(imageY, splat((float)sourceHeight)), splat(0.5f));
+            const lanes baseX = round_down(positionX);
+            const lanes baseY = round_down(positionY);
+            const lanes fractionX = subtract(positionX, baseX);
+            const lanes fractionY = subtract(positionY, baseY);
+
+            int32_t left[4];
+            int32_t right[4];
+            int32_t above[4];
+            int32_t below[4];
+            store_integers(clamp(baseX, 0.0f, sourceWidth - 1.0f), left);
+            store_integers(clamp(add(baseX, splat(1.0f)), 0.0f, sourceWidth - 1.0f), right);
+            store_integers(clamp(baseY, 0.0f, sourceHeight - 1.0f), above);
+            store_integers(clamp(add(baseY, splat(1.0f)), 0.0f, sourceHeight - 1.0f), below);
+
+            int32_t topLeft[4];
+            int32_t topRight[4];
+            int32_t bottomLeft[4];
+            int32_t bottomRight[4];
+
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const int32_t aboveOffset = above[lane] * (int32_t)sourceBytesPerRow;
+                const int32_t belowOffset = below[lane] * (int32_t)sourceBytesPerRow;
+
+                topLeft[lane] = aboveOffset + left[lane] * 4;
+                topRight[lane] = aboveOffset + right[lane] * 4;
+                bottomLeft[lane] = belowOffset + left[lane] * 4;
+                bottomRight[lane] = belowOffset + right[lane] * 4;
+            }
+
+            const pixel_lanes topLeftColor = gather_pixels(source, topLeft);
+            const pixel_lanes topRightColor = gather_pixels(source, topRight);
+            const pixel_lanes bottomLeftColor = gather_pixels(source, bottomLeft);
+            const pixel_lanes bottomRightColor = gather_pixels(source, bottomRight);
+
+            pixel_lanes color;
+
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                const lanes upper = mix(topLeftColor.channel[channel], topRightColor.channel[channel], fractionX);
+                const lanes lower = mix(bottomLeftColor.channel[channel], bottomRightColor.channel[channel], fractionX);
+
+                color.channel[channel] = select(outside, splat(channel == 3 ? 1.0f : 0.0f), mix(upper, lower, fractionY));
+            }
+
+            write_pixels(destination + y * destinationBytesPerRow + x * 4, color, std::min(destinationWidth - x, 4));
+        }
+    }
+}
@@ -0,0 +1,68 @@
+//
+//  ikin_ryz_distortion.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_DISTORTION_H
+#define IKIN_RYZ_DISTORTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// @brief: The most vertices a distortion mesh can have along either axis.
+const int maxDistortionMeshSize = 256;
+
+/// @brief: A grid that maps each point of the Ryz display to the point of the Ryz image that has to be drawn there for it to look undistorted through the optics.
+/// @remarks: Measured for each device and loaded from its calibration file.
+/// Points between the vertices are interpolated bilinearly. Points that map outside of the image are drawn black.
+struct distortion_mesh
+{
+    /// @brief: The number of vertices in each row.
+    int columns;
+
+    /// @brief: The number of rows of vertices.
+    int rows;
+
+    /// @brief: The image coordinates of each vertex, as x and y pairs, row by row from the top.
+    /// @remarks: The vertices are spread evenly over the display, from its top left corner to its bottom right corner.
+    /// Image coordinates are normalized, with their origin at the top left of the image.
+    /// Shares ownership of whatever holds them, which is either the parsed file or the mapped calibration package, so they are never copied.
+    std::shared_ptr<const float> coordinates;
+};
+
+/// @brief: Loads a distortion mesh from a calibration file.
+/// @param path The path of the file.
+/// @param mesh The mesh that is loaded. Left unchanged if the file can't be loaded.
+/// @returns: True if the mesh was loaded, false if the file is missing or malformed.
+/// @remarks: The file is text. Lines starting with # are comments.
+/// The first values are the number of columns and rows, from 2 to @see maxDistortionMeshSize, followed by the x and y image coordinates of each vertex.
+bool load_distortion_mesh(const char* path, distortion_mesh& mesh);
+
+/// @brief: Gets the point of the image that is drawn at a point of the display.
+/// @param mesh The distortion mesh.
+/// @param x The horizontal position on the display, from 0 at its left edge to 1 at its right edge.
+/// @param y The vertical position on the display, from 0 at its top edge to 1 at its bottom edge.
+/// @param imageX The horizontal image coordinate.
+/// @param imageY The vertical image coordinate.
+void sample_distortion_mesh(const distortion_mesh& mesh, float x, float y, float& imageX, float& imageY);
+
+/// @brief: Draws a 32-bit image through a distortion mesh, so that it looks undistorted through the optics.
+/// @param source The first row of the image.
+/// @param sourceWidth The width of the image in pixels.
+/// @param sourceHeight The height of the image in pixels.
+/// @param sourceBytesPerRow The distance between the start of two rows of the image, in bytes.
+/// @param destination The first row of the warped image.
+/// @param destinationWidth The width of the warped image in pixels.
+/// @param destinationHeight The height of the warped image in pixels.
+/// @param destinationBytesPerRow The distance between the start of two rows of the warped image, in bytes.
+/// @param mesh The distortion mesh.
+/// @remarks: This is the CPU reference of the distortion correction the compose pass applies, and follows the same steps.
+/// Four pixels are warped at a time, with a lane of an SSE2 or NEON vector for each when the compiler targets them, and the image is filtered bilinearly.
+void warp_image(const uint8_t* source, int sourceWidth, int sourceHeight, size_t sourceBytesPerRow,
+                uint8_t* destination, int destinationWidth, int destinationHeight, size_t destinationBytesPerRow,
+                const distortion_mesh& mesh);
+
+#endif
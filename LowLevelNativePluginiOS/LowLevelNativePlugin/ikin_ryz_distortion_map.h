@@ -0,0 +1,69 @@
+//
+//  ikin_ryz_distortion_map.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_DISTORTION_MAP_H
+#define IKIN_RYZ_DISTORTION_MAP_H
+
+#import <Metal/Metal.h>
+
+#include "ikin_ryz_distortion.h"
+#include "native_to_unity_notifiers.h"
+
+/// @brief: The Metal source of the functions that look up the distortion mesh, which the compose and upscale shaders are compiled with.
+/// @remarks: The mesh is only read when the distortionCorrection function constant is true, so each pass is compiled with and without it.
+extern const char* const distortionShaderSource;
+
+/// @brief: Keeps the distortion mesh of the Ryz display in a texture the compose passes can read.
+/// @remarks: Each texel holds the image coordinates of a vertex in its red and green channels. @see distortion_mesh.
+class ikin_ryz_distortion_map
+{
+public:
+    /// @brief: Uploads the distortion mesh if a different one has been loaded since it was last uploaded.
+    /// @param device The Metal device that Unity renders with.
+    /// @returns: The texture that holds the mesh, or nil if there is no mesh and the image is drawn without distortion correction.
+    id<MTLTexture> update(id<MTLDevice> device);
+
+    /// @brief: Releases the texture, so that the mesh is uploaded again the next time it is needed.
+    void release();
+
+    /// @brief: Gets the memory held by the texture that holds the mesh.
+    /// @returns: The size of the texture in bytes, or zero if there is none.
+    uint64_t allocated_bytes() const;
+
+private:
+    /// @brief: The texture that holds the mesh, or nil if there is none.
+    id<MTLTexture> meshTexture;
+
+    /// @brief: The version of the loaded mesh that @see meshTexture holds.
+    int uploadedVersion;
+};
+
+/// @brief: Sets the distortion mesh that the Ryz image is corrected with from the next frame.
+/// @param mesh The mesh, or a mesh without coordinates to stop correcting distortion.
+void set_distortion_mesh(const distortion_mesh& mesh);
+
+/// @brief: Gets the distortion mesh that the Ryz image is corrected with.
+/// @returns: The mesh, which has no coordinates if distortion isn't being corrected.
+distortion_mesh get_distortion_mesh();
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Loads the distortion mesh of the connected Ryz optics from a calibration file, and corrects the Ryz image with it from the next frame.
+    /// @param path The path of the calibration file. @see load_distortion_mesh. Null or empty to stop correcting distortion.
+    /// @returns: 1 if the mesh was loaded or cleared, 0 if the file couldn't be loaded, in which case the current mesh is kept.
+    EXPORT_API int ikinRyzLoadDistortionMesh(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,157 @@
+//
+//  ikin_ryz_distortion_map.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_distortion_map.h"
+
+#include <mutex>
+
+/// @brief: The Metal source of the functions that look up the distortion mesh.
+/// @remarks: Matches @see sample_distortion_mesh. The vertices are read rather than sampled, since 32-bit float textures can't be filtered on every GPU.
+const char* const distortionShaderSource = R"(
+    #include <metal_stdlib>
+    using namespace metal;
+
+    constant bool distortionCorrection [[function_constant(0)]];
+
+    float2 sample_distortion_mesh(texture2d<float, access::read> mesh, float2 position)
+    {
+        // Find the cell the point is in, and where in the cell it is.
+        const float2 size = float2(mesh.get_width(), mesh.get_height());
+        const float2 grid = saturate(position) * (size - 1.0);
+        const float2 cell = min(floor(grid), size - 2.0);
+        const float2 fraction = grid - cell;
+        const uint2 corner = uint2(cell);
+
+        // Blend the corners of the cell.
+        const float2 top = mix(mesh.read(corner).xy, mesh.read(corner + uint2(1, 0)).xy, fraction.x);
+        const float2 bottom = mix(mesh.read(corner + uint2(0, 1)).xy, mesh.read(corner + uint2(1, 1)).xy, fraction.x);
+
+        return mix(top, bottom, fraction.y);
+    }
+
+    bool is_outside_image(float2 coordinates)
+    {
+        return any(coordinates < 0.0) || any(coordinates > 1.0);
+    }
+)";
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The distortion mesh that was last loaded. Has no coordinates when there is none.
+    distortion_mesh loadedMesh;
+
+    /// @brief: Counts the meshes that have been loaded, so the render thread can tell when to upload a new one.
+    int loadedVersion;
+
+    /// @brief: Guards @see loadedMesh and @see loadedVersion, which are loaded on the main thread and uploaded on the render thread.
+    std::mutex loadedMeshMutex;
+}
+
+/// @brief: Uploads the distortion mesh if a different one has been loaded since it was last uploaded.
+/// @param device The Metal device that Unity renders with.
+/// @returns: The texture that holds the mesh, or nil if there is no mesh and the image is drawn without distortion correction.
+id<MTLTexture> ikin_ryz_distortion_map::update(id<MTLDevice> device)
+{
+    std::lock_guard<std::mutex> guard(loadedMeshMutex);
+
+    // If the texture holds the latest mesh, then there is nothing to do.
+    if (uploadedVersion == loadedVersion)
+    {
+        return meshTexture;
+    }
+
+    uploadedVersion = loadedVersion;
+    meshTexture = nil;
+
+    if (loadedMesh.coordinates == nullptr)
+    {
+        return nil;
+    }
+
+    MTLTextureDescriptor* meshDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat : MTLPixelFormatRG32Float
+                                                                                              width : loadedMesh.columns
+                                                                                             height : loadedMesh.rows
+                                                                                          mipmapped : NO];
+    meshDescriptor.usage = MTLTextureUsageShaderRead;
+
+    meshTexture = [device newTextureWithDescriptor : meshDescriptor];
+
+    [meshTexture replaceRegion : MTLRegionMake2D(0, 0, loadedMesh.columns, loadedMesh.rows)
+                   mipmapLevel : 0
+                     withBytes : loadedMesh.coordinates.get()
+                   bytesPerRow : loadedMesh.columns * 2 * sizeof(float)];
+
+    return meshTexture;
+}
+
+/// @brief: Sets the distortion mesh that the Ryz image is corrected with from the next frame.
+/// @param mesh The mesh, or a mesh without coordinates to stop correcting distortion.
+void set_distortion_mesh(const distortion_mesh& mesh)
+{
+    std::lock_guard<std::mutex> guard(loadedMeshMutex);
+
+    loadedMesh = mesh;
+    ++loadedVersion;
+}
+
+/// @brief: Gets the distortion mesh that the Ryz image is corrected with.
+/// @returns: The mesh, which has no coordinates if distortion isn't being corrected.
+distortion_mesh get_distortion_mesh()
+{
+    std::lock_guard<std::mutex> guard(loadedMeshMutex);
+
+    return loadedMesh;
+}
+
+/// @brief: Releases the texture, so that the mesh is uploaded again the next time it is needed.
+void ikin_ryz_distortion_map::release()
+{
+    std::lock_guard<std::mutex> guard(loadedMeshMutex);
+
+    meshTexture = nil;
+    uploadedVersion = loadedVersion - 1;
+}
+
+/// @brief: Gets the memory held by the texture that holds the mesh.
+/// @returns: The size of the texture in bytes, or zero if there is none.
+uint64_t ikin_ryz_distortion_map::allocated_bytes() const
+{
+    if (@available(iOS 11.0, *))
+    {
+        return meshTexture != nil ? meshTexture.allocatedSize : 0;
+    }
+
+    return 0;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Loads the distortion mesh of the connected Ryz optics from a calibration file, and corrects the Ryz image with it from the next frame.
+    /// @param path The path of the calibration file. Null or empty to stop correcting distortion.
+    /// @returns: 1 if the mesh was loaded or cleared, 0 if the file couldn't be loaded, in which case the current mesh is kept.
+    EXPORT_API int ikinRyzLoadDistortionMesh(const char* path)
+    {
+        distortion_mesh mesh = {};
+
+        // Parse the file before taking the lock, so the render thread doesn't wait on it.
+        if (path != nullptr && path[0] != '\0' && !load_distortion_mesh(path, mesh))
+        {
+            return 0;
+        }
+
+        set_distortion_mesh(mesh);
+
+        return 1;
+    }
+
+#ifdef __cplusplus
+}
+#endif
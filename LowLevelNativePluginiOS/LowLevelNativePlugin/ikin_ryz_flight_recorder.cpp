@@ -0,0 +1,350 @@
+//
+//  ikin_ryz_flight_recorder.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_flight_recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The sequence of a slot while a record is being written into it.
+    const uint64_t flightSlotBusy = UINT64_MAX;
+
+    /// @brief: The fewest seconds between two hitch dumps, so that a run of hitches writes one file.
+    const uint64_t flightHitchDumpSeconds = 5;
+
+    /// @brief: The interval between two frames, in microseconds, past which the app is taken to have been paused.
+    const uint32_t flightPauseMicroseconds = 2000000;
+
+    /// @brief: The number of hitch dumps that are kept in the directory. Later ones overwrite the oldest.
+    const int maxFlightHitchDumps = 8;
+
+    /// @brief: How often the dump thread looks for a hitch to dump, in milliseconds.
+    const int flightDumpPollMilliseconds = 100;
+
+    /// @brief: A record in the recorder's ring.
+    /// @remarks: The sequence is the number of the record plus one once it is written, so a dump can tell a whole record from one that is being overwritten.
+    /// The value, type and detail are packed into one word, and both words are relaxed atomics, so reading a slot while it is overwritten is only ever stale.
+    struct flight_slot
+    {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> timestamp;
+        std::atomic<uint64_t> packed;
+    };
+
+    /// @brief: The ring, which is reserved with the plugin and zeroed before anything runs.
+    flight_slot flightSlots[flightRecorderCapacity];
+
+    /// @brief: The number of the next record. Writers reserve their slot by moving it on.
+    std::atomic<uint64_t> flightNext(0);
+
+    /// @brief: The time the last frame was submitted, or 0 before the first.
+    std::atomic<uint64_t> lastFlightFrame(0);
+
+    /// @brief: The time of the last hitch dump, or 0 before the first.
+    std::atomic<uint64_t> lastFlightHitchDump(0);
+
+    /// @brief: A value indicating whether a hitch is waiting to be dumped.
+    std::atomic<bool> flightHitchPending(false);
+
+    std::atomic<int> flightRecorderSeconds(defaultFlightRecorderSeconds);
+    std::atomic<uint32_t> flightHitchMicroseconds(defaultFlightRecorderHitchMilliseconds * 1000);
+
+    static_assert((flightRecorderCapacity & (flightRecorderCapacity - 1)) == 0, "The ring is indexed with a mask.");
+
+    /// @brief: Writes the hitch dumps on a thread of its own, so the render thread only raises a flag.
+    class flight_dump_worker
+    {
+    public:
+        /// @brief: Stops the thread.
+        ~flight_dump_worker()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                stopping = true;
+            }
+
+            wake.notify_one();
+
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+        }
+
+        /// @brief: Sets the directory the dumps are written to, starting the thread if it hasn't been started.
+        /// @param path The directory, or empty to not write dumps.
+        void set_directory(const std::string& path)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+
+            directory = path;
+
+            if (!directory.empty() && !thread.joinable())
+            {
+                thread = std::thread(&flight_dump_worker::run, this);
+            }
+        }
+
+        /// @brief: Gets the path of a dump in the directory.
+        /// @param name The name of the file.
+        /// @returns: The path, or empty if no directory was set.
+        std::string get_path(const std::string& name)
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+
+            return directory.empty() ? std::string() : directory + "/" + name;
+        }
+
+    private:
+        /// @brief: Dumps each hitch that is flagged, until the thread is asked to stop.
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (!stopping)
+            {
+                wake.wait_for(lock, std::chrono::milliseconds(flightDumpPollMilliseconds), [this] { return stopping; });
+
+                if (stopping || !flightHitchPending.exchange(false))
+                {
+                    continue;
+                }
+
+                const std::string path = directory + "/ryz_flight_hitch_" + std::to_string(hitchDumps++ % maxFlightHitchDumps) + ".bin";
+
+                lock.unlock();
+                dump_flight_recorder(path.c_str(), flight_dump_hitch);
+                lock.lock();
+            }
+        }
+
+        /// @brief: The directory the dumps are written to, or empty.
+        std::string directory;
+
+        /// @brief: The number of hitch dumps that have been written, which picks the file of the next.
+        int hitchDumps = 0;
+
+        /// @brief: A value indicating whether the thread has been asked to stop.
+        bool stopping = false;
+
+        /// @brief: Guards @see directory, @see hitchDumps and @see stopping.
+        std::mutex mutex;
+
+        /// @brief: Signals the thread when it is asked to stop.
+        std::condition_variable wake;
+
+        /// @brief: The thread, which is started when a directory is first set.
+        std::thread thread;
+    };
+
+    flight_dump_worker flightDumpWorker;
+
+    /// @brief: Serializes dumps, so that two of them don't write the same file at once.
+    std::mutex flightDumpMutex;
+
+    /// @brief: Gets the microseconds from a time until now, saturated to fit a record.
+    uint32_t microseconds_since(uint64_t start, uint64_t now)
+    {
+        return now > start ? (uint32_t)std::min<uint64_t>((now - start) / 1000, UINT32_MAX) : 0;
+    }
+}
+
+uint64_t flight_recorder_now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record_flight(flight_record_type type, uint32_t value, uint16_t detail)
+{
+    const uint64_t index = flightNext.fetch_add(1, std::memory_order_relaxed);
+    flight_slot& slot = flightSlots[index & (flightRecorderCapacity - 1)];
+
+    // Claim the slot before touching it. If a writer a whole lap behind still holds it, then this record is left out.
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+    do
+    {
+        if (sequence == flightSlotBusy || sequence > index)
+        {
+            return;
+        }
+    }
+    while (!slot.sequence.compare_exchange_weak(sequence, flightSlotBusy, std::memory_order_relaxed));
+
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.timestamp.store(flight_recorder_now(), std::memory_order_relaxed);
+    slot.packed.store(((uint64_t)value << 32) | ((uint64_t)type << 16) | detail, std::memory_order_relaxed);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void record_flight_frame(uint64_t start)
+{
+    const uint64_t now = flight_recorder_now();
+
+    record_flight(flight_frame_submitted, microseconds_since(start, now));
+
+    // The interval is taken between the starts of the frames, which is the cadence Unity drives the display at.
+    const uint64_t last = lastFlightFrame.exchange(start, std::memory_order_relaxed);
+    const uint32_t hitchMicroseconds = flightHitchMicroseconds.load(std::memory_order_relaxed);
+
+    if (last == 0 || hitchMicroseconds == 0)
+    {
+        return;
+    }
+
+    const uint32_t interval = microseconds_since(last, start);
+
+    if (interval < hitchMicroseconds)
+    {
+        return;
+    }
+
+    // An interval of seconds is more likely the app being paused than a hitch, so it is kept but not dumped.
+    if (interval >= flightPauseMicroseconds)
+    {
+        record_flight(flight_hitch, interval, 1);
+        return;
+    }
+
+    record_flight(flight_hitch, interval);
+
+    // If the last hitch dump was long enough ago, then ask for another, which holds the frames that led up to this one.
+    const uint64_t lastDump = lastFlightHitchDump.load(std::memory_order_relaxed);
+
+    if (lastDump == 0 || now - lastDump >= flightHitchDumpSeconds * 1000000000ull)
+    {
+        lastFlightHitchDump.store(now, std::memory_order_relaxed);
+        flightHitchPending.store(true);
+    }
+}
+
+void record_flight_wait(flight_record_type type, uint64_t start, uint16_t detail)
+{
+    const uint32_t wait = microseconds_since(start, flight_recorder_now());
+
+    // A wait that didn't happen, such as a lock that wasn't taken, is always kept.
+    if (wait >= flightRecorderMinimumWaitMicroseconds || detail != 0)
+    {
+        record_flight(type, wait, detail);
+    }
+}
+
+void configure_flight_recorder(const char* directory, int seconds, int hitchMilliseconds)
+{
+    flightRecorderSeconds.store(std::max(seconds, 1));
+    flightHitchMicroseconds.store((uint32_t)std::max(hitchMilliseconds, 0) * 1000);
+
+    flightDumpWorker.set_directory(directory != nullptr ? directory : "");
+}
+
+bool dump_flight_recorder(const char* path, flight_dump_reason reason)
+{
+    if (path == nullptr || path[0] == '\0')
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(flightDumpMutex);
+
+    const uint64_t now = flight_recorder_now();
+    const uint64_t window = (uint64_t)flightRecorderSeconds.load() * 1000000000ull;
+    const uint64_t oldest = now > window ? now - window : 0;
+
+    const uint64_t end = flightNext.load(std::memory_order_acquire);
+    const uint64_t begin = end > flightRecorderCapacity ? end - flightRecorderCapacity : 0;
+
+    std::vector<flight_record> records;
+    records.reserve((size_t)(end - begin));
+
+    for (uint64_t index = begin; index < end; ++index)
+    {
+        const flight_slot& slot = flightSlots[index & (flightRecorderCapacity - 1)];
+
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+        {
+            continue;
+        }
+
+        const uint64_t timestamp = slot.timestamp.load(std::memory_order_relaxed);
+        const uint64_t packed = slot.packed.load(std::memory_order_relaxed);
+
+        // If a writer lapped the ring while the record was copied, then the copy may be torn.
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) != index + 1 || timestamp < oldest)
+        {
+            continue;
+        }
+
+        records.push_back({ timestamp, (uint32_t)(packed >> 32), (flight_record_type)((packed >> 16) & 0xFFFF), (uint16_t)(packed & 0xFFFF) });
+    }
+
+    // The records of each thread are already in order. Sorting by time interleaves the threads, keeping ties in the order they were recorded.
+    std::stable_sort(records.begin(), records.end(), [](const flight_record& a, const flight_record& b) { return a.timestamp < b.timestamp; });
+
+    flight_dump_header header = {};
+    header.magic = flightRecorderMagic;
+    header.version = flightRecorderVersion;
+    header.reason = reason;
+    header.recordCount = (uint32_t)records.size();
+    header.recordSize = sizeof(flight_record);
+    header.timestamp = now;
+    header.hitchMicroseconds = flightHitchMicroseconds.load();
+    header.olderRecords = (uint32_t)std::min<uint64_t>(end - records.size(), UINT32_MAX);
+
+    FILE* file = fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    if (written && !records.empty())
+    {
+        written = fwrite(records.data(), sizeof(flight_record), records.size(), file) == records.size();
+    }
+
+    return fclose(file) == 0 && written;
+}
+
+void dump_flight_recorder_on_shutdown()
+{
+    const std::string path = flightDumpWorker.get_path("ryz_flight_shutdown.bin");
+
+    if (!path.empty())
+    {
+        dump_flight_recorder(path.c_str(), flight_dump_shutdown);
+    }
+}
+
+/// @brief Sets where the flight recorder writes its dumps when a severe hitch happens or the display shuts down.
+void ikinRyzConfigureFlightRecorder(const char* directory, int seconds, int hitchMilliseconds)
+{
+    configure_flight_recorder(directory,
+                              seconds > 0 ? seconds : defaultFlightRecorderSeconds,
+                              hitchMilliseconds == 0 ? defaultFlightRecorderHitchMilliseconds : std::max(hitchMilliseconds, 0));
+}
+
+/// @brief Writes the flight recorder's last seconds of frame timings, hotplugs, skipped frames and waits to a file.
+int ikinRyzDumpFlightRecorder(const char* path)
+{
+    return dump_flight_recorder(path, flight_dump_requested) ? 1 : 0;
+}
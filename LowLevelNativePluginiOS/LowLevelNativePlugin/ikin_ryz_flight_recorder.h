@@ -0,0 +1,184 @@
+//
+//  ikin_ryz_flight_recorder.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_FLIGHT_RECORDER_H
+#define IKIN_RYZ_FLIGHT_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "native_to_unity_notifiers.h"
+
+/// @brief: The value of the first four bytes of a dump, which read "RYZF".
+const uint32_t flightRecorderMagic = 0x465A5952;
+
+/// @brief: The version of the dump's layout, which a reader checks before it reads the records.
+const uint16_t flightRecorderVersion = 1;
+
+/// @brief: The number of records the recorder keeps, which is about a minute and a half of frames at 120 frames per second.
+/// @remarks: The records are reserved with the plugin, so that recording never allocates.
+const size_t flightRecorderCapacity = 32 * 1024;
+
+/// @brief: The seconds of records that a dump keeps when no other number is given.
+const int defaultFlightRecorderSeconds = 30;
+
+/// @brief: The interval between two frames, in milliseconds, that counts as a severe hitch when no other is given.
+const int defaultFlightRecorderHitchMilliseconds = 250;
+
+/// @brief: The shortest wait, in microseconds, that is recorded. Shorter ones are left out so that the records last longer.
+const uint32_t flightRecorderMinimumWaitMicroseconds = 100;
+
+/// @brief: The kinds of record the recorder keeps.
+enum flight_record_type : uint16_t
+{
+    /// @brief: Unity submitted a frame. The value is the microseconds the render thread spent on it.
+    flight_frame_submitted = 1,
+
+    /// @brief: A frame was presented to the Ryz display.
+    flight_frame_presented = 2,
+
+    /// @brief: A frame looked the same as the last presented one, so it wasn't presented.
+    flight_frame_skipped = 3,
+
+    /// @brief: A frame should have been presented, but no drawable was available.
+    flight_frame_dropped = 4,
+
+    /// @brief: The Ryz display was connected or disconnected. The value is the @see display_event.
+    flight_hotplug = 5,
+
+    /// @brief: The render thread waited to lock the Metal Kit View. The value is the microseconds, and the detail is 1 if the lock wasn't taken.
+    flight_lock_wait = 6,
+
+    /// @brief: The render thread waited for a drawable of the Metal Kit View. The value is the microseconds.
+    flight_drawable_wait = 7,
+
+    /// @brief: The interval since the last frame was a severe hitch. The value is the interval in microseconds, and the detail is 1 if it was long enough that the app was likely paused.
+    flight_hitch = 8
+};
+
+/// @brief: The reasons a dump is written.
+enum flight_dump_reason : uint16_t
+{
+    /// @brief: The app asked for it.
+    flight_dump_requested = 0,
+
+    /// @brief: A frame came a severe hitch after the last.
+    flight_dump_hitch = 1,
+
+    /// @brief: The display subsystem shut down, or the app is terminating.
+    flight_dump_shutdown = 2
+};
+
+/// @brief: A record, as it is kept in memory and written to a dump.
+struct flight_record
+{
+    /// @brief: The time of the record, in nanoseconds of the monotonic clock.
+    uint64_t timestamp;
+
+    /// @brief: The value, whose meaning depends on the type.
+    uint32_t value;
+
+    /// @brief: The kind of record.
+    flight_record_type type;
+
+    /// @brief: A detail, whose meaning depends on the type.
+    uint16_t detail;
+};
+
+/// @brief: The header that starts a dump. The records follow it, oldest first.
+struct flight_dump_header
+{
+    /// @brief: @see flightRecorderMagic.
+    uint32_t magic;
+
+    /// @brief: @see flightRecorderVersion.
+    uint16_t version;
+
+    /// @brief: The @see flight_dump_reason.
+    uint16_t reason;
+
+    /// @brief: The number of records that follow.
+    uint32_t recordCount;
+
+    /// @brief: The size of each record, in bytes.
+    uint32_t recordSize;
+
+    /// @brief: The time of the dump, in nanoseconds of the monotonic clock.
+    uint64_t timestamp;
+
+    /// @brief: The interval that counted as a severe hitch, in microseconds, or 0 if hitches weren't dumped.
+    uint32_t hitchMicroseconds;
+
+    /// @brief: The number of records that were overwritten before the dump, or were too old for it.
+    uint32_t olderRecords;
+};
+
+static_assert(sizeof(flight_record) == 16, "The records are written to dumps as they are.");
+static_assert(sizeof(flight_dump_header) == 32, "The header is written to dumps as it is.");
+
+/// @brief: Gets the time on the monotonic clock that the records are stamped with, in nanoseconds.
+uint64_t flight_recorder_now();
+
+/// @brief: Appends a record.
+/// @param type The kind of record.
+/// @param value The value of the record.
+/// @param detail The detail of the record.
+/// @remarks: Safe to call from any thread. Costs an atomic increment and a 16 byte write, so it is always on.
+void record_flight(flight_record_type type, uint32_t value, uint16_t detail = 0);
+
+/// @brief: Records that Unity submitted a frame, and asks for a dump if it came a severe hitch after the last.
+/// @param start The time the render thread started on the frame, from @see flight_recorder_now.
+/// @remarks: Called from the render thread once the frame has been handed on.
+void record_flight_frame(uint64_t start);
+
+/// @brief: Records a wait, if it was long enough to matter.
+/// @param type @see flight_lock_wait or @see flight_drawable_wait.
+/// @param start The time the wait started, from @see flight_recorder_now.
+/// @param detail The detail of the record.
+void record_flight_wait(flight_record_type type, uint64_t start, uint16_t detail = 0);
+
+/// @brief: Sets where dumps that aren't asked for are written, and how much they hold.
+/// @param directory The directory the hitch and shutdown dumps are written to, or null to not write them.
+/// @param seconds The seconds of records a dump keeps.
+/// @param hitchMilliseconds The interval between two frames that counts as a severe hitch, or 0 to not dump on hitches.
+/// @remarks: Hitch dumps are written by a thread of their own, at most one every few seconds, so the render thread never waits for the file.
+void configure_flight_recorder(const char* directory, int seconds, int hitchMilliseconds);
+
+/// @brief: Writes the records of the last seconds to a file.
+/// @param path The path of the file.
+/// @param reason The reason for the dump, which is kept in its header.
+/// @returns: True if the file was written, otherwise false.
+/// @remarks: Safe to call while records are appended. A record that is overwritten while it is copied is left out.
+bool dump_flight_recorder(const char* path, flight_dump_reason reason);
+
+/// @brief: Writes the shutdown dump to the configured directory, if one was set.
+void dump_flight_recorder_on_shutdown();
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Sets where the flight recorder writes its dumps when a severe hitch happens or the display shuts down.
+    /// @param directory The directory, or null to only write dumps that are asked for.
+    /// @param seconds The seconds of records a dump keeps, or 0 for @see defaultFlightRecorderSeconds.
+    /// @param hitchMilliseconds The interval between two frames that counts as a severe hitch, 0 for @see defaultFlightRecorderHitchMilliseconds, or -1 to not dump on hitches.
+    EXPORT_API void ikinRyzConfigureFlightRecorder(const char* directory, int seconds, int hitchMilliseconds);
+
+    /// @brief Writes the flight recorder's last seconds of frame timings, hotplugs, skipped frames and waits to a file.
+    /// @param path The path of the file.
+    /// @returns: 1 if the file was written, otherwise 0.
+    /// @remarks: Tools/ryz_flight_report summarizes a dump.
+    EXPORT_API int ikinRyzDumpFlightRecorder(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
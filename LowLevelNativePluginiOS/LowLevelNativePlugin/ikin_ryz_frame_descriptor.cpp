@@ -0,0 +1,133 @@
+//
+//  ikin_ryz_frame_descriptor.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_frame_descriptor.h"
+
+#include "native_to_unity_notifiers.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The distance between the eyes that a single culling pass covers when both eyes are rendered in one pass.
+    const float stereoCullingSeparation = 0.625f;
+}
+
+UnityXRPose get_eye_pose()
+{
+    UnityXRPose pose = {};
+
+    pose.position.x = 0.0;
+    pose.position.z = 0.0f;
+    pose.rotation.w = 1.0f;
+
+    return pose;
+}
+
+UnityXRProjection get_eye_projection(int targetEye, float displayWidth, float displayHeight)
+{
+    UnityXRProjection ret;
+
+    ret.type = projectionType;
+
+    if (ret.type == kUnityXRProjectionTypeMatrix)
+    {
+        ret.data.matrix = targetEye == 0 ? leftProjectionMatrix : rightProjectionMatrix;
+    }
+    else
+    {
+        float aspectRatio = (displayWidth * 0.5f) / displayHeight;
+
+        ret.data.halfAngles.left = -aspectRatio;
+        ret.data.halfAngles.right = aspectRatio;
+        ret.data.halfAngles.top = 0.5;
+        ret.data.halfAngles.bottom = -0.5;
+    }
+
+    return ret;
+}
+
+uint64_t populate_render_passes(const int* passEyes, int passCount, const eye_pass_target* targets,
+                                float displayWidth, float displayHeight, UnityXRNextFrameDesc* nextFrame)
+{
+    uint64_t occludedPixels = 0;
+
+    nextFrame->renderPassesCount = 0;
+
+    // For each eye that is rendered, do the following:
+    for (int index = 0; index < passCount; ++index)
+    {
+        // The eye that is rendered.
+        const int eye = passEyes[index];
+        const eye_pass_target& target = targets[eye];
+
+        // If the eye shares its texture with the eye before it, then render both in the same pass, side by side.
+        // Otherwise, render the eye in a pass of its own.
+        const int previousPass = nextFrame->renderPassesCount - 1;
+        const bool singlePass = previousPass >= 0 &&
+            nextFrame->renderPasses[previousPass].textureId == target.textureId &&
+            nextFrame->renderPasses[previousPass].renderParamsCount < kUnityXRMaxNumUnityXRRenderParams;
+
+        const int pass = singlePass ? previousPass : nextFrame->renderPassesCount++;
+
+        // Retrieve the render pass.
+        auto& renderPass = nextFrame->renderPasses[pass];
+
+        // Get the culling pass.
+        auto& cullingPass = nextFrame->cullingPasses[pass];
+
+        if (singlePass)
+        {
+            // Both eyes are culled together, from the first eye's view widened by the separation between the eyes.
+            cullingPass.separation = stereoCullingSeparation;
+        }
+        else
+        {
+            // Render the eye into its texture.
+            renderPass.textureId = target.textureId;
+
+            // The pass starts with no render params. Each eye it renders adds a set.
+            renderPass.renderParamsCount = 0;
+
+            // Note: culling is shared between multiple passes by setting this to the same index.
+            renderPass.cullingPassIndex = pass;
+
+            // Fill out the culling pass' separation.
+            cullingPass.separation = 0.0;
+
+            // Cull from the eye's own pose and projection.
+            cullingPass.deviceAnchorToCullingPose = get_eye_pose();
+            cullingPass.projection = get_eye_projection(eye, displayWidth, displayHeight);
+        }
+
+        // Fill out render params. View, projection, viewport for the eye.
+        auto& renderParams = renderPass.renderParams[renderPass.renderParamsCount++];
+
+        // Set the pose for each eye.
+        renderParams.deviceAnchorToEyePose = get_eye_pose();
+
+        // Set the projection matrix for each eye.
+        renderParams.projection = get_eye_projection(eye, displayWidth, displayHeight);
+
+        // Render into the texture itself, rather than a slice of a texture array.
+        renderParams.textureArraySlice = 0;
+
+        // Cover the parts of the eye texture that can't be seen on its display, so Unity doesn't shade them.
+        renderParams.occlusionMeshId = target.occlusionMeshId;
+
+        if (target.occlusionMeshId != 0)
+        {
+            occludedPixels += (uint64_t)(target.occludedFraction *
+                                         target.textureWidth * target.viewport.width *
+                                         target.textureHeight * target.viewport.height);
+        }
+
+        // The eye covers the part of its texture that Unity asked for.
+        renderParams.viewportRect = target.viewport;
+    }
+
+    return occludedPixels;
+}
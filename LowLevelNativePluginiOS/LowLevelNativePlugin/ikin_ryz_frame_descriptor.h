@@ -0,0 +1,61 @@
+//
+//  ikin_ryz_frame_descriptor.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_FRAME_DESCRIPTOR_H
+#define IKIN_RYZ_FRAME_DESCRIPTOR_H
+
+#include <cstdint>
+
+#include "../External Headers/Unity/XR/Subsystems/Display/IUnityXRDisplay.h"
+
+/// @brief: What a render pass needs to know about the eye it renders.
+struct eye_pass_target
+{
+    /// @brief: The texture Unity renders the eye into.
+    UnityXRRenderTextureId textureId;
+
+    /// @brief: The occlusion mesh of the eye, or 0 if it has none.
+    UnityXROcclusionMeshId occlusionMeshId;
+
+    /// @brief: The fraction of the eye's viewport that its occlusion mesh covers.
+    float occludedFraction;
+
+    /// @brief: The part of the texture that Unity renders the eye into, from zero (bottom/left) to one (top/right).
+    /// @remarks: When the eyes share a texture, this is within the eye's half of it.
+    UnityXRRectf viewport;
+
+    /// @brief: The size of the texture, in pixels.
+    uint32_t textureWidth;
+    uint32_t textureHeight;
+};
+
+/// @brief: Creates a description of the pose, which is a position that is an offset of the camera.
+/// @returns: The description of the pose.
+UnityXRPose get_eye_pose();
+
+/// @brief: Creates a description of the projection of an eye.
+/// @param targetEye The eye, where 0 takes the left projection matrix and anything else the right one.
+/// @param displayWidth The width of the display, in points.
+/// @param displayHeight The height of the display, in points.
+/// @returns: The projection matrix set through ikinRyzSetCameraMatrix, or half angles that fit the display if none was set.
+UnityXRProjection get_eye_projection(int targetEye, float displayWidth, float displayHeight);
+
+/// @brief: Fills out the render passes and culling passes for the eyes that are rendered this frame.
+/// @param passEyes The eyes that are rendered, in order.
+/// @param passCount The number of eyes that are rendered.
+/// @param targets The targets of every eye, indexed by eye.
+/// @param displayWidth The width of the display, in points, which the projection fits.
+/// @param displayHeight The height of the display, in points.
+/// @param nextFrame The description of the next frame that is filled out.
+/// @returns: The number of pixels the occlusion meshes keep from being shaded.
+/// @remarks: Runs on the Unity render thread every frame, so it only writes into the descriptor.
+/// Consecutive eyes that share a texture are rendered side by side in a single pass, with one culling pass.
+/// Eyes with textures of their own get a render pass and a culling pass each.
+uint64_t populate_render_passes(const int* passEyes, int passCount, const eye_pass_target* targets,
+                                float displayWidth, float displayHeight, UnityXRNextFrameDesc* nextFrame);
+
+#endif
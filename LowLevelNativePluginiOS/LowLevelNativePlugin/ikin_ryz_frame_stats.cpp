@@ -0,0 +1,53 @@
+//
+//  ikin_ryz_frame_stats.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_frame_stats.h"
+
+/// @brief: The counters for the frames the plugin has handled.
+frame_stats_counters frameStatsCounters;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Copies the current frame counters.
+    /// @param stats The object that the counters are copied into.
+    EXPORT_API void ikinRyzGetFrameStats(frame_stats* stats)
+    {
+        if (stats == nullptr)
+        {
+            return;
+        }
+
+        stats->framesSubmitted = frameStatsCounters.framesSubmitted.load(std::memory_order_relaxed);
+        stats->framesPresented = frameStatsCounters.framesPresented.load(std::memory_order_relaxed);
+        stats->framesSkipped = frameStatsCounters.framesSkipped.load(std::memory_order_relaxed);
+        stats->ryzBytesCopied = frameStatsCounters.ryzBytesCopied.load(std::memory_order_relaxed);
+        stats->ryzBytesLastFrame = frameStatsCounters.ryzBytesLastFrame.load(std::memory_order_relaxed);
+        stats->occludedPixels = frameStatsCounters.occludedPixels.load(std::memory_order_relaxed);
+        stats->occludedPixelsLastFrame = frameStatsCounters.occludedPixelsLastFrame.load(std::memory_order_relaxed);
+        stats->ryzFramesRepeated = frameStatsCounters.ryzFramesRepeated.load(std::memory_order_relaxed);
+        stats->mainFramesDropped = frameStatsCounters.mainFramesDropped.load(std::memory_order_relaxed);
+        stats->framesSynthesized = frameStatsCounters.framesSynthesized.load(std::memory_order_relaxed);
+        stats->surfaceFramesPresented = frameStatsCounters.surfaceFramesPresented.load(std::memory_order_relaxed);
+        stats->surfaceFramesDropped = frameStatsCounters.surfaceFramesDropped.load(std::memory_order_relaxed);
+        stats->captureFrames = frameStatsCounters.captureFrames.load(std::memory_order_relaxed);
+        stats->captureFramesDropped = frameStatsCounters.captureFramesDropped.load(std::memory_order_relaxed);
+        stats->captureBytesLastFrame = frameStatsCounters.captureBytesLastFrame.load(std::memory_order_relaxed);
+        stats->captureRenderMicrosecondsLastFrame = frameStatsCounters.captureRenderMicrosecondsLastFrame.load(std::memory_order_relaxed);
+        stats->captureWorkerMicrosecondsLastFrame = frameStatsCounters.captureWorkerMicrosecondsLastFrame.load(std::memory_order_relaxed);
+        stats->recordingFramesWritten = frameStatsCounters.recordingFramesWritten.load(std::memory_order_relaxed);
+        stats->recordingFramesDropped = frameStatsCounters.recordingFramesDropped.load(std::memory_order_relaxed);
+        stats->previewFramesSent = frameStatsCounters.previewFramesSent.load(std::memory_order_relaxed);
+        stats->previewBytesSent = frameStatsCounters.previewBytesSent.load(std::memory_order_relaxed);
+        stats->previewFramesSkipped = frameStatsCounters.previewFramesSkipped.load(std::memory_order_relaxed);
+    }
+
+#ifdef __cplusplus
+}
+#endif
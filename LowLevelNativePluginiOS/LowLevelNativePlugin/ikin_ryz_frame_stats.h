@@ -0,0 +1,133 @@
+//
+//  ikin_ryz_frame_stats.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_FRAME_STATS_H
+#define IKIN_RYZ_FRAME_STATS_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "native_to_unity_notifiers.h"
+
+/// @brief: A snapshot of the counters the plugin keeps about the frames it has handled.
+/// @remarks: This is marshalled to C# as a sequential struct, so the layout must match ikinRyzFrameStats.
+struct frame_stats
+{
+    /// @brief: The number of frames that have been submitted by Unity.
+    uint64_t framesSubmitted;
+
+    /// @brief: The number of frames that have been presented on the Ryz.
+    uint64_t framesPresented;
+
+    /// @brief: The number of frames that were not presented on the Ryz because they looked the same as the last presented frame.
+    uint64_t framesSkipped;
+
+    /// @brief: The total number of bytes read to present the Ryz eye, by the damage copy and by the present.
+    uint64_t ryzBytesCopied;
+
+    /// @brief: The number of bytes read to present the Ryz eye in the last frame, by the damage copy and by the present.
+    uint64_t ryzBytesLastFrame;
+
+    /// @brief: The total number of eye texture pixels that were covered by occlusion meshes, and so not shaded.
+    uint64_t occludedPixels;
+
+    /// @brief: The number of eye texture pixels that were covered by occlusion meshes in the last frame.
+    uint64_t occludedPixelsLastFrame;
+
+    /// @brief: The number of frames in which the Ryz eye was not rendered, and its last image was used again.
+    uint64_t ryzFramesRepeated;
+
+    /// @brief: The number of frames in which the main eye was not rendered, because only the Ryz eye is.
+    uint64_t mainFramesDropped;
+
+    /// @brief: The number of frames that were synthesized for the Ryz display because Unity missed them.
+    uint64_t framesSynthesized;
+
+    /// @brief: The number of external surface frames that were blended over the Ryz image, at their presentation times.
+    uint64_t surfaceFramesPresented;
+
+    /// @brief: The number of external surface frames that were never shown, because a later frame was due by the time they could be.
+    uint64_t surfaceFramesDropped;
+
+    /// @brief: The number of frames that were copied off the GPU for the capture sinks.
+    uint64_t captureFrames;
+
+    /// @brief: The number of frames that weren't captured because every staging buffer was still waiting for the GPU or the capture thread.
+    uint64_t captureFramesDropped;
+
+    /// @brief: The number of bytes that were copied off the GPU for the capture sinks in the last frame.
+    uint64_t captureBytesLastFrame;
+
+    /// @brief: The time the render thread spent encoding the capture copies of the last frame, in microseconds.
+    uint64_t captureRenderMicrosecondsLastFrame;
+
+    /// @brief: The time the capture sinks spent on the last captured frame, in microseconds.
+    uint64_t captureWorkerMicrosecondsLastFrame;
+
+    /// @brief: The number of frames that were written to the recording.
+    uint64_t recordingFramesWritten;
+
+    /// @brief: The number of frames that weren't recorded because the disk had fallen behind, or the frame changed size.
+    uint64_t recordingFramesDropped;
+
+    /// @brief: The number of frames that were sent to the preview client.
+    uint64_t previewFramesSent;
+
+    /// @brief: The number of bytes that were sent to the preview client.
+    uint64_t previewBytesSent;
+
+    /// @brief: The number of frames that were replaced by newer ones before the preview server could send them.
+    uint64_t previewFramesSkipped;
+};
+
+/// @brief: The live counters behind @see frame_stats.
+/// @remarks: These are written by the render thread and can be read from any thread.
+struct frame_stats_counters
+{
+    std::atomic<uint64_t> framesSubmitted;
+    std::atomic<uint64_t> framesPresented;
+    std::atomic<uint64_t> framesSkipped;
+    std::atomic<uint64_t> ryzBytesCopied;
+    std::atomic<uint64_t> ryzBytesLastFrame;
+    std::atomic<uint64_t> occludedPixels;
+    std::atomic<uint64_t> occludedPixelsLastFrame;
+    std::atomic<uint64_t> ryzFramesRepeated;
+    std::atomic<uint64_t> mainFramesDropped;
+    std::atomic<uint64_t> framesSynthesized;
+    std::atomic<uint64_t> surfaceFramesPresented;
+    std::atomic<uint64_t> surfaceFramesDropped;
+    std::atomic<uint64_t> captureFrames;
+    std::atomic<uint64_t> captureFramesDropped;
+    std::atomic<uint64_t> captureBytesLastFrame;
+    std::atomic<uint64_t> captureRenderMicrosecondsLastFrame;
+    std::atomic<uint64_t> captureWorkerMicrosecondsLastFrame;
+    std::atomic<uint64_t> recordingFramesWritten;
+    std::atomic<uint64_t> recordingFramesDropped;
+    std::atomic<uint64_t> previewFramesSent;
+    std::atomic<uint64_t> previewBytesSent;
+    std::atomic<uint64_t> previewFramesSkipped;
+};
+
+/// @brief: The counters for the frames the plugin has handled.
+extern frame_stats_counters frameStatsCounters;
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Copies the current frame counters.
+    /// @param stats The object that the counters are copied into.
+    EXPORT_API void ikinRyzGetFrameStats(frame_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
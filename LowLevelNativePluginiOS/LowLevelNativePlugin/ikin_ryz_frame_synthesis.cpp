@@ -0,0 +1,112 @@
+//
+//  ikin_ryz_frame_synthesis.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_frame_synthesis.h"
+
+#include <cmath>
+
+// Placed in an anonymous namespace to avoid these functions being accessed outside this file
+namespace
+{
+    /// @brief: Converts a value in bytes back to a byte, rounding to nearest and clamping, the same as writing a normalized value does.
+    inline uint8_t to_byte(float value)
+    {
+        if (value <= 0.0f)
+        {
+            return 0;
+        }
+
+        if (value >= 255.0f)
+        {
+            return 255;
+        }
+
+        return (uint8_t)(value + 0.5f);
+    }
+
+    /// @brief: Clamps a pixel coordinate to the edge of the image, the same as the clamp-to-edge address mode.
+    inline int clamp_coordinate(int value, int size)
+    {
+        return value < 0 ? 0 : (value >= size ? size - 1 : value);
+    }
+}
+
+/// @brief: Synthesizes a frame by pushing each pixel of the latest frame further along the change from the previous frame.
+/// @param previous The first row of the frame before the latest one.
+/// @param current The first row of the latest frame.
+/// @param output The first row of the synthesized frame.
+/// @param width The width of the frames in pixels.
+/// @param height The height of the frames in pixels.
+/// @param bytesPerRow The distance between the start of two rows of each frame, in bytes.
+/// @param extrapolation How far past the latest frame to go, as a fraction of the change between the two frames.
+void extrapolate_frame(const uint8_t* previous, const uint8_t* current, uint8_t* output,
+                       int width, int height, size_t bytesPerRow, float extrapolation)
+{
+    const int rowBytes = width * 4;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* previousRow = previous + y * bytesPerRow;
+        const uint8_t* currentRow = current + y * bytesPerRow;
+        uint8_t* outputRow = output + y * bytesPerRow;
+
+        // Each byte is independent, so the compiler is free to vectorize this loop.
+        for (int byte = 0; byte < rowBytes; ++byte)
+        {
+            const float change = (float)currentRow[byte] - (float)previousRow[byte];
+
+            outputRow[byte] = to_byte(currentRow[byte] + change * extrapolation);
+        }
+    }
+}
+
+/// @brief: Synthesizes a frame by moving the pixels of the latest frame along their motion vectors.
+/// @param current The first row of the latest 32-bit frame.
+/// @param motionVectors The change in texture coordinates of each pixel since the previous frame, as pairs of floats in rows from the top left.
+/// @param output The first row of the synthesized frame.
+/// @param width The width of the frames and the motion vectors in pixels.
+/// @param height The height of the frames and the motion vectors in pixels.
+/// @param bytesPerRow The distance between the start of two rows of the current and synthesized frames, in bytes.
+/// @param frames How many frames past the latest one to move the pixels.
+void reproject_frame(const uint8_t* current, const float* motionVectors, uint8_t* output,
+                     int width, int height, size_t bytesPerRow, float frames)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        uint8_t* outputRow = output + y * bytesPerRow;
+
+        for (int x = 0; x < width; ++x)
+        {
+            const float* motion = motionVectors + ((size_t)y * width + x) * 2;
+
+            // The pixel comes from where it was, moved back along its motion. Sample at pixel centers, the same as the GPU does.
+            const float sourceX = (x + 0.5f - motion[0] * frames * width) - 0.5f;
+            const float sourceY = (y + 0.5f - motion[1] * frames * height) - 0.5f;
+
+            const float floorX = std::floor(sourceX);
+            const float floorY = std::floor(sourceY);
+            const float fractionX = sourceX - floorX;
+            const float fractionY = sourceY - floorY;
+
+            const int left = clamp_coordinate((int)floorX, width);
+            const int right = clamp_coordinate((int)floorX + 1, width);
+            const int top = clamp_coordinate((int)floorY, height);
+            const int bottom = clamp_coordinate((int)floorY + 1, height);
+
+            const uint8_t* topRow = current + top * bytesPerRow;
+            const uint8_t* bottomRow = current + bottom * bytesPerRow;
+
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                const float upper = topRow[left * 4 + channel] + (topRow[right * 4 + channel] - topRow[left * 4 + channel]) * fractionX;
+                const float lower = bottomRow[left * 4 + channel] + (bottomRow[right * 4 + channel] - bottomRow[left * 4 + channel]) * fractionX;
+
+                outputRow[x * 4 + channel] = to_byte(upper + (lower - upper) * fractionY);
+            }
+        }
+    }
+}
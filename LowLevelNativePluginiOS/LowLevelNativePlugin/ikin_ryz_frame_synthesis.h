@@ -0,0 +1,48 @@
+//
+//  ikin_ryz_frame_synthesis.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_FRAME_SYNTHESIS_H
+#define IKIN_RYZ_FRAME_SYNTHESIS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief: How far past the latest frame a blended frame extrapolates, per synthesized frame, as a fraction of the change between the last two frames.
+/// @remarks: Less than a whole frame, since pixels that moved ghost more the further they are pushed.
+const float frameSynthesisExtrapolation = 0.5f;
+
+/// @brief: The most frames that are synthesized in a row before the display is left showing the last one.
+/// @remarks: Each synthesized frame is extrapolated further from real frames, so the error grows with every one.
+const int maxSynthesizedFrames = 2;
+
+/// @brief: Synthesizes a frame by pushing each pixel of the latest frame further along the change from the previous frame.
+/// @param previous The first row of the frame before the latest one.
+/// @param current The first row of the latest frame.
+/// @param output The first row of the synthesized frame.
+/// @param width The width of the frames in pixels.
+/// @param height The height of the frames in pixels.
+/// @param bytesPerRow The distance between the start of two rows of each frame, in bytes.
+/// @param extrapolation How far past the latest frame to go, as a fraction of the change between the two frames.
+/// @remarks: This is the CPU reference of the blend pass the frame synthesizer runs on the GPU.
+/// Works on any 32-bit format with 8-bit channels, since every channel is extrapolated on its own.
+void extrapolate_frame(const uint8_t* previous, const uint8_t* current, uint8_t* output,
+                       int width, int height, size_t bytesPerRow, float extrapolation);
+
+/// @brief: Synthesizes a frame by moving the pixels of the latest frame along their motion vectors.
+/// @param current The first row of the latest 32-bit frame.
+/// @param motionVectors The change in texture coordinates of each pixel since the previous frame, as pairs of floats in rows from the top left.
+/// @param output The first row of the synthesized frame.
+/// @param width The width of the frames and the motion vectors in pixels.
+/// @param height The height of the frames and the motion vectors in pixels.
+/// @param bytesPerRow The distance between the start of two rows of the current and synthesized frames, in bytes.
+/// @param frames How many frames past the latest one to move the pixels.
+/// @remarks: This is the CPU reference of the motion vector pass the frame synthesizer runs on the GPU.
+/// Each pixel is sampled bilinearly from where its motion vector says it came from, the same as the GPU sampler does.
+void reproject_frame(const uint8_t* current, const float* motionVectors, uint8_t* output,
+                     int width, int height, size_t bytesPerRow, float frames);
+
+#endif
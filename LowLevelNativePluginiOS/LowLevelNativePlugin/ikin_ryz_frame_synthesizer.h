@@ -0,0 +1,113 @@
+//
+//  ikin_ryz_frame_synthesizer.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_FRAME_SYNTHESIZER_H
+#define IKIN_RYZ_FRAME_SYNTHESIZER_H
+
+#import <Metal/Metal.h>
+#import <simd/simd.h>
+
+#include <mutex>
+
+#include "ikin_ryz_frame_synthesis.h"
+#include "native_to_unity_notifiers.h"
+
+/// @brief: Keeps the last two images presented on the Ryz display, and synthesizes a new one from them when Unity misses a frame.
+/// @remarks: Without motion vectors, the latest image is extrapolated along its change from the one before it.
+/// With motion vectors from the application, its pixels are moved along them instead, which doesn't ghost.
+/// The passes produce the same values as @see extrapolate_frame and @see reproject_frame.
+class ikin_ryz_frame_synthesizer
+{
+public:
+    /// @brief: Compiles the shaders and creates the pipeline objects.
+    /// @param device The Metal device that Unity renders with.
+    /// @param pixelFormat The pixel format of the drawables of the Ryz display.
+    /// @returns: True if the synthesizer is ready to record and synthesize frames, otherwise false.
+    bool initialize(id<MTLDevice> device, MTLPixelFormat pixelFormat);
+
+    /// @brief: Releases the pipeline objects and the recorded images.
+    void release();
+
+    /// @brief: Gets a value indicating whether the synthesizer is ready to record and synthesize frames.
+    /// @returns: True if the synthesizer is ready, otherwise false.
+    bool is_initialized() const;
+
+    /// @brief: Gets the memory held by the recorded images.
+    /// @returns: The size of the images in bytes, or zero if none have been recorded.
+    uint64_t allocated_bytes();
+
+    /// @brief: Encodes a copy of an image that is being presented on the Ryz display into the recorded images.
+    /// @param commandBuffer The command buffer that presents the image. Must not have been committed yet.
+    /// @param presented The texture that is presented, after it has been composed.
+    /// @param uvTransform The transform from the texture coordinates of the presented texture to those of the Ryz eye texture. @see uv_transform.
+    void record(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> presented, simd_float4 uvTransform);
+
+    /// @brief: Forgets the recorded images, so that nothing is synthesized until two more have been recorded.
+    void clear();
+
+    /// @brief: Encodes a pass that synthesizes a frame from the recorded images.
+    /// @param commandBuffer The command buffer the pass is encoded into. Must not have been committed yet.
+    /// @param destination The texture that is drawn into. Must be the size of the recorded images.
+    /// @param frames How many frames past the latest recorded image the synthesized frame is.
+    /// @returns: True if a frame was synthesized, false if there aren't two recorded images of the size of the destination.
+    bool encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> destination, int frames);
+
+private:
+    /// @brief: The number of presented images that are kept.
+    static const int historyCount = 2;
+
+    /// @brief: The pipeline that extrapolates the latest image from the one before it.
+    id<MTLRenderPipelineState> blendPipelineState;
+
+    /// @brief: The pipeline that moves the pixels of the latest image along the motion vectors.
+    id<MTLRenderPipelineState> motionPipelineState;
+
+    /// @brief: The sampler that reads the recorded images and the motion vectors.
+    id<MTLSamplerState> samplerState;
+
+    /// @brief: The recorded images. Only the GPU accesses them.
+    id<MTLTexture> history[historyCount];
+
+    /// @brief: The index of the latest recorded image in @see history.
+    int latest;
+
+    /// @brief: The number of images recorded since the last call to @see clear, up to @see historyCount.
+    int recordedCount;
+
+    /// @brief: The transform from the texture coordinates of the latest recorded image to those of the Ryz eye texture.
+    simd_float4 latestUvTransform;
+
+    /// @brief: Signaled on the GPU once each image has been recorded, since frames are synthesized on a different command queue than they are recorded on.
+    id<MTLEvent> recordedEvent API_AVAILABLE(ios(12.0));
+
+    /// @brief: The value @see recordedEvent is signaled with once the latest image has been recorded.
+    uint64_t recordedEventValue;
+
+    /// @brief: The command buffer that records the latest image, for systems without events.
+    id<MTLCommandBuffer> recordingCommandBuffer;
+
+    /// @brief: Guards the recorded images, which are recorded on the render thread and synthesized from on the main thread.
+    std::mutex historyMutex;
+};
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Sets the texture that holds the motion vectors of the Ryz eye, which make synthesized frames more accurate.
+    /// @param texture The native Metal texture, from Texture.GetNativeTexturePtr, or null to stop using motion vectors.
+    /// @remarks: Each texel holds the change in texture coordinates of the Ryz eye pixel under it since the previous frame, in its red and green channels.
+    EXPORT_API void ikinRyzSetMotionVectorTexture(void* texture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,361 @@
+//
+//  ikin_ryz_frame_synthesizer.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_frame_synthesizer.h"
+
+#include <algorithm>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The source of the synthesis shaders.
+    /// @remarks: The plugin is a static library, so the shaders are compiled at runtime instead of shipping a Metal library with it.
+    /// Both passes draw a triangle that covers the whole drawable, the same as the compose pass.
+    const char* const synthesisShaderSource = R"(
+        #include <metal_stdlib>
+        using namespace metal;
+
+        struct synthesis_vertex
+        {
+            float4 position [[position]];
+            float2 uv;
+        };
+
+        struct synthesis_params
+        {
+            float4 uvTransform;
+            float frames;
+            float extrapolation;
+        };
+
+        vertex synthesis_vertex synthesis_vertex_main(uint vertexId [[vertex_id]])
+        {
+            float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+
+            synthesis_vertex out;
+            out.position = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+            out.uv = uv;
+
+            return out;
+        }
+
+        fragment float4 synthesis_blend_main(synthesis_vertex in [[stage_in]],
+                                             texture2d<float> current [[texture(0)]],
+                                             texture2d<float> previous [[texture(1)]],
+                                             sampler historySampler [[sampler(0)]],
+                                             constant synthesis_params& params [[buffer(0)]])
+        {
+            const float4 latest = current.sample(historySampler, in.uv);
+            const float4 change = latest - previous.sample(historySampler, in.uv);
+
+            return saturate(latest + change * params.extrapolation);
+        }
+
+        fragment float4 synthesis_motion_main(synthesis_vertex in [[stage_in]],
+                                              texture2d<float> current [[texture(0)]],
+                                              texture2d<float> motionVectors [[texture(2)]],
+                                              sampler historySampler [[sampler(0)]],
+                                              constant synthesis_params& params [[buffer(0)]])
+        {
+            // The motion vectors are laid out like the Ryz eye, which the presented image may have been flipped or cropped from.
+            const float2 eyeUv = in.uv * params.uvTransform.xy + params.uvTransform.zw;
+            const float2 motion = motionVectors.sample(historySampler, eyeUv).xy / params.uvTransform.xy;
+
+            return current.sample(historySampler, in.uv - motion * params.frames);
+        }
+    )";
+
+    /// @brief: The values the synthesis shaders are given. Must match synthesis_params in the shader source.
+    struct synthesis_params
+    {
+        simd_float4 uvTransform;
+        float frames;
+        float extrapolation;
+    };
+
+    /// @brief: The motion vectors of the Ryz eye that the application has set, or nil.
+    id<MTLTexture> motionVectorTexture;
+
+    /// @brief: Guards @see motionVectorTexture, which is set on the main thread and read wherever frames are synthesized.
+    std::mutex motionVectorTextureMutex;
+
+    /// @brief: Gets the motion vectors of the Ryz eye that the application has set.
+    /// @returns: The texture, or nil if there is none.
+    id<MTLTexture> get_motion_vector_texture()
+    {
+        std::lock_guard<std::mutex> guard(motionVectorTextureMutex);
+
+        return motionVectorTexture;
+    }
+}
+
+/// @brief: Compiles the shaders and creates the pipeline objects.
+/// @param device The Metal device that Unity renders with.
+/// @param pixelFormat The pixel format of the drawables of the Ryz display.
+/// @returns: True if the synthesizer is ready to record and synthesize frames, otherwise false.
+bool ikin_ryz_frame_synthesizer::initialize(id<MTLDevice> device, MTLPixelFormat pixelFormat)
+{
+    // If the pipelines already exist, then there is nothing to do.
+    if (blendPipelineState != nil && blendPipelineState.device == device)
+    {
+        return true;
+    }
+
+    release();
+
+    NSError* error = nil;
+
+    // Compile the shaders.
+    id<MTLLibrary> library = [device newLibraryWithSource : [NSString stringWithUTF8String : synthesisShaderSource]
+                                                  options : nil
+                                                    error : &error];
+
+    if (library == nil)
+    {
+        return false;
+    }
+
+    // Both pipelines draw the same full-screen triangle into the drawable, with a different fragment shader.
+    MTLRenderPipelineDescriptor* pipelineDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
+    pipelineDescriptor.vertexFunction = [library newFunctionWithName : @"synthesis_vertex_main"];
+    pipelineDescriptor.colorAttachments[0].pixelFormat = pixelFormat;
+
+    pipelineDescriptor.fragmentFunction = [library newFunctionWithName : @"synthesis_blend_main"];
+    blendPipelineState = [device newRenderPipelineStateWithDescriptor : pipelineDescriptor
+                                                                 error : &error];
+
+    pipelineDescriptor.fragmentFunction = [library newFunctionWithName : @"synthesis_motion_main"];
+    motionPipelineState = [device newRenderPipelineStateWithDescriptor : pipelineDescriptor
+                                                                  error : &error];
+
+    // Use bilinear filtering, since motion vectors rarely land on pixel centers.
+    MTLSamplerDescriptor* samplerDescriptor = [[MTLSamplerDescriptor alloc] init];
+    samplerDescriptor.minFilter = MTLSamplerMinMagFilterLinear;
+    samplerDescriptor.magFilter = MTLSamplerMinMagFilterLinear;
+    samplerDescriptor.sAddressMode = MTLSamplerAddressModeClampToEdge;
+    samplerDescriptor.tAddressMode = MTLSamplerAddressModeClampToEdge;
+
+    samplerState = [device newSamplerStateWithDescriptor : samplerDescriptor];
+
+    if (@available(iOS 12.0, *))
+    {
+        recordedEvent = [device newEvent];
+    }
+
+    if (blendPipelineState == nil || motionPipelineState == nil)
+    {
+        release();
+        return false;
+    }
+
+    return true;
+}
+
+/// @brief: Releases the pipeline objects and the recorded images.
+void ikin_ryz_frame_synthesizer::release()
+{
+    blendPipelineState = nil;
+    motionPipelineState = nil;
+    samplerState = nil;
+
+    std::lock_guard<std::mutex> guard(historyMutex);
+
+    for (int image = 0; image < historyCount; ++image)
+    {
+        history[image] = nil;
+    }
+
+    if (@available(iOS 12.0, *))
+    {
+        recordedEvent = nil;
+    }
+
+    recordedEventValue = 0;
+    recordingCommandBuffer = nil;
+    recordedCount = 0;
+}
+
+/// @brief: Gets a value indicating whether the synthesizer is ready to record and synthesize frames.
+/// @returns: True if the synthesizer is ready, otherwise false.
+bool ikin_ryz_frame_synthesizer::is_initialized() const
+{
+    return blendPipelineState != nil;
+}
+
+/// @brief: Gets the memory held by the recorded images.
+/// @returns: The size of the images in bytes, or zero if none have been recorded.
+uint64_t ikin_ryz_frame_synthesizer::allocated_bytes()
+{
+    uint64_t bytes = 0;
+
+    if (@available(iOS 11.0, *))
+    {
+        std::lock_guard<std::mutex> guard(historyMutex);
+
+        for (int image = 0; image < historyCount; ++image)
+        {
+            if (history[image] != nil)
+            {
+                bytes += history[image].allocatedSize;
+            }
+        }
+    }
+
+    return bytes;
+}
+
+/// @brief: Encodes a copy of an image that is being presented on the Ryz display into the recorded images.
+/// @param commandBuffer The command buffer that presents the image. Must not have been committed yet.
+/// @param presented The texture that is presented, after it has been composed.
+/// @param uvTransform The transform from the texture coordinates of the presented texture to those of the Ryz eye texture. @see uv_transform.
+void ikin_ryz_frame_synthesizer::record(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> presented, simd_float4 uvTransform)
+{
+    std::lock_guard<std::mutex> guard(historyMutex);
+
+    const int next = (latest + 1) % historyCount;
+
+    // If the display changed size or format, then the recorded images no longer match it.
+    if (history[next] == nil ||
+        history[next].width != presented.width ||
+        history[next].height != presented.height ||
+        history[next].pixelFormat != presented.pixelFormat)
+    {
+        MTLTextureDescriptor* historyDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat : presented.pixelFormat
+                                                                                                     width : presented.width
+                                                                                                    height : presented.height
+                                                                                                 mipmapped : NO];
+        historyDescriptor.storageMode = MTLStorageModePrivate;
+        historyDescriptor.usage = MTLTextureUsageShaderRead;
+
+        history[next] = [commandBuffer.device newTextureWithDescriptor : historyDescriptor];
+
+        // The other image is the old size, so it can't be synthesized from.
+        recordedCount = 0;
+    }
+
+    id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+
+    [blitEncoder copyFromTexture : presented
+                     sourceSlice : 0
+                     sourceLevel : 0
+                    sourceOrigin : MTLOriginMake(0, 0, 0)
+                      sourceSize : MTLSizeMake(presented.width, presented.height, 1)
+                       toTexture : history[next]
+                destinationSlice : 0
+                destinationLevel : 0
+               destinationOrigin : MTLOriginMake(0, 0, 0)];
+
+    [blitEncoder endEncoding];
+
+    // Frames are synthesized on their own command queue, so they have to wait for the copy to finish on the GPU before reading it.
+    if (@available(iOS 12.0, *))
+    {
+        [commandBuffer encodeSignalEvent : recordedEvent
+                                   value : ++recordedEventValue];
+    }
+    else
+    {
+        recordingCommandBuffer = commandBuffer;
+    }
+
+    latest = next;
+    latestUvTransform = uvTransform;
+    recordedCount = std::min(recordedCount + 1, historyCount);
+}
+
+/// @brief: Forgets the recorded images, so that nothing is synthesized until two more have been recorded.
+void ikin_ryz_frame_synthesizer::clear()
+{
+    std::lock_guard<std::mutex> guard(historyMutex);
+
+    recordedCount = 0;
+}
+
+/// @brief: Encodes a pass that synthesizes a frame from the recorded images.
+/// @param commandBuffer The command buffer the pass is encoded into. Must not have been committed yet.
+/// @param destination The texture that is drawn into. Must be the size of the recorded images.
+/// @param frames How many frames past the latest recorded image the synthesized frame is.
+/// @returns: True if a frame was synthesized, false if there aren't two recorded images of the size of the destination.
+bool ikin_ryz_frame_synthesizer::encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> destination, int frames)
+{
+    std::lock_guard<std::mutex> guard(historyMutex);
+
+    id<MTLTexture> current = history[latest];
+    id<MTLTexture> previous = history[(latest + historyCount - 1) % historyCount];
+
+    // If there is nothing to extrapolate from, or it doesn't fit the drawable, then leave the last image on the display.
+    if (recordedCount < historyCount ||
+        current.width != destination.width ||
+        current.height != destination.height)
+    {
+        return false;
+    }
+
+    // Wait for the latest image to be recorded, which also covers the one before it.
+    // If there are no events to order the command queues with, then only synthesize from an image that has finished recording.
+    if (@available(iOS 12.0, *))
+    {
+        [commandBuffer encodeWaitForEvent : recordedEvent
+                                    value : recordedEventValue];
+    }
+    else if (recordingCommandBuffer.status != MTLCommandBufferStatusCompleted)
+    {
+        return false;
+    }
+
+    id<MTLTexture> motionVectors = get_motion_vector_texture();
+
+    const synthesis_params params =
+    {
+        latestUvTransform,
+        (float)frames,
+        frameSynthesisExtrapolation * frames
+    };
+
+    // Every pixel of the destination is overwritten, so its previous contents don't need to be loaded.
+    MTLRenderPassDescriptor* renderPassDescriptor = [MTLRenderPassDescriptor renderPassDescriptor];
+    renderPassDescriptor.colorAttachments[0].texture = destination;
+    renderPassDescriptor.colorAttachments[0].loadAction = MTLLoadActionDontCare;
+    renderPassDescriptor.colorAttachments[0].storeAction = MTLStoreActionStore;
+
+    id<MTLRenderCommandEncoder> renderEncoder = [commandBuffer renderCommandEncoderWithDescriptor : renderPassDescriptor];
+
+    // If the application supplies motion vectors, then move the pixels along them. Otherwise, extrapolate from the previous image.
+    [renderEncoder setRenderPipelineState : motionVectors != nil ? motionPipelineState : blendPipelineState];
+    [renderEncoder setFragmentTexture : current atIndex : 0];
+    [renderEncoder setFragmentTexture : previous atIndex : 1];
+    [renderEncoder setFragmentTexture : motionVectors atIndex : 2];
+    [renderEncoder setFragmentSamplerState : samplerState atIndex : 0];
+    [renderEncoder setFragmentBytes : &params length : sizeof(params) atIndex : 0];
+
+    // Draw the full-screen triangle.
+    [renderEncoder drawPrimitives : MTLPrimitiveTypeTriangle
+                      vertexStart : 0
+                      vertexCount : 3];
+
+    [renderEncoder endEncoding];
+
+    return true;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Sets the texture that holds the motion vectors of the Ryz eye, which make synthesized frames more accurate.
+    /// @param texture The native Metal texture, from Texture.GetNativeTexturePtr, or null to stop using motion vectors.
+    EXPORT_API void ikinRyzSetMotionVectorTexture(void* texture)
+    {
+        std::lock_guard<std::mutex> guard(motionVectorTextureMutex);
+
+        motionVectorTexture = (__bridge id<MTLTexture>)texture;
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,299 @@
+//
+//  ikin_ryz_input_trace.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_input_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::atomic<bool> inputTraceRecording(false);
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The start of a trace file.
+    struct input_trace_file_header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordHeaderSize;
+
+        /// @brief: The offset just past the last record, or 0 if the trace wasn't stopped, in which case the records end at the first one without a type.
+        uint64_t recordsEnd;
+
+        /// @brief: The number of records that were left out because the trace was full.
+        uint64_t droppedRecords;
+
+        /// @brief: The wall-clock time the trace started, in nanoseconds since the Unix epoch.
+        uint64_t startTime;
+    };
+
+    static_assert(sizeof(input_trace_file_header) == inputTraceHeaderSize, "The file header has to match inputTraceHeaderSize.");
+
+    /// @brief: The start of a record.
+    struct input_trace_record_header
+    {
+        /// @brief: The @see input_trace_record_type, which is stored last so that a reader never sees a record that is half written.
+        uint16_t type;
+        uint16_t size;
+        uint32_t reserved;
+        uint64_t timestamp;
+    };
+
+    static_assert(sizeof(input_trace_record_header) == inputTraceRecordHeaderSize, "The record header has to match inputTraceRecordHeaderSize.");
+
+    /// @brief: Serializes starting and stopping a trace.
+    std::mutex traceMutex;
+
+    /// @brief: The mapping of the trace that is being recorded.
+    uint8_t* traceMapping = nullptr;
+    size_t traceCapacity = 0;
+    int traceFd = -1;
+
+    /// @brief: The time the trace started, which the records' timestamps count from.
+    std::chrono::steady_clock::time_point traceStart;
+
+    /// @brief: The offset the next record is written at. Writers reserve their record by moving it on.
+    std::atomic<size_t> traceOffset(0);
+
+    /// @brief: The number of threads that are writing a record, which stopping waits for.
+    std::atomic<int> traceWriters(0);
+
+    /// @brief: The number of records that didn't fit.
+    std::atomic<uint64_t> traceDroppedRecords(0);
+
+    /// @brief: Rounds a payload size up to the 8 bytes that each record is aligned to.
+    inline size_t padded_size(size_t size)
+    {
+        return (size + 7) & ~(size_t)7;
+    }
+}
+
+bool start_input_trace(const char* path, size_t maxBytes)
+{
+    stop_input_trace();
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    const size_t capacity = std::max(padded_size(maxBytes), inputTraceHeaderSize + inputTraceRecordHeaderSize * 16);
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // The file is sparse until the records reach its pages, so reserving the whole size up front costs nothing.
+    void* mapping = ftruncate(fd, (off_t)capacity) == 0 ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    if (mapping == MAP_FAILED)
+    {
+        close(fd);
+        unlink(path);
+        return false;
+    }
+
+    input_trace_file_header header = {};
+    header.magic = inputTraceMagic;
+    header.version = inputTraceVersion;
+    header.recordHeaderSize = (uint16_t)inputTraceRecordHeaderSize;
+    header.startTime = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    memcpy(mapping, &header, sizeof(header));
+
+    traceMapping = (uint8_t*)mapping;
+    traceCapacity = capacity;
+    traceFd = fd;
+    traceStart = std::chrono::steady_clock::now();
+    traceOffset.store(inputTraceHeaderSize);
+    traceDroppedRecords.store(0);
+
+    inputTraceRecording.store(true, std::memory_order_release);
+
+    return true;
+}
+
+void stop_input_trace()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    if (!inputTraceRecording.exchange(false))
+    {
+        return;
+    }
+
+    // A writer that got past the flag before it was cleared is still copying into the mapping.
+    while (traceWriters.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    // A record that only partly fitted reserved space past the end, so the records end at the last whole one.
+    size_t recordsEnd = inputTraceHeaderSize;
+
+    while (recordsEnd + inputTraceRecordHeaderSize <= std::min(traceOffset.load(), traceCapacity))
+    {
+        const input_trace_record_header* record = (const input_trace_record_header*)(traceMapping + recordsEnd);
+
+        if (record->type == input_trace_end)
+        {
+            break;
+        }
+
+        recordsEnd += inputTraceRecordHeaderSize + padded_size(record->size);
+    }
+
+    input_trace_file_header* header = (input_trace_file_header*)traceMapping;
+    header->recordsEnd = recordsEnd;
+    header->droppedRecords = traceDroppedRecords.load();
+
+    msync(traceMapping, recordsEnd, MS_SYNC);
+    munmap(traceMapping, traceCapacity);
+    ftruncate(traceFd, (off_t)recordsEnd);
+    close(traceFd);
+
+    traceMapping = nullptr;
+    traceCapacity = 0;
+    traceFd = -1;
+}
+
+void append_input_record(input_trace_record_type type, const void* payload, uint16_t size)
+{
+    traceWriters.fetch_add(1);
+
+    // If the trace was stopped after the caller checked, then the mapping may be gone.
+    if (!inputTraceRecording.load())
+    {
+        traceWriters.fetch_sub(1);
+        return;
+    }
+
+    const uint64_t timestamp = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+    const size_t recordSize = inputTraceRecordHeaderSize + padded_size(size);
+    const size_t offset = traceOffset.fetch_add(recordSize, std::memory_order_relaxed);
+
+    if (offset + recordSize > traceCapacity)
+    {
+        traceDroppedRecords.fetch_add(1, std::memory_order_relaxed);
+        traceWriters.fetch_sub(1);
+        return;
+    }
+
+    input_trace_record_header* record = (input_trace_record_header*)(traceMapping + offset);
+    record->size = size;
+    record->timestamp = timestamp;
+    memcpy(record + 1, payload, size);
+
+    __atomic_store_n(&record->type, (uint16_t)type, __ATOMIC_RELEASE);
+
+    traceWriters.fetch_sub(1);
+}
+
+input_trace_reader::~input_trace_reader()
+{
+    if (mapping != nullptr)
+    {
+        munmap((void*)mapping, size);
+    }
+}
+
+bool input_trace_reader::open(const char* path)
+{
+    const int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    void* fileMapping = MAP_FAILED;
+
+    if (fstat(fd, &status) == 0 && (size_t)status.st_size >= inputTraceHeaderSize)
+    {
+        fileMapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    close(fd);
+
+    if (fileMapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const input_trace_file_header* header = (const input_trace_file_header*)fileMapping;
+
+    if (header->magic != inputTraceMagic || header->version != inputTraceVersion || header->recordHeaderSize != inputTraceRecordHeaderSize)
+    {
+        munmap(fileMapping, (size_t)status.st_size);
+        return false;
+    }
+
+    mapping = (const uint8_t*)fileMapping;
+    size = (size_t)status.st_size;
+    offset = inputTraceHeaderSize;
+
+    // A trace that wasn't stopped still holds every record that was finished before the app went away.
+    end = header->recordsEnd != 0 ? std::min((size_t)header->recordsEnd, size) : size;
+    droppedRecords = header->droppedRecords;
+
+    return true;
+}
+
+bool input_trace_reader::next(input_trace_record& record)
+{
+    if (mapping == nullptr || offset + inputTraceRecordHeaderSize > end)
+    {
+        return false;
+    }
+
+    const input_trace_record_header* header = (const input_trace_record_header*)(mapping + offset);
+    const size_t recordSize = inputTraceRecordHeaderSize + padded_size(header->size);
+
+    if (header->type == input_trace_end || offset + recordSize > end)
+    {
+        return false;
+    }
+
+    record.type = (input_trace_record_type)header->type;
+    record.timestamp = header->timestamp;
+    record.payload = (const uint8_t*)(header + 1);
+    record.size = header->size;
+
+    offset += recordSize;
+
+    return true;
+}
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts recording the frame hints, camera matrices, display events and submit times of the provider to a trace file.
+    EXPORT_API int ikinRyzStartInputTrace(const char* path, int maxBytes)
+    {
+        return start_input_trace(path, maxBytes > 0 ? (size_t)maxBytes : defaultInputTraceBytes) ? 1 : 0;
+    }
+
+    /// @brief Stops recording the trace and closes the file.
+    EXPORT_API void ikinRyzStopInputTrace()
+    {
+        stop_input_trace();
+    }
+
+#ifdef __cplusplus
+}
+#endif
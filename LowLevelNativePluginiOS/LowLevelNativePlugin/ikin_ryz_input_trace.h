@@ -0,0 +1,154 @@
+//
+//  ikin_ryz_input_trace.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_INPUT_TRACE_H
+#define IKIN_RYZ_INPUT_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "native_to_unity_notifiers.h"
+
+/// @brief: The value of the first four bytes of a trace, which read "RYZT".
+const uint32_t inputTraceMagic = 0x545A5952;
+
+/// @brief: The version of the trace's layout, which a reader checks before it reads the records.
+const uint16_t inputTraceVersion = 1;
+
+/// @brief: The size of the file header that starts a trace, in bytes.
+const size_t inputTraceHeaderSize = 32;
+
+/// @brief: The size of the header that starts each record, in bytes. Each record's payload follows it, padded to 8 bytes.
+const size_t inputTraceRecordHeaderSize = 16;
+
+/// @brief: The size a trace can grow to when none is given, in bytes.
+const size_t defaultInputTraceBytes = 64 * 1024 * 1024;
+
+/// @brief: The kinds of input that cross into the provider, which a trace records.
+enum input_trace_record_type : uint16_t
+{
+    /// @brief: Marks where the records end. A record is only given its type once its payload is written.
+    input_trace_end = 0,
+
+    /// @brief: The UnityXRFrameSetupHints that Unity populated the next frame with.
+    input_trace_frame_hints = 1,
+
+    /// @brief: A call to ikinRyzSetCameraMatrix, as an int32 stereo target mask and the 16 floats of the matrix, row by row.
+    input_trace_camera_matrix = 2,
+
+    /// @brief: A call to ikinRyzOnDisplayEvent, as an int32 @see display_event.
+    input_trace_display_event = 3,
+
+    /// @brief: A frame that Unity submitted, as the uint64 number of the frame.
+    input_trace_submit = 4
+};
+
+/// @brief: A record that was read from a trace.
+struct input_trace_record
+{
+    /// @brief: The kind of input.
+    input_trace_record_type type;
+
+    /// @brief: The time of the input, in nanoseconds since the trace started.
+    uint64_t timestamp;
+
+    /// @brief: The payload, which is only valid while the reader is open.
+    const uint8_t* payload;
+
+    /// @brief: The size of the payload, in bytes.
+    uint16_t size;
+};
+
+/// @brief: A value indicating whether a trace is being recorded, which the hooks check before they build a record.
+extern std::atomic<bool> inputTraceRecording;
+
+/// @brief: Starts recording the inputs of the provider to a trace file.
+/// @param path The path of the file.
+/// @param maxBytes The most bytes the file can hold. The records after that are counted but left out.
+/// @returns: True if the file was created and mapped, otherwise false.
+/// @remarks: The file is mapped into memory up front, so each record is a copy into the mapping without a system call or a lock.
+/// The mapping is shared with the file, so the records that were written survive the app being killed.
+/// A trace that is already being recorded is stopped first.
+bool start_input_trace(const char* path, size_t maxBytes);
+
+/// @brief: Stops recording, once the records that are being written are done, and trims the file to the records.
+void stop_input_trace();
+
+/// @brief: Appends a record to the trace.
+/// @param type The kind of input.
+/// @param payload The bytes of the input.
+/// @param size The number of bytes.
+/// @remarks: Safe to call from any thread. Call it through @see record_input so that it costs one load when no trace is being recorded.
+void append_input_record(input_trace_record_type type, const void* payload, uint16_t size);
+
+/// @brief: Appends a record to the trace, if a trace is being recorded.
+inline void record_input(input_trace_record_type type, const void* payload, uint16_t size)
+{
+    if (inputTraceRecording.load(std::memory_order_relaxed))
+    {
+        append_input_record(type, payload, size);
+    }
+}
+
+/// @brief: Reads the records of a trace file in the order they were appended.
+class input_trace_reader
+{
+public:
+    input_trace_reader() = default;
+    input_trace_reader(const input_trace_reader&) = delete;
+    input_trace_reader& operator=(const input_trace_reader&) = delete;
+
+    /// @brief: Unmaps the file.
+    ~input_trace_reader();
+
+    /// @brief: Maps a trace file.
+    /// @param path The path of the file.
+    /// @returns: True if the file is a trace of this version, otherwise false.
+    bool open(const char* path);
+
+    /// @brief: Reads the next record.
+    /// @param record The record that is read into.
+    /// @returns: True if a record was read, otherwise false at the end of the records.
+    bool next(input_trace_record& record);
+
+    /// @brief: Goes back to the first record.
+    void rewind() { offset = inputTraceHeaderSize; }
+
+    /// @brief: Gets the number of records that were left out because the trace was full.
+    uint64_t get_dropped_records() const { return droppedRecords; }
+
+private:
+    const uint8_t* mapping = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    size_t end = 0;
+    uint64_t droppedRecords = 0;
+};
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts recording the frame hints, camera matrices, display events and submit times of the provider to a trace file.
+    /// @param path The path of the file.
+    /// @param maxBytes The most bytes the file can hold, or 0 for @see defaultInputTraceBytes.
+    /// @returns: 1 if recording started, 0 if the file couldn't be created.
+    /// @remarks: Tools/ryz_replay replays a trace with its original timing.
+    EXPORT_API int ikinRyzStartInputTrace(const char* path, int maxBytes);
+
+    /// @brief Stops recording the trace and closes the file.
+    EXPORT_API void ikinRyzStopInputTrace();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+//
+//  ikin_ryz_layer_compositor.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_LAYER_COMPOSITOR_H
+#define IKIN_RYZ_LAYER_COMPOSITOR_H
+
+#import <Metal/Metal.h>
+#import <simd/simd.h>
+
+#include "ikin_ryz_composition_layers.h"
+#include "ikin_ryz_compositor.h"
+#include "ikin_ryz_settings.h"
+
+/// @brief: Blends the composition layers over the Ryz image once the eye has been drawn into the drawable of the Ryz display.
+/// @remarks: Each layer is placed on the Ryz image rather than on the display, so it is oriented, undistorted and color calibrated the same as the eye it covers.
+class ikin_ryz_layer_compositor
+{
+public:
+    /// @brief: Compiles the shaders and creates the pipeline objects.
+    /// @param device The Metal device that Unity renders with.
+    /// @param destinationPixelFormat The pixel format of the textures the layers are blended into.
+    /// @returns: True if the layer compositor is ready to encode layer passes, otherwise false.
+    bool initialize(id<MTLDevice> device, MTLPixelFormat destinationPixelFormat);
+
+    /// @brief: Releases the pipeline objects.
+    void release();
+
+    /// @brief: Gets a value indicating whether the layer compositor is ready to encode layer passes.
+    /// @returns: True if the layer compositor is ready, otherwise false.
+    bool is_initialized() const;
+
+    /// @brief: Encodes a pass that blends layers over the destination texture, lowest first.
+    /// @param commandBuffer The command buffer the pass is encoded into.
+    /// @param destination The texture that the Ryz eye was drawn into, which the layers are blended over.
+    /// @param layers The layers, in the order they are drawn in. @see get_composition_layers.
+    /// @param layerCount The number of layers.
+    /// @param orientation How the Ryz eye was flipped or rotated as it was drawn.
+    /// @param distortionMesh The distortion mesh the Ryz eye was drawn through, or nil.
+    /// @param colorLut The color lookup table the Ryz eye was drawn through, or nil.
+    void encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> destination, const composition_layer* layers, int layerCount, eye_orientation orientation, id<MTLTexture> distortionMesh, id<MTLTexture> colorLut);
+
+private:
+    /// @brief: The pipelines that run the layer shaders, indexed by @see compose_variant.
+    id<MTLRenderPipelineState> pipelineStates[compose_variant_count];
+
+    /// @brief: The sampler that reads the layer textures.
+    id<MTLSamplerState> samplerState;
+
+    /// @brief: The pixel format that the pipelines were created for.
+    MTLPixelFormat pixelFormat;
+};
+
+#endif
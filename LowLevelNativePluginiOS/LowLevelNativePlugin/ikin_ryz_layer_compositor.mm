@@ -0,0 +1,301 @@
+//
+//  ikin_ryz_layer_compositor.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_layer_compositor.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The source of the layer shaders.
+    /// @remarks: Each layer is drawn with the full-screen triangle of the compose pass, and every pixel outside of it is discarded.
+    /// This finds the layer's pixels the same way the compose pass finds the eye's, however the image is oriented or distorted.
+    /// Without distortion, the pass is scissored to the layer, so pixels it doesn't cover aren't shaded at all.
+    const char* const layerShaderSource = R"(
+        struct layer_vertex
+        {
+            float4 position [[position]];
+            float2 screenUv;
+        };
+
+        struct layer_uniforms
+        {
+            float4 imageTransform;
+            float4 rect;
+            float opacity;
+            uint encodeSrgb;
+        };
+
+        vertex layer_vertex layer_vertex_main(uint vertexId [[vertex_id]])
+        {
+            float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+
+            layer_vertex out;
+            out.position = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+            out.screenUv = uv;
+
+            return out;
+        }
+
+        fragment half4 layer_fragment_main(layer_vertex in [[stage_in]],
+                                           texture2d<half> layer [[texture(0)]],
+                                           texture2d<float, access::read> distortionMesh [[texture(1), function_constant(distortionCorrection)]],
+                                           texture3d<float, access::read> colorLut [[texture(2), function_constant(colorCalibration)]],
+                                           sampler layerSampler [[sampler(0)]],
+                                           constant layer_uniforms& uniforms [[buffer(0)]])
+        {
+            float2 imageUv = in.screenUv;
+
+            // If the optics distort the image, then find the point of the image that is drawn here, as the compose pass does.
+            if (distortionCorrection)
+            {
+                imageUv = sample_distortion_mesh(distortionMesh, in.screenUv);
+            }
+
+            // Find the point of the layer that covers that point of the image.
+            const float2 layerUv = ((imageUv * uniforms.imageTransform.xy + uniforms.imageTransform.zw) - uniforms.rect.xy) / uniforms.rect.zw;
+
+            if (any(layerUv < 0.0) || any(layerUv > 1.0))
+            {
+                discard_fragment();
+            }
+
+            half4 color = layer.sample(layerSampler, layerUv);
+
+            // The eye is presented as encoded sRGB bytes, so a layer that was decoded as it was sampled is encoded again to match.
+            if (uniforms.encodeSrgb != 0)
+            {
+                const half3 low = color.rgb * 12.92h;
+                const half3 high = 1.055h * pow(color.rgb, 1.0h / 2.4h) - 0.055h;
+                color.rgb = select(high, low, color.rgb <= 0.0031308h);
+            }
+
+            if (colorCalibration)
+            {
+                color.rgb = half3(apply_color_lut(colorLut, float3(color.rgb)));
+            }
+
+            color.a *= half(uniforms.opacity);
+
+            return color;
+        }
+    )";
+
+    /// @brief: The values the layer shaders draw a layer with. Matches layer_uniforms in @see layerShaderSource.
+    struct layer_uniforms
+    {
+        /// @brief: Maps points of the oriented image on the display to points of the image as it was rendered.
+        simd_float4 imageTransform;
+
+        /// @brief: The region of the image the layer covers, as its origin in x and y and its size in z and w.
+        simd_float4 rect;
+
+        /// @brief: How opaque the layer is.
+        float opacity;
+
+        /// @brief: Non-zero if the layer texture is decoded from sRGB as it is sampled.
+        uint32_t encodeSrgb;
+    };
+
+    /// @brief: Gets a value indicating whether a pixel format is decoded from sRGB as it is sampled.
+    /// @param format The pixel format.
+    /// @returns: True for the sRGB formats Unity renders into, otherwise false.
+    bool is_srgb_pixel_format(MTLPixelFormat format)
+    {
+        switch (format)
+        {
+            case MTLPixelFormatRGBA8Unorm_sRGB:
+            case MTLPixelFormatBGRA8Unorm_sRGB:
+            case MTLPixelFormatBGR10_XR_sRGB:
+            case MTLPixelFormatBGRA10_XR_sRGB:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    /// @brief: Gets the pixels of a destination texture that a region of the image is drawn into.
+    /// @param imageTransform Maps points of the oriented image on the display to points of the image as it was rendered.
+    /// @param rect The region of the image.
+    /// @param destination The destination texture.
+    /// @returns: The pixels, which are empty if the region is outside the destination.
+    MTLScissorRect image_rect_scissor(simd_float4 imageTransform, const normalized_rect& rect, id<MTLTexture> destination)
+    {
+        // The transform only flips the image, so each edge of the region maps back to an edge on the display.
+        const float left = (rect.x - imageTransform.z) / imageTransform.x;
+        const float right = (rect.x + rect.width - imageTransform.z) / imageTransform.x;
+        const float top = (rect.y - imageTransform.w) / imageTransform.y;
+        const float bottom = (rect.y + rect.height - imageTransform.w) / imageTransform.y;
+
+        const float width = (float)destination.width;
+        const float height = (float)destination.height;
+
+        const NSUInteger x0 = (NSUInteger)std::min(std::max(std::floor(std::min(left, right) * width), 0.0f), width);
+        const NSUInteger x1 = (NSUInteger)std::min(std::max(std::ceil(std::max(left, right) * width), 0.0f), width);
+        const NSUInteger y0 = (NSUInteger)std::min(std::max(std::floor(std::min(top, bottom) * height), 0.0f), height);
+        const NSUInteger y1 = (NSUInteger)std::min(std::max(std::ceil(std::max(top, bottom) * height), 0.0f), height);
+
+        return { x0, y0, x1 - x0, y1 - y0 };
+    }
+}
+
+/// @brief: Compiles the shaders and creates the pipeline objects.
+/// @param device The Metal device that Unity renders with.
+/// @param destinationPixelFormat The pixel format of the textures the layers are blended into.
+/// @returns: True if the layer compositor is ready to encode layer passes, otherwise false.
+bool ikin_ryz_layer_compositor::initialize(id<MTLDevice> device, MTLPixelFormat destinationPixelFormat)
+{
+    // If the pipelines already target this format, then there is nothing to do.
+    if (pipelineStates[compose_variant_none] != nil && pixelFormat == destinationPixelFormat)
+    {
+        return true;
+    }
+
+    release();
+
+    NSError* error = nil;
+
+    // Compile the shaders after the calibration functions they share with the compose pass.
+    NSString* shaderSource = [compose_calibration_shader_source() stringByAppendingString : [NSString stringWithUTF8String : layerShaderSource]];
+
+    id<MTLLibrary> library = [device newLibraryWithSource : shaderSource
+                                                  options : nil
+                                                    error : &error];
+
+    if (library == nil)
+    {
+        return false;
+    }
+
+    // Blend each layer over what is already in the destination by its alpha.
+    MTLRenderPipelineDescriptor* pipelineDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
+    pipelineDescriptor.vertexFunction = [library newFunctionWithName : @"layer_vertex_main"];
+    pipelineDescriptor.colorAttachments[0].pixelFormat = destinationPixelFormat;
+    pipelineDescriptor.colorAttachments[0].blendingEnabled = YES;
+    pipelineDescriptor.colorAttachments[0].sourceRGBBlendFactor = MTLBlendFactorSourceAlpha;
+    pipelineDescriptor.colorAttachments[0].destinationRGBBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
+    pipelineDescriptor.colorAttachments[0].sourceAlphaBlendFactor = MTLBlendFactorOne;
+    pipelineDescriptor.colorAttachments[0].destinationAlphaBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
+
+    for (int variant = 0; variant < compose_variant_count; ++variant)
+    {
+        pipelineDescriptor.fragmentFunction = [library newFunctionWithName : @"layer_fragment_main"
+                                                             constantValues : compose_function_constants(variant)
+                                                                      error : &error];
+
+        pipelineStates[variant] = [device newRenderPipelineStateWithDescriptor : pipelineDescriptor
+                                                                          error : &error];
+
+        if (pipelineStates[variant] == nil)
+        {
+            release();
+            return false;
+        }
+    }
+
+    // Use bilinear filtering so that a layer can be a different size than the region it covers.
+    MTLSamplerDescriptor* samplerDescriptor = [[MTLSamplerDescriptor alloc] init];
+    samplerDescriptor.minFilter = MTLSamplerMinMagFilterLinear;
+    samplerDescriptor.magFilter = MTLSamplerMinMagFilterLinear;
+    samplerDescriptor.sAddressMode = MTLSamplerAddressModeClampToEdge;
+    samplerDescriptor.tAddressMode = MTLSamplerAddressModeClampToEdge;
+
+    samplerState = [device newSamplerStateWithDescriptor : samplerDescriptor];
+
+    pixelFormat = destinationPixelFormat;
+
+    return true;
+}
+
+/// @brief: Releases the pipeline objects.
+void ikin_ryz_layer_compositor::release()
+{
+    for (int variant = 0; variant < compose_variant_count; ++variant)
+    {
+        pipelineStates[variant] = nil;
+    }
+
+    samplerState = nil;
+    pixelFormat = MTLPixelFormatInvalid;
+}
+
+/// @brief: Gets a value indicating whether the layer compositor is ready to encode layer passes.
+/// @returns: True if the layer compositor is ready, otherwise false.
+bool ikin_ryz_layer_compositor::is_initialized() const
+{
+    return pipelineStates[compose_variant_none] != nil;
+}
+
+/// @brief: Encodes a pass that blends layers over the destination texture, lowest first.
+/// @param commandBuffer The command buffer the pass is encoded into.
+/// @param destination The texture that the Ryz eye was drawn into, which the layers are blended over.
+/// @param layers The layers, in the order they are drawn in. @see get_composition_layers.
+/// @param layerCount The number of layers.
+/// @param orientation How the Ryz eye was flipped or rotated as it was drawn.
+/// @param distortionMesh The distortion mesh the Ryz eye was drawn through, or nil.
+/// @param colorLut The color lookup table the Ryz eye was drawn through, or nil.
+void ikin_ryz_layer_compositor::encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> destination, const composition_layer* layers, int layerCount, eye_orientation orientation, id<MTLTexture> distortionMesh, id<MTLTexture> colorLut)
+{
+    if (layerCount <= 0)
+    {
+        return;
+    }
+
+    // Layers are placed on the whole image, not on the region of the eye texture that was rendered into.
+    const simd_float4 imageTransform = uv_transform(orientation, { 0.0f, 0.0f, 1.0f, 1.0f });
+
+    // The eye has been drawn into the destination already, so the layers are blended over its contents.
+    MTLRenderPassDescriptor* renderPassDescriptor = [MTLRenderPassDescriptor renderPassDescriptor];
+    renderPassDescriptor.colorAttachments[0].texture = destination;
+    renderPassDescriptor.colorAttachments[0].loadAction = MTLLoadActionLoad;
+    renderPassDescriptor.colorAttachments[0].storeAction = MTLStoreActionStore;
+
+    id<MTLRenderCommandEncoder> renderEncoder = [commandBuffer renderCommandEncoderWithDescriptor : renderPassDescriptor];
+
+    [renderEncoder setRenderPipelineState : pipelineStates[compose_variant_for(distortionMesh, colorLut)]];
+    [renderEncoder setFragmentTexture : distortionMesh atIndex : 1];
+    [renderEncoder setFragmentTexture : colorLut atIndex : 2];
+    [renderEncoder setFragmentSamplerState : samplerState atIndex : 0];
+
+    for (int i = 0; i < layerCount; ++i)
+    {
+        const composition_layer& layer = layers[i];
+        const normalized_rect rect = composition_layer_rect(layer);
+
+        // A distorted layer can land anywhere on the display, so only an undistorted one can be scissored.
+        const MTLScissorRect scissorRect = distortionMesh == nil ?
+            image_rect_scissor(imageTransform, rect, destination) :
+            MTLScissorRect{ 0, 0, destination.width, destination.height };
+
+        if (scissorRect.width == 0 || scissorRect.height == 0)
+        {
+            continue;
+        }
+
+        const layer_uniforms uniforms =
+        {
+            imageTransform,
+            simd_make_float4(rect.x, rect.y, rect.width, rect.height),
+            layer.opacity,
+            is_srgb_pixel_format(layer.texture.pixelFormat) ? 1u : 0u
+        };
+
+        [renderEncoder setScissorRect : scissorRect];
+        [renderEncoder setFragmentBytes : &uniforms length : sizeof(uniforms) atIndex : 0];
+        [renderEncoder setFragmentTexture : layer.texture atIndex : 0];
+
+        // Draw the full-screen triangle, which the scissor and the shader cut down to the layer.
+        [renderEncoder drawPrimitives : MTLPrimitiveTypeTriangle
+                          vertexStart : 0
+                          vertexCount : 3];
+    }
+
+    [renderEncoder endEncoding];
+}
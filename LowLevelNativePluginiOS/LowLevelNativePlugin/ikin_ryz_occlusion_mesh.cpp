@@ -0,0 +1,94 @@
+//
+//  ikin_ryz_occlusion_mesh.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_occlusion_mesh.h"
+
+#include <cmath>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The number of samples along each axis used to measure how much of the viewport the mesh covers.
+    const int coverageSampleCount = 64;
+}
+
+/// @brief: Builds the mesh around a visible ellipse.
+/// @param radiusX The horizontal radius of the visible ellipse, where 0.5 reaches the left and right edges of the viewport.
+/// @param radiusY The vertical radius of the visible ellipse, where 0.5 reaches the top and bottom edges of the viewport.
+/// @returns: True if the mesh covers part of the viewport, false if the ellipse leaves nothing to occlude,
+/// or a radius isn't less than @see occlusionMeshOuterRadius.
+bool occlusion_mesh::build(float radiusX, float radiusY)
+{
+    vertices.clear();
+    indices.clear();
+    occludedFraction = 0.0f;
+
+    if (radiusX <= 0.0f || radiusY <= 0.0f)
+    {
+        return false;
+    }
+
+    // If the ellipse reaches the outer edge, then the ring between them would fold over itself.
+    if (!(radiusX < occlusionMeshOuterRadius) || !(radiusY < occlusionMeshOuterRadius))
+    {
+        return false;
+    }
+
+    // Measure the part of the viewport that is outside of the ellipse by sampling the center of each cell of a grid.
+    int occludedSamples = 0;
+
+    for (int row = 0; row < coverageSampleCount; ++row)
+    {
+        const float y = ((row + 0.5f) / coverageSampleCount - 0.5f) / radiusY;
+
+        for (int column = 0; column < coverageSampleCount; ++column)
+        {
+            const float x = ((column + 0.5f) / coverageSampleCount - 0.5f) / radiusX;
+
+            if (x * x + y * y > 1.0f)
+            {
+                ++occludedSamples;
+            }
+        }
+    }
+
+    // If the ellipse covers the whole viewport, then there is no need for a mesh.
+    if (occludedSamples == 0)
+    {
+        return false;
+    }
+
+    occludedFraction = (float)occludedSamples / (coverageSampleCount * coverageSampleCount);
+
+    vertices.reserve(segmentCount * 2);
+    indices.reserve(segmentCount * 6);
+
+    // Each segment has a vertex on the ellipse, followed by one on the outer circle in the same direction.
+    for (int segment = 0; segment < segmentCount; ++segment)
+    {
+        const float angle = 2.0f * (float)M_PI * segment / segmentCount;
+        const float cosine = std::cos(angle);
+        const float sine = std::sin(angle);
+
+        vertices.push_back({ 0.5f + radiusX * cosine, 0.5f + radiusY * sine });
+        vertices.push_back({ 0.5f + occlusionMeshOuterRadius * cosine, 0.5f + occlusionMeshOuterRadius * sine });
+    }
+
+    // Join each segment to the next with two triangles, wrapping around to the first segment.
+    for (int segment = 0; segment < segmentCount; ++segment)
+    {
+        const uint32_t inner = segment * 2;
+        const uint32_t outer = inner + 1;
+        const uint32_t nextInner = ((segment + 1) % segmentCount) * 2;
+        const uint32_t nextOuter = nextInner + 1;
+
+        indices.insert(indices.end(), { inner, outer, nextOuter });
+        indices.insert(indices.end(), { inner, nextOuter, nextInner });
+    }
+
+    return true;
+}
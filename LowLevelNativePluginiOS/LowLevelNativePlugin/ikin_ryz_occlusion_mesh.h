@@ -0,0 +1,48 @@
+//
+//  ikin_ryz_occlusion_mesh.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_OCCLUSION_MESH_H
+#define IKIN_RYZ_OCCLUSION_MESH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../External Headers/Unity/XR/UnityXRTypes.h"
+
+/// @brief: The radius of the outer edge of an occlusion mesh, measured from the center of the viewport.
+/// @remarks: The corners are about 0.71 from the center. The outer polygon has to stay past them between its vertices too,
+/// which 1.0 does for 32 segments, since each edge only dips to cos(pi / 32) of the radius.
+/// The visible ellipse has to stay inside of it, or the triangles of the ring would cross.
+const float occlusionMeshOuterRadius = 1.0f;
+
+/// @brief: A mesh that covers the parts of an eye texture that can't be seen on its display.
+/// @remarks: Unity draws the mesh into the depth buffer before the scene, so the pixels under it are never shaded.
+/// The visible part of the texture is an ellipse centered in it. The mesh fills the ring between the ellipse and
+/// a circle that reaches past the corners of the texture, so the corners are covered once the mesh is clipped to the viewport.
+struct occlusion_mesh
+{
+    /// @brief: The number of segments the ellipse is approximated with.
+    static const int segmentCount = 32;
+
+    /// @brief: The vertices of the mesh, in homogeneous viewport coordinates from zero (bottom/left) to one (top/right).
+    std::vector<UnityXRVector2> vertices;
+
+    /// @brief: The indices of the triangles of the mesh.
+    std::vector<uint32_t> indices;
+
+    /// @brief: The fraction of the viewport that the mesh covers, from zero to one.
+    float occludedFraction;
+
+    /// @brief: Builds the mesh around a visible ellipse.
+    /// @param radiusX The horizontal radius of the visible ellipse, where 0.5 reaches the left and right edges of the viewport.
+    /// @param radiusY The vertical radius of the visible ellipse, where 0.5 reaches the top and bottom edges of the viewport.
+    /// @returns: True if the mesh covers part of the viewport, false if the ellipse leaves nothing to occlude,
+    /// or a radius isn't less than @see occlusionMeshOuterRadius.
+    bool build(float radiusX, float radiusY);
+};
+
+#endif
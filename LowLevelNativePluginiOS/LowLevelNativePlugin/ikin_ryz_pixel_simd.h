@@ -0,0 +1,392 @@
+//
+//  ikin_ryz_pixel_simd.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_PIXEL_SIMD_H
+#define IKIN_RYZ_PIXEL_SIMD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/// @brief: Operations on four pixels at once, for the CPU references of the Ryz compose passes.
+/// @remarks: The pixels are held as structures of arrays: each vector holds one value for each of the four pixels, in its lanes,
+/// so that every step of a kernel handles four pixels in one instruction. The vectors are SSE2 or NEON when the compiler targets them,
+/// and arrays otherwise. Each function does what the matching Metal operation does, so the references read like their shaders.
+namespace pixel_simd
+{
+#if defined(__SSE2__)
+    /// @brief: A value for each of four pixels.
+    typedef __m128 lanes;
+
+    /// @brief: A condition for each of four pixels, with every bit of a lane set where it holds.
+    typedef __m128 lane_mask;
+
+    /// @brief: Four 32-bit pixels, as they are stored.
+    typedef __m128i packed_pixels;
+
+    inline lanes splat(float value) { return _mm_set1_ps(value); }
+    inline lanes add(lanes a, lanes b) { return _mm_add_ps(a, b); }
+    inline lanes subtract(lanes a, lanes b) { return _mm_sub_ps(a, b); }
+    inline lanes multiply(lanes a, lanes b) { return _mm_mul_ps(a, b); }
+    inline lanes divide(lanes a, lanes b) { return _mm_div_ps(a, b); }
+    inline lanes minimum(lanes a, lanes b) { return _mm_min_ps(a, b); }
+    inline lanes maximum(lanes a, lanes b) { return _mm_max_ps(a, b); }
+    inline lanes absolute(lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    inline lanes square_root(lanes a) { return _mm_sqrt_ps(a); }
+    inline void store(lanes value, float* values) { _mm_storeu_ps(values, value); }
+    inline lanes load(const float* values) { return _mm_loadu_ps(values); }
+
+    /// @brief: Rounds each lane down to a whole number, the same as floor in Metal.
+    inline lanes round_down(lanes a)
+    {
+        // Truncating rounds negative values up, so step those back down.
+        const lanes truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a), _mm_set1_ps(1.0f)));
+    }
+
+    /// @brief: Stores each lane as an integer, rounded toward zero.
+    inline void store_integers(lanes value, int32_t* values) { _mm_storeu_si128((__m128i*)values, _mm_cvttps_epi32(value)); }
+
+    inline lane_mask less(lanes a, lanes b) { return _mm_cmplt_ps(a, b); }
+    inline lane_mask greater(lanes a, lanes b) { return _mm_cmpgt_ps(a, b); }
+    inline lane_mask greater_or_equal(lanes a, lanes b) { return _mm_cmpge_ps(a, b); }
+    inline lane_mask either(lane_mask a, lane_mask b) { return _mm_or_ps(a, b); }
+    inline lane_mask both(lane_mask a, lane_mask b) { return _mm_and_ps(a, b); }
+
+    /// @brief: Picks each lane from the first value where the condition holds, and from the second where it doesn't, the same as select in Metal.
+    inline lanes select(lane_mask condition, lanes a, lanes b) { return _mm_or_ps(_mm_and_ps(condition, a), _mm_andnot_ps(condition, b)); }
+
+    /// @brief: Transposes four vectors, so that the lanes of each become one lane of every vector.
+    inline void transpose(lanes& a, lanes& b, lanes& c, lanes& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+
+    inline packed_pixels load_packed(const uint8_t* first) { return _mm_loadu_si128((const __m128i*)first); }
+    inline void store_packed(uint8_t* first, packed_pixels pixels) { _mm_storeu_si128((__m128i*)first, pixels); }
+    inline packed_pixels make_packed(uint32_t a, uint32_t b, uint32_t c, uint32_t d) { return _mm_setr_epi32((int)a, (int)b, (int)c, (int)d); }
+
+    /// @brief: Gets one 8-bit channel of four pixels, as values from 0 to 255.
+    template <int channel>
+    inline lanes unpack_channel(packed_pixels pixels)
+    {
+        return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, channel * 8), _mm_set1_epi32(0xFF)));
+    }
+
+    /// @brief: Packs four channels of four pixels, each already a whole number from 0 to 255, into the pixels.
+    inline packed_pixels pack_channels(lanes a, lanes b, lanes c, lanes d)
+    {
+        return _mm_or_si128(_mm_or_si128(_mm_cvttps_epi32(a), _mm_slli_epi32(_mm_cvttps_epi32(b), 8)),
+                            _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(c), 16), _mm_slli_epi32(_mm_cvttps_epi32(d), 24)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    /// @brief: A value for each of four pixels.
+    typedef float32x4_t lanes;
+
+    /// @brief: A condition for each of four pixels, with every bit of a lane set where it holds.
+    typedef uint32x4_t lane_mask;
+
+    /// @brief: Four 32-bit pixels, as they are stored.
+    typedef uint32x4_t packed_pixels;
+
+    inline lanes splat(float value) { return vdupq_n_f32(value); }
+    inline lanes add(lanes a, lanes b) { return vaddq_f32(a, b); }
+    inline lanes subtract(lanes a, lanes b) { return vsubq_f32(a, b); }
+    inline lanes multiply(lanes a, lanes b) { return vmulq_f32(a, b); }
+    inline lanes divide(lanes a, lanes b) { return vdivq_f32(a, b); }
+    inline lanes minimum(lanes a, lanes b) { return vminq_f32(a, b); }
+    inline lanes maximum(lanes a, lanes b) { return vmaxq_f32(a, b); }
+    inline lanes absolute(lanes a) { return vabsq_f32(a); }
+    inline lanes square_root(lanes a) { return vsqrtq_f32(a); }
+    inline void store(lanes value, float* values) { vst1q_f32(values, value); }
+    inline lanes load(const float* values) { return vld1q_f32(values); }
+
+    /// @brief: Rounds each lane down to a whole number, the same as floor in Metal.
+    inline lanes round_down(lanes a) { return vrndmq_f32(a); }
+
+    /// @brief: Stores each lane as an integer, rounded toward zero.
+    inline void store_integers(lanes value, int32_t* values) { vst1q_s32(values, vcvtq_s32_f32(value)); }
+
+    inline lane_mask less(lanes a, lanes b) { return vcltq_f32(a, b); }
+    inline lane_mask greater(lanes a, lanes b) { return vcgtq_f32(a, b); }
+    inline lane_mask greater_or_equal(lanes a, lanes b) { return vcgeq_f32(a, b); }
+    inline lane_mask either(lane_mask a, lane_mask b) { return vorrq_u32(a, b); }
+    inline lane_mask both(lane_mask a, lane_mask b) { return vandq_u32(a, b); }
+
+    /// @brief: Picks each lane from the first value where the condition holds, and from the second where it doesn't, the same as select in Metal.
+    inline lanes select(lane_mask condition, lanes a, lanes b) { return vbslq_f32(condition, a, b); }
+
+    /// @brief: Transposes four vectors, so that the lanes of each become one lane of every vector.
+    inline void transpose(lanes& a, lanes& b, lanes& c, lanes& d)
+    {
+        const float32x4x2_t ab = vtrnq_f32(a, b);
+        const float32x4x2_t cd = vtrnq_f32(c, d);
+
+        a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+
+    inline packed_pixels load_packed(const uint8_t* first) { return vld1q_u32((const uint32_t*)first); }
+    inline void store_packed(uint8_t* first, packed_pixels pixels) { vst1q_u32((uint32_t*)first, pixels); }
+
+    inline packed_pixels make_packed(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+    {
+        const uint32_t values[4] = { a, b, c, d };
+
+        return vld1q_u32(values);
+    }
+
+    /// @brief: Gets one 8-bit channel of four pixels, as values from 0 to 255.
+    template <int channel>
+    inline lanes unpack_channel(packed_pixels pixels)
+    {
+        return vcvtq_f32_u32(vandq_u32(vshrq_n_u32(pixels, channel * 8), vdupq_n_u32(0xFF)));
+    }
+
+    /// @brief: Gets the first 8-bit channel of four pixels, which needs no shift.
+    template <>
+    inline lanes unpack_channel<0>(packed_pixels pixels)
+    {
+        return vcvtq_f32_u32(vandq_u32(pixels, vdupq_n_u32(0xFF)));
+    }
+
+    /// @brief: Packs four channels of four pixels, each already a whole number from 0 to 255, into the pixels.
+    inline packed_pixels pack_channels(lanes a, lanes b, lanes c, lanes d)
+    {
+        return vorrq_u32(vorrq_u32(vcvtq_u32_f32(a), vshlq_n_u32(vcvtq_u32_f32(b), 8)),
+                         vorrq_u32(vshlq_n_u32(vcvtq_u32_f32(c), 16), vshlq_n_u32(vcvtq_u32_f32(d), 24)));
+    }
+#else
+    /// @brief: A value for each of four pixels.
+    struct lanes
+    {
+        float values[4];
+    };
+
+    /// @brief: A condition for each of four pixels.
+    struct lane_mask
+    {
+        bool values[4];
+    };
+
+    /// @brief: Four 32-bit pixels, as they are stored.
+    struct packed_pixels
+    {
+        uint32_t values[4];
+    };
+
+    /// @brief: Applies an operation to each lane.
+    template <typename Result, typename Value, typename Operation>
+    inline Result each(Value a, Value b, Operation operation)
+    {
+        return { { operation(a.values[0], b.values[0]), operation(a.values[1], b.values[1]),
+                   operation(a.values[2], b.values[2]), operation(a.values[3], b.values[3]) } };
+    }
+
+    inline lanes splat(float value) { return { { value, value, value, value } }; }
+    inline lanes add(lanes a, lanes b) { return each<lanes>(a, b, [](float x, float y) { return x + y; }); }
+    inline lanes subtract(lanes a, lanes b) { return each<lanes>(a, b, [](float x, float y) { return x - y; }); }
+    inline lanes multiply(lanes a, lanes b) { return each<lanes>(a, b, [](float x, float y) { return x * y; }); }
+    inline lanes divide(lanes a, lanes b) { return each<lanes>(a, b, [](float x, float y) { return x / y; }); }
+    inline lanes minimum(lanes a, lanes b) { return each<lanes>(a, b, [](float x, float y) { return std::min(x, y); }); }
+    inline lanes maximum(lanes a, lanes b) { return each<lanes>(a, b, [](float x, float y) { return std::max(x, y); }); }
+    inline lanes absolute(lanes a) { return each<lanes>(a, a, [](float x, float) { return std::fabs(x); }); }
+    inline lanes square_root(lanes a) { return each<lanes>(a, a, [](float x, float) { return std::sqrt(x); }); }
+    inline void store(lanes value, float* values) { std::copy(value.values, value.values + 4, values); }
+    inline lanes load(const float* values) { return { { values[0], values[1], values[2], values[3] } }; }
+
+    /// @brief: Rounds each lane down to a whole number, the same as floor in Metal.
+    inline lanes round_down(lanes a) { return each<lanes>(a, a, [](float x, float) { return std::floor(x); }); }
+
+    /// @brief: Stores each lane as an integer, rounded toward zero.
+    inline void store_integers(lanes value, int32_t* values)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            values[lane] = (int32_t)value.values[lane];
+        }
+    }
+
+    inline lane_mask less(lanes a, lanes b) { return each<lane_mask>(a, b, [](float x, float y) { return x < y; }); }
+    inline lane_mask greater(lanes a, lanes b) { return each<lane_mask>(a, b, [](float x, float y) { return x > y; }); }
+    inline lane_mask greater_or_equal(lanes a, lanes b) { return each<lane_mask>(a, b, [](float x, float y) { return x >= y; }); }
+    inline lane_mask either(lane_mask a, lane_mask b) { return each<lane_mask>(a, b, [](bool x, bool y) { return x || y; }); }
+    inline lane_mask both(lane_mask a, lane_mask b) { return each<lane_mask>(a, b, [](bool x, bool y) { return x && y; }); }
+
+    /// @brief: Picks each lane from the first value where the condition holds, and from the second where it doesn't, the same as select in Metal.
+    inline lanes select(lane_mask condition, lanes a, lanes b)
+    {
+        return { { condition.values[0] ? a.values[0] : b.values[0], condition.values[1] ? a.values[1] : b.values[1],
+                   condition.values[2] ? a.values[2] : b.values[2], condition.values[3] ? a.values[3] : b.values[3] } };
+    }
+
+    /// @brief: Transposes four vectors, so that the lanes of each become one lane of every vector.
+    inline void transpose(lanes& a, lanes& b, lanes& c, lanes& d)
+    {
+        lanes* rows[4] = { &a, &b, &c, &d };
+
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = row + 1; column < 4; ++column)
+            {
+                std::swap(rows[row]->values[column], rows[column]->values[row]);
+            }
+        }
+    }
+
+    inline packed_pixels load_packed(const uint8_t* first)
+    {
+        packed_pixels pixels;
+        memcpy(pixels.values, first, sizeof(pixels.values));
+        return pixels;
+    }
+
+    inline void store_packed(uint8_t* first, packed_pixels pixels) { memcpy(first, pixels.values, sizeof(pixels.values)); }
+    inline packed_pixels make_packed(uint32_t a, uint32_t b, uint32_t c, uint32_t d) { return { { a, b, c, d } }; }
+
+    /// @brief: Gets one 8-bit channel of four pixels, as values from 0 to 255.
+    template <int channel>
+    inline lanes unpack_channel(packed_pixels pixels)
+    {
+        lanes values;
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            values.values[lane] = (float)((pixels.values[lane] >> (channel * 8)) & 0xFF);
+        }
+
+        return values;
+    }
+
+    /// @brief: Packs four channels of four pixels, each already a whole number from 0 to 255, into the pixels.
+    inline packed_pixels pack_channels(lanes a, lanes b, lanes c, lanes d)
+    {
+        packed_pixels pixels;
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            pixels.values[lane] = (uint32_t)a.values[lane] | ((uint32_t)b.values[lane] << 8) |
+                                  ((uint32_t)c.values[lane] << 16) | ((uint32_t)d.values[lane] << 24);
+        }
+
+        return pixels;
+    }
+#endif
+
+    /// @brief: The four normalized channels of four pixels, each channel in a vector of its own.
+    struct pixel_lanes
+    {
+        lanes channel[4];
+    };
+
+    /// @brief: Gets the values 0, 1, 2 and 3, which are the offsets of the pixels in the lanes from the first of them.
+    inline lanes lane_offsets()
+    {
+        const float offsets[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+
+        return load(offsets);
+    }
+
+    /// @brief: Blends two values, the same as mix in Metal.
+    inline lanes mix(lanes a, lanes b, lanes amount)
+    {
+        return add(a, multiply(subtract(b, a), amount));
+    }
+
+    /// @brief: Keeps each lane within a range, the same as clamp in Metal.
+    inline lanes clamp(lanes value, float low, float high)
+    {
+        return minimum(maximum(value, splat(low)), splat(high));
+    }
+
+    /// @brief: Unpacks four 32-bit pixels into their normalized channels, the same as reading a normalized texture does.
+    inline pixel_lanes unpack(packed_pixels pixels)
+    {
+        const lanes scale = splat(1.0f / 255.0f);
+
+        return { { multiply(unpack_channel<0>(pixels), scale), multiply(unpack_channel<1>(pixels), scale),
+                   multiply(unpack_channel<2>(pixels), scale), multiply(unpack_channel<3>(pixels), scale) } };
+    }
+
+    /// @brief: Packs the normalized channels of four pixels, rounding to nearest and clamping, the same as writing a normalized value does.
+    inline packed_pixels pack(const pixel_lanes& value)
+    {
+        lanes scaled[4];
+
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            const lanes clamped = minimum(maximum(value.channel[channel], splat(0.0f)), splat(1.0f));
+
+            scaled[channel] = add(multiply(clamped, splat(255.0f)), splat(0.5f));
+        }
+
+        return pack_channels(scaled[0], scaled[1], scaled[2], scaled[3]);
+    }
+
+    /// @brief: Reads up to four pixels of a row of a 32-bit image.
+    /// @param first The first of the pixels.
+    /// @param count The number of pixels, from 1 to 4. The lanes past the last pixel repeat it.
+    inline pixel_lanes read_pixels(const uint8_t* first, int count)
+    {
+        if (count >= 4)
+        {
+            return unpack(load_packed(first));
+        }
+
+        // Don't read past the end of the row, which may be the end of the image.
+        uint32_t pixels[4];
+        memcpy(pixels, first, count * sizeof(uint32_t));
+        std::fill(pixels + count, pixels + 4, pixels[count - 1]);
+
+        return unpack(make_packed(pixels[0], pixels[1], pixels[2], pixels[3]));
+    }
+
+    /// @brief: Reads four pixels of a 32-bit image from anywhere in it.
+    /// @param pixels The first row of the image.
+    /// @param offsets The distance of each pixel from the start of the image, in bytes.
+    inline pixel_lanes gather_pixels(const uint8_t* pixels, const int32_t* offsets)
+    {
+        uint32_t gathered[4];
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            memcpy(&gathered[lane], pixels + offsets[lane], sizeof(uint32_t));
+        }
+
+        return unpack(make_packed(gathered[0], gathered[1], gathered[2], gathered[3]));
+    }
+
+    /// @brief: Writes up to four pixels of a row of a 32-bit image.
+    /// @param first The first of the pixels.
+    /// @param value The channels of the pixels.
+    /// @param count The number of pixels, from 1 to 4. The lanes past the last pixel are dropped.
+    inline void write_pixels(uint8_t* first, const pixel_lanes& value, int count)
+    {
+        const packed_pixels pixels = pack(value);
+
+        if (count >= 4)
+        {
+            store_packed(first, pixels);
+            return;
+        }
+
+        uint8_t bytes[16];
+        store_packed(bytes, pixels);
+        memcpy(first, bytes, count * sizeof(uint32_t));
+    }
+}
+
+#endif
@@ -0,0 +1,317 @@
+//
+//  ikin_ryz_preview_codec.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_preview_codec.h"
+
+#include <algorithm>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The most pixels a literal packet holds.
+    const int maxLiteralPixels = 128;
+
+    /// @brief: The most times a run packet repeats its pixel.
+    const int maxRunPixels = 129;
+
+    /// @brief: The size of the column, row and size that start each tile, in bytes.
+    const size_t tileHeaderSize = 8;
+
+    void write_u16(uint8_t* bytes, uint16_t value)
+    {
+        bytes[0] = (uint8_t)value;
+        bytes[1] = (uint8_t)(value >> 8);
+    }
+
+    void write_u32(uint8_t* bytes, uint32_t value)
+    {
+        write_u16(bytes, (uint16_t)value);
+        write_u16(bytes + 2, (uint16_t)(value >> 16));
+    }
+
+    uint16_t read_u16(const uint8_t* bytes)
+    {
+        return (uint16_t)(bytes[0] | (bytes[1] << 8));
+    }
+
+    uint32_t read_u32(const uint8_t* bytes)
+    {
+        return read_u16(bytes) | ((uint32_t)read_u16(bytes + 2) << 16);
+    }
+
+    /// @brief: Appends a color as 3-byte BGR.
+    inline void append_color(uint32_t color, std::vector<uint8_t>& out)
+    {
+        out.insert(out.end(), { (uint8_t)color, (uint8_t)(color >> 8), (uint8_t)(color >> 16) });
+    }
+
+    /// @brief: Appends the colors of a tile as runs.
+    /// @param colors The colors of the tile's pixels, a row at a time, as BGR in the low three bytes.
+    /// @param count The number of pixels.
+    /// @param out The bytes the runs are appended to.
+    /// @remarks: The tile is walked as one sequence of pixels, so that runs carry on across rows.
+    void encode_runs(const uint32_t* colors, int count, std::vector<uint8_t>& out)
+    {
+        int index = 0;
+
+        while (index < count)
+        {
+            int runLength = 1;
+
+            while (index + runLength < count && runLength < maxRunPixels && colors[index + runLength] == colors[index])
+            {
+                ++runLength;
+            }
+
+            // If the pixel repeats, then send it once with its count.
+            if (runLength >= 2)
+            {
+                out.push_back((uint8_t)(runLength + 126));
+                append_color(colors[index], out);
+                index += runLength;
+                continue;
+            }
+
+            // Otherwise send pixels as they are up to the next repeat.
+            int literalLength = 1;
+
+            while (index + literalLength < count && literalLength < maxLiteralPixels)
+            {
+                const int next = index + literalLength;
+
+                if (next + 1 < count && colors[next] == colors[next + 1])
+                {
+                    break;
+                }
+
+                ++literalLength;
+            }
+
+            out.push_back((uint8_t)(literalLength - 1));
+
+            for (int i = 0; i < literalLength; ++i)
+            {
+                append_color(colors[index + i], out);
+            }
+
+            index += literalLength;
+        }
+    }
+
+    /// @brief: Reads runs into the pixels of a tile.
+    /// @param bytes The runs.
+    /// @param size The number of bytes of runs.
+    /// @param rows The first pixel of each row of the tile.
+    /// @param rowCount The number of rows.
+    /// @param columnCount The number of pixels in each row.
+    /// @returns: True if the runs cover the tile exactly, otherwise false.
+    bool decode_runs(const uint8_t* bytes, size_t size, uint8_t* const* rows, int rowCount, int columnCount)
+    {
+        const int count = rowCount * columnCount;
+        const uint8_t* end = bytes + size;
+        int index = 0;
+
+        while (bytes < end)
+        {
+            const uint8_t control = *bytes++;
+            const bool run = control >= 128;
+            const int length = run ? control - 126 : control + 1;
+            const size_t packetSize = run ? 3 : (size_t)length * 3;
+
+            if (index + length > count || (size_t)(end - bytes) < packetSize)
+            {
+                return false;
+            }
+
+            for (int i = 0; i < length; ++i, ++index)
+            {
+                const uint8_t* source = run ? bytes : bytes + i * 3;
+                uint8_t* pixel = rows[index / columnCount] + (index % columnCount) * 4;
+
+                pixel[0] = source[0];
+                pixel[1] = source[1];
+                pixel[2] = source[2];
+                pixel[3] = 255;
+            }
+
+            bytes += packetSize;
+        }
+
+        return index == count;
+    }
+}
+
+/// @brief: Reads the header of a preview message.
+/// @param bytes The first @see previewHeaderSize bytes of the message.
+/// @param header The header that is read into.
+/// @returns: True if the bytes start a preview message of this version, otherwise false.
+bool read_preview_header(const uint8_t* bytes, preview_header& header)
+{
+    if (read_u32(bytes) != previewMagic || read_u16(bytes + 4) != previewVersion)
+    {
+        return false;
+    }
+
+    header.flags = read_u16(bytes + 6);
+    header.width = read_u16(bytes + 8);
+    header.height = read_u16(bytes + 10);
+    header.tileSize = read_u16(bytes + 12);
+    header.tileCount = read_u16(bytes + 14);
+    header.payloadSize = read_u32(bytes + 16);
+    header.frameIndex = read_u32(bytes + 20);
+
+    return header.tileSize > 0;
+}
+
+/// @brief: Encodes an image into a message.
+/// @param pixels The 8-bit BGRA pixels, top row first. The alpha is left out.
+/// @param width The width of the image in pixels, up to 65535.
+/// @param height The height of the image in pixels, up to 65535.
+/// @param bytesPerRow The distance between the starts of two rows of pixels, in bytes.
+/// @param frameIndex The number of the frame.
+/// @param keyframe True to send every tile, such as for a client that just connected.
+/// @param message The message, which is overwritten.
+/// @returns: The number of tiles in the message. A message without tiles doesn't need to be sent.
+int preview_encoder::encode(const uint8_t* pixels, int width, int height, size_t bytesPerRow, uint32_t frameIndex, bool keyframe, std::vector<uint8_t>& message)
+{
+    const int columns = (width + previewTileSize - 1) / previewTileSize;
+    const int rows = (height + previewTileSize - 1) / previewTileSize;
+
+    hashes.resize(tile_hash_count(width, height));
+    hash_tiles(pixels, width, height, bytesPerRow, hashes.data());
+
+    // If the image changed size, then none of the client's tiles can be kept.
+    if (width != previousWidth || height != previousHeight)
+    {
+        keyframe = true;
+        previousWidth = width;
+        previousHeight = height;
+    }
+
+    message.assign(previewHeaderSize, 0);
+
+    uint32_t colors[previewTileSize * previewTileSize];
+    int tileCount = 0;
+
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            const int tile = row * columns + column;
+
+            if (!keyframe && hashes[tile] == previousHashes[tile])
+            {
+                continue;
+            }
+
+            const int x = column * previewTileSize;
+            const int y = row * previewTileSize;
+            const int tileWidth = std::min(previewTileSize, width - x);
+            const int tileHeight = std::min(previewTileSize, height - y);
+
+            // Gather the colors of the tile, leaving out their alpha.
+            uint32_t* color = colors;
+
+            for (int i = 0; i < tileHeight; ++i)
+            {
+                const uint8_t* pixel = pixels + (y + i) * bytesPerRow + x * 4;
+
+                for (int j = 0; j < tileWidth; ++j, pixel += 4)
+                {
+                    *color++ = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
+                }
+            }
+
+            // Write the tile header, then fill in its size once its runs are known.
+            const size_t tileStart = message.size();
+            message.resize(tileStart + tileHeaderSize);
+            write_u16(&message[tileStart], (uint16_t)column);
+            write_u16(&message[tileStart + 2], (uint16_t)row);
+
+            encode_runs(colors, tileWidth * tileHeight, message);
+
+            write_u32(&message[tileStart + 4], (uint32_t)(message.size() - tileStart - tileHeaderSize));
+            ++tileCount;
+        }
+    }
+
+    write_u32(&message[0], previewMagic);
+    write_u16(&message[4], previewVersion);
+    write_u16(&message[6], keyframe ? previewKeyframe : 0);
+    write_u16(&message[8], (uint16_t)width);
+    write_u16(&message[10], (uint16_t)height);
+    write_u16(&message[12], (uint16_t)previewTileSize);
+    write_u16(&message[14], (uint16_t)tileCount);
+    write_u32(&message[16], (uint32_t)(message.size() - previewHeaderSize));
+    write_u32(&message[20], frameIndex);
+
+    previousHashes.swap(hashes);
+
+    return tileCount;
+}
+
+/// @brief: Applies the tiles of a message.
+/// @param header The header of the message.
+/// @param payload The @see preview_header::payloadSize bytes that follow the header.
+/// @returns: True if the message was applied, otherwise false if it is malformed or doesn't follow a keyframe.
+bool preview_decoder::decode(const preview_header& header, const uint8_t* payload)
+{
+    // If this is a keyframe, then start a new image, otherwise it has to patch the image there is.
+    if ((header.flags & previewKeyframe) != 0)
+    {
+        width = header.width;
+        height = header.height;
+        pixels.assign((size_t)width * height * 4, 0);
+    }
+    else if (header.width != width || header.height != height || width == 0)
+    {
+        return false;
+    }
+
+    const int tileSize = header.tileSize;
+    const int columns = (width + tileSize - 1) / tileSize;
+    const int rows = (height + tileSize - 1) / tileSize;
+    const uint8_t* end = payload + header.payloadSize;
+    std::vector<uint8_t*> tileRows(tileSize);
+
+    for (int i = 0; i < header.tileCount; ++i)
+    {
+        if ((size_t)(end - payload) < tileHeaderSize)
+        {
+            return false;
+        }
+
+        const int column = read_u16(payload);
+        const int row = read_u16(payload + 2);
+        const uint32_t size = read_u32(payload + 4);
+        payload += tileHeaderSize;
+
+        if (column >= columns || row >= rows || (size_t)(end - payload) < size)
+        {
+            return false;
+        }
+
+        const int x = column * tileSize;
+        const int y = row * tileSize;
+        const int tileWidth = std::min(tileSize, width - x);
+        const int tileHeight = std::min(tileSize, height - y);
+
+        for (int r = 0; r < tileHeight; ++r)
+        {
+            tileRows[r] = pixels.data() + ((size_t)(y + r) * width + x) * 4;
+        }
+
+        if (!decode_runs(payload, size, tileRows.data(), tileHeight, tileWidth))
+        {
+            return false;
+        }
+
+        payload += size;
+    }
+
+    return payload == end;
+}
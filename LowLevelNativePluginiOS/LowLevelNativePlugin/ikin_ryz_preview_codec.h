@@ -0,0 +1,122 @@
+//
+//  ikin_ryz_preview_codec.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_PREVIEW_CODEC_H
+#define IKIN_RYZ_PREVIEW_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ikin_ryz_tile_hash.h"
+
+/// @brief: The value of the first four bytes of each preview message, which read "RYZP".
+const uint32_t previewMagic = 0x505A5952;
+
+/// @brief: The version of the preview messages, which a client checks before decoding them.
+const uint16_t previewVersion = 1;
+
+/// @brief: The size of the header that starts each preview message, in bytes.
+const size_t previewHeaderSize = 24;
+
+/// @brief: The width and height, in pixels, of the tiles that are sent when they change.
+const int previewTileSize = tileHashTileSize;
+
+/// @brief: Set in @see preview_header::flags when every tile of the frame is sent, so the client can start from it.
+const uint16_t previewKeyframe = 1;
+
+/// @brief: The header that starts each preview message.
+/// @remarks: On the wire every field is little-endian, after the magic and version, and the changed tiles follow it.
+/// Each tile is its column and row as 16-bit values, the size of its encoded pixels as a 32-bit value, then the encoded pixels.
+/// The pixels are read a row at a time, clipped to the image, as 3-byte BGR. Each run starts with a control byte.
+/// A control byte below 128 is followed by that many plus one literal pixels, and any other by a single pixel repeated that many minus 126 times.
+struct preview_header
+{
+    /// @brief: The combination of flags such as @see previewKeyframe.
+    uint16_t flags;
+
+    /// @brief: The width of the image in pixels.
+    uint16_t width;
+
+    /// @brief: The height of the image in pixels.
+    uint16_t height;
+
+    /// @brief: The width and height of the tiles in pixels.
+    uint16_t tileSize;
+
+    /// @brief: The number of tiles in the message.
+    uint16_t tileCount;
+
+    /// @brief: The number of bytes that follow the header.
+    uint32_t payloadSize;
+
+    /// @brief: The number of the captured frame, which counts up from 1 and skips the frames that weren't sent.
+    uint32_t frameIndex;
+};
+
+/// @brief: Reads the header of a preview message.
+/// @param bytes The first @see previewHeaderSize bytes of the message.
+/// @param header The header that is read into.
+/// @returns: True if the bytes start a preview message of this version, otherwise false.
+bool read_preview_header(const uint8_t* bytes, preview_header& header);
+
+/// @brief: Encodes the tiles of an image that changed since the last image it encoded.
+/// @remarks: The changed tiles are found by comparing @see hash_tiles values, so the encoder doesn't hold a copy of the last image.
+/// A change that keeps a tile's hash the same is missed, which a preview can live with until the tile changes again.
+class preview_encoder
+{
+public:
+    /// @brief: Encodes an image into a message.
+    /// @param pixels The 8-bit BGRA pixels, top row first. The alpha is left out.
+    /// @param width The width of the image in pixels, up to 65535.
+    /// @param height The height of the image in pixels, up to 65535.
+    /// @param bytesPerRow The distance between the starts of two rows of pixels, in bytes.
+    /// @param frameIndex The number of the frame.
+    /// @param keyframe True to send every tile, such as for a client that just connected.
+    /// @param message The message, which is overwritten.
+    /// @returns: The number of tiles in the message. A message without tiles doesn't need to be sent.
+    /// @remarks: An image of another size than the last one is always a keyframe.
+    int encode(const uint8_t* pixels, int width, int height, size_t bytesPerRow, uint32_t frameIndex, bool keyframe, std::vector<uint8_t>& message);
+
+private:
+    /// @brief: The hashes of the tiles of the last image.
+    std::vector<uint32_t> previousHashes;
+
+    /// @brief: The hashes of the tiles of the image being encoded.
+    std::vector<uint32_t> hashes;
+
+    /// @brief: The size of the last image, in pixels.
+    int previousWidth = 0;
+    int previousHeight = 0;
+};
+
+/// @brief: Applies preview messages to an image.
+class preview_decoder
+{
+public:
+    /// @brief: Applies the tiles of a message.
+    /// @param header The header of the message.
+    /// @param payload The @see preview_header::payloadSize bytes that follow the header.
+    /// @returns: True if the message was applied, otherwise false if it is malformed or doesn't follow a keyframe.
+    bool decode(const preview_header& header, const uint8_t* payload);
+
+    /// @brief: Gets the 8-bit BGRA pixels of the image, top row first, with opaque alpha.
+    const std::vector<uint8_t>& get_pixels() const { return pixels; }
+
+    /// @brief: Gets the width of the image in pixels, which is 0 before the first keyframe.
+    int get_width() const { return width; }
+
+    /// @brief: Gets the height of the image in pixels, which is 0 before the first keyframe.
+    int get_height() const { return height; }
+
+private:
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+};
+
+#endif
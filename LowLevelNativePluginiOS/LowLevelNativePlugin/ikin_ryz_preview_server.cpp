@@ -0,0 +1,427 @@
+//
+//  ikin_ryz_preview_server.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_preview_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ikin_ryz_capture.h"
+#include "ikin_ryz_frame_stats.h"
+#include "ikin_ryz_preview_codec.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: How long the server thread waits before it checks whether it has been asked to stop, in milliseconds.
+    const int previewPollMilliseconds = 100;
+
+    /// @brief: How long a send can wait for a client that stopped reading before it is disconnected, in seconds.
+    const int previewSendTimeoutSeconds = 1;
+
+#if defined(MSG_NOSIGNAL)
+    /// @brief: Keeps a send to a client that disconnected from raising SIGPIPE. Darwin uses SO_NOSIGPIPE on the socket instead.
+    const int previewSendFlags = MSG_NOSIGNAL;
+#else
+    const int previewSendFlags = 0;
+#endif
+
+    /// @brief: A copy of a captured frame, tightly packed.
+    struct preview_frame
+    {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+        uint64_t frameIndex = 0;
+    };
+
+    /// @brief: Accepts a client and sends it the frames that are offered, on a thread of its own.
+    class preview_server
+    {
+    public:
+        /// @brief: Starts the server thread.
+        /// @param listenSocket The socket that is listening for clients, which the server closes.
+        preview_server(int listenSocket, int maxFramesPerSecond, int maxBytesPerSecond) :
+            listenSocket(listenSocket),
+            frameInterval(1.0 / maxFramesPerSecond),
+            maxBytesPerSecond(maxBytesPerSecond)
+        {
+            thread = std::thread(&preview_server::run, this);
+        }
+
+        /// @brief: Stops the server thread and closes the sockets.
+        ~preview_server()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                stopping = true;
+            }
+
+            offered.notify_one();
+            thread.join();
+
+            disconnect();
+            close(listenSocket);
+        }
+
+        /// @brief: Copies a frame for the server thread, if a client is connected and the frame rate cap allows it.
+        /// @param frame The frame, on the capture thread.
+        void offer(const captured_frame& frame)
+        {
+            // Frames arrive with some jitter, so a frame that is a little early still counts as on time.
+            // Otherwise a cap of half the display's rate would only let every third frame through.
+            if (!clientConnected.load(std::memory_order_relaxed) || frame.captureTime + frameInterval * 0.25 < nextOfferTime)
+            {
+                return;
+            }
+
+            nextOfferTime = std::max(nextOfferTime + frameInterval, frame.captureTime + frameInterval * 0.5);
+
+            std::lock_guard<std::mutex> guard(mutex);
+
+            // If the last frame hasn't been taken yet, then this one replaces it, since only the latest matters to a preview.
+            if (hasPending)
+            {
+                frameStatsCounters.previewFramesSkipped++;
+            }
+
+            const size_t rowSize = (size_t)frame.width * 4;
+
+            pending.pixels.resize(rowSize * frame.height);
+
+            for (int row = 0; row < frame.height; ++row)
+            {
+                memcpy(pending.pixels.data() + row * rowSize, frame.pixels + row * frame.bytesPerRow, rowSize);
+            }
+
+            pending.width = frame.width;
+            pending.height = frame.height;
+            pending.frameIndex = frame.frameIndex;
+            hasPending = true;
+
+            offered.notify_one();
+        }
+
+    private:
+        /// @brief: Accepts a client, then sends it frames until it disconnects, until the server is stopped.
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (!stopping)
+            {
+                // If there is no client, then wait for one.
+                if (clientSocket < 0)
+                {
+                    lock.unlock();
+                    accept_client();
+                    lock.lock();
+                    continue;
+                }
+
+                offered.wait_for(lock, std::chrono::milliseconds(previewPollMilliseconds), [this] { return stopping || hasPending; });
+
+                if (stopping)
+                {
+                    break;
+                }
+
+                // If the client has gone, then drop it, and any frame that was waiting for it.
+                if (!hasPending)
+                {
+                    lock.unlock();
+                    check_client();
+                    lock.lock();
+                    continue;
+                }
+
+                // If the last frames used up the bandwidth, then wait for it to build up, letting newer frames replace this one.
+                const double waitSeconds = bandwidth_wait();
+
+                if (waitSeconds > 0.0)
+                {
+                    offered.wait_for(lock, std::chrono::duration<double>(std::min(waitSeconds, previewPollMilliseconds / 1000.0)), [this] { return stopping; });
+                    continue;
+                }
+
+                std::swap(pending, sending);
+                hasPending = false;
+
+                lock.unlock();
+                send_frame();
+                lock.lock();
+            }
+        }
+
+        /// @brief: Waits a while for a client, and connects it.
+        void accept_client()
+        {
+            pollfd listenPoll = { listenSocket, POLLIN, 0 };
+
+            if (poll(&listenPoll, 1, previewPollMilliseconds) <= 0)
+            {
+                return;
+            }
+
+            const int acceptedSocket = accept(listenSocket, nullptr, nullptr);
+
+            if (acceptedSocket < 0)
+            {
+                return;
+            }
+
+            // Send each frame as soon as it is written, and give up on a client that stops reading rather than waiting on it.
+            const int noDelay = 1;
+            const timeval sendTimeout = { previewSendTimeoutSeconds, 0 };
+
+            setsockopt(acceptedSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            setsockopt(acceptedSocket, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+
+#if defined(SO_NOSIGPIPE)
+            const int noSigPipe = 1;
+            setsockopt(acceptedSocket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+            clientSocket = acceptedSocket;
+            keyframe = true;
+            bandwidthBudget = 0.0;
+            lastBudgetTime = std::chrono::steady_clock::now();
+            clientConnected = true;
+        }
+
+        /// @brief: Disconnects the client if it has closed its end. The client never sends anything, so anything readable is its end closing.
+        void check_client()
+        {
+            pollfd clientPoll = { clientSocket, POLLIN, 0 };
+
+            if (poll(&clientPoll, 1, 0) <= 0)
+            {
+                return;
+            }
+
+            uint8_t discarded[64];
+
+            if (recv(clientSocket, discarded, sizeof(discarded), 0) <= 0)
+            {
+                disconnect();
+            }
+        }
+
+        /// @brief: Disconnects the client.
+        void disconnect()
+        {
+            clientConnected = false;
+
+            if (clientSocket >= 0)
+            {
+                close(clientSocket);
+                clientSocket = -1;
+            }
+        }
+
+        /// @brief: Tops up the bandwidth budget for the time that has passed.
+        /// @returns: How long to wait until the budget is no longer overdrawn, in seconds, or 0 if a frame can be sent.
+        /// @remarks: The budget builds up to a second's worth of bandwidth, so a keyframe can go out at once after a quiet spell.
+        double bandwidth_wait()
+        {
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - lastBudgetTime).count();
+
+            lastBudgetTime = now;
+            bandwidthBudget = std::min((double)maxBytesPerSecond, bandwidthBudget + elapsed * maxBytesPerSecond);
+
+            return bandwidthBudget < 0.0 ? -bandwidthBudget / maxBytesPerSecond : 0.0;
+        }
+
+        /// @brief: Encodes the frame that was taken, and sends it if any tile changed.
+        void send_frame()
+        {
+            const int tileCount = encoder.encode(sending.pixels.data(), sending.width, sending.height, (size_t)sending.width * 4, (uint32_t)sending.frameIndex, keyframe, message);
+
+            if (tileCount == 0)
+            {
+                return;
+            }
+
+            size_t sent = 0;
+
+            while (sent < message.size())
+            {
+                const ssize_t result = send(clientSocket, message.data() + sent, message.size() - sent, previewSendFlags);
+
+                // If the client has gone or stopped reading, then drop it, since the rest of the message can't be sent.
+                if (result <= 0)
+                {
+                    disconnect();
+                    return;
+                }
+
+                sent += result;
+            }
+
+            keyframe = false;
+            bandwidthBudget -= (double)message.size();
+
+            frameStatsCounters.previewFramesSent++;
+            frameStatsCounters.previewBytesSent += message.size();
+        }
+
+        const int listenSocket;
+        const double frameInterval;
+        const int maxBytesPerSecond;
+        std::thread thread;
+
+        /// @brief: Set while a client is connected, so that frames aren't copied when nobody is watching.
+        std::atomic<bool> clientConnected{ false };
+
+        /// @brief: The capture time the next frame is due at. Only touched by the capture thread.
+        double nextOfferTime = 0.0;
+
+        /// @brief: Guards @see pending, @see hasPending and @see stopping.
+        std::mutex mutex;
+        std::condition_variable offered;
+        preview_frame pending;
+        bool hasPending = false;
+        bool stopping = false;
+
+        /// @brief: Only touched by the server thread.
+        int clientSocket = -1;
+        preview_frame sending;
+        preview_encoder encoder;
+        std::vector<uint8_t> message;
+        bool keyframe = true;
+        double bandwidthBudget = 0.0;
+        std::chrono::steady_clock::time_point lastBudgetTime;
+    };
+
+    /// @brief: Guards @see activeServer and @see serverSinkId.
+    std::mutex previewMutex;
+
+    /// @brief: The server that is running, or null.
+    std::shared_ptr<preview_server> activeServer;
+
+    /// @brief: The ID of the capture sink that feeds @see activeServer.
+    int serverSinkId = -1;
+}
+
+/// @brief: Starts a server that streams the Ryz eye to a client, such as Tools/ryz_preview_client.
+/// @param port The TCP port the server listens on.
+/// @param maxFramesPerSecond The most frames that are sent each second.
+/// @param maxBytesPerSecond The most bytes that are sent each second, on average.
+/// @param allowRemote True to accept clients on any network, otherwise only clients on the device itself, such as through a USB port forward.
+/// @returns: True if the server is listening, otherwise false.
+bool start_preview_server(int port, int maxFramesPerSecond, int maxBytesPerSecond, bool allowRemote)
+{
+    if (port <= 0 || port > 65535 || maxFramesPerSecond <= 0 || maxBytesPerSecond <= 0)
+    {
+        return false;
+    }
+
+    stop_preview_server();
+
+    const int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (listenSocket < 0)
+    {
+        return false;
+    }
+
+    // Let the port be bound again straight after a server is stopped.
+    const int reuseAddress = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(allowRemote ? INADDR_ANY : INADDR_LOOPBACK);
+
+    if (bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 1) != 0)
+    {
+        close(listenSocket);
+        return false;
+    }
+
+    std::shared_ptr<preview_server> newServer = std::make_shared<preview_server>(listenSocket, maxFramesPerSecond, maxBytesPerSecond);
+
+    std::lock_guard<std::mutex> guard(previewMutex);
+
+    activeServer = newServer;
+    serverSinkId = add_capture_sink(1 << ryz_eye, [newServer](const captured_frame& frame)
+    {
+        newServer->offer(frame);
+    });
+
+    return true;
+}
+
+/// @brief: Stops the preview server and disconnects its client.
+void stop_preview_server()
+{
+    std::shared_ptr<preview_server> stoppedServer;
+    int sinkId;
+
+    {
+        std::lock_guard<std::mutex> guard(previewMutex);
+
+        stoppedServer = std::move(activeServer);
+        sinkId = serverSinkId;
+        serverSinkId = -1;
+    }
+
+    if (stoppedServer == nullptr)
+    {
+        return;
+    }
+
+    // Removing the sink waits for a frame that is being offered, so the server is only stopped once no more frames can reach it.
+    remove_capture_sink(sinkId);
+
+    stoppedServer.reset();
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts a server that streams the Ryz eye to a preview client over TCP.
+    /// @param port The TCP port the server listens on, or 0 for @see defaultPreviewPort.
+    /// @param maxFramesPerSecond The most frames that are sent each second, or 0 for @see defaultPreviewFramesPerSecond.
+    /// @param maxBytesPerSecond The most bytes that are sent each second, or 0 for @see defaultPreviewBytesPerSecond.
+    /// @param allowRemote 1 to accept clients on any network, 0 to only accept clients on the device itself.
+    /// @returns: 1 if the server is listening, 0 if the port couldn't be bound.
+    EXPORT_API int ikinRyzStartPreviewServer(int port, int maxFramesPerSecond, int maxBytesPerSecond, int allowRemote)
+    {
+        return start_preview_server(port > 0 ? port : defaultPreviewPort,
+                                    maxFramesPerSecond > 0 ? maxFramesPerSecond : defaultPreviewFramesPerSecond,
+                                    maxBytesPerSecond > 0 ? maxBytesPerSecond : defaultPreviewBytesPerSecond,
+                                    allowRemote != 0) ? 1 : 0;
+    }
+
+    /// @brief Stops the preview server and disconnects its client.
+    EXPORT_API void ikinRyzStopPreviewServer()
+    {
+        stop_preview_server();
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,59 @@
+//
+//  ikin_ryz_preview_server.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_PREVIEW_SERVER_H
+#define IKIN_RYZ_PREVIEW_SERVER_H
+
+#include "ikin_ryz_settings.h"
+
+/// @brief: The port the preview server listens on when none is given.
+const int defaultPreviewPort = 7878;
+
+/// @brief: The frame rate the preview is capped to when none is given.
+const int defaultPreviewFramesPerSecond = 15;
+
+/// @brief: The bandwidth the preview is capped to when none is given, in bytes per second.
+const int defaultPreviewBytesPerSecond = 4 * 1024 * 1024;
+
+/// @brief: Starts a server that streams the Ryz eye to a client, such as Tools/ryz_preview_client.
+/// @param port The TCP port the server listens on.
+/// @param maxFramesPerSecond The most frames that are sent each second.
+/// @param maxBytesPerSecond The most bytes that are sent each second, on average.
+/// @param allowRemote True to accept clients on any network, otherwise only clients on the device itself, such as through a USB port forward.
+/// @returns: True if the server is listening, otherwise false.
+/// @remarks: The frames come from a capture sink, so the render thread never waits for them, and are only captured while a client is connected.
+/// Each frame is encoded with @see preview_encoder and sent on a thread of its own. Frames that arrive while it is busy or over the caps replace each other,
+/// so a slow client or network makes the preview skip frames rather than holding up the device.
+/// A server that is already running is stopped first.
+bool start_preview_server(int port, int maxFramesPerSecond, int maxBytesPerSecond, bool allowRemote);
+
+/// @brief: Stops the preview server and disconnects its client.
+void stop_preview_server();
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts a server that streams the Ryz eye to a preview client over TCP.
+    /// @param port The TCP port the server listens on, or 0 for @see defaultPreviewPort.
+    /// @param maxFramesPerSecond The most frames that are sent each second, or 0 for @see defaultPreviewFramesPerSecond.
+    /// @param maxBytesPerSecond The most bytes that are sent each second, or 0 for @see defaultPreviewBytesPerSecond.
+    /// @param allowRemote 1 to accept clients on any network, 0 to only accept clients on the device itself.
+    /// @returns: 1 if the server is listening, 0 if the port couldn't be bound.
+    EXPORT_API int ikinRyzStartPreviewServer(int port, int maxFramesPerSecond, int maxBytesPerSecond, int allowRemote);
+
+    /// @brief Stops the preview server and disconnects its client.
+    EXPORT_API void ikinRyzStopPreviewServer();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
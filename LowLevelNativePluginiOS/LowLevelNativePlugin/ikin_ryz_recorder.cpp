@@ -0,0 +1,638 @@
+//
+//  ikin_ryz_recorder.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_recorder.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "ikin_ryz_capture.h"
+#include "ikin_ryz_frame_stats.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The most threads that convert a frame, counting the capture thread.
+    const int maxConversionThreads = 4;
+
+    /// @brief: The number of bands each conversion thread is given, so that a thread that starts late doesn't hold up the frame.
+    const int bandsPerConversionThread = 4;
+
+    /// @brief: The frame rate that is written into the header when none is given.
+    const int defaultRecordingFrameRate = 60;
+
+    /// @brief: Converts a pixel to luma. The rounding matches the vector paths.
+    inline uint8_t luma(int r, int g, int b)
+    {
+        return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+
+    /// @brief: Converts the sums of the channels of 2x2 pixels to chroma. The rounding matches the vector paths.
+    inline void chroma(int rSum, int gSum, int bSum, uint8_t& u, uint8_t& v)
+    {
+        const int r = (rSum + 2) >> 2;
+        const int g = (gSum + 2) >> 2;
+        const int b = (bSum + 2) >> 2;
+
+        u = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    /// @brief: Converts two rows of pixels a pair of columns at a time.
+    /// @param top The first pixel of the top row.
+    /// @param bottom The first pixel of the bottom row.
+    /// @param count The number of columns, which must be even.
+    void convert_row_pair_scalar(const uint8_t* top, const uint8_t* bottom, int count, uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v)
+    {
+        for (int x = 0; x < count; x += 2)
+        {
+            const uint8_t* pixels[4] = { top + x * 4, top + x * 4 + 4, bottom + x * 4, bottom + x * 4 + 4 };
+
+            yTop[x] = luma(pixels[0][2], pixels[0][1], pixels[0][0]);
+            yTop[x + 1] = luma(pixels[1][2], pixels[1][1], pixels[1][0]);
+            yBottom[x] = luma(pixels[2][2], pixels[2][1], pixels[2][0]);
+            yBottom[x + 1] = luma(pixels[3][2], pixels[3][1], pixels[3][0]);
+
+            int sums[3] = { 0, 0, 0 };
+
+            for (const uint8_t* pixel : pixels)
+            {
+                sums[0] += pixel[0];
+                sums[1] += pixel[1];
+                sums[2] += pixel[2];
+            }
+
+            chroma(sums[2], sums[1], sums[0], u[x / 2], v[x / 2]);
+        }
+    }
+
+#if defined(__SSE2__)
+    /// @brief: Spreads the blue, green and red channels of 8 pixels over the 16-bit lanes of three vectors.
+    inline void load_channels(const uint8_t* pixels, __m128i& b, __m128i& g, __m128i& r)
+    {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        const __m128i first = _mm_loadu_si128((const __m128i*)pixels);
+        const __m128i second = _mm_loadu_si128((const __m128i*)(pixels + 16));
+
+        b = _mm_packs_epi32(_mm_and_si128(first, mask), _mm_and_si128(second, mask));
+        g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(first, 8), mask), _mm_and_si128(_mm_srli_epi32(second, 8), mask));
+        r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(first, 16), mask), _mm_and_si128(_mm_srli_epi32(second, 16), mask));
+    }
+
+    /// @brief: Converts the channels of 8 pixels to luma, in 16-bit lanes.
+    /// @remarks: The weighted sum can pass 32767, but never 65535, so it is added as unsigned and shifted logically.
+    inline __m128i luma(__m128i b, __m128i g, __m128i r)
+    {
+        __m128i sum = _mm_mullo_epi16(r, _mm_set1_epi16(66));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+        sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+
+        return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+    }
+
+    /// @brief: Adds each pair of neighbouring 16-bit lanes of two vectors of 8, into a vector of 8.
+    inline __m128i add_pairs(__m128i first, __m128i second)
+    {
+        const __m128i ones = _mm_set1_epi16(1);
+
+        return _mm_packs_epi32(_mm_madd_epi16(first, ones), _mm_madd_epi16(second, ones));
+    }
+
+    /// @brief: Converts 8 averaged pixels to a chroma channel, in 16-bit lanes.
+    inline __m128i chroma(__m128i b, __m128i g, __m128i r, short rWeight, short gWeight, short bWeight)
+    {
+        __m128i sum = _mm_mullo_epi16(r, _mm_set1_epi16(rWeight));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(g, _mm_set1_epi16(gWeight)));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(bWeight)));
+        sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+
+        return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+    }
+
+    /// @brief: Converts two rows of pixels 16 columns at a time.
+    /// @returns: The number of columns that were converted, which leaves fewer than 16.
+    int convert_row_pair_vector(const uint8_t* top, const uint8_t* bottom, int count, uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v)
+    {
+        const __m128i two = _mm_set1_epi16(2);
+        int x = 0;
+
+        for (; x + 16 <= count; x += 16)
+        {
+            __m128i b[4], g[4], r[4];
+
+            load_channels(top + x * 4, b[0], g[0], r[0]);
+            load_channels(top + x * 4 + 32, b[1], g[1], r[1]);
+            load_channels(bottom + x * 4, b[2], g[2], r[2]);
+            load_channels(bottom + x * 4 + 32, b[3], g[3], r[3]);
+
+            _mm_storeu_si128((__m128i*)(yTop + x), _mm_packus_epi16(luma(b[0], g[0], r[0]), luma(b[1], g[1], r[1])));
+            _mm_storeu_si128((__m128i*)(yBottom + x), _mm_packus_epi16(luma(b[2], g[2], r[2]), luma(b[3], g[3], r[3])));
+
+            // Average each 2x2 block, rounding to nearest.
+            const __m128i bAverage = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(add_pairs(b[0], b[1]), add_pairs(b[2], b[3])), two), 2);
+            const __m128i gAverage = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(add_pairs(g[0], g[1]), add_pairs(g[2], g[3])), two), 2);
+            const __m128i rAverage = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(add_pairs(r[0], r[1]), add_pairs(r[2], r[3])), two), 2);
+
+            const __m128i uValues = chroma(bAverage, gAverage, rAverage, -38, -74, 112);
+            const __m128i vValues = chroma(bAverage, gAverage, rAverage, 112, -94, -18);
+
+            _mm_storel_epi64((__m128i*)(u + x / 2), _mm_packus_epi16(uValues, uValues));
+            _mm_storel_epi64((__m128i*)(v + x / 2), _mm_packus_epi16(vValues, vValues));
+        }
+
+        return x;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    /// @brief: Converts the channels of 8 pixels to luma.
+    inline uint8x8_t luma(uint8x8_t b, uint8x8_t g, uint8x8_t r)
+    {
+        uint16x8_t sum = vmull_u8(r, vdup_n_u8(66));
+        sum = vmlal_u8(sum, g, vdup_n_u8(129));
+        sum = vmlal_u8(sum, b, vdup_n_u8(25));
+
+        return vadd_u8(vrshrn_n_u16(sum, 8), vdup_n_u8(16));
+    }
+
+    /// @brief: Converts 8 averaged pixels to a chroma channel.
+    inline uint8x8_t chroma(int16x8_t b, int16x8_t g, int16x8_t r, int16_t rWeight, int16_t gWeight, int16_t bWeight)
+    {
+        int16x8_t sum = vmulq_n_s16(r, rWeight);
+        sum = vmlaq_n_s16(sum, g, gWeight);
+        sum = vmlaq_n_s16(sum, b, bWeight);
+
+        return vqmovun_s16(vaddq_s16(vrshrq_n_s16(sum, 8), vdupq_n_s16(128)));
+    }
+
+    /// @brief: Averages the 2x2 blocks of a channel of two rows of 16 pixels, rounding to nearest.
+    inline int16x8_t average_blocks(uint8x16_t top, uint8x16_t bottom)
+    {
+        return vreinterpretq_s16_u16(vrshrq_n_u16(vaddq_u16(vpaddlq_u8(top), vpaddlq_u8(bottom)), 2));
+    }
+
+    /// @brief: Converts two rows of pixels 16 columns at a time.
+    /// @returns: The number of columns that were converted, which leaves fewer than 16.
+    int convert_row_pair_vector(const uint8_t* top, const uint8_t* bottom, int count, uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v)
+    {
+        int x = 0;
+
+        for (; x + 16 <= count; x += 16)
+        {
+            // Deinterleave the channels as they are loaded.
+            const uint8x16x4_t topPixels = vld4q_u8(top + x * 4);
+            const uint8x16x4_t bottomPixels = vld4q_u8(bottom + x * 4);
+
+            vst1q_u8(yTop + x, vcombine_u8(
+                luma(vget_low_u8(topPixels.val[0]), vget_low_u8(topPixels.val[1]), vget_low_u8(topPixels.val[2])),
+                luma(vget_high_u8(topPixels.val[0]), vget_high_u8(topPixels.val[1]), vget_high_u8(topPixels.val[2]))));
+            vst1q_u8(yBottom + x, vcombine_u8(
+                luma(vget_low_u8(bottomPixels.val[0]), vget_low_u8(bottomPixels.val[1]), vget_low_u8(bottomPixels.val[2])),
+                luma(vget_high_u8(bottomPixels.val[0]), vget_high_u8(bottomPixels.val[1]), vget_high_u8(bottomPixels.val[2]))));
+
+            const int16x8_t bAverage = average_blocks(topPixels.val[0], bottomPixels.val[0]);
+            const int16x8_t gAverage = average_blocks(topPixels.val[1], bottomPixels.val[1]);
+            const int16x8_t rAverage = average_blocks(topPixels.val[2], bottomPixels.val[2]);
+
+            vst1_u8(u + x / 2, chroma(bAverage, gAverage, rAverage, -38, -74, 112));
+            vst1_u8(v + x / 2, chroma(bAverage, gAverage, rAverage, 112, -94, -18));
+        }
+
+        return x;
+    }
+#else
+    /// @brief: Converts two rows of pixels 16 columns at a time, which without vector instructions is none.
+    /// @returns: The number of columns that were converted.
+    int convert_row_pair_vector(const uint8_t*, const uint8_t*, int, uint8_t*, uint8_t*, uint8_t*, uint8_t*)
+    {
+        return 0;
+    }
+#endif
+
+    /// @brief: Runs the tasks of a parallel loop on a fixed set of threads, and on the thread that starts the loop.
+    class worker_pool
+    {
+    public:
+        /// @brief: Starts the threads.
+        /// @param threadCount The number of threads, not counting the one that starts the loops.
+        explicit worker_pool(int threadCount)
+        {
+            for (int i = 0; i < threadCount; ++i)
+            {
+                threads.emplace_back(&worker_pool::run_worker, this);
+            }
+        }
+
+        /// @brief: Stops the threads.
+        ~worker_pool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                stopping = true;
+            }
+
+            wake.notify_all();
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        /// @brief: Runs a task for each index, and returns once they have all finished.
+        /// @param count The number of tasks.
+        /// @param task The task, which is handed its index.
+        void run(int count, const std::function<void(int)>& task)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            currentTask = &task;
+            taskCount = count;
+            nextTask = 0;
+            pendingTasks = count;
+
+            wake.notify_all();
+
+            // Take tasks too, rather than waiting idle.
+            while (nextTask < taskCount)
+            {
+                run_next_task(lock);
+            }
+
+            finished.wait(lock, [this] { return pendingTasks == 0; });
+
+            currentTask = nullptr;
+            taskCount = 0;
+        }
+
+    private:
+        /// @brief: Takes tasks until the pool is stopped.
+        void run_worker()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (true)
+            {
+                wake.wait(lock, [this] { return stopping || nextTask < taskCount; });
+
+                if (stopping)
+                {
+                    return;
+                }
+
+                run_next_task(lock);
+            }
+        }
+
+        /// @brief: Takes the next task, and runs it with the lock released.
+        void run_next_task(std::unique_lock<std::mutex>& lock)
+        {
+            const int index = nextTask++;
+            const std::function<void(int)>* task = currentTask;
+
+            lock.unlock();
+            (*task)(index);
+            lock.lock();
+
+            if (--pendingTasks == 0)
+            {
+                finished.notify_all();
+            }
+        }
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        const std::function<void(int)>* currentTask = nullptr;
+        int taskCount = 0;
+        int nextTask = 0;
+        int pendingTasks = 0;
+        bool stopping = false;
+    };
+
+    /// @brief: Records the frames of a capture sink to a file.
+    /// @remarks: The capture thread converts each frame into a free buffer with the help of the pool, and queues it for the writer thread.
+    /// The buffers are only allocated once, so when the writer falls behind there is no free buffer, and the frame is dropped.
+    class recorder
+    {
+    public:
+        /// @brief: Opens the file, and starts the writer thread and the conversion pool.
+        recorder(FILE* file, int frameRate, int format) :
+            file(file),
+            frameRate(frameRate),
+            format(format),
+            pool(std::max(1, std::min(maxConversionThreads, (int)std::thread::hardware_concurrency())) - 1)
+        {
+            writer = std::thread(&recorder::run_writer, this);
+        }
+
+        /// @brief: Writes the frames that are waiting, and closes the file.
+        /// @remarks: The sink has to be removed first, so that no more frames arrive.
+        ~recorder()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                stopping = true;
+            }
+
+            queued.notify_one();
+            writer.join();
+
+            fclose(file);
+        }
+
+        /// @brief: Converts a frame and queues it for the writer thread, or drops it if every buffer is waiting for the disk.
+        /// @param frame The frame, on the capture thread.
+        void record(const captured_frame& frame)
+        {
+            const int frameWidth = frame.width & ~1;
+            const int frameHeight = frame.height & ~1;
+
+            if (frameWidth == 0 || frameHeight == 0)
+            {
+                return;
+            }
+
+            std::unique_ptr<std::vector<uint8_t>> buffer;
+
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+
+                // The first frame sets the size of the recording, since a stream can't change size.
+                if (width == 0)
+                {
+                    width = frameWidth;
+                    height = frameHeight;
+
+                    for (int i = 0; i < maxQueuedRecordingFrames; ++i)
+                    {
+                        freeBuffers.emplace_back(new std::vector<uint8_t>((size_t)width * height * 3 / 2));
+                    }
+                }
+
+                // If the frame is another size, or the disk has fallen behind, then drop it rather than waiting.
+                if (frameWidth != width || frameHeight != height || freeBuffers.empty() || failed)
+                {
+                    frameStatsCounters.recordingFramesDropped++;
+                    return;
+                }
+
+                buffer = std::move(freeBuffers.back());
+                freeBuffers.pop_back();
+            }
+
+            // Convert bands of rows in parallel. The bands start on even rows so that they don't share chroma rows.
+            uint8_t* yPlane = buffer->data();
+            uint8_t* uPlane = yPlane + (size_t)width * height;
+            uint8_t* vPlane = uPlane + (size_t)width * height / 4;
+
+            const int bandCount = std::max(1, std::min(frameHeight / 2, maxConversionThreads * bandsPerConversionThread));
+            const int bandRows = ((frameHeight / 2 + bandCount - 1) / bandCount) * 2;
+
+            pool.run(bandCount, [&](int band)
+            {
+                const int firstRow = band * bandRows;
+                const int rowCount = std::min(bandRows, frameHeight - firstRow);
+
+                if (rowCount > 0)
+                {
+                    convert_bgra_to_i420(frame.pixels, frame.bytesPerRow, frameWidth, firstRow, rowCount, yPlane, uPlane, vPlane);
+                }
+            });
+
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                frames.push_back(std::move(buffer));
+            }
+
+            queued.notify_one();
+        }
+
+    private:
+        /// @brief: Writes the queued frames until the recorder is stopped and the queue is empty.
+        void run_writer()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (true)
+            {
+                queued.wait(lock, [this] { return stopping || !frames.empty(); });
+
+                if (frames.empty())
+                {
+                    return;
+                }
+
+                std::unique_ptr<std::vector<uint8_t>> buffer = std::move(frames.front());
+                frames.pop_front();
+
+                const int frameWidth = width;
+                const int frameHeight = height;
+
+                lock.unlock();
+
+                const bool written = write_frame(*buffer, frameWidth, frameHeight);
+
+                lock.lock();
+
+                freeBuffers.push_back(std::move(buffer));
+
+                // If the disk is full or gone, then drop the rest of the frames rather than failing on each of them.
+                if (written)
+                {
+                    frameStatsCounters.recordingFramesWritten++;
+                }
+                else
+                {
+                    failed = true;
+                    frameStatsCounters.recordingFramesDropped++;
+                }
+            }
+        }
+
+        /// @brief: Writes a frame, and the stream header before the first one.
+        /// @returns: True if the frame was written, otherwise false.
+        bool write_frame(const std::vector<uint8_t>& buffer, int frameWidth, int frameHeight)
+        {
+            if (format == recording_format_y4m)
+            {
+                if (!headerWritten)
+                {
+                    if (fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", frameWidth, frameHeight, frameRate) < 0)
+                    {
+                        return false;
+                    }
+
+                    headerWritten = true;
+                }
+
+                if (fputs("FRAME\n", file) < 0)
+                {
+                    return false;
+                }
+            }
+
+            return fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        }
+
+        FILE* file;
+        const int frameRate;
+        const int format;
+        worker_pool pool;
+        std::thread writer;
+
+        /// @brief: Guards the members below.
+        std::mutex mutex;
+        std::condition_variable queued;
+        std::vector<std::unique_ptr<std::vector<uint8_t>>> freeBuffers;
+        std::deque<std::unique_ptr<std::vector<uint8_t>>> frames;
+        int width = 0;
+        int height = 0;
+        bool stopping = false;
+        bool failed = false;
+
+        /// @brief: Only touched by the writer thread.
+        bool headerWritten = false;
+    };
+
+    /// @brief: Guards @see activeRecorder and @see recorderSinkId.
+    std::mutex recordingMutex;
+
+    /// @brief: The recording that is running, or null.
+    std::shared_ptr<recorder> activeRecorder;
+
+    /// @brief: The ID of the capture sink that feeds @see activeRecorder.
+    int recorderSinkId = -1;
+}
+
+/// @brief: Converts rows of 8-bit BGRA pixels to the planes of an I420 image, with the BT.601 limited range matrix.
+/// @param pixels The BGRA pixels of the whole image, top row first.
+/// @param bytesPerRow The distance between the starts of two rows of pixels, in bytes.
+/// @param width The width of the image in pixels, which must be even.
+/// @param firstRow The first row that is converted, which must be even.
+/// @param rowCount The number of rows that are converted, which must be even.
+/// @param yPlane The luma plane of the whole image, width bytes a row.
+/// @param uPlane The blue-difference plane of the whole image, half the width and height of the luma plane.
+/// @param vPlane The red-difference plane of the whole image, half the width and height of the luma plane.
+void convert_bgra_to_i420(const uint8_t* pixels, size_t bytesPerRow, int width, int firstRow, int rowCount, uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane)
+{
+    const int chromaWidth = width / 2;
+
+    for (int row = firstRow; row < firstRow + rowCount; row += 2)
+    {
+        const uint8_t* top = pixels + row * bytesPerRow;
+        const uint8_t* bottom = top + bytesPerRow;
+        uint8_t* yTop = yPlane + (size_t)row * width;
+        uint8_t* yBottom = yTop + width;
+        uint8_t* u = uPlane + (size_t)(row / 2) * chromaWidth;
+        uint8_t* v = vPlane + (size_t)(row / 2) * chromaWidth;
+
+        const int converted = convert_row_pair_vector(top, bottom, width, yTop, yBottom, u, v);
+
+        convert_row_pair_scalar(top + converted * 4, bottom + converted * 4, width - converted, yTop + converted, yBottom + converted, u + converted / 2, v + converted / 2);
+    }
+}
+
+/// @brief: Starts recording the frames of an eye to a file.
+/// @param eye The eye that is recorded. @see eye_index.
+/// @param path The path of the file.
+/// @param frameRate The frame rate written into the file's header, in frames per second.
+/// @param format The format of the file. @see recording_format.
+/// @returns: True if the file was opened, otherwise false.
+bool start_recording(int eye, const char* path, int frameRate, int format)
+{
+    if (eye < main_eye || eye >= eye_count || path == nullptr || path[0] == '\0' ||
+        (format != recording_format_y4m && format != recording_format_raw))
+    {
+        return false;
+    }
+
+    stop_recording();
+
+    FILE* file = fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    std::shared_ptr<recorder> newRecorder = std::make_shared<recorder>(file, frameRate > 0 ? frameRate : defaultRecordingFrameRate, format);
+
+    std::lock_guard<std::mutex> guard(recordingMutex);
+
+    activeRecorder = newRecorder;
+    recorderSinkId = add_capture_sink(1 << eye, [newRecorder](const captured_frame& frame)
+    {
+        newRecorder->record(frame);
+    });
+
+    return true;
+}
+
+/// @brief: Stops recording, once the frames that are waiting have been written, and closes the file.
+void stop_recording()
+{
+    std::shared_ptr<recorder> stoppedRecorder;
+    int sinkId;
+
+    {
+        std::lock_guard<std::mutex> guard(recordingMutex);
+
+        stoppedRecorder = std::move(activeRecorder);
+        sinkId = recorderSinkId;
+        recorderSinkId = -1;
+    }
+
+    if (stoppedRecorder == nullptr)
+    {
+        return;
+    }
+
+    // Removing the sink waits for a frame that is being converted, so the recorder is only closed once no more frames can reach it.
+    remove_capture_sink(sinkId);
+
+    stoppedRecorder.reset();
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts recording the frames of an eye to a YUV4MPEG2 or raw I420 file.
+    /// @param eye The eye that is recorded. @see eye_index.
+    /// @param path The path of the file.
+    /// @param frameRate The frame rate written into the file's header, in frames per second.
+    /// @param format The format of the file. @see recording_format.
+    /// @returns: 1 if the recording started, 0 if the eye or format doesn't exist or the file couldn't be opened.
+    EXPORT_API int ikinRyzStartRecording(int eye, const char* path, int frameRate, int format)
+    {
+        return start_recording(eye, path, frameRate, format) ? 1 : 0;
+    }
+
+    /// @brief Stops recording, once the frames that are waiting have been written, and closes the file.
+    EXPORT_API void ikinRyzStopRecording()
+    {
+        stop_recording();
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+//
+//  ikin_ryz_recorder.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_RECORDER_H
+#define IKIN_RYZ_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ikin_ryz_settings.h"
+
+/// @brief: The file formats a recording can be written in.
+enum recording_format
+{
+    /// @brief: A YUV4MPEG2 stream, which players and encoders read without being told the size or frame rate.
+    recording_format_y4m = 0,
+
+    /// @brief: The I420 planes of each frame back to back, without any headers.
+    recording_format_raw = 1
+};
+
+/// @brief: The number of converted frames that can wait for the disk before new frames are dropped.
+/// @remarks: This bounds the memory a recording uses to this many I420 frames, however far the disk falls behind.
+const int maxQueuedRecordingFrames = 4;
+
+/// @brief: Converts rows of 8-bit BGRA pixels to the planes of an I420 image, with the BT.601 limited range matrix.
+/// @param pixels The BGRA pixels of the whole image, top row first.
+/// @param bytesPerRow The distance between the starts of two rows of pixels, in bytes.
+/// @param width The width of the image in pixels, which must be even.
+/// @param firstRow The first row that is converted, which must be even.
+/// @param rowCount The number of rows that are converted, which must be even.
+/// @param yPlane The luma plane of the whole image, width bytes a row.
+/// @param uPlane The blue-difference plane of the whole image, half the width and height of the luma plane.
+/// @param vPlane The red-difference plane of the whole image, half the width and height of the luma plane.
+/// @remarks: Each chroma sample is converted from the average of the 2x2 pixels it covers, which places it at their center.
+/// Sixteen pixels are converted at a time with SSE2 or NEON when the compiler targets them, and the rest one pair at a time.
+/// Every path rounds the same way, so they produce the same bytes.
+void convert_bgra_to_i420(const uint8_t* pixels, size_t bytesPerRow, int width, int firstRow, int rowCount, uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane);
+
+/// @brief: Starts recording the frames of an eye to a file.
+/// @param eye The eye that is recorded. @see eye_index.
+/// @param path The path of the file.
+/// @param frameRate The frame rate written into the file's header, in frames per second.
+/// @param format The format of the file. @see recording_format.
+/// @returns: True if the file was opened, otherwise false.
+/// @remarks: The frames come from a capture sink, so they are copied off the GPU without the render thread waiting for them.
+/// They are converted on a pool of threads, and written on a thread of their own.
+/// When the disk falls behind and @see maxQueuedRecordingFrames are waiting for it, new frames are dropped rather than waited on.
+/// A recording that is already running is stopped first.
+bool start_recording(int eye, const char* path, int frameRate, int format);
+
+/// @brief: Stops recording, once the frames that are waiting have been written, and closes the file.
+void stop_recording();
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts recording the frames of an eye to a YUV4MPEG2 or raw I420 file.
+    /// @param eye The eye that is recorded. @see eye_index.
+    /// @param path The path of the file.
+    /// @param frameRate The frame rate written into the file's header, in frames per second.
+    /// @param format The format of the file. @see recording_format.
+    /// @returns: 1 if the recording started, 0 if the eye or format doesn't exist or the file couldn't be opened.
+    /// @remarks: The frames are recorded the way they are captured, so the Ryz eye is recorded as it is presented.
+    /// Odd widths and heights lose their last column or row, since every chroma sample covers 2x2 pixels.
+    /// The first frame sets the size of the recording, and frames of other sizes are dropped.
+    EXPORT_API int ikinRyzStartRecording(int eye, const char* path, int frameRate, int format);
+
+    /// @brief Stops recording, once the frames that are waiting have been written, and closes the file.
+    EXPORT_API void ikinRyzStopRecording();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,292 @@
+//
+//  ikin_ryz_settings.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_settings.h"
+
+#include <cmath>
+
+#include "ikin_ryz_occlusion_mesh.h"
+#include "ikin_ryz_upscale.h"
+
+/// @brief: The formats that each eye texture is created with, indexed by @see eye_index.
+eye_format_settings eyeFormatSettings[eye_count] =
+{
+    { color_format_default, depth_format_24bit },
+    { color_format_default, depth_format_24bit }
+};
+
+/// @brief: A value indicating whether the eye formats have changed since the eye textures were last created.
+std::atomic<bool> eyeFormatSettingsChanged(false);
+
+/// @brief: The orientation that each eye texture is presented with, indexed by @see eye_index.
+/// @remarks: The Ryz image is flipped top to bottom by default, which is what the Ryz cameras used to do to their projection.
+std::atomic<eye_orientation> eyeOrientations[eye_count] =
+{
+    { orientation_none },
+    { orientation_flip_vertical }
+};
+
+/// @brief: The visible region of each eye texture, indexed by @see eye_index.
+/// @remarks: Both eyes are fully visible until the visible region of the optics is set.
+eye_occlusion_settings eyeOcclusionSettings[eye_count] =
+{
+    { 0.0f, 0.0f },
+    { 0.0f, 0.0f }
+};
+
+/// @brief: A value indicating whether the visible regions have changed since the occlusion meshes were last built.
+std::atomic<bool> eyeOcclusionSettingsChanged(false);
+
+/// @brief: A value indicating whether Ryz frames that look the same as the last presented frame are skipped instead of presented.
+std::atomic<bool> skipStaticFrames(false);
+
+/// @brief: How the regions of the Ryz eye that changed since the last frame are found.
+std::atomic<damage_tracking_mode> damageTrackingMode(damage_tracking_off);
+
+/// @brief: The Ryz eye is rendered once every this many frames.
+std::atomic<int> ryzFrameRateDivisor(1);
+
+/// @brief: A value indicating whether only the Ryz eye is rendered.
+std::atomic<bool> ryzOnly(false);
+
+/// @brief: A value indicating whether a frame is synthesized for the Ryz display when Unity misses one.
+std::atomic<bool> frameSynthesis(false);
+
+/// @brief: The scale the Ryz eye texture is created at, relative to the size of the display.
+std::atomic<float> ryzRenderScale(1.0f);
+
+/// @brief: A value indicating whether a Ryz eye rendered smaller than the display is upscaled with edge reconstruction.
+std::atomic<bool> ryzUpscaling(false);
+
+/// @brief: How much weaker than the strongest sharpening the upscaled Ryz eye is sharpened, in stops.
+std::atomic<float> ryzUpscaleSharpness(defaultUpscaleSharpness);
+
+/// @brief: The region of the mirror view that the Ryz eye is drawn into in @see mirror_blit_picture_in_picture mode.
+/// @remarks: Defaults to a corner of the view, 30% of its size, so the inset keeps the aspect ratio of the eye texture.
+std::atomic<normalized_rect> mirrorPictureInPictureRect(normalized_rect { 0.65f, 0.05f, 0.3f, 0.3f });
+
+/// @brief: Gets the number of bytes a single pixel of the color format occupies.
+/// @param format The color format.
+/// @returns: The number of bytes per pixel.
+int color_format_byte_size(color_format format)
+{
+    switch (format)
+    {
+        case color_format_rgb565:
+            return 2;
+
+        case color_format_bgra8:
+        case color_format_bgra8_srgb:
+        default:
+            return 4;
+    }
+}
+
+/// @brief: Gets the color format that an eye texture is created in.
+/// @param format The color format that has been configured for the eye.
+/// @param sRGB A value indicating whether the application renders to sRGB textures.
+/// @param use16BitColorBuffers A value indicating whether the application renders to 16-bit color buffers where it can.
+/// @returns: The configured format, or for @see color_format_default the one the application asks for.
+color_format resolve_color_format(color_format format, bool sRGB, bool use16BitColorBuffers)
+{
+    // A format that was set explicitly is used as it is.
+    if (format != color_format_default)
+    {
+        return format;
+    }
+
+    // There is no 16-bit sRGB format, and linear lighting looks wrong without sRGB, so sRGB takes precedence.
+    if (sRGB)
+    {
+        return color_format_bgra8_srgb;
+    }
+
+    return use16BitColorBuffers ? color_format_rgb565 : color_format_bgra8;
+}
+
+/// @brief: Gets a value indicating whether a radius of the visible ellipse of an eye can be used.
+/// @param radius The horizontal or vertical radius, where 0.5 reaches the edges of the eye texture.
+/// @returns: True if the radius disables the occlusion mesh or fits inside of it, otherwise false.
+bool is_valid_occlusion_radius(float radius)
+{
+    // An ellipse that reaches the outer edge of the mesh would fold its triangles over.
+    return std::isfinite(radius) && radius < occlusionMeshOuterRadius;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Sets the formats that an eye texture is created with.
+    /// @param eye The eye to configure. @see eye_index.
+    /// @param colorFormat The format of the color texture. @see color_format.
+    /// @param depthFormat The format of the depth texture. @see depth_format.
+    EXPORT_API void ikinRyzSetEyeFormat(int eye, int colorFormat, int depthFormat)
+    {
+        // Ignore requests for eyes or formats that don't exist.
+        if (eye < main_eye || eye >= eye_count ||
+            colorFormat < color_format_bgra8 || colorFormat > color_format_default ||
+            depthFormat < depth_format_24bit || depthFormat > depth_format_none)
+        {
+            return;
+        }
+
+        eye_format_settings& settings = eyeFormatSettings[eye];
+
+        // If nothing changed, then there is no need to recreate the textures.
+        if (settings.colorFormat == colorFormat && settings.depthFormat == depthFormat)
+        {
+            return;
+        }
+
+        settings.colorFormat = (color_format)colorFormat;
+        settings.depthFormat = (depth_format)depthFormat;
+
+        // Let the render thread know that the textures need to be recreated.
+        eyeFormatSettingsChanged = true;
+    }
+
+    /// @brief Sets the orientation that an eye texture is presented with.
+    /// @param eye The eye to configure. @see eye_index.
+    /// @param orientation The orientation of the image on the display. @see eye_orientation.
+    EXPORT_API void ikinRyzSetEyeOrientation(int eye, int orientation)
+    {
+        // Ignore requests for eyes or orientations that don't exist.
+        if (eye < main_eye || eye >= eye_count ||
+            orientation < orientation_none || orientation > orientation_rotate_180)
+        {
+            return;
+        }
+
+        eyeOrientations[eye].store((eye_orientation)orientation, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets the region of an eye texture that can be seen on its display, so the pixels outside of it are not shaded.
+    /// @param eye The eye to configure. @see eye_index.
+    /// @param radiusX The horizontal radius of the visible ellipse, where 0.5 reaches the left and right edges.
+    /// @param radiusY The vertical radius of the visible ellipse, where 0.5 reaches the top and bottom edges.
+    EXPORT_API void ikinRyzSetEyeOcclusion(int eye, float radiusX, float radiusY)
+    {
+        // Ignore requests for eyes that don't exist, or for ellipses the occlusion mesh can't be built around.
+        if (eye < main_eye || eye >= eye_count ||
+            !is_valid_occlusion_radius(radiusX) || !is_valid_occlusion_radius(radiusY))
+        {
+            return;
+        }
+
+        eye_occlusion_settings& settings = eyeOcclusionSettings[eye];
+
+        // If nothing changed, then there is no need to rebuild the mesh.
+        if (settings.radiusX == radiusX && settings.radiusY == radiusY)
+        {
+            return;
+        }
+
+        settings.radiusX = radiusX;
+        settings.radiusY = radiusY;
+
+        // Let the render thread know that the meshes need to be rebuilt.
+        eyeOcclusionSettingsChanged = true;
+    }
+
+    /// @brief Sets whether Ryz frames that look the same as the last presented frame are skipped instead of presented.
+    /// @param enabled Non-zero to skip static frames, zero to present every frame.
+    EXPORT_API void ikinRyzSetSkipStaticFrames(int enabled)
+    {
+        skipStaticFrames.store(enabled != 0, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets how the regions of the Ryz eye that changed since the last frame are found.
+    /// @param mode The @see damage_tracking_mode value.
+    EXPORT_API void ikinRyzSetDamageTracking(int mode)
+    {
+        // Ignore modes that don't exist.
+        if (mode < damage_tracking_off || mode > damage_tracking_tiles)
+        {
+            return;
+        }
+
+        damageTrackingMode.store((damage_tracking_mode)mode, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets how often the Ryz eye is rendered, relative to the main eye.
+    /// @param divisor The Ryz eye is rendered once every this many frames. 1 renders it every frame, 2 at half rate, and so on.
+    EXPORT_API void ikinRyzSetRyzFrameRateDivisor(int divisor)
+    {
+        // Ignore divisors that would never render the Ryz eye.
+        if (divisor < 1)
+        {
+            return;
+        }
+
+        ryzFrameRateDivisor.store(divisor, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets whether only the Ryz eye is rendered, for installs where the phone display can't be seen.
+    /// @param enabled Non-zero to stop rendering the main eye, zero to render both eyes.
+    EXPORT_API void ikinRyzSetRyzOnly(int enabled)
+    {
+        ryzOnly.store(enabled != 0, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets whether a frame is synthesized for the Ryz display when Unity misses one, instead of the last frame being shown again.
+    /// @param enabled Non-zero to synthesize frames, zero to let the display stutter.
+    EXPORT_API void ikinRyzSetFrameSynthesis(int enabled)
+    {
+        frameSynthesis.store(enabled != 0, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets the scale the Ryz eye is rendered at, relative to the size of the Ryz display.
+    /// @param scale The scale, greater than 0 and at most 1.
+    EXPORT_API void ikinRyzSetRyzRenderScale(float scale)
+    {
+        // Ignore scales that would leave nothing to render, or render more pixels than the display has.
+        if (!(scale > 0.0f && scale <= 1.0f) || scale == ryzRenderScale.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        ryzRenderScale.store(scale, std::memory_order_relaxed);
+
+        // Let the render thread know that the textures need to be recreated at the new size.
+        eyeFormatSettingsChanged = true;
+    }
+
+    /// @brief Sets whether a Ryz eye rendered smaller than the display is upscaled with edge reconstruction and sharpening.
+    /// @param enabled Non-zero to upscale, zero to stretch the eye with bilinear filtering.
+    /// @param sharpness How much weaker than the strongest sharpening to sharpen, in stops.
+    EXPORT_API void ikinRyzSetUpscaling(int enabled, float sharpness)
+    {
+        if (sharpness >= 0.0f)
+        {
+            ryzUpscaleSharpness.store(sharpness, std::memory_order_relaxed);
+        }
+
+        ryzUpscaling.store(enabled != 0, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets the region of the mirror view that the Ryz eye is drawn into when the picture in picture mirror mode is selected.
+    /// @param x The left edge of the region, from 0 to 1.
+    /// @param y The bottom edge of the region, from 0 to 1.
+    /// @param width The width of the region, from 0 to 1.
+    /// @param height The height of the region, from 0 to 1.
+    EXPORT_API void ikinRyzSetMirrorPictureInPictureRect(float x, float y, float width, float height)
+    {
+        // Ignore regions that are empty or reach outside of the mirror view.
+        if (width <= 0.0f || height <= 0.0f ||
+            x < 0.0f || y < 0.0f || x + width > 1.0f || y + height > 1.0f)
+        {
+            return;
+        }
+
+        mirrorPictureInPictureRect.store(normalized_rect { x, y, width, height }, std::memory_order_relaxed);
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,266 @@
+//
+//  ikin_ryz_settings.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_SETTINGS_H
+#define IKIN_RYZ_SETTINGS_H
+
+#include <atomic>
+
+#include "native_to_unity_notifiers.h"
+
+/// @brief: Identifies the display that an eye texture is presented on.
+/// @remarks: Unity's left eye is the phone display and its right eye is the Ryz display.
+enum eye_index
+{
+    main_eye = 0,
+    ryz_eye = 1,
+    eye_count = 2
+};
+
+/// @brief: The color formats that an eye texture can be rendered in.
+enum color_format
+{
+    /// @brief: 8 bits per channel, stored blue first. 4 bytes per pixel.
+    color_format_bgra8 = 0,
+
+    /// @brief: 8 bits per channel with sRGB encoding, stored blue first. 4 bytes per pixel.
+    color_format_bgra8_srgb = 1,
+
+    /// @brief: 5 bits red, 6 bits green and 5 bits blue. 2 bytes per pixel.
+    color_format_rgb565 = 2,
+
+    /// @brief: Whichever of the formats above the application asks Unity for, through its sRGB and 16-bit color buffer settings.
+    color_format_default = 3
+};
+
+/// @brief: The depth formats that an eye texture can be rendered with.
+enum depth_format
+{
+    /// @brief: A 24 bit or greater depth buffer.
+    depth_format_24bit = 0,
+
+    /// @brief: A 16 bit depth buffer.
+    depth_format_16bit = 1,
+
+    /// @brief: No depth buffer.
+    depth_format_none = 2
+};
+
+/// @brief: How an eye texture is oriented when it is presented on its display.
+/// @remarks: Applied when the eye texture is presented, so scenes are rendered without flipping the projection or inverting culling.
+enum eye_orientation
+{
+    /// @brief: The texture is presented as it was rendered.
+    orientation_none = 0,
+
+    /// @brief: The texture is flipped top to bottom.
+    orientation_flip_vertical = 1,
+
+    /// @brief: The texture is flipped left to right.
+    orientation_flip_horizontal = 2,
+
+    /// @brief: The texture is rotated half a turn, which flips it both ways.
+    orientation_rotate_180 = 3
+};
+
+/// @brief: Describes the formats an eye texture is created with.
+struct eye_format_settings
+{
+    /// @brief: The format of the color texture.
+    color_format colorFormat;
+
+    /// @brief: The format of the depth texture.
+    depth_format depthFormat;
+};
+
+/// @brief: Describes the part of an eye texture that can be seen on its display.
+/// @remarks: The visible part is an ellipse centered in the texture. Pixels outside of it are covered by an occlusion mesh and never shaded.
+struct eye_occlusion_settings
+{
+    /// @brief: The horizontal radius of the visible ellipse, where 0.5 reaches the left and right edges. Zero or less disables the occlusion mesh.
+    float radiusX;
+
+    /// @brief: The vertical radius of the visible ellipse, where 0.5 reaches the top and bottom edges. Zero or less disables the occlusion mesh.
+    float radiusY;
+};
+
+/// @brief: A rectangle in homogeneous coordinates, where 0 and 1 are the edges of the texture or view.
+struct normalized_rect
+{
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+/// @brief: How the regions of the Ryz eye that changed since the last frame are found.
+/// @remarks: The values match the RyzDamageTracking enum on the C# side.
+enum damage_tracking_mode
+{
+    /// @brief: The whole Ryz eye is treated as changed every frame.
+    damage_tracking_off = 0,
+
+    /// @brief: The application reports the regions it changed with ikinRyzAddDamageRect.
+    /// @remarks: Frames without any reported regions are treated as unchanged.
+    damage_tracking_application = 1,
+
+    /// @brief: The regions are found by comparing hashes of the tiles of the Ryz eye on the GPU.
+    damage_tracking_tiles = 2
+};
+
+/// @brief: The custom mirror blit mode that shows the main eye with a picture of the Ryz eye inset in it.
+/// @remarks: Custom blit modes start at 1 and must also be listed in UnitySubsystemsManifest.json.
+const int mirror_blit_picture_in_picture = 1;
+
+/// @brief: The formats that each eye texture is created with, indexed by @see eye_index.
+extern eye_format_settings eyeFormatSettings[eye_count];
+
+/// @brief: A value indicating whether the eye formats or the Ryz render scale have changed since the eye textures were last created.
+/// @remarks: Set on the main thread and cleared on the render thread once the textures have been recreated.
+extern std::atomic<bool> eyeFormatSettingsChanged;
+
+/// @brief: The orientation that each eye texture is presented with, indexed by @see eye_index.
+/// @remarks: Read by the render thread every frame, so changes take effect on the next presented frame.
+extern std::atomic<eye_orientation> eyeOrientations[eye_count];
+
+/// @brief: The visible region of each eye texture, indexed by @see eye_index.
+extern eye_occlusion_settings eyeOcclusionSettings[eye_count];
+
+/// @brief: A value indicating whether the visible regions have changed since the occlusion meshes were last built.
+/// @remarks: Set on the main thread and cleared on the render thread once the meshes have been rebuilt.
+extern std::atomic<bool> eyeOcclusionSettingsChanged;
+
+/// @brief: A value indicating whether Ryz frames that look the same as the last presented frame are skipped instead of presented.
+/// @remarks: Off by default. Read by the render thread every frame.
+extern std::atomic<bool> skipStaticFrames;
+
+/// @brief: How the regions of the Ryz eye that changed since the last frame are found.
+/// @remarks: Off by default. Read by the render thread every frame.
+extern std::atomic<damage_tracking_mode> damageTrackingMode;
+
+/// @brief: The Ryz eye is rendered once every this many frames. The frames in between present its last image again.
+/// @remarks: 1 by default, which renders it every frame. Read by the render thread every frame.
+extern std::atomic<int> ryzFrameRateDivisor;
+
+/// @brief: A value indicating whether only the Ryz eye is rendered, leaving the phone display showing the last main eye image.
+/// @remarks: Off by default. Read by the render thread every frame.
+extern std::atomic<bool> ryzOnly;
+
+/// @brief: A value indicating whether a frame is synthesized for the Ryz display when Unity misses one.
+/// @remarks: Off by default. Read at every refresh of the Ryz display.
+extern std::atomic<bool> frameSynthesis;
+
+/// @brief: The scale the Ryz eye texture is created at, relative to the size of the display.
+/// @remarks: 1 by default. Changing it recreates the eye textures.
+extern std::atomic<float> ryzRenderScale;
+
+/// @brief: A value indicating whether a Ryz eye rendered smaller than the display is upscaled with edge reconstruction, rather than bilinear filtering.
+/// @remarks: Off by default. Read by the render thread every frame.
+extern std::atomic<bool> ryzUpscaling;
+
+/// @brief: How much weaker than the strongest sharpening the upscaled Ryz eye is sharpened, in stops.
+extern std::atomic<float> ryzUpscaleSharpness;
+
+/// @brief: The region of the mirror view that the Ryz eye is drawn into in @see mirror_blit_picture_in_picture mode.
+/// @remarks: Read whenever Unity asks for the mirror view descriptor, so changes take effect on the next frame.
+/// Set and read as a whole, so the render thread never sees the edges of one region with the size of another.
+extern std::atomic<normalized_rect> mirrorPictureInPictureRect;
+
+/// @brief: Gets the number of bytes a single pixel of the color format occupies.
+/// @param format The color format.
+/// @returns: The number of bytes per pixel.
+int color_format_byte_size(color_format format);
+
+/// @brief: Gets the color format that an eye texture is created in.
+/// @param format The color format that has been configured for the eye.
+/// @param sRGB A value indicating whether the application renders to sRGB textures.
+/// @param use16BitColorBuffers A value indicating whether the application renders to 16-bit color buffers where it can.
+/// @returns: The configured format, or for @see color_format_default the one the application asks for. sRGB wins over 16-bit, which has no sRGB form.
+color_format resolve_color_format(color_format format, bool sRGB, bool use16BitColorBuffers);
+
+/// @brief: Gets a value indicating whether a radius of the visible ellipse of an eye can be used.
+/// @param radius The horizontal or vertical radius, where 0.5 reaches the edges of the eye texture.
+/// @returns: True if the radius is zero or less, which disables the occlusion mesh, or is less than @see occlusionMeshOuterRadius. False if it isn't finite.
+bool is_valid_occlusion_radius(float radius);
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Sets the formats that an eye texture is created with.
+    /// @param eye The eye to configure. @see eye_index.
+    /// @param colorFormat The format of the color texture. @see color_format.
+    /// @param depthFormat The format of the depth texture. @see depth_format.
+    /// @remarks: The eye textures are recreated on the render thread before the next frame is rendered.
+    EXPORT_API void ikinRyzSetEyeFormat(int eye, int colorFormat, int depthFormat);
+
+    /// @brief Sets the orientation that an eye texture is presented with.
+    /// @param eye The eye to configure. @see eye_index.
+    /// @param orientation The orientation of the image on the display. @see eye_orientation.
+    EXPORT_API void ikinRyzSetEyeOrientation(int eye, int orientation);
+
+    /// @brief Sets the region of an eye texture that can be seen on its display, so the pixels outside of it are not shaded.
+    /// @param eye The eye to configure. @see eye_index.
+    /// @param radiusX The horizontal radius of the visible ellipse, where 0.5 reaches the left and right edges.
+    /// @param radiusY The vertical radius of the visible ellipse, where 0.5 reaches the top and bottom edges.
+    /// @remarks: Pass zero for either radius to stop occluding the eye. The occlusion mesh is rebuilt before the next frame is rendered.
+    /// Radii that aren't finite, or reach the outer edge of the mesh at @see occlusionMeshOuterRadius, are ignored.
+    EXPORT_API void ikinRyzSetEyeOcclusion(int eye, float radiusX, float radiusY);
+
+    /// @brief Sets whether Ryz frames that look the same as the last presented frame are skipped instead of presented.
+    /// @param enabled Non-zero to skip static frames, zero to present every frame.
+    /// @remarks: Saves the copy and present of frames whose content did not change, such as menus and paused states.
+    /// The first changed frame after a static period is presented a frame or two late, since the comparison happens on the GPU.
+    EXPORT_API void ikinRyzSetSkipStaticFrames(int enabled);
+
+    /// @brief Sets how the regions of the Ryz eye that changed since the last frame are found.
+    /// @param mode The @see damage_tracking_mode value.
+    /// @remarks: Only the changed regions are copied into the buffer that the Ryz display is presented from.
+    EXPORT_API void ikinRyzSetDamageTracking(int mode);
+
+    /// @brief Sets how often the Ryz eye is rendered, relative to the main eye.
+    /// @param divisor The Ryz eye is rendered once every this many frames. 1 renders it every frame, 2 at half rate, and so on.
+    /// @remarks: The frames in between present the last rendered Ryz image again, and don't cost any Ryz scene rendering.
+    EXPORT_API void ikinRyzSetRyzFrameRateDivisor(int divisor);
+
+    /// @brief Sets whether only the Ryz eye is rendered, for installs where the phone display can't be seen.
+    /// @param enabled Non-zero to stop rendering the main eye, zero to render both eyes.
+    /// @remarks: The main eye is left out of every frame, so the mirror view keeps showing its last image.
+    EXPORT_API void ikinRyzSetRyzOnly(int enabled);
+
+    /// @brief Sets whether a frame is synthesized for the Ryz display when Unity misses one, instead of the last frame being shown again.
+    /// @param enabled Non-zero to synthesize frames, zero to let the display stutter.
+    /// @remarks: The synthesized frame is extrapolated from the last two presented frames, or moved along the motion vectors set with ikinRyzSetMotionVectorTexture.
+    EXPORT_API void ikinRyzSetFrameSynthesis(int enabled);
+
+    /// @brief Sets the scale the Ryz eye is rendered at, relative to the size of the Ryz display.
+    /// @param scale The scale, greater than 0 and at most 1.
+    /// @remarks: The eye textures are recreated on the render thread before the next frame is rendered.
+    /// A scale of 0.6 to 0.75 with upscaling turned on saves most of the shading cost, with little visible loss.
+    EXPORT_API void ikinRyzSetRyzRenderScale(float scale);
+
+    /// @brief Sets whether a Ryz eye rendered smaller than the display is upscaled with edge reconstruction and sharpening.
+    /// @param enabled Non-zero to upscale, zero to stretch the eye with bilinear filtering.
+    /// @param sharpness How much weaker than the strongest sharpening to sharpen, in stops. 0 is the strongest, 2 is barely sharpened.
+    /// @remarks: Negative sharpness values are ignored, and the last valid one is kept.
+    EXPORT_API void ikinRyzSetUpscaling(int enabled, float sharpness);
+
+    /// @brief Sets the region of the mirror view that the Ryz eye is drawn into when the picture in picture mirror mode is selected.
+    /// @param x The left edge of the region, from 0 to 1.
+    /// @param y The bottom edge of the region, from 0 to 1.
+    /// @param width The width of the region, from 0 to 1.
+    /// @param height The height of the region, from 0 to 1.
+    EXPORT_API void ikinRyzSetMirrorPictureInPictureRect(float x, float y, float width, float height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
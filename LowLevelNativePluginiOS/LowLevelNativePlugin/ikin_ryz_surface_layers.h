@@ -0,0 +1,110 @@
+//
+//  ikin_ryz_surface_layers.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_SURFACE_LAYERS_H
+#define IKIN_RYZ_SURFACE_LAYERS_H
+
+#import <IOSurface/IOSurfaceRef.h>
+#import <Metal/Metal.h>
+
+#include "ikin_ryz_composition_layers.h"
+#include "native_to_unity_notifiers.h"
+
+/// @brief: The most frames that can be queued on a composition layer at once.
+/// @remarks: A decoder that gets ahead of the display by more than this is turned away, which keeps it from holding on to every surface in its pool.
+const int maxQueuedSurfaces = 4;
+
+/// @brief: The most surfaces the textures of which are kept for reuse.
+/// @remarks: Decoders cycle through a small pool of surfaces, so each surface only needs a texture made for it once.
+const int maxCachedSurfaceTextures = 16;
+
+/// @brief: Shows the frames that are queued on composition layers from outside of Unity, such as decoded video, at their presentation times.
+/// @remarks: The surfaces are drawn from where the decoder left them, so a frame is never copied, and Unity never renders it.
+/// A surface is kept in use from when it is queued until the GPU is done drawing it, so that the decoder doesn't write over it in the meantime.
+class ikin_ryz_surface_layers
+{
+public:
+    /// @brief: Puts the latest frame that is due on each layer, and drops the frames that it replaces.
+    /// @param commandBuffer The command buffer that draws the layers this frame, which tells when the surfaces it replaces can be given back.
+    /// @param device The Metal device that Unity renders with.
+    /// @param displayTime The host time that the frame is expected to be shown at, in seconds, on the clock of CACurrentMediaTime.
+    void update(id<MTLCommandBuffer> commandBuffer, id<MTLDevice> device, double displayTime);
+
+    /// @brief: Gives back every surface, and releases the textures that were made for them.
+    void release();
+
+private:
+    /// @brief: Gets the texture for a surface, making it if the surface hasn't been seen before.
+    /// @param device The Metal device that Unity renders with.
+    /// @param surface The surface.
+    /// @returns: The texture, or nil if one can't be made for the surface.
+    id<MTLTexture> surface_texture(id<MTLDevice> device, IOSurfaceRef surface);
+
+    /// @brief: The surface that each layer shows, indexed like the layer slots. Held until the GPU is done with it.
+    struct shown_surface
+    {
+        /// @brief: The ID of the layer, or zero if the slot is free.
+        int layerId;
+
+        /// @brief: The surface.
+        IOSurfaceRef surface;
+    };
+
+    /// @brief: A texture that was made for a surface.
+    struct cached_texture
+    {
+        /// @brief: The surface, which is kept alive so that another one can't take its address.
+        IOSurfaceRef surface;
+
+        /// @brief: The texture that was made for the surface.
+        id<MTLTexture> texture;
+    };
+
+    /// @brief: The surfaces that the layers show.
+    shown_surface shownSurfaces[maxCompositionLayers];
+
+    /// @brief: The textures that were made for surfaces, which are replaced oldest first.
+    cached_texture textureCache[maxCachedSurfaceTextures];
+
+    /// @brief: The entry of @see textureCache that is replaced next.
+    int nextCachedTexture;
+};
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Queues a frame on a composition layer, to be shown in place of its texture from its presentation time.
+    /// @param layerId The ID of the layer. @see ikinRyzCreateCompositionLayer.
+    /// @param surface The IOSurfaceRef that holds the frame, such as from CVPixelBufferGetIOSurface. Only 32-bit BGRA surfaces are supported.
+    /// @param presentationTime The presentation time of the frame, in seconds, on the clock of the stream it is from.
+    /// @returns: 1 if the frame was queued, 0 if the layer doesn't exist, the surface isn't supported or the queue is full.
+    /// @remarks: The surface is marked in use until it has been shown and replaced, so a decoder's pool won't reuse it before then.
+    /// Frames have to be queued in presentation order. When frames fall behind, the ones that are overdue are dropped rather than shown late.
+    EXPORT_API int ikinRyzQueueCompositionLayerSurface(int layerId, void* surface, double presentationTime);
+
+    /// @brief Ties the clock of the stream that is queued on a composition layer to the host clock.
+    /// @param layerId The ID of the layer.
+    /// @param presentationTime A time on the clock of the stream, in seconds.
+    /// @param hostTime The host time that it is shown at, in seconds, on the clock of CACurrentMediaTime.
+    /// @remarks: Without this, the first frame queued after the layer is created or flushed is shown straight away, and the others follow at their spacing.
+    /// Call this to keep the frames in time with something else, such as the audio of the stream.
+    EXPORT_API void ikinRyzSetCompositionLayerClock(int layerId, double presentationTime, double hostTime);
+
+    /// @brief Drops the frames that are queued on a composition layer, and forgets its clock, such as when the stream it shows seeks.
+    /// @param layerId The ID of the layer.
+    /// @remarks: The frame that is being shown stays until a new one is due.
+    EXPORT_API void ikinRyzFlushCompositionLayerSurfaces(int layerId);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,374 @@
+//
+//  ikin_ryz_surface_layers.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_surface_layers.h"
+
+#import <QuartzCore/QuartzCore.h>
+
+#include <cmath>
+#include <mutex>
+
+#include "ikin_ryz_frame_stats.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: A frame that is queued on a composition layer.
+    struct surface_frame
+    {
+        /// @brief: The surface that holds the frame, which is retained and marked in use.
+        IOSurfaceRef surface;
+
+        /// @brief: The presentation time of the frame, on the clock of its stream.
+        double presentationTime;
+    };
+
+    /// @brief: The frames that are queued on a composition layer, oldest first.
+    struct surface_queue
+    {
+        /// @brief: The ID of the layer, or zero if the queue is free.
+        int layerId;
+
+        /// @brief: The frames.
+        surface_frame frames[maxQueuedSurfaces];
+
+        /// @brief: The number of frames.
+        int count;
+
+        /// @brief: A value indicating whether @see clockOffset has been set.
+        bool clockSet;
+
+        /// @brief: The host time of the stream's time 0, which is added to presentation times to get the host times they are shown at.
+        double clockOffset;
+    };
+
+    /// @brief: The queues of the layers that frames have been queued on.
+    surface_queue surfaceQueues[maxCompositionLayers];
+
+    /// @brief: Guards the queues, which are filled on the decoder's thread and emptied on the render thread.
+    std::mutex surfaceQueuesMutex;
+
+    /// @brief: Gives a surface back, once nothing is going to read it.
+    /// @param surface The surface.
+    void release_surface(IOSurfaceRef surface)
+    {
+        IOSurfaceDecrementUseCount(surface);
+        CFRelease(surface);
+    }
+
+    /// @brief: Finds the queue of a layer. The caller has to hold @see surfaceQueuesMutex.
+    /// @param layerId The ID of the layer.
+    /// @param create A value indicating whether to take a free queue if the layer has none.
+    /// @returns: The queue, or null if the layer has none and one wasn't taken.
+    surface_queue* find_queue(int layerId, bool create)
+    {
+        surface_queue* freeQueue = nullptr;
+
+        for (surface_queue& queue : surfaceQueues)
+        {
+            if (queue.layerId == layerId)
+            {
+                return &queue;
+            }
+
+            if (queue.layerId == 0 && freeQueue == nullptr)
+            {
+                freeQueue = &queue;
+            }
+        }
+
+        if (!create || freeQueue == nullptr)
+        {
+            return nullptr;
+        }
+
+        *freeQueue = {};
+        freeQueue->layerId = layerId;
+
+        return freeQueue;
+    }
+
+    /// @brief: Gives back every frame that is queued. The caller has to hold @see surfaceQueuesMutex.
+    /// @param queue The queue.
+    void flush_queue(surface_queue& queue)
+    {
+        for (int i = 0; i < queue.count; ++i)
+        {
+            release_surface(queue.frames[i].surface);
+        }
+
+        queue.count = 0;
+        queue.clockSet = false;
+    }
+
+    /// @brief: Removes the oldest frame of a queue, without giving it back. The caller has to hold @see surfaceQueuesMutex.
+    /// @param queue The queue, which has at least one frame.
+    /// @returns: The frame.
+    surface_frame pop_frame(surface_queue& queue)
+    {
+        const surface_frame frame = queue.frames[0];
+
+        for (int i = 1; i < queue.count; ++i)
+        {
+            queue.frames[i - 1] = queue.frames[i];
+        }
+
+        --queue.count;
+
+        return frame;
+    }
+}
+
+/// @brief: Puts the latest frame that is due on each layer, and drops the frames that it replaces.
+/// @param commandBuffer The command buffer that draws the layers this frame, which tells when the surfaces it replaces can be given back.
+/// @param device The Metal device that Unity renders with.
+/// @param displayTime The host time that the frame is expected to be shown at, in seconds, on the clock of CACurrentMediaTime.
+void ikin_ryz_surface_layers::update(id<MTLCommandBuffer> commandBuffer, id<MTLDevice> device, double displayTime)
+{
+    // The frame that is due on each queue, taken out while the queues are locked, and shown once they are unlocked.
+    surface_frame dueFrames[maxCompositionLayers] = {};
+    int dueLayerIds[maxCompositionLayers] = {};
+
+    {
+        std::lock_guard<std::mutex> guard(surfaceQueuesMutex);
+
+        for (int slot = 0; slot < maxCompositionLayers; ++slot)
+        {
+            surface_queue& queue = surfaceQueues[slot];
+
+            if (queue.layerId == 0)
+            {
+                continue;
+            }
+
+            // If the layer was destroyed, then its frames are no use.
+            if (!composition_layer_exists(queue.layerId))
+            {
+                flush_queue(queue);
+                queue.layerId = 0;
+                continue;
+            }
+
+            // Drop every frame that a later frame is due in place of, so that a stream that fell behind catches up rather than stays late.
+            while (queue.count >= 2 && queue.frames[1].presentationTime + queue.clockOffset <= displayTime)
+            {
+                release_surface(pop_frame(queue).surface);
+
+                frameStatsCounters.surfaceFramesDropped.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (queue.count > 0 && queue.frames[0].presentationTime + queue.clockOffset <= displayTime)
+            {
+                dueFrames[slot] = pop_frame(queue);
+                dueLayerIds[slot] = queue.layerId;
+            }
+        }
+    }
+
+    for (int slot = 0; slot < maxCompositionLayers; ++slot)
+    {
+        shown_surface& shown = shownSurfaces[slot];
+
+        // If a layer is no longer there, then let go of the surface it showed once the GPU is done with it.
+        if (shown.layerId != 0 && dueLayerIds[slot] != shown.layerId && !composition_layer_exists(shown.layerId))
+        {
+            IOSurfaceRef retired = shown.surface;
+            [commandBuffer addCompletedHandler : ^(id<MTLCommandBuffer>) { release_surface(retired); }];
+
+            shown = {};
+        }
+
+        if (dueLayerIds[slot] == 0)
+        {
+            continue;
+        }
+
+        const surface_frame& frame = dueFrames[slot];
+
+        id<MTLTexture> texture = surface_texture(device, frame.surface);
+
+        if (texture == nil || !set_composition_layer_texture(dueLayerIds[slot], texture))
+        {
+            release_surface(frame.surface);
+            continue;
+        }
+
+        // The surface that was shown until now may still be read by the frames in flight, so it is only given back once this frame completes.
+        if (shown.surface != nullptr)
+        {
+            IOSurfaceRef retired = shown.surface;
+            [commandBuffer addCompletedHandler : ^(id<MTLCommandBuffer>) { release_surface(retired); }];
+        }
+
+        shown.layerId = dueLayerIds[slot];
+        shown.surface = frame.surface;
+
+        frameStatsCounters.surfaceFramesPresented.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/// @brief: Gives back every surface, and releases the textures that were made for them.
+void ikin_ryz_surface_layers::release()
+{
+    for (shown_surface& shown : shownSurfaces)
+    {
+        if (shown.surface != nullptr)
+        {
+            set_composition_layer_texture(shown.layerId, nil);
+            release_surface(shown.surface);
+        }
+
+        shown = {};
+    }
+
+    for (cached_texture& cached : textureCache)
+    {
+        if (cached.surface != nullptr)
+        {
+            CFRelease(cached.surface);
+        }
+
+        cached = {};
+    }
+
+    nextCachedTexture = 0;
+}
+
+/// @brief: Gets the texture for a surface, making it if the surface hasn't been seen before.
+/// @param device The Metal device that Unity renders with.
+/// @param surface The surface.
+/// @returns: The texture, or nil if one can't be made for the surface.
+id<MTLTexture> ikin_ryz_surface_layers::surface_texture(id<MTLDevice> device, IOSurfaceRef surface)
+{
+    for (const cached_texture& cached : textureCache)
+    {
+        if (cached.surface == surface)
+        {
+            return cached.texture;
+        }
+    }
+
+    // The texture reads the surface's memory directly.
+    MTLTextureDescriptor* textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat : MTLPixelFormatBGRA8Unorm
+                                                                                                 width : IOSurfaceGetWidth(surface)
+                                                                                                height : IOSurfaceGetHeight(surface)
+                                                                                             mipmapped : NO];
+    textureDescriptor.usage = MTLTextureUsageShaderRead;
+
+    id<MTLTexture> texture = [device newTextureWithDescriptor : textureDescriptor
+                                                    iosurface : surface
+                                                        plane : 0];
+
+    if (texture == nil)
+    {
+        return nil;
+    }
+
+    // Replace the oldest texture. It may still be drawn by the frames in flight, which hold their own references to it.
+    cached_texture& cached = textureCache[nextCachedTexture];
+    nextCachedTexture = (nextCachedTexture + 1) % maxCachedSurfaceTextures;
+
+    if (cached.surface != nullptr)
+    {
+        CFRelease(cached.surface);
+    }
+
+    CFRetain(surface);
+    cached.surface = surface;
+    cached.texture = texture;
+
+    return texture;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Queues a frame on a composition layer, to be shown in place of its texture from its presentation time.
+    /// @param layerId The ID of the layer. @see ikinRyzCreateCompositionLayer.
+    /// @param surface The IOSurfaceRef that holds the frame, such as from CVPixelBufferGetIOSurface. Only 32-bit BGRA surfaces are supported.
+    /// @param presentationTime The presentation time of the frame, in seconds, on the clock of the stream it is from.
+    /// @returns: 1 if the frame was queued, 0 if the layer doesn't exist, the surface isn't supported or the queue is full.
+    EXPORT_API int ikinRyzQueueCompositionLayerSurface(int layerId, void* surface, double presentationTime)
+    {
+        IOSurfaceRef frameSurface = static_cast<IOSurfaceRef>(surface);
+
+        // Ignore frames that can't be drawn or placed in time.
+        if (frameSurface == nullptr ||
+            IOSurfaceGetPixelFormat(frameSurface) != 'BGRA' ||
+            !std::isfinite(presentationTime) ||
+            !composition_layer_exists(layerId))
+        {
+            return 0;
+        }
+
+        std::lock_guard<std::mutex> guard(surfaceQueuesMutex);
+
+        surface_queue* queue = find_queue(layerId, true);
+
+        if (queue == nullptr || queue->count >= maxQueuedSurfaces)
+        {
+            return 0;
+        }
+
+        // If the stream's clock hasn't been tied to the host clock, then its first frame is shown straight away.
+        if (!queue->clockSet)
+        {
+            queue->clockOffset = CACurrentMediaTime() - presentationTime;
+            queue->clockSet = true;
+        }
+
+        // Keep the surface from being reused by the decoder until it has been shown and replaced.
+        CFRetain(frameSurface);
+        IOSurfaceIncrementUseCount(frameSurface);
+
+        queue->frames[queue->count++] = { frameSurface, presentationTime };
+
+        return 1;
+    }
+
+    /// @brief Ties the clock of the stream that is queued on a composition layer to the host clock.
+    /// @param layerId The ID of the layer.
+    /// @param presentationTime A time on the clock of the stream, in seconds.
+    /// @param hostTime The host time that it is shown at, in seconds, on the clock of CACurrentMediaTime.
+    EXPORT_API void ikinRyzSetCompositionLayerClock(int layerId, double presentationTime, double hostTime)
+    {
+        // Ignore times that aren't numbers.
+        if (!std::isfinite(presentationTime) || !std::isfinite(hostTime) || !composition_layer_exists(layerId))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(surfaceQueuesMutex);
+
+        surface_queue* queue = find_queue(layerId, true);
+
+        if (queue != nullptr)
+        {
+            queue->clockOffset = hostTime - presentationTime;
+            queue->clockSet = true;
+        }
+    }
+
+    /// @brief Drops the frames that are queued on a composition layer, and forgets its clock, such as when the stream it shows seeks.
+    /// @param layerId The ID of the layer.
+    EXPORT_API void ikinRyzFlushCompositionLayerSurfaces(int layerId)
+    {
+        std::lock_guard<std::mutex> guard(surfaceQueuesMutex);
+
+        surface_queue* queue = find_queue(layerId, false);
+
+        if (queue != nullptr)
+        {
+            flush_queue(*queue);
+        }
+    }
+
+#ifdef __cplusplus
+}
+#endif
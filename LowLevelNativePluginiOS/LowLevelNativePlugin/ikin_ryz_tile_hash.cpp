@@ -0,0 +1,203 @@
+//
+//  ikin_ryz_tile_hash.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_tile_hash.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Placed in an anonymous namespace to avoid these functions being accessed outside this file
+namespace
+{
+    /// @brief: The number of interleaved lanes each row of a tile is summed in.
+    const int laneCount = 4;
+
+    /// @brief: Rotates the bits of a value to the left.
+    inline uint32_t rotate_left(uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    /// @brief: Combines the running sums of the lanes of a tile row into the hash of the tile.
+    /// @param hash The hash of the tile rows above this one.
+    /// @param sums The first running sum of each lane.
+    /// @param sumsOfSums The second running sum of each lane, which makes the hash depend on the order of the pixels.
+    /// @returns: The hash of the tile rows up to and including this one.
+    inline uint32_t combine_row(uint32_t hash, const uint32_t* sums, const uint32_t* sumsOfSums)
+    {
+        const uint32_t rowHash = (sums[0] ^ rotate_left(sumsOfSums[0], 7)) +
+                                 (sums[1] ^ rotate_left(sumsOfSums[1], 11)) +
+                                 (sums[2] ^ rotate_left(sumsOfSums[2], 13)) +
+                                 (sums[3] ^ rotate_left(sumsOfSums[3], 17));
+
+        return rotate_left(hash, 5) ^ rowHash;
+    }
+
+    /// @brief: Calls a row function for every tile row of an image, and stores the resulting tile hashes.
+    /// @param rowFunction Sums one row of a tile. Takes the first pixel, the number of pixels, and the sums to add to.
+    template <typename RowFunction>
+    void for_each_tile(const uint8_t* pixels, int width, int height, size_t bytesPerRow, uint32_t* hashes, RowFunction rowFunction)
+    {
+        const int tilesAcross = (width + tileHashTileSize - 1) / tileHashTileSize;
+
+        for (int tileY = 0; tileY * tileHashTileSize < height; ++tileY)
+        {
+            const int top = tileY * tileHashTileSize;
+            const int tileHeight = height - top < tileHashTileSize ? height - top : tileHashTileSize;
+
+            for (int tileX = 0; tileX < tilesAcross; ++tileX)
+            {
+                const int left = tileX * tileHashTileSize;
+                const int tileWidth = width - left < tileHashTileSize ? width - left : tileHashTileSize;
+
+                uint32_t hash = 0;
+
+                for (int row = 0; row < tileHeight; ++row)
+                {
+                    const uint32_t* rowPixels = (const uint32_t*)(pixels + (top + row) * bytesPerRow) + left;
+
+                    uint32_t sums[laneCount] = { 0 };
+                    uint32_t sumsOfSums[laneCount] = { 0 };
+
+                    rowFunction(rowPixels, tileWidth, sums, sumsOfSums);
+
+                    hash = combine_row(hash, sums, sumsOfSums);
+                }
+
+                hashes[tileY * tilesAcross + tileX] = hash;
+            }
+        }
+    }
+
+    /// @brief: Sums one row of a tile, one pixel at a time.
+    /// @remarks: A partial group of pixels at the end of the row is padded with zero pixels.
+    void sum_row_scalar(const uint32_t* rowPixels, int tileWidth, uint32_t* sums, uint32_t* sumsOfSums)
+    {
+        for (int group = 0; group < tileWidth; group += laneCount)
+        {
+            for (int lane = 0; lane < laneCount; ++lane)
+            {
+                const uint32_t pixel = group + lane < tileWidth ? rowPixels[group + lane] : 0;
+
+                sums[lane] += pixel;
+                sumsOfSums[lane] += sums[lane];
+            }
+        }
+    }
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    /// @brief: Sums one row of a tile, a group of pixels at a time.
+    void sum_row_vector(const uint32_t* rowPixels, int tileWidth, uint32_t* sums, uint32_t* sumsOfSums)
+    {
+        const int fullGroupsWidth = tileWidth & ~(laneCount - 1);
+
+        // The partial group at the end of the row, padded with zero pixels.
+        uint32_t lastGroup[laneCount] = { 0 };
+        memcpy(lastGroup, rowPixels + fullGroupsWidth, (tileWidth - fullGroupsWidth) * sizeof(uint32_t));
+
+#if defined(__SSE2__)
+        __m128i sumVector = _mm_setzero_si128();
+        __m128i sumOfSumsVector = _mm_setzero_si128();
+
+        for (int group = 0; group < fullGroupsWidth; group += laneCount)
+        {
+            sumVector = _mm_add_epi32(sumVector, _mm_loadu_si128((const __m128i*)(rowPixels + group)));
+            sumOfSumsVector = _mm_add_epi32(sumOfSumsVector, sumVector);
+        }
+
+        if (fullGroupsWidth < tileWidth)
+        {
+            sumVector = _mm_add_epi32(sumVector, _mm_loadu_si128((const __m128i*)lastGroup));
+            sumOfSumsVector = _mm_add_epi32(sumOfSumsVector, sumVector);
+        }
+
+        _mm_storeu_si128((__m128i*)sums, sumVector);
+        _mm_storeu_si128((__m128i*)sumsOfSums, sumOfSumsVector);
+#else
+        uint32x4_t sumVector = vdupq_n_u32(0);
+        uint32x4_t sumOfSumsVector = vdupq_n_u32(0);
+
+        for (int group = 0; group < fullGroupsWidth; group += laneCount)
+        {
+            sumVector = vaddq_u32(sumVector, vld1q_u32(rowPixels + group));
+            sumOfSumsVector = vaddq_u32(sumOfSumsVector, sumVector);
+        }
+
+        if (fullGroupsWidth < tileWidth)
+        {
+            sumVector = vaddq_u32(sumVector, vld1q_u32(lastGroup));
+            sumOfSumsVector = vaddq_u32(sumOfSumsVector, sumVector);
+        }
+
+        vst1q_u32(sums, sumVector);
+        vst1q_u32(sumsOfSums, sumOfSumsVector);
+#endif
+    }
+#endif
+}
+
+/// @brief: Gets the number of tiles an image is split into.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @returns: The number of tiles, counting the partial tiles along the right and bottom edges.
+int tile_hash_count(int width, int height)
+{
+    const int tilesAcross = (width + tileHashTileSize - 1) / tileHashTileSize;
+    const int tilesDown = (height + tileHashTileSize - 1) / tileHashTileSize;
+
+    return tilesAcross * tilesDown;
+}
+
+/// @brief: Hashes each tile of a 32-bit image, so that tiles that changed between two images can be found cheaply.
+/// @param pixels The first row of the image.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param bytesPerRow The distance between the start of two rows, in bytes.
+/// @param hashes The hash of each tile, in rows of tiles from the top left. Must hold @see tile_hash_count entries.
+void hash_tiles(const uint8_t* pixels, int width, int height, size_t bytesPerRow, uint32_t* hashes)
+{
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    for_each_tile(pixels, width, height, bytesPerRow, hashes, sum_row_vector);
+#else
+    for_each_tile(pixels, width, height, bytesPerRow, hashes, sum_row_scalar);
+#endif
+}
+
+/// @brief: Hashes each tile of a 32-bit image one pixel at a time.
+void hash_tiles_scalar(const uint8_t* pixels, int width, int height, size_t bytesPerRow, uint32_t* hashes)
+{
+    for_each_tile(pixels, width, height, bytesPerRow, hashes, sum_row_scalar);
+}
+
+/// @brief: Counts the tiles whose hashes differ between two frames.
+/// @param previousHashes The hashes of the earlier frame.
+/// @param previousHashCount The number of hashes of the earlier frame. Zero if there is no earlier frame.
+/// @param hashes The hashes of the later frame.
+/// @param hashCount The number of hashes of the later frame.
+/// @returns: The number of tiles that changed. Every tile changed if the frames have different numbers of tiles.
+int count_changed_tiles(const uint32_t* previousHashes, int previousHashCount, const uint32_t* hashes, int hashCount)
+{
+    // Every tile differs from no hashes at all, or from the hashes of an image of another size.
+    if (previousHashCount != hashCount)
+    {
+        return hashCount;
+    }
+
+    int changedTiles = 0;
+
+    for (int tile = 0; tile < hashCount; ++tile)
+    {
+        changedTiles += previousHashes[tile] != hashes[tile];
+    }
+
+    return changedTiles;
+}
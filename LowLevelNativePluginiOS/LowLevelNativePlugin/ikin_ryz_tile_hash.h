@@ -0,0 +1,46 @@
+//
+//  ikin_ryz_tile_hash.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_TILE_HASH_H
+#define IKIN_RYZ_TILE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief: The width and height, in pixels, of the square tiles that an image is hashed in.
+const int tileHashTileSize = 32;
+
+/// @brief: Gets the number of tiles an image is split into.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @returns: The number of tiles, counting the partial tiles along the right and bottom edges.
+int tile_hash_count(int width, int height);
+
+/// @brief: Hashes each tile of a 32-bit image, so that tiles that changed between two images can be found cheaply.
+/// @param pixels The first row of the image.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param bytesPerRow The distance between the start of two rows, in bytes.
+/// @param hashes The hash of each tile, in rows of tiles from the top left. Must hold @see tile_hash_count entries.
+/// @remarks: This is the CPU reference of the hash kernel the compositor runs on the GPU, and produces the same values.
+/// Each row of a tile is summed in four interleaved lanes, two running sums per lane, so that the sums can be vectorized.
+/// Uses SSE2 or NEON when the compiler targets them, otherwise @see hash_tiles_scalar.
+void hash_tiles(const uint8_t* pixels, int width, int height, size_t bytesPerRow, uint32_t* hashes);
+
+/// @brief: Hashes each tile of a 32-bit image one pixel at a time.
+/// @remarks: The plain version of @see hash_tiles, which the vectorized versions are checked against.
+void hash_tiles_scalar(const uint8_t* pixels, int width, int height, size_t bytesPerRow, uint32_t* hashes);
+
+/// @brief: Counts the tiles whose hashes differ between two frames.
+/// @param previousHashes The hashes of the earlier frame.
+/// @param previousHashCount The number of hashes of the earlier frame. Zero if there is no earlier frame.
+/// @param hashes The hashes of the later frame.
+/// @param hashCount The number of hashes of the later frame.
+/// @returns: The number of tiles that changed. Every tile changed if the frames have different numbers of tiles.
+int count_changed_tiles(const uint32_t* previousHashes, int previousHashCount, const uint32_t* hashes, int hashCount);
+
+#endif
@@ -0,0 +1,118 @@
+//
+//  ikin_ryz_tile_hasher.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_TILE_HASHER_H
+#define IKIN_RYZ_TILE_HASHER_H
+
+#import <Metal/Metal.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "ikin_ryz_tile_hash.h"
+
+/// @brief: Hashes the tiles of the Ryz eye texture on the GPU, to find out whether a frame looks the same as the one before it.
+/// @remarks: The hashes are only known once the GPU has finished the frame, which is after the frame has been submitted.
+/// So a change is reported to the first frame submitted after the changed frame completes, which is one or two frames late.
+/// The kernel produces the same values as @see hash_tiles.
+class ikin_ryz_tile_hasher
+{
+public:
+    /// @brief: Compiles the hash kernel and creates the pipeline objects.
+    /// @param device The Metal device that Unity renders with.
+    /// @returns: True if the hasher is ready to encode, otherwise false.
+    bool initialize(id<MTLDevice> device);
+
+    /// @brief: Releases the pipeline objects and hash buffers.
+    void release();
+
+    /// @brief: Gets a value indicating whether the hasher is ready to encode.
+    /// @returns: True if the hasher is ready, otherwise false.
+    bool is_initialized() const;
+
+    /// @brief: Encodes a pass that hashes the tiles of the source texture, and compares them to the previous hashes once the GPU is done.
+    /// @param commandBuffer The command buffer the pass is encoded into. Must not have been committed yet.
+    /// @param source The texture that is hashed. Must be readable by shaders.
+    /// @param region The region of the texture that is hashed, in pixels.
+    void encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const MTLRegion& region);
+
+    /// @brief: Encodes passes that hash the tiles of the source texture, and copy the tiles that changed since the last copy into the destination.
+    /// @param commandBuffer The command buffer the passes are encoded into. Must not have been committed yet.
+    /// @param source The texture that is hashed and copied. Must be readable by shaders.
+    /// @param region The region of the texture that is hashed and copied, in pixels.
+    /// @param destination The texture that keeps the last copied image. Must be the size of the region, writable by shaders and in a format a blit can copy the source into.
+    /// @remarks: The hashes are also compared to the previous frame's, the same as @see encode does.
+    /// Unlike that comparison, the copy happens on the GPU within the same frame, so it is never late.
+    void encode_with_damage_copy(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const MTLRegion& region, id<MTLTexture> destination);
+
+    /// @brief: Gets whether any hashed frame has differed from the one before it since the last call, and clears it.
+    /// @returns: True if the contents changed, or may have changed, since the last call. Otherwise false.
+    bool consume_changed();
+
+    /// @brief: Gets the number of tiles that differed between the last completed frame and the one before it.
+    /// @returns: The number of tiles. Lags the submitted frames by one or two frames, the same as @see consume_changed.
+    int last_changed_tile_count() const;
+
+    /// @brief: Forgets the previous hashes, so that the next call to @see consume_changed reports a change.
+    void reset();
+
+private:
+    /// @brief: Encodes a pass that hashes the tiles of the source texture into the next hash buffer.
+    /// @param commandBuffer The command buffer the pass is encoded into. Must not have been committed yet.
+    /// @param source The texture that is hashed. Must be readable by shaders.
+    /// @param region The region of the texture that is hashed, in pixels.
+    /// @returns: The buffer the hashes are written into, or nil if the GPU is still using every hash buffer.
+    id<MTLBuffer> encode_hashes(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const MTLRegion& region);
+
+    /// @brief: Compares the hashes of a completed frame to the previous hashes, and keeps them for the next comparison.
+    /// @param hashes The hashes of the completed frame.
+    /// @param hashCount The number of hashes.
+    void compare_hashes(const uint32_t* hashes, int hashCount);
+
+    /// @brief: The number of frames whose hashes can be in flight on the GPU at once.
+    static const int bufferCount = 3;
+
+    /// @brief: The pipeline that runs the hash kernel.
+    id<MTLComputePipelineState> pipelineState;
+
+    /// @brief: The pipeline that runs the kernel that copies changed tiles.
+    id<MTLComputePipelineState> copyPipelineState;
+
+    /// @brief: The hashes of the tiles that the damage copy destination holds. Only used by the GPU.
+    id<MTLBuffer> copiedHashBuffer;
+
+    /// @brief: The texture that @see copiedHashBuffer describes.
+    /// @remarks: Held weakly, so that it doesn't keep the texture alive once its owner releases it.
+    __weak id<MTLTexture> copiedDestination;
+
+    /// @brief: The buffers that the GPU writes the hashes into, used in turn.
+    id<MTLBuffer> hashBuffers[bufferCount];
+
+    /// @brief: Values indicating whether the GPU is still using each hash buffer.
+    std::atomic<bool> bufferInUse[bufferCount];
+
+    /// @brief: The index of the next hash buffer to use.
+    int nextBuffer;
+
+    /// @brief: The number of tiles that the hash buffers were allocated for.
+    int tileCount;
+
+    /// @brief: The hashes of the last completed frame.
+    std::vector<uint32_t> previousHashes;
+
+    /// @brief: Guards @see previousHashes, which is written from Metal's completion handlers.
+    std::mutex previousHashesMutex;
+
+    /// @brief: A value indicating whether a completed frame differed from the one before it since the last call to @see consume_changed.
+    std::atomic<bool> changed;
+
+    /// @brief: The number of tiles that differed between the last completed frame and the one before it.
+    std::atomic<int> changedTileCount;
+};
+
+#endif
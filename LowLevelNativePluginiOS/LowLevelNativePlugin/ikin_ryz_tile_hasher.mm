@@ -0,0 +1,389 @@
+//
+//  ikin_ryz_tile_hasher.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_tile_hasher.h"
+
+#import <simd/simd.h>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The source of the hash kernel.
+    /// @remarks: Each thread hashes one tile. Pixels are packed back into the bytes they are stored as, so the hashes match @see hash_tiles.
+    const char* const hashShaderSource = R"(
+        #include <metal_stdlib>
+        using namespace metal;
+
+        constant uint tileSize = 32;
+
+        kernel void hash_tiles_main(texture2d<float, access::read> source [[texture(0)]],
+                                    device uint* hashes [[buffer(0)]],
+                                    constant uint4& region [[buffer(1)]],
+                                    uint2 tile [[thread_position_in_grid]])
+        {
+            // The region is the left, top, width and height of the pixels that are hashed.
+            const uint width = region.z;
+            const uint height = region.w;
+            const uint tilesAcross = (width + tileSize - 1) / tileSize;
+            const uint tilesDown = (height + tileSize - 1) / tileSize;
+
+            if (tile.x >= tilesAcross || tile.y >= tilesDown)
+            {
+                return;
+            }
+
+            const uint left = tile.x * tileSize;
+            const uint top = tile.y * tileSize;
+            const uint tileWidth = min(tileSize, width - left);
+            const uint tileHeight = min(tileSize, height - top);
+
+            uint hash = 0;
+
+            for (uint row = 0; row < tileHeight; ++row)
+            {
+                uint4 sums = 0;
+                uint4 sumsOfSums = 0;
+
+                for (uint group = 0; group < tileWidth; group += 4)
+                {
+                    uint4 pixels = 0;
+
+                    for (uint lane = 0; lane < 4; ++lane)
+                    {
+                        if (group + lane < tileWidth)
+                        {
+                            const float4 color = source.read(region.xy + uint2(left + group + lane, top + row));
+                            pixels[lane] = pack_float_to_unorm4x8(color.bgra);
+                        }
+                    }
+
+                    sums += pixels;
+                    sumsOfSums += sums;
+                }
+
+                const uint rowHash = (sums.x ^ rotate(sumsOfSums.x, 7u)) +
+                                     (sums.y ^ rotate(sumsOfSums.y, 11u)) +
+                                     (sums.z ^ rotate(sumsOfSums.z, 13u)) +
+                                     (sums.w ^ rotate(sumsOfSums.w, 17u));
+
+                hash = rotate(hash, 5u) ^ rowHash;
+            }
+
+            hashes[tile.y * tilesAcross + tile.x] = hash;
+        }
+
+        constant uint copyThreadsDown = 8;
+
+        kernel void copy_changed_tiles_main(texture2d<float, access::read> source [[texture(0)]],
+                                            texture2d<float, access::write> destination [[texture(1)]],
+                                            device const uint* hashes [[buffer(0)]],
+                                            device uint* copiedHashes [[buffer(1)]],
+                                            constant uint4& region [[buffer(2)]],
+                                            uint2 tile [[threadgroup_position_in_grid]],
+                                            uint2 thread [[thread_position_in_threadgroup]])
+        {
+            // The destination holds just the region, so it is written from its top left.
+            const uint width = region.z;
+            const uint height = region.w;
+            const uint tilesAcross = (width + tileSize - 1) / tileSize;
+            const uint tileIndex = tile.y * tilesAcross + tile.x;
+
+            // Every thread of the tile reads the same hashes, so either all of them copy or none do.
+            if (hashes[tileIndex] == copiedHashes[tileIndex])
+            {
+                return;
+            }
+
+            const uint2 topLeft = tile * tileSize;
+
+            for (uint row = thread.y; row < tileSize; row += copyThreadsDown)
+            {
+                const uint2 position = topLeft + uint2(thread.x, row);
+
+                if (position.x < width && position.y < height)
+                {
+                    destination.write(source.read(region.xy + position), position);
+                }
+            }
+
+            // Only remember the new hash once every thread has read the old one.
+            threadgroup_barrier(mem_flags::mem_device);
+
+            if (thread.x == 0 && thread.y == 0)
+            {
+                copiedHashes[tileIndex] = hashes[tileIndex];
+            }
+        }
+    )";
+
+    /// @brief: The width and height of the threadgroups the hash kernel is dispatched in.
+    const NSUInteger threadgroupSize = 8;
+
+    /// @brief: The number of rows of threads that copy each tile. Each thread copies every eighth pixel of its column.
+    const NSUInteger copyThreadsDown = 8;
+
+    /// @brief: Packs a region into the left, top, width and height that the kernels read it as.
+    /// @param region The region, in pixels.
+    /// @returns: The packed region.
+    simd_uint4 region_bounds(const MTLRegion& region)
+    {
+        return simd_make_uint4((uint32_t)region.origin.x, (uint32_t)region.origin.y, (uint32_t)region.size.width, (uint32_t)region.size.height);
+    }
+}
+
+/// @brief: Compiles the hash kernel and creates the pipeline objects.
+/// @param device The Metal device that Unity renders with.
+/// @returns: True if the hasher is ready to encode, otherwise false.
+bool ikin_ryz_tile_hasher::initialize(id<MTLDevice> device)
+{
+    // If the pipeline already exists, then there is nothing to do.
+    if (pipelineState != nil)
+    {
+        return true;
+    }
+
+    NSError* error = nil;
+
+    // Compile the kernel.
+    id<MTLLibrary> library = [device newLibraryWithSource : [NSString stringWithUTF8String : hashShaderSource]
+                                                  options : nil
+                                                    error : &error];
+
+    if (library == nil)
+    {
+        return false;
+    }
+
+    pipelineState = [device newComputePipelineStateWithFunction : [library newFunctionWithName : @"hash_tiles_main"]
+                                                          error : &error];
+
+    copyPipelineState = [device newComputePipelineStateWithFunction : [library newFunctionWithName : @"copy_changed_tiles_main"]
+                                                              error : &error];
+
+    reset();
+
+    return pipelineState != nil && copyPipelineState != nil;
+}
+
+/// @brief: Releases the pipeline objects and hash buffers.
+void ikin_ryz_tile_hasher::release()
+{
+    pipelineState = nil;
+    copyPipelineState = nil;
+    copiedHashBuffer = nil;
+    copiedDestination = nil;
+
+    for (int buffer = 0; buffer < bufferCount; ++buffer)
+    {
+        hashBuffers[buffer] = nil;
+    }
+
+    tileCount = 0;
+}
+
+/// @brief: Gets a value indicating whether the hasher is ready to encode.
+/// @returns: True if the hasher is ready, otherwise false.
+bool ikin_ryz_tile_hasher::is_initialized() const
+{
+    return pipelineState != nil;
+}
+
+/// @brief: Encodes a pass that hashes the tiles of the source texture, and compares them to the previous hashes once the GPU is done.
+/// @param commandBuffer The command buffer the pass is encoded into. Must not have been committed yet.
+/// @param source The texture that is hashed. Must be readable by shaders.
+/// @param region The region of the texture that is hashed, in pixels.
+void ikin_ryz_tile_hasher::encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const MTLRegion& region)
+{
+    encode_hashes(commandBuffer, source, region);
+}
+
+/// @brief: Encodes passes that hash the tiles of the source texture, and copy the tiles that changed since the last copy into the destination.
+/// @param commandBuffer The command buffer the passes are encoded into. Must not have been committed yet.
+/// @param source The texture that is hashed and copied. Must be readable by shaders.
+/// @param region The region of the texture that is hashed and copied, in pixels.
+/// @param destination The texture that keeps the last copied image. Must be the size of the region, writable by shaders and in a format a blit can copy the source into.
+/// @remarks: The hashes are also compared to the previous frame's, the same as @see encode does.
+void ikin_ryz_tile_hasher::encode_with_damage_copy(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const MTLRegion& region, id<MTLTexture> destination)
+{
+    id<MTLBuffer> hashBuffer = encode_hashes(commandBuffer, source, region);
+
+    // If this frame couldn't be hashed, or the destination holds nothing that can be compared against, then copy all of it.
+    if (hashBuffer == nil || destination != copiedDestination || copiedHashBuffer.length != hashBuffer.length)
+    {
+        id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+
+        [blitEncoder copyFromTexture : source
+                         sourceSlice : 0
+                         sourceLevel : 0
+                        sourceOrigin : region.origin
+                          sourceSize : region.size
+                           toTexture : destination
+                    destinationSlice : 0
+                    destinationLevel : 0
+                   destinationOrigin : MTLOriginMake(0, 0, 0)];
+
+        // Remember which hashes the destination now holds, so that the next frame only copies what changes.
+        if (hashBuffer != nil)
+        {
+            copiedHashBuffer = [commandBuffer.device newBufferWithLength : hashBuffer.length
+                                                                 options : MTLResourceStorageModePrivate];
+
+            [blitEncoder copyFromBuffer : hashBuffer
+                           sourceOffset : 0
+                               toBuffer : copiedHashBuffer
+                      destinationOffset : 0
+                                   size : hashBuffer.length];
+
+            copiedDestination = destination;
+        }
+        else
+        {
+            copiedDestination = nil;
+        }
+
+        [blitEncoder endEncoding];
+
+        return;
+    }
+
+    const simd_uint4 regionBounds = region_bounds(region);
+
+    id<MTLComputeCommandEncoder> computeEncoder = [commandBuffer computeCommandEncoder];
+
+    [computeEncoder setComputePipelineState : copyPipelineState];
+    [computeEncoder setTexture : source atIndex : 0];
+    [computeEncoder setTexture : destination atIndex : 1];
+    [computeEncoder setBuffer : hashBuffer offset : 0 atIndex : 0];
+    [computeEncoder setBuffer : copiedHashBuffer offset : 0 atIndex : 1];
+    [computeEncoder setBytes : &regionBounds length : sizeof(regionBounds) atIndex : 2];
+
+    // Dispatch one threadgroup per tile. Tiles whose hash did not change return straight away.
+    [computeEncoder dispatchThreadgroups : MTLSizeMake((region.size.width + tileHashTileSize - 1) / tileHashTileSize,
+                                                       (region.size.height + tileHashTileSize - 1) / tileHashTileSize,
+                                                       1)
+                   threadsPerThreadgroup : MTLSizeMake(tileHashTileSize, copyThreadsDown, 1)];
+
+    [computeEncoder endEncoding];
+}
+
+/// @brief: Encodes a pass that hashes the tiles of the source texture into the next hash buffer.
+/// @param commandBuffer The command buffer the pass is encoded into. Must not have been committed yet.
+/// @param source The texture that is hashed. Must be readable by shaders.
+/// @param region The region of the texture that is hashed, in pixels.
+/// @returns: The buffer the hashes are written into, or nil if the GPU is still using every hash buffer.
+id<MTLBuffer> ikin_ryz_tile_hasher::encode_hashes(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const MTLRegion& region)
+{
+    const int width = (int)region.size.width;
+    const int height = (int)region.size.height;
+    const int sourceTileCount = tile_hash_count(width, height);
+
+    // If the texture was resized, then reallocate the hash buffers to match.
+    // Buffers still in flight are kept alive by their command buffers.
+    if (sourceTileCount != tileCount)
+    {
+        for (int buffer = 0; buffer < bufferCount; ++buffer)
+        {
+            hashBuffers[buffer] = [commandBuffer.device newBufferWithLength : sourceTileCount * sizeof(uint32_t)
+                                                                    options : MTLResourceStorageModeShared];
+            bufferInUse[buffer] = false;
+        }
+
+        tileCount = sourceTileCount;
+        reset();
+    }
+
+    const int bufferIndex = nextBuffer;
+    nextBuffer = (nextBuffer + 1) % bufferCount;
+
+    // If the GPU is further behind than there are buffers, then this frame can't be hashed.
+    // Treat it as changed, since it can't be proven otherwise.
+    if (bufferInUse[bufferIndex].exchange(true))
+    {
+        changed = true;
+        return nil;
+    }
+
+    id<MTLBuffer> hashBuffer = hashBuffers[bufferIndex];
+
+    id<MTLComputeCommandEncoder> computeEncoder = [commandBuffer computeCommandEncoder];
+
+    [computeEncoder setComputePipelineState : pipelineState];
+    [computeEncoder setTexture : source atIndex : 0];
+    [computeEncoder setBuffer : hashBuffer offset : 0 atIndex : 0];
+
+    const simd_uint4 regionBounds = region_bounds(region);
+    [computeEncoder setBytes : &regionBounds length : sizeof(regionBounds) atIndex : 1];
+
+    // Dispatch one thread per tile, rounded up to whole threadgroups. The kernel ignores the threads past the last tile.
+    const NSUInteger tilesAcross = (width + tileHashTileSize - 1) / tileHashTileSize;
+    const NSUInteger tilesDown = (height + tileHashTileSize - 1) / tileHashTileSize;
+
+    [computeEncoder dispatchThreadgroups : MTLSizeMake((tilesAcross + threadgroupSize - 1) / threadgroupSize,
+                                                       (tilesDown + threadgroupSize - 1) / threadgroupSize,
+                                                       1)
+                   threadsPerThreadgroup : MTLSizeMake(threadgroupSize, threadgroupSize, 1)];
+
+    [computeEncoder endEncoding];
+
+    // Once the GPU is done, compare the hashes to the previous frame's and give the buffer back.
+    const int hashCount = sourceTileCount;
+
+    [commandBuffer addCompletedHandler : ^(id<MTLCommandBuffer> completedCommandBuffer)
+    {
+        compare_hashes((const uint32_t*)hashBuffer.contents, hashCount);
+
+        bufferInUse[bufferIndex] = false;
+    }];
+
+    return hashBuffer;
+}
+
+/// @brief: Gets whether any hashed frame has differed from the one before it since the last call, and clears it.
+/// @returns: True if the contents changed, or may have changed, since the last call. Otherwise false.
+bool ikin_ryz_tile_hasher::consume_changed()
+{
+    return changed.exchange(false);
+}
+
+/// @brief: Gets the number of tiles that differed between the last completed frame and the one before it.
+/// @returns: The number of tiles. Lags the submitted frames by one or two frames, the same as @see consume_changed.
+int ikin_ryz_tile_hasher::last_changed_tile_count() const
+{
+    return changedTileCount;
+}
+
+/// @brief: Forgets the previous hashes, so that the next call to @see consume_changed reports a change.
+void ikin_ryz_tile_hasher::reset()
+{
+    std::lock_guard<std::mutex> guard(previousHashesMutex);
+
+    previousHashes.clear();
+    changed = true;
+}
+
+/// @brief: Compares the hashes of a completed frame to the previous hashes, and keeps them for the next comparison.
+/// @param hashes The hashes of the completed frame.
+/// @param hashCount The number of hashes.
+void ikin_ryz_tile_hasher::compare_hashes(const uint32_t* hashes, int hashCount)
+{
+    std::lock_guard<std::mutex> guard(previousHashesMutex);
+
+    // Count the tiles that differ, so the damage copies can be measured.
+    const int changedTiles = count_changed_tiles(previousHashes.data(), (int)previousHashes.size(), hashes, hashCount);
+
+    // If any tile differs from the last completed frame, then the frame changed.
+    if (changedTiles != 0)
+    {
+        previousHashes.assign(hashes, hashes + hashCount);
+        changedTileCount = changedTiles;
+        changed = true;
+    }
+    else
+    {
+        changedTileCount = 0;
+    }
+}
@@ -0,0 +1,433 @@
+//
+//  ikin_ryz_timeline.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_timeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+std::atomic<bool> timelineRecording(false);
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The sequence of a slot while an event is being written into it.
+    const uint64_t timelineSlotBusy = UINT64_MAX;
+
+    /// @brief: An event in the timeline's ring.
+    /// @remarks: The sequence is the number of the event plus one once it is written, so an exporter can tell a whole event from one that is being overwritten.
+    /// The fields are relaxed atomics, which cost the same as plain stores, so that reading a slot while it is overwritten is only ever stale rather than undefined.
+    struct timeline_slot
+    {
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> timestamp;
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> flowId;
+        std::atomic<uint32_t> thread;
+        std::atomic<uint8_t> type;
+    };
+
+    /// @brief: A copy of an event, taken by the exporter.
+    struct timeline_event
+    {
+        uint64_t timestamp;
+        const char* name;
+        uint64_t flowId;
+        uint32_t thread;
+        timeline_event_type type;
+    };
+
+    /// @brief: A thread that recorded events.
+    struct timeline_thread
+    {
+        std::atomic<uint64_t> osThreadId;
+        std::atomic<const char*> name;
+    };
+
+    /// @brief: Serializes starting, stopping and exporting, so that the ring isn't replaced while it is read.
+    std::mutex timelineMutex;
+
+    std::unique_ptr<timeline_slot[]> timelineSlots;
+    size_t timelineMask = 0;
+
+    /// @brief: The number of the next event. Writers reserve their slot by moving it on.
+    std::atomic<uint64_t> timelineNext(0);
+
+    /// @brief: The number of threads that are writing an event, which replacing the ring waits for.
+    std::atomic<int> timelineWriters(0);
+
+    timeline_thread timelineThreads[maxTimelineThreads];
+    std::atomic<int> timelineThreadCount(0);
+
+    /// @brief: The track of the calling thread, or -1 before it records anything.
+    thread_local int timelineThreadIndex = -1;
+
+    /// @brief: The pipe that the signal handler wakes the exporting thread through.
+    int signalPipe[2] = { -1, -1 };
+    std::string signalExportPath;
+
+    /// @brief: Gets the id the operating system gives the calling thread, which system traces show.
+    uint64_t get_os_thread_id()
+    {
+#if defined(__APPLE__)
+        uint64_t threadId = 0;
+        pthread_threadid_np(nullptr, &threadId);
+        return threadId;
+#elif defined(__linux__)
+        return (uint64_t)syscall(SYS_gettid);
+#else
+        return (uint64_t)pthread_self();
+#endif
+    }
+
+    /// @brief: Gets the track of the calling thread, giving it one the first time.
+    int get_timeline_thread()
+    {
+        if (timelineThreadIndex < 0)
+        {
+            timelineThreadIndex = std::min(timelineThreadCount.fetch_add(1), maxTimelineThreads - 1);
+            timelineThreads[timelineThreadIndex].osThreadId.store(get_os_thread_id());
+        }
+
+        return timelineThreadIndex;
+    }
+
+    /// @brief: Gets the time on the monotonic clock, in nanoseconds.
+    uint64_t timeline_now()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// @brief: Writes a string as a JSON string, escaping what has to be.
+    void write_json_string(FILE* file, const char* text)
+    {
+        fputc('"', file);
+
+        for (const char* character = text; *character != '\0'; ++character)
+        {
+            if (*character == '"' || *character == '\\')
+            {
+                fputc('\\', file);
+                fputc(*character, file);
+            }
+            else if ((unsigned char)*character < 0x20)
+            {
+                fprintf(file, "\\u%04x", (unsigned)*character);
+            }
+            else
+            {
+                fputc(*character, file);
+            }
+        }
+
+        fputc('"', file);
+    }
+
+    /// @brief: Copies the whole events that are kept, oldest first. Called with the mutex held.
+    void copy_timeline_events(std::vector<timeline_event>& events)
+    {
+        if (!timelineSlots)
+        {
+            return;
+        }
+
+        const uint64_t end = timelineNext.load(std::memory_order_acquire);
+        const uint64_t capacity = timelineMask + 1;
+        const uint64_t begin = end > capacity ? end - capacity : 0;
+
+        events.reserve((size_t)(end - begin));
+
+        for (uint64_t index = begin; index < end; ++index)
+        {
+            const timeline_slot& slot = timelineSlots[index & timelineMask];
+
+            if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+            {
+                continue;
+            }
+
+            timeline_event event =
+            {
+                slot.timestamp.load(std::memory_order_relaxed),
+                slot.name.load(std::memory_order_relaxed),
+                slot.flowId.load(std::memory_order_relaxed),
+                slot.thread.load(std::memory_order_relaxed),
+                (timeline_event_type)slot.type.load(std::memory_order_relaxed)
+            };
+
+            // If a writer lapped the ring while the event was copied, then the copy may be torn.
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.sequence.load(std::memory_order_relaxed) == index + 1)
+            {
+                events.push_back(event);
+            }
+        }
+
+        // Each thread's events are already in order. Sorting by time interleaves the threads, keeping ties in the order they were recorded.
+        std::stable_sort(events.begin(), events.end(), [](const timeline_event& a, const timeline_event& b) { return a.timestamp < b.timestamp; });
+    }
+
+    /// @brief: Wakes the exporting thread. Only does what is safe inside a signal handler.
+    void on_export_signal(int)
+    {
+        const char wake = 1;
+        ssize_t written = write(signalPipe[1], &wake, 1);
+        (void)written;
+    }
+}
+
+void start_timeline(size_t eventCount)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    size_t capacity = 1;
+
+    while (capacity < std::max<size_t>(eventCount, 2))
+    {
+        capacity <<= 1;
+    }
+
+    // If the ring has to be replaced, then wait for the writers that are still in the old one.
+    if (!timelineSlots || capacity != timelineMask + 1)
+    {
+        timelineRecording.store(false);
+
+        while (timelineWriters.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+
+        timelineSlots.reset(new timeline_slot[capacity]);
+
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            timelineSlots[i].sequence.store(0, std::memory_order_relaxed);
+        }
+
+        timelineMask = capacity - 1;
+        timelineNext.store(0);
+    }
+
+    timelineRecording.store(true, std::memory_order_release);
+}
+
+void stop_timeline()
+{
+    timelineRecording.store(false);
+}
+
+bool export_timeline(const char* path)
+{
+    std::vector<timeline_event> events;
+    int bindingDepth[maxTimelineThreads] = {};
+
+    {
+        std::lock_guard<std::mutex> lock(timelineMutex);
+        copy_timeline_events(events);
+    }
+
+    FILE* file = fopen(path, "w");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    const int processId = (int)getpid();
+    const int threadCount = std::min(timelineThreadCount.load(), maxTimelineThreads);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"iKin Ryz plugin\"}}", processId);
+
+    // Name each thread's track, and keep the tracks in the order the threads first recorded.
+    for (int thread = 0; thread < threadCount; ++thread)
+    {
+        const unsigned long long osThreadId = (unsigned long long)timelineThreads[thread].osThreadId.load();
+        const char* name = timelineThreads[thread].name.load();
+
+        fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":", processId, osThreadId);
+
+        if (name != nullptr)
+        {
+            write_json_string(file, name);
+        }
+        else
+        {
+            fprintf(file, "\"Thread %llu\"", osThreadId);
+        }
+
+        fprintf(file, "}}");
+        fprintf(file, ",\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":%d,\"tid\":%llu,\"args\":{\"sort_index\":%d}}", processId, osThreadId, thread);
+    }
+
+    static const char* const phases[] = { "B", "E", "i", "s", "t", "f" };
+
+    for (const timeline_event& event : events)
+    {
+        // The slices that began before the oldest event that was kept have lost their start, so their ends are left out.
+        if (event.type == timeline_slice_begin)
+        {
+            ++bindingDepth[event.thread];
+        }
+        else if (event.type == timeline_slice_end)
+        {
+            if (bindingDepth[event.thread] == 0)
+            {
+                continue;
+            }
+
+            --bindingDepth[event.thread];
+        }
+
+        fprintf(file, ",\n{\"ph\":\"%s\",\"name\":", phases[event.type]);
+        write_json_string(file, event.name);
+        fprintf(file, ",\"cat\":\"%s\",\"ts\":%.3f,\"pid\":%d,\"tid\":%llu",
+                event.type >= timeline_flow_start ? "frame" : "ryz", event.timestamp / 1000.0, processId,
+                (unsigned long long)timelineThreads[event.thread].osThreadId.load());
+
+        if (event.type == timeline_instant)
+        {
+            fprintf(file, ",\"s\":\"t\"");
+        }
+        else if (event.type >= timeline_flow_start)
+        {
+            // Each flow event is bound to the slice it is recorded in, which is what the arrows are drawn between.
+            fprintf(file, ",\"id\":%llu,\"bp\":\"e\"", (unsigned long long)event.flowId);
+        }
+
+        fprintf(file, "}");
+    }
+
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+}
+
+bool export_timeline_on_signal(int signalNumber, const char* path)
+{
+    std::lock_guard<std::mutex> lock(timelineMutex);
+
+    if (signalPipe[0] >= 0 || pipe(signalPipe) != 0)
+    {
+        return false;
+    }
+
+    signalExportPath = path;
+
+    // The thread blocks on the pipe until the handler writes to it, then exports outside of the handler.
+    std::thread([]()
+    {
+        name_timeline_thread("Timeline export");
+
+        char wake;
+
+        while (read(signalPipe[0], &wake, 1) == 1)
+        {
+            if (export_timeline(signalExportPath.c_str()))
+            {
+                fprintf(stderr, "timeline exported to %s\n", signalExportPath.c_str());
+            }
+        }
+    }).detach();
+
+    struct sigaction action = {};
+    action.sa_handler = on_export_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    return sigaction(signalNumber, &action, nullptr) == 0;
+}
+
+void name_timeline_thread(const char* name)
+{
+    timelineThreads[get_timeline_thread()].name.store(name, std::memory_order_relaxed);
+}
+
+void append_timeline_event(timeline_event_type type, const char* name, uint64_t flowId)
+{
+    timelineWriters.fetch_add(1);
+
+    // If the ring is being replaced, then the event is left out.
+    if (!timelineRecording.load())
+    {
+        timelineWriters.fetch_sub(1);
+        return;
+    }
+
+    const uint64_t timestamp = timeline_now();
+    const uint64_t index = timelineNext.fetch_add(1, std::memory_order_relaxed);
+    timeline_slot& slot = timelineSlots[index & timelineMask];
+
+    // Claim the slot before touching it, so an exporter that is reading it sees the change.
+    // If a writer a whole lap behind or ahead holds it, which only happens when the ring is far too small, then the event is left out.
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+    do
+    {
+        if (sequence == timelineSlotBusy || sequence > index)
+        {
+            timelineWriters.fetch_sub(1);
+            return;
+        }
+    }
+    while (!slot.sequence.compare_exchange_weak(sequence, timelineSlotBusy, std::memory_order_relaxed));
+
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.flowId.store(flowId, std::memory_order_relaxed);
+    slot.thread.store((uint32_t)get_timeline_thread(), std::memory_order_relaxed);
+    slot.type.store(type, std::memory_order_relaxed);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+
+    timelineWriters.fetch_sub(1);
+}
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts recording the plugin's markers and frame lifecycle to an in-memory timeline.
+    EXPORT_API void ikinRyzStartTimeline(int eventCount)
+    {
+        start_timeline(eventCount > 0 ? (size_t)eventCount : defaultTimelineEventCount);
+    }
+
+    /// @brief Stops recording the timeline.
+    EXPORT_API void ikinRyzStopTimeline()
+    {
+        stop_timeline();
+    }
+
+    /// @brief Writes the timeline to a file as Chrome trace JSON, which Perfetto opens.
+    EXPORT_API int ikinRyzExportTimeline(const char* path)
+    {
+        return export_timeline(path) ? 1 : 0;
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,157 @@
+//
+//  ikin_ryz_timeline.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_TIMELINE_H
+#define IKIN_RYZ_TIMELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "native_to_unity_notifiers.h"
+
+/// @brief: The number of events the timeline keeps when no other number is given. Older events are overwritten by newer ones.
+const size_t defaultTimelineEventCount = 64 * 1024;
+
+/// @brief: The most threads the timeline names. Threads past this share the last track.
+const int maxTimelineThreads = 64;
+
+/// @brief: The kinds of event on the timeline, which map onto the phases of the Chrome trace format.
+enum timeline_event_type : uint8_t
+{
+    /// @brief: Starts a slice on the thread's track.
+    timeline_slice_begin = 0,
+
+    /// @brief: Ends the innermost slice on the thread's track.
+    timeline_slice_end = 1,
+
+    /// @brief: A moment on the thread's track.
+    timeline_instant = 2,
+
+    /// @brief: Starts a flow arrow from the enclosing slice, such as when a frame is submitted.
+    timeline_flow_start = 3,
+
+    /// @brief: Continues a flow arrow through the enclosing slice, which may be on another thread.
+    timeline_flow_step = 4,
+
+    /// @brief: Ends a flow arrow at the enclosing slice.
+    timeline_flow_end = 5
+};
+
+/// @brief: A value indicating whether the timeline is being recorded, which the hooks check before they record anything.
+extern std::atomic<bool> timelineRecording;
+
+/// @brief: Starts recording the timeline, keeping the newest events in memory.
+/// @param eventCount The number of events to keep, which is rounded up to a power of two. The memory is reserved the first time.
+/// @remarks: Recording again keeps the events that were already recorded, unless the number of events changes.
+void start_timeline(size_t eventCount);
+
+/// @brief: Stops recording the timeline. The events that were recorded can still be exported.
+void stop_timeline();
+
+/// @brief: Writes the events that are kept to a file as Chrome trace JSON, which Perfetto and chrome://tracing open.
+/// @param path The path of the file.
+/// @returns: True if the file was written, otherwise false.
+/// @remarks: Safe to call while the timeline is being recorded. Each thread gets a named track, and each frame's flow events are joined by arrows.
+/// Timestamps are in microseconds of the monotonic clock, so they line up with other traces of the same device taken on that clock.
+bool export_timeline(const char* path);
+
+/// @brief: Exports the timeline to a file whenever the process receives a signal. Meant for host builds, which have no C# to ask for it.
+/// @param signalNumber The signal, such as SIGUSR1.
+/// @param path The path of the file, which is overwritten on each export.
+/// @returns: True if the handler was installed, otherwise false.
+/// @remarks: The handler only wakes a thread that does the export, since writing a file isn't safe inside a signal handler.
+bool export_timeline_on_signal(int signalNumber, const char* path);
+
+/// @brief: Names the track of the calling thread.
+/// @param name The name, which has to stay valid for the life of the process, such as a string literal.
+void name_timeline_thread(const char* name);
+
+/// @brief: Appends an event to the timeline.
+/// @param type The kind of event.
+/// @param name The name of the event, which has to stay valid for the life of the process, such as a string literal.
+/// @param flowId The frame a flow event belongs to, or 0 for other events.
+/// @remarks: Safe to call from any thread. Call it through the inline functions below, so that it costs one load when the timeline isn't recorded.
+void append_timeline_event(timeline_event_type type, const char* name, uint64_t flowId);
+
+/// @brief: Starts a slice on the calling thread's track, if the timeline is being recorded.
+inline void timeline_begin(const char* name)
+{
+    if (timelineRecording.load(std::memory_order_relaxed))
+    {
+        append_timeline_event(timeline_slice_begin, name, 0);
+    }
+}
+
+/// @brief: Ends the innermost slice on the calling thread's track, if the timeline is being recorded.
+inline void timeline_end(const char* name)
+{
+    if (timelineRecording.load(std::memory_order_relaxed))
+    {
+        append_timeline_event(timeline_slice_end, name, 0);
+    }
+}
+
+/// @brief: Marks a moment on the calling thread's track, if the timeline is being recorded.
+inline void timeline_mark(const char* name)
+{
+    if (timelineRecording.load(std::memory_order_relaxed))
+    {
+        append_timeline_event(timeline_instant, name, 0);
+    }
+}
+
+/// @brief: Links the enclosing slice into the flow of a frame, if the timeline is being recorded.
+/// @param type @see timeline_flow_start, @see timeline_flow_step or @see timeline_flow_end.
+/// @param frameIndex The number of the frame, which identifies its flow.
+inline void timeline_flow(timeline_event_type type, uint64_t frameIndex)
+{
+    if (timelineRecording.load(std::memory_order_relaxed))
+    {
+        append_timeline_event(type, "frame", frameIndex);
+    }
+}
+
+/// @brief: Marks a point in the life of a frame with a slice of no length, linked into the frame's flow, if the timeline is being recorded.
+/// @param name The name of the point, such as "GPU complete".
+/// @param type @see timeline_flow_step, or @see timeline_flow_end for the last point of the frame.
+/// @param frameIndex The number of the frame.
+/// @remarks: For callbacks, such as Metal's, that run outside of any slice for a flow to be bound to.
+inline void timeline_milestone(const char* name, timeline_event_type type, uint64_t frameIndex)
+{
+    if (timelineRecording.load(std::memory_order_relaxed))
+    {
+        append_timeline_event(timeline_slice_begin, name, 0);
+        append_timeline_event(type, "frame", frameIndex);
+        append_timeline_event(timeline_slice_end, name, 0);
+    }
+}
+
+// Prevents the functions defined in this block from being name-mangled by C++ compiler.
+// This makes them easy to locate by name, which is needed in order to bind them to C# scripts.
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// @brief Starts recording the plugin's markers and frame lifecycle to an in-memory timeline.
+    /// @param eventCount The number of events to keep, or 0 for @see defaultTimelineEventCount.
+    EXPORT_API void ikinRyzStartTimeline(int eventCount);
+
+    /// @brief Stops recording the timeline.
+    EXPORT_API void ikinRyzStopTimeline();
+
+    /// @brief Writes the timeline to a file as Chrome trace JSON, which Perfetto opens.
+    /// @param path The path of the file.
+    /// @returns: 1 if the file was written, otherwise 0.
+    EXPORT_API int ikinRyzExportTimeline(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
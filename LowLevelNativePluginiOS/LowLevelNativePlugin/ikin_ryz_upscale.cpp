@@ -0,0 +1,315 @@
+//
+//  ikin_ryz_upscale.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_upscale.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ikin_ryz_pixel_simd.h"
+
+using namespace pixel_simd;
+
+// Placed in an anonymous namespace to avoid these functions being accessed outside this file
+namespace
+{
+    /// @brief: The strongest that the sharpen pass sharpens, as the most negative weight a neighbour can have.
+    const float sharpenLimit = 0.25f - 1.0f / 16.0f;
+
+    /// @brief: Gets the approximate luma of four pixels, from 0 to 1.
+    /// @remarks: Red and blue are weighted the same, so it doesn't matter which order they are in.
+    inline lanes luma(const pixel_lanes& value)
+    {
+        return add(add(multiply(value.channel[0], splat(0.25f)), multiply(value.channel[1], splat(0.5f))), multiply(value.channel[2], splat(0.25f)));
+    }
+
+    /// @brief: Gets a value indicating whether a tap of the 4x4 pixels around a point is one of the corners, which aren't blended.
+    inline bool is_corner(int row, int column)
+    {
+        return (row == 0 || row == 3) && (column == 0 || column == 3);
+    }
+}
+
+/// @brief: Upscales a 32-bit image with an edge-adaptive filter, so that edges stay crisp instead of going soft the way bilinear filtering does.
+/// @param source The first row of the image that is upscaled.
+/// @param sourceWidth The width of the source in pixels.
+/// @param sourceHeight The height of the source in pixels.
+/// @param sourceBytesPerRow The distance between the start of two rows of the source, in bytes.
+/// @param destination The first row of the upscaled image.
+/// @param destinationWidth The width of the destination in pixels.
+/// @param destinationHeight The height of the destination in pixels.
+/// @param destinationBytesPerRow The distance between the start of two rows of the destination, in bytes.
+void upscale_easu(const uint8_t* source, int sourceWidth, int sourceHeight, size_t sourceBytesPerRow,
+                  uint8_t* destination, int destinationWidth, int destinationHeight, size_t destinationBytesPerRow)
+{
+    // If the image isn't scaled, then each pixel's center lands on a source pixel's, so it is copied as it is.
+    // The edge-adaptive kernel would otherwise still blend in the neighbours along strong edges.
+    if (sourceWidth == destinationWidth && sourceHeight == destinationHeight)
+    {
+        for (int y = 0; y < destinationHeight; ++y)
+        {
+            memcpy(destination + y * destinationBytesPerRow, source + y * sourceBytesPerRow, (size_t)destinationWidth * 4);
+        }
+
+        return;
+    }
+
+    const float scaleX = (float)sourceWidth / destinationWidth;
+    const float scaleY = (float)sourceHeight / destinationHeight;
+
+    for (int y = 0; y < destinationHeight; ++y)
+    {
+        // Every pixel of the row lands on the same row of the source, so only the columns differ between the lanes.
+        const float positionY = (y + 0.5f) * scaleY - 0.5f;
+        const int baseY = (int)std::floor(positionY);
+        const lanes fractionY = splat(positionY - baseY);
+
+        size_t rowOffsets[4];
+
+        for (int row = 0; row < 4; ++row)
+        {
+            rowOffsets[row] = std::min(std::max(baseY + row - 1, 0), sourceHeight - 1) * sourceBytesPerRow;
+        }
+
+        for (int x = 0; x < destinationWidth; x += 4)
+        {
+            // Find the source pixel to the top left of where each pixel's center lands, and how far past it the center is.
+            const lanes positionX = subtract(multiply(add(lane_offsets(), splat(x + 0.5f)), splat(scaleX)), splat(0.5f));
+            const lanes baseX = round_down(positionX);
+            const lanes fractionX = subtract(positionX, baseX);
+
+            int32_t columnOffsets[4][4];
+
+            for (int column = 0; column < 4; ++column)
+            {
+                store_integers(multiply(clamp(add(baseX, splat(column - 1.0f)), 0.0f, sourceWidth - 1.0f), splat(4.0f)), columnOffsets[column]);
+            }
+
+            // Read the 12 source pixels around each center, leaving out the corners of the 4x4 pixels.
+            pixel_lanes colors[4][4];
+            lanes lumas[4][4];
+
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    if (is_corner(row, column))
+                    {
+                        continue;
+                    }
+
+                    colors[row][column] = gather_pixels(source + rowOffsets[row], columnOffsets[column]);
+                    lumas[row][column] = luma(colors[row][column]);
+                }
+            }
+
+            // Find the direction the luma changes fastest in, from the gradients of the 4 nearest pixels weighted by how near they are.
+            lanes directionX = splat(0.0f);
+            lanes directionY = splat(0.0f);
+
+            for (int row = 1; row <= 2; ++row)
+            {
+                for (int column = 1; column <= 2; ++column)
+                {
+                    const lanes weight = multiply(column == 1 ? subtract(splat(1.0f), fractionX) : fractionX,
+                                                  row == 1 ? subtract(splat(1.0f), fractionY) : fractionY);
+
+                    directionX = add(directionX, multiply(weight, subtract(lumas[row][column + 1], lumas[row][column - 1])));
+                    directionY = add(directionY, multiply(weight, subtract(lumas[row + 1][column], lumas[row - 1][column])));
+                }
+            }
+
+            // Measure the contrast of the 12 pixels that are blended, so that the edge strength doesn't depend on how bright the edge is.
+            lanes lumaMin = splat(1.0f);
+            lanes lumaMax = splat(0.0f);
+
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    if (is_corner(row, column))
+                    {
+                        continue;
+                    }
+
+                    lumaMin = minimum(lumaMin, lumas[row][column]);
+                    lumaMax = maximum(lumaMax, lumas[row][column]);
+                }
+            }
+
+            // A step gives an edge strength near 1, a smooth ramp about half that, and a flat area none.
+            // Where the area is flat, the direction is undefined, so any fixed direction does.
+            const lanes directionLengthSquared = add(multiply(directionX, directionX), multiply(directionY, directionY));
+            const lane_mask flat = less(directionLengthSquared, splat(1.0f / 32768.0f));
+            const lanes directionLength = square_root(directionLengthSquared);
+
+            lanes edge = minimum(divide(directionLength, maximum(subtract(lumaMax, lumaMin), splat(1.0f / 256.0f))), splat(1.0f));
+            edge = select(flat, splat(0.0f), multiply(edge, edge));
+
+            directionX = select(flat, splat(1.0f), divide(directionX, directionLength));
+            directionY = select(flat, splat(0.0f), divide(directionY, directionLength));
+
+            // Squeeze the kernel across the edge and stretch it along the edge, more so the stronger the edge is.
+            const lanes stretch = divide(splat(1.0f), maximum(absolute(directionX), absolute(directionY)));
+            const lanes scaleAcross = add(splat(1.0f), multiply(subtract(stretch, splat(1.0f)), edge));
+            const lanes scaleAlong = subtract(splat(1.0f), multiply(splat(0.5f), edge));
+
+            // Sharpen the window on edges too.
+            const lanes lobe = subtract(splat(0.5f), multiply(splat(0.29f), edge));
+            const lanes clip = divide(splat(1.0f), lobe);
+
+            pixel_lanes sum = { { splat(0.0f), splat(0.0f), splat(0.0f), splat(0.0f) } };
+            lanes weightSum = splat(0.0f);
+
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    if (is_corner(row, column))
+                    {
+                        continue;
+                    }
+
+                    // Rotate the offset to the tap into the frame of the edge, and scale it.
+                    const lanes offsetX = subtract(splat(column - 1.0f), fractionX);
+                    const lanes offsetY = subtract(splat(row - 1.0f), fractionY);
+                    const lanes across = multiply(add(multiply(offsetX, directionX), multiply(offsetY, directionY)), scaleAcross);
+                    const lanes along = multiply(subtract(multiply(offsetY, directionX), multiply(offsetX, directionY)), scaleAlong);
+                    const lanes distanceSquared = minimum(add(multiply(across, across), multiply(along, along)), clip);
+
+                    // Approximate the windowed Lanczos 2 kernel with polynomials.
+                    lanes base = subtract(multiply(splat(0.4f), distanceSquared), splat(1.0f));
+                    lanes window = subtract(multiply(lobe, distanceSquared), splat(1.0f));
+                    base = multiply(base, base);
+                    window = multiply(window, window);
+                    base = subtract(multiply(splat(1.5625f), base), splat(0.5625f));
+
+                    const lanes weight = multiply(base, window);
+
+                    for (int channel = 0; channel < 4; ++channel)
+                    {
+                        sum.channel[channel] = add(sum.channel[channel], multiply(colors[row][column].channel[channel], weight));
+                    }
+
+                    weightSum = add(weightSum, weight);
+                }
+            }
+
+            // Keep the result within the 4 nearest pixels, so that the negative lobes don't ring.
+            pixel_lanes color;
+
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                const lanes nearestMin = minimum(minimum(colors[1][1].channel[channel], colors[1][2].channel[channel]),
+                                                 minimum(colors[2][1].channel[channel], colors[2][2].channel[channel]));
+                const lanes nearestMax = maximum(maximum(colors[1][1].channel[channel], colors[1][2].channel[channel]),
+                                                 maximum(colors[2][1].channel[channel], colors[2][2].channel[channel]));
+
+                color.channel[channel] = minimum(maximum(divide(sum.channel[channel], weightSum), nearestMin), nearestMax);
+            }
+
+            write_pixels(destination + y * destinationBytesPerRow + x * 4, color, std::min(destinationWidth - x, 4));
+        }
+    }
+}
+
+/// @brief: Sharpens a 32-bit image as much as it can be without any pixel going past its neighbours, so that it doesn't ring or clip.
+/// @param source The first row of the image that is sharpened.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param sourceBytesPerRow The distance between the start of two rows of the source, in bytes.
+/// @param destination The first row of the sharpened image. Must not overlap the source.
+/// @param destinationBytesPerRow The distance between the start of two rows of the destination, in bytes.
+/// @param sharpness How much weaker than the strongest sharpening to sharpen, in stops. 0 is the strongest.
+void sharpen_rcas(const uint8_t* source, int width, int height, size_t sourceBytesPerRow,
+                  uint8_t* destination, size_t destinationBytesPerRow, float sharpness)
+{
+    const float strength = std::exp2(-sharpness);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* row = source + y * sourceBytesPerRow;
+        const uint8_t* rowAbove = source + std::max(y - 1, 0) * sourceBytesPerRow;
+        const uint8_t* rowBelow = source + std::min(y + 1, height - 1) * sourceBytesPerRow;
+
+        for (int x = 0; x < width; x += 4)
+        {
+            const int count = std::min(width - x, 4);
+
+            // Read four pixels and the four pixels that share an edge with each of them.
+            const pixel_lanes above = read_pixels(rowAbove + x * 4, count);
+            const pixel_lanes center = read_pixels(row + x * 4, count);
+            const pixel_lanes below = read_pixels(rowBelow + x * 4, count);
+            pixel_lanes left;
+            pixel_lanes right;
+
+            // If all of the neighbours to the sides are within the row, then they are read as they are stored, otherwise the edges are clamped to.
+            if (x >= 1 && x + 4 < width)
+            {
+                left = read_pixels(row + (x - 1) * 4, 4);
+                right = read_pixels(row + (x + 1) * 4, 4);
+            }
+            else
+            {
+                int32_t leftOffsets[4];
+                int32_t rightOffsets[4];
+
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    leftOffsets[lane] = std::min(std::max(x + lane - 1, 0), width - 1) * 4;
+                    rightOffsets[lane] = std::min(x + lane + 1, width - 1) * 4;
+                }
+
+                left = gather_pixels(row, leftOffsets);
+                right = gather_pixels(row, rightOffsets);
+            }
+
+            pixel_lanes neighbourMin;
+            pixel_lanes neighbourMax;
+            lanes channelLobes[3];
+
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                neighbourMin.channel[channel] = minimum(minimum(above.channel[channel], left.channel[channel]), minimum(right.channel[channel], below.channel[channel]));
+                neighbourMax.channel[channel] = maximum(maximum(above.channel[channel], left.channel[channel]), maximum(right.channel[channel], below.channel[channel]));
+
+                // Find the most negative neighbour weight that keeps the result from going below 0 or above 1, in each color channel.
+                // Alpha has no say in it.
+                if (channel < 3)
+                {
+                    const lanes hitMin = divide(minimum(neighbourMin.channel[channel], center.channel[channel]),
+                                                maximum(multiply(splat(4.0f), neighbourMax.channel[channel]), splat(1.0f / 256.0f)));
+                    const lanes hitMax = divide(subtract(splat(1.0f), maximum(neighbourMax.channel[channel], center.channel[channel])),
+                                                minimum(subtract(multiply(splat(4.0f), neighbourMin.channel[channel]), splat(4.0f)), splat(-1.0f / 256.0f)));
+
+                    channelLobes[channel] = maximum(subtract(splat(0.0f), hitMin), hitMax);
+                }
+            }
+
+            // The color channels share the weight, so that sharpening doesn't shift hues.
+            const lanes largestLobe = maximum(maximum(channelLobes[0], channelLobes[1]), channelLobes[2]);
+            const lanes lobe = multiply(clamp(largestLobe, -sharpenLimit, 0.0f), splat(strength));
+            const lanes weightSum = add(multiply(splat(4.0f), lobe), splat(1.0f));
+
+            pixel_lanes color;
+
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                // Blend the neighbours in with the negative weight.
+                const lanes neighbourSum = add(add(above.channel[channel], left.channel[channel]), add(right.channel[channel], below.channel[channel]));
+                const lanes blended = divide(add(multiply(neighbourSum, lobe), center.channel[channel]), weightSum);
+
+                // Keep the result within the pixel and its neighbours, so that an edge between two greys doesn't ring past either of them.
+                color.channel[channel] = minimum(maximum(blended, minimum(neighbourMin.channel[channel], center.channel[channel])),
+                                                 maximum(neighbourMax.channel[channel], center.channel[channel]));
+            }
+
+            write_pixels(destination + y * destinationBytesPerRow + x * 4, color, count);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+//
+//  ikin_ryz_upscale.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_UPSCALE_H
+#define IKIN_RYZ_UPSCALE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief: The sharpness that the upscaled Ryz eye is sharpened with unless the application sets another, in stops below the strongest sharpening.
+const float defaultUpscaleSharpness = 0.2f;
+
+/// @brief: Upscales a 32-bit image with an edge-adaptive filter, so that edges stay crisp instead of going soft the way bilinear filtering does.
+/// @param source The first row of the image that is upscaled.
+/// @param sourceWidth The width of the source in pixels.
+/// @param sourceHeight The height of the source in pixels.
+/// @param sourceBytesPerRow The distance between the start of two rows of the source, in bytes.
+/// @param destination The first row of the upscaled image.
+/// @param destinationWidth The width of the destination in pixels.
+/// @param destinationHeight The height of the destination in pixels.
+/// @param destinationBytesPerRow The distance between the start of two rows of the destination, in bytes.
+/// @remarks: This is the CPU reference of the upscale pass the upscaler runs on the GPU, and follows the same steps.
+/// Each destination pixel is a windowed Lanczos blend of the 12 nearest source pixels, with the kernel stretched along the local edge
+/// and squeezed across it, then clamped to the 4 nearest source pixels so that it doesn't ring. An image that isn't scaled is copied as it is.
+/// Four pixels are processed at a time, with a lane of an SSE2 or NEON vector for each when the compiler targets them.
+void upscale_easu(const uint8_t* source, int sourceWidth, int sourceHeight, size_t sourceBytesPerRow,
+                  uint8_t* destination, int destinationWidth, int destinationHeight, size_t destinationBytesPerRow);
+
+/// @brief: Sharpens a 32-bit image as much as it can be without any pixel going past its neighbours, so that it doesn't ring or clip.
+/// @param source The first row of the image that is sharpened.
+/// @param width The width of the image in pixels.
+/// @param height The height of the image in pixels.
+/// @param sourceBytesPerRow The distance between the start of two rows of the source, in bytes.
+/// @param destination The first row of the sharpened image. Must not overlap the source.
+/// @param destinationBytesPerRow The distance between the start of two rows of the destination, in bytes.
+/// @param sharpness How much weaker than the strongest sharpening to sharpen, in stops. 0 is the strongest.
+/// @remarks: This is the CPU reference of the sharpen pass the upscaler runs on the GPU, and follows the same steps.
+/// Four pixels are processed at a time, with a lane of an SSE2 or NEON vector for each when the compiler targets them.
+void sharpen_rcas(const uint8_t* source, int width, int height, size_t sourceBytesPerRow,
+                  uint8_t* destination, size_t destinationBytesPerRow, float sharpness);
+
+#endif
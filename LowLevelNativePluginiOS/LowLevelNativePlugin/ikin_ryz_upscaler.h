@@ -0,0 +1,66 @@
+//
+//  ikin_ryz_upscaler.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#ifndef IKIN_RYZ_UPSCALER_H
+#define IKIN_RYZ_UPSCALER_H
+
+#import <Metal/Metal.h>
+#import <simd/simd.h>
+
+#include "ikin_ryz_compositor.h"
+#include "ikin_ryz_settings.h"
+
+/// @brief: Draws a Ryz eye texture that was rendered smaller than the display into its drawable, reconstructing edges as it scales it up.
+/// @remarks: Used in place of the compose pass when the Ryz eye is rendered at a reduced scale, and applies the same calibration steps.
+/// An edge-adaptive upscale pass draws into an intermediate texture the size of the drawable, then a sharpen pass draws that into the drawable.
+/// The passes produce the same values as @see upscale_easu and @see sharpen_rcas.
+class ikin_ryz_upscaler
+{
+public:
+    /// @brief: Compiles the shaders and creates the pipeline objects.
+    /// @param device The Metal device that Unity renders with.
+    /// @param destinationPixelFormat The pixel format of the textures the upscaler draws into.
+    /// @returns: True if the upscaler is ready to encode upscale passes, otherwise false.
+    bool initialize(id<MTLDevice> device, MTLPixelFormat destinationPixelFormat);
+
+    /// @brief: Releases the pipeline objects and the intermediate texture.
+    void release();
+
+    /// @brief: Gets a value indicating whether the upscaler is ready to encode upscale passes.
+    /// @returns: True if the upscaler is ready, otherwise false.
+    bool is_initialized() const;
+
+    /// @brief: Gets the memory held by the intermediate texture.
+    /// @returns: The size of the texture in bytes, or zero if it hasn't been created.
+    uint64_t allocated_bytes() const;
+
+    /// @brief: Encodes the passes that upscale a region of the source texture over the whole destination texture.
+    /// @param commandBuffer The command buffer the passes are encoded into.
+    /// @param source The texture that is upscaled.
+    /// @param sourceRect The region of the source that is drawn, in homogeneous coordinates with their origin at the top left.
+    /// @param destination The texture that is drawn into.
+    /// @param orientation How the source is flipped or rotated as it is drawn.
+    /// @param sharpness How much weaker than the strongest sharpening to sharpen, in stops.
+    /// @param distortionMesh The distortion mesh of the display, from @see ikin_ryz_distortion_map, or nil to draw the source undistorted.
+    /// @param colorLut The color lookup table of the display, from @see ikin_ryz_color_lut_map, or nil to draw the source colors as they are.
+    void encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const normalized_rect& sourceRect, id<MTLTexture> destination, eye_orientation orientation, float sharpness, id<MTLTexture> distortionMesh, id<MTLTexture> colorLut);
+
+private:
+    /// @brief: The pipelines that upscale the source into the intermediate texture, indexed by @see compose_variant.
+    id<MTLRenderPipelineState> upscalePipelineStates[compose_variant_count];
+
+    /// @brief: The pipelines that sharpen the intermediate texture into the destination, indexed by @see compose_variant.
+    id<MTLRenderPipelineState> sharpenPipelineStates[compose_variant_count];
+
+    /// @brief: The upscaled image, before it is sharpened. Recreated when the destination changes size.
+    id<MTLTexture> upscaledTexture;
+
+    /// @brief: The pixel format that the pipelines were created for.
+    MTLPixelFormat pixelFormat;
+};
+
+#endif
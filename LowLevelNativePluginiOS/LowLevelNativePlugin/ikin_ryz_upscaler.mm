@@ -0,0 +1,444 @@
+//
+//  ikin_ryz_upscaler.mm
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ikin_ryz_upscaler.h"
+
+#include <cmath>
+
+#include "ikin_ryz_compositor.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The source of the upscale shaders.
+    /// @remarks: The plugin is a static library, so the shaders are compiled at runtime instead of shipping a Metal library with it.
+    /// Both passes draw a triangle that covers the whole destination, the same as the compose pass.
+    /// Texels are read rather than sampled, since the filters weigh each one themselves, and reads are clamped to the drawn region so nothing outside it bleeds in.
+    /// It is compiled after @see compose_calibration_shader_source, which it corrects distortion and calibrates colors with.
+    const char* const upscaleShaderSource = R"(
+        struct upscale_vertex
+        {
+            float4 position [[position]];
+            float2 uv;
+        };
+
+        struct upscale_params
+        {
+            float4 uvTransform;
+            float2 sourceSize;
+            int2 sourceMin;
+            int2 sourceMax;
+        };
+
+        struct sharpen_params
+        {
+            float strength;
+        };
+
+        vertex upscale_vertex upscale_vertex_main(uint vertexId [[vertex_id]])
+        {
+            float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+
+            upscale_vertex out;
+            out.position = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+            out.uv = uv;
+
+            return out;
+        }
+
+        float luma(float4 color)
+        {
+            return color.r * 0.25 + color.g * 0.5 + color.b * 0.25;
+        }
+
+        fragment float4 upscale_fragment_main(upscale_vertex in [[stage_in]],
+                                              texture2d<float, access::read> source [[texture(0)]],
+                                              texture2d<float, access::read> distortionMesh [[texture(1), function_constant(distortionCorrection)]],
+                                              constant upscale_params& params [[buffer(0)]])
+        {
+            float2 imageUv = in.uv;
+
+            // If the optics distort the image, then reconstruct the point of the image that looks right through them instead.
+            if (distortionCorrection)
+            {
+                imageUv = sample_distortion_mesh(distortionMesh, in.uv);
+
+                if (is_outside_image(imageUv))
+                {
+                    return float4(0.0, 0.0, 0.0, 1.0);
+                }
+            }
+
+            // Find the source pixel to the top left of where this pixel's center lands, and how far past it the center is.
+            const float2 position = (imageUv * params.uvTransform.xy + params.uvTransform.zw) * params.sourceSize - 0.5;
+            const float2 base = floor(position);
+            const float2 fraction = position - base;
+
+            // Read the 4x4 source pixels around it. The corners are only read to keep the indexing simple.
+            float4 colors[4][4];
+            float lumas[4][4];
+
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    const int2 texel = clamp(int2(base) + int2(column - 1, row - 1), params.sourceMin, params.sourceMax);
+
+                    colors[row][column] = source.read(uint2(texel));
+                    lumas[row][column] = luma(colors[row][column]);
+                }
+            }
+
+            // Find the direction the luma changes fastest in, from the gradients of the 4 nearest pixels weighted by how near they are.
+            float2 direction = float2(0.0);
+
+            for (int row = 1; row <= 2; ++row)
+            {
+                for (int column = 1; column <= 2; ++column)
+                {
+                    const float weight = (column == 1 ? 1.0 - fraction.x : fraction.x) * (row == 1 ? 1.0 - fraction.y : fraction.y);
+
+                    direction += weight * float2(lumas[row][column + 1] - lumas[row][column - 1],
+                                                 lumas[row + 1][column] - lumas[row - 1][column]);
+                }
+            }
+
+            // Measure the contrast of the 12 pixels that are blended.
+            float lumaMin = 1.0;
+            float lumaMax = 0.0;
+
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    if ((row == 0 || row == 3) && (column == 0 || column == 3))
+                    {
+                        continue;
+                    }
+
+                    lumaMin = min(lumaMin, lumas[row][column]);
+                    lumaMax = max(lumaMax, lumas[row][column]);
+                }
+            }
+
+            const float directionLengthSquared = dot(direction, direction);
+            float edge = 0.0;
+
+            if (directionLengthSquared < 1.0 / 32768.0)
+            {
+                direction = float2(1.0, 0.0);
+            }
+            else
+            {
+                const float directionLength = sqrt(directionLengthSquared);
+
+                edge = min(directionLength / max(lumaMax - lumaMin, 1.0 / 256.0), 1.0);
+                edge *= edge;
+
+                direction /= directionLength;
+            }
+
+            // Squeeze the kernel across the edge, stretch it along the edge, and sharpen its window, more so the stronger the edge is.
+            const float stretch = 1.0 / max(abs(direction.x), abs(direction.y));
+            const float2 scale = float2(1.0 + (stretch - 1.0) * edge, 1.0 - 0.5 * edge);
+            const float lobe = 0.5 - 0.29 * edge;
+            const float clip = 1.0 / lobe;
+
+            float4 sum = float4(0.0);
+            float weightSum = 0.0;
+
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int column = 0; column < 4; ++column)
+                {
+                    if ((row == 0 || row == 3) && (column == 0 || column == 3))
+                    {
+                        continue;
+                    }
+
+                    const float2 offset = float2(column - 1, row - 1) - fraction;
+                    const float2 rotated = float2(dot(offset, direction), offset.y * direction.x - offset.x * direction.y) * scale;
+                    const float distanceSquared = min(dot(rotated, rotated), clip);
+
+                    // Approximate the windowed Lanczos 2 kernel with polynomials.
+                    float base = 0.4 * distanceSquared - 1.0;
+                    float window = lobe * distanceSquared - 1.0;
+                    base *= base;
+                    window *= window;
+                    base = 1.5625 * base - 0.5625;
+
+                    const float weight = base * window;
+
+                    sum += colors[row][column] * weight;
+                    weightSum += weight;
+                }
+            }
+
+            // Keep the result within the 4 nearest pixels, so that the negative lobes don't ring.
+            const float4 nearestMin = min(min(colors[1][1], colors[1][2]), min(colors[2][1], colors[2][2]));
+            const float4 nearestMax = max(max(colors[1][1], colors[1][2]), max(colors[2][1], colors[2][2]));
+
+            return clamp(sum / weightSum, nearestMin, nearestMax);
+        }
+
+        fragment float4 sharpen_fragment_main(upscale_vertex in [[stage_in]],
+                                              texture2d<float, access::read> source [[texture(0)]],
+                                              texture3d<float, access::read> colorLut [[texture(2), function_constant(colorCalibration)]],
+                                              constant sharpen_params& params [[buffer(0)]])
+        {
+            const int2 size = int2(source.get_width(), source.get_height());
+            const int2 texel = int2(in.position.xy);
+
+            // Read the pixel and the four pixels that share an edge with it.
+            const float4 above = source.read(uint2(clamp(texel + int2(0, -1), int2(0), size - 1)));
+            const float4 left = source.read(uint2(clamp(texel + int2(-1, 0), int2(0), size - 1)));
+            const float4 center = source.read(uint2(texel));
+            const float4 right = source.read(uint2(clamp(texel + int2(1, 0), int2(0), size - 1)));
+            const float4 below = source.read(uint2(clamp(texel + int2(0, 1), int2(0), size - 1)));
+
+            const float4 neighbourMin = min(min(above, left), min(right, below));
+            const float4 neighbourMax = max(max(above, left), max(right, below));
+
+            // Find the most negative neighbour weight that keeps the result from going below 0 or above 1, in each channel.
+            const float4 hitMin = min(neighbourMin, center) / max(4.0 * neighbourMax, 1.0 / 256.0);
+            const float4 hitMax = (1.0 - max(neighbourMax, center)) / min(4.0 * neighbourMin - 4.0, -1.0 / 256.0);
+            const float4 lobes = max(-hitMin, hitMax);
+
+            // The color channels share the weight, so that sharpening doesn't shift hues.
+            const float lobe = max(-0.1875, min(max(max(lobes.r, lobes.g), lobes.b), 0.0)) * params.strength;
+
+            float4 color = ((above + left + right + below) * lobe + center) / (4.0 * lobe + 1.0);
+
+            // Keep the result within the pixel and its neighbours, so that an edge between two greys doesn't ring past either of them.
+            color = clamp(color, min(neighbourMin, center), max(neighbourMax, center));
+
+            // If the panel's colors are off, then drive it with the colors that look right on it instead.
+            if (colorCalibration)
+            {
+                color.rgb = apply_color_lut(colorLut, color.rgb);
+            }
+
+            return color;
+        }
+    )";
+
+    /// @brief: The values the upscale shader is given. Must match upscale_params in the shader source.
+    struct upscale_params
+    {
+        simd_float4 uvTransform;
+        simd_float2 sourceSize;
+        simd_int2 sourceMin;
+        simd_int2 sourceMax;
+    };
+
+    /// @brief: The values the sharpen shader is given. Must match sharpen_params in the shader source.
+    struct sharpen_params
+    {
+        float strength;
+    };
+
+    /// @brief: Encodes a pass that draws a full-screen triangle into a texture.
+    /// @param commandBuffer The command buffer the pass is encoded into.
+    /// @param pipelineState The pipeline that draws the triangle.
+    /// @param source The texture that the fragment shader reads.
+    /// @param params The values the fragment shader is given.
+    /// @param paramsLength The size of the values, in bytes.
+    /// @param destination The texture that is drawn into.
+    /// @param distortionMesh The distortion mesh of the display, or nil.
+    /// @param colorLut The color lookup table of the display, or nil.
+    void encode_full_screen_pass(id<MTLCommandBuffer> commandBuffer,
+                                 id<MTLRenderPipelineState> pipelineState,
+                                 id<MTLTexture> source,
+                                 const void* params,
+                                 size_t paramsLength,
+                                 id<MTLTexture> destination,
+                                 id<MTLTexture> distortionMesh,
+                                 id<MTLTexture> colorLut)
+    {
+        // Every pixel of the destination is overwritten, so its previous contents don't need to be loaded.
+        MTLRenderPassDescriptor* renderPassDescriptor = [MTLRenderPassDescriptor renderPassDescriptor];
+        renderPassDescriptor.colorAttachments[0].texture = destination;
+        renderPassDescriptor.colorAttachments[0].loadAction = MTLLoadActionDontCare;
+        renderPassDescriptor.colorAttachments[0].storeAction = MTLStoreActionStore;
+
+        id<MTLRenderCommandEncoder> renderEncoder = [commandBuffer renderCommandEncoderWithDescriptor : renderPassDescriptor];
+
+        [renderEncoder setRenderPipelineState : pipelineState];
+        [renderEncoder setFragmentTexture : source atIndex : 0];
+        [renderEncoder setFragmentTexture : distortionMesh atIndex : 1];
+        [renderEncoder setFragmentTexture : colorLut atIndex : 2];
+        [renderEncoder setFragmentBytes : params length : paramsLength atIndex : 0];
+
+        // Draw the full-screen triangle.
+        [renderEncoder drawPrimitives : MTLPrimitiveTypeTriangle
+                          vertexStart : 0
+                          vertexCount : 3];
+
+        [renderEncoder endEncoding];
+    }
+}
+
+/// @brief: Compiles the shaders and creates the pipeline objects.
+/// @param device The Metal device that Unity renders with.
+/// @param destinationPixelFormat The pixel format of the textures the upscaler draws into.
+/// @returns: True if the upscaler is ready to encode upscale passes, otherwise false.
+bool ikin_ryz_upscaler::initialize(id<MTLDevice> device, MTLPixelFormat destinationPixelFormat)
+{
+    // If the pipelines already target this format, then there is nothing to do.
+    if (upscalePipelineStates[compose_variant_none] != nil && pixelFormat == destinationPixelFormat)
+    {
+        return true;
+    }
+
+    release();
+
+    NSError* error = nil;
+
+    // Compile the shaders.
+    NSString* shaderSource = [compose_calibration_shader_source() stringByAppendingString : [NSString stringWithUTF8String : upscaleShaderSource]];
+
+    id<MTLLibrary> library = [device newLibraryWithSource : shaderSource
+                                                  options : nil
+                                                    error : &error];
+
+    if (library == nil)
+    {
+        return false;
+    }
+
+    // Both passes draw the same full-screen triangle, with a different fragment shader.
+    // The intermediate texture is created in the destination format, so both draw into the same format.
+    MTLRenderPipelineDescriptor* pipelineDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
+    pipelineDescriptor.vertexFunction = [library newFunctionWithName : @"upscale_vertex_main"];
+    pipelineDescriptor.colorAttachments[0].pixelFormat = destinationPixelFormat;
+
+    // Each combination of calibration steps gets its own pipelines, the same as in the compose pass.
+    // Distortion is corrected as the image is upscaled, so the sharpen pass works on what is seen through the optics.
+    // Colors are calibrated after sharpening, so the sharpen pass works on the colors the application rendered.
+    for (int variant = 0; variant < compose_variant_count; ++variant)
+    {
+        MTLFunctionConstantValues* constantValues = compose_function_constants(variant);
+
+        pipelineDescriptor.fragmentFunction = [library newFunctionWithName : @"upscale_fragment_main"
+                                                             constantValues : constantValues
+                                                                      error : &error];
+        upscalePipelineStates[variant] = [device newRenderPipelineStateWithDescriptor : pipelineDescriptor
+                                                                                 error : &error];
+
+        pipelineDescriptor.fragmentFunction = [library newFunctionWithName : @"sharpen_fragment_main"
+                                                             constantValues : constantValues
+                                                                      error : &error];
+        sharpenPipelineStates[variant] = [device newRenderPipelineStateWithDescriptor : pipelineDescriptor
+                                                                                 error : &error];
+
+        if (upscalePipelineStates[variant] == nil || sharpenPipelineStates[variant] == nil)
+        {
+            release();
+            return false;
+        }
+    }
+
+    pixelFormat = destinationPixelFormat;
+
+    return true;
+}
+
+/// @brief: Releases the pipeline objects and the intermediate texture.
+void ikin_ryz_upscaler::release()
+{
+    for (int variant = 0; variant < compose_variant_count; ++variant)
+    {
+        upscalePipelineStates[variant] = nil;
+        sharpenPipelineStates[variant] = nil;
+    }
+
+    upscaledTexture = nil;
+    pixelFormat = MTLPixelFormatInvalid;
+}
+
+/// @brief: Gets a value indicating whether the upscaler is ready to encode upscale passes.
+/// @returns: True if the upscaler is ready, otherwise false.
+bool ikin_ryz_upscaler::is_initialized() const
+{
+    return upscalePipelineStates[compose_variant_none] != nil;
+}
+
+/// @brief: Gets the memory held by the intermediate texture.
+/// @returns: The size of the texture in bytes, or zero if it hasn't been created.
+uint64_t ikin_ryz_upscaler::allocated_bytes() const
+{
+    if (@available(iOS 11.0, *))
+    {
+        return upscaledTexture != nil ? upscaledTexture.allocatedSize : 0;
+    }
+
+    return 0;
+}
+
+/// @brief: Encodes the passes that upscale a region of the source texture over the whole destination texture.
+/// @param commandBuffer The command buffer the passes are encoded into.
+/// @param source The texture that is upscaled.
+/// @param sourceRect The region of the source that is drawn, in homogeneous coordinates with their origin at the top left.
+/// @param destination The texture that is drawn into.
+/// @param orientation How the source is flipped or rotated as it is drawn.
+/// @param sharpness How much weaker than the strongest sharpening to sharpen, in stops.
+/// @param distortionMesh The distortion mesh of the display, from @see ikin_ryz_distortion_map, or nil to draw the source undistorted.
+/// @param colorLut The color lookup table of the display, from @see ikin_ryz_color_lut_map, or nil to draw the source colors as they are.
+void ikin_ryz_upscaler::encode(id<MTLCommandBuffer> commandBuffer, id<MTLTexture> source, const normalized_rect& sourceRect, id<MTLTexture> destination, eye_orientation orientation, float sharpness, id<MTLTexture> distortionMesh, id<MTLTexture> colorLut)
+{
+    // If the destination changed size, then the intermediate texture no longer fits it.
+    if (upscaledTexture == nil ||
+        upscaledTexture.width != destination.width ||
+        upscaledTexture.height != destination.height)
+    {
+        MTLTextureDescriptor* upscaledDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat : pixelFormat
+                                                                                                      width : destination.width
+                                                                                                     height : destination.height
+                                                                                                  mipmapped : NO];
+        upscaledDescriptor.storageMode = MTLStorageModePrivate;
+        upscaledDescriptor.usage = MTLTextureUsageRenderTarget | MTLTextureUsageShaderRead;
+
+        upscaledTexture = [commandBuffer.device newTextureWithDescriptor : upscaledDescriptor];
+    }
+
+    // The pixels of the source that the region covers, so that reads past its edges repeat its edge pixels.
+    const float sourceWidth = (float)source.width;
+    const float sourceHeight = (float)source.height;
+
+    const upscale_params upscaleParams =
+    {
+        uv_transform(orientation, sourceRect),
+        simd_make_float2(sourceWidth, sourceHeight),
+        simd_make_int2((int)std::floor(sourceRect.x * sourceWidth), (int)std::floor(sourceRect.y * sourceHeight)),
+        simd_make_int2((int)std::ceil((sourceRect.x + sourceRect.width) * sourceWidth) - 1, (int)std::ceil((sourceRect.y + sourceRect.height) * sourceHeight) - 1)
+    };
+
+    const sharpen_params sharpenParams =
+    {
+        std::exp2(-sharpness)
+    };
+
+    const int variant = compose_variant_for(distortionMesh, colorLut);
+
+    encode_full_screen_pass(commandBuffer,
+                            upscalePipelineStates[variant],
+                            source,
+                            &upscaleParams,
+                            sizeof(upscaleParams),
+                            upscaledTexture,
+                            distortionMesh,
+                            colorLut);
+
+    encode_full_screen_pass(commandBuffer,
+                            sharpenPipelineStates[variant],
+                            upscaledTexture,
+                            &sharpenParams,
+                            sizeof(sharpenParams),
+                            destination,
+                            distortionMesh,
+                            colorLut);
+}
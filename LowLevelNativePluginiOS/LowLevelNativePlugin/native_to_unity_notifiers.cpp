@@ -10,6 +10,10 @@
 
 #include <functional>
 #include <vector>
+
+#include "ikin_ryz_flight_recorder.h"
+#include "ikin_ryz_input_trace.h"
+#include "ikin_ryz_timeline.h"
 UnityXRProjectionType projectionType = kUnityXRProjectionTypeHalfAngles;
 
 /// @brief: The projection matrix for the left eye.
@@ -41,7 +45,7 @@ extern "C"
 
     EXPORT_API void ikinRyzRemoveOnDisplayEvent(int id)
     {
-        if (id < 0 || id >= displayEventVector.size())
+        if (id < 0 || id >= (int)displayEventVector.size())
         {
             return;
         }
@@ -53,6 +57,11 @@ extern "C"
     /// @param displayEvent The type of display event.
     EXPORT_API void ikinRyzOnDisplayEvent(display_event value)
     {
+        const int32_t tracedEvent = (int32_t)value;
+        record_input(input_trace_display_event, &tracedEvent, sizeof(tracedEvent));
+        timeline_mark(value == connected ? "Ryz connected" : "Ryz disconnected");
+        record_flight(flight_hotplug, (uint32_t)value);
+
         for (auto displayEventCallback : displayEventVector)
         {
             // If a valid callback is cached, then:
@@ -78,6 +87,18 @@ extern "C"
             float m20, float m21, float m22, float m23,
             float m30, float m31, float m32, float m33)
     {
+        // If a trace is being recorded, then record the call as it was made.
+        if (inputTraceRecording.load(std::memory_order_relaxed))
+        {
+            const struct
+            {
+                int32_t stereoTargetMask;
+                float matrix[16];
+            } tracedCall = { stereoTargetMask, { m00, m01, m02, m03, m10, m11, m12, m13, m20, m21, m22, m23, m30, m31, m32, m33 } };
+
+            append_input_record(input_trace_camera_matrix, &tracedCall, sizeof(tracedCall));
+        }
+
         projectionType = kUnityXRProjectionTypeMatrix;
 
         if (stereoTargetMask == 0 || stereoTargetMask == 1)
@@ -140,7 +161,7 @@ int ikinRyzAddOnDisplayEvent(std::function<DisplayEventDelegate> callback)
     }
 
     int i = 0;
-    for (; i < displayEventVector.size(); ++i)
+    for (; i < (int)displayEventVector.size(); ++i)
     {
         auto& displayEventCallback = displayEventVector[i];
 
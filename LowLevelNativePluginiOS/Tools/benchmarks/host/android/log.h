@@ -0,0 +1,29 @@
+//
+//  log.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Stands in for the NDK's <android/log.h>, so that the Android plugin's logging can be benchmarked on a host.
+//  Only declares what android_logbuffer.h uses. ryz_benchmarks.cpp defines __android_log_print, which leaves out the priority and tag.
+//
+
+#ifndef RYZ_BENCHMARKS_ANDROID_LOG_H
+#define RYZ_BENCHMARKS_ANDROID_LOG_H
+
+typedef enum android_LogPriority
+{
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT
+} android_LogPriority;
+
+int __android_log_print(int priority, const char* tag, const char* format, ...);
+
+#endif
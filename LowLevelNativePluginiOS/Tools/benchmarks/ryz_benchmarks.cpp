@@ -0,0 +1,523 @@
+//
+//  ryz_benchmarks.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Microbenchmarks of the plugin's per-frame and per-event code, run on a Linux host with Google Benchmark.
+//  They call the plugin's own sources: frame descriptor population and projection, camera matrix publication,
+//  display event dispatch, the Android plugin's log buffer, and the CPU references of the compose kernels.
+//
+//  Build from this directory, with Google Benchmark installed (libbenchmark-dev on Debian and Ubuntu):
+//      P=../../LowLevelNativePlugin; U="../../External Headers/Unity"; A=../../../LowLevelNativePluginAndroid/LowLevelPlugin/src/main/jni/UnityXrPlugin
+//      c++ -O2 -std=c++14 -Wall -Wextra -pthread -I$P -I"$U" -I"$U/XR" -I"$U/XR/Subsystems" -I"$U/XR/Subsystems/Display" -Ihost -I$A ryz_benchmarks.cpp $P/ikin_ryz_frame_descriptor.cpp $P/native_to_unity_notifiers.cpp $P/ikin_ryz_input_trace.cpp $P/ikin_ryz_flight_recorder.cpp $P/ikin_ryz_timeline.cpp $P/ikin_ryz_distortion.cpp $P/ikin_ryz_color_lut.cpp $P/ikin_ryz_upscale.cpp $P/ikin_ryz_frame_synthesis.cpp $P/ikin_ryz_tile_hash.cpp $P/ikin_ryz_damage.cpp $A/android_logbuffer.cpp -lbenchmark -o ryz_benchmarks
+//
+//  Run, saving the results as JSON:
+//      ./ryz_benchmarks --benchmark_out=ryz_benchmarks.json --benchmark_out_format=json [--benchmark_filter=Kernel]
+//
+//  Compare two releases with the compare.py script that ships with Google Benchmark:
+//      compare.py benchmarks before.json after.json
+//
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "IUnityXRDisplay.h"
+#include "ikin_ryz_color_lut.h"
+#include "ikin_ryz_damage.h"
+#include "ikin_ryz_distortion.h"
+#include "ikin_ryz_flight_recorder.h"
+#include "ikin_ryz_frame_descriptor.h"
+#include "ikin_ryz_frame_synthesis.h"
+#include "ikin_ryz_input_trace.h"
+#include "ikin_ryz_settings.h"
+#include "ikin_ryz_tile_hash.h"
+#include "ikin_ryz_upscale.h"
+#include "native_to_unity_notifiers.h"
+#include "include/android_logbuffer.h"
+
+/// @brief: Formats the message the way logcat does, then drops it, so the log buffer is measured without a device.
+/// @remarks: The priority and tag are left out, since nothing reads the message.
+int __android_log_print(int /* priority */, const char* /* tag */, const char* format, ...)
+{
+    char message[4096];
+    va_list arguments;
+
+    va_start(arguments, format);
+    const int length = vsnprintf(message, sizeof(message), format, arguments);
+    va_end(arguments);
+
+    benchmark::DoNotOptimize(message);
+
+    return length;
+}
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: Where the traced benchmarks record to. Removed once they finish.
+    const char* const benchmarkTracePath = "/tmp/ryz_benchmarks.trace";
+
+    /// @brief: A 32-bit image filled with a pattern that has both smooth areas and edges, so that edge-adaptive kernels take every path.
+    struct benchmark_image
+    {
+        int width;
+        int height;
+        size_t bytesPerRow;
+        std::vector<uint8_t> pixels;
+
+        benchmark_image(int imageWidth, int imageHeight, uint32_t seed = 1) :
+            width(imageWidth),
+            height(imageHeight),
+            bytesPerRow((size_t)imageWidth * 4),
+            pixels(bytesPerRow * imageHeight)
+        {
+            uint32_t noise = seed;
+
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    noise = noise * 1664525u + 1013904223u;
+
+                    uint8_t* pixel = &pixels[y * bytesPerRow + x * 4];
+                    const bool checker = ((x / 24) + (y / 24)) % 2 == 0;
+
+                    pixel[0] = (uint8_t)(x * 255 / width);
+                    pixel[1] = (uint8_t)(y * 255 / height);
+                    pixel[2] = (uint8_t)(checker ? 200 + (noise >> 28) : 40 + (noise >> 28));
+                    pixel[3] = 255;
+                }
+            }
+        }
+
+        uint8_t* data() { return pixels.data(); }
+        const uint8_t* data() const { return pixels.data(); }
+    };
+
+    /// @brief: Registers the sizes the compose kernels are measured at: the Ryz eye at 720p and at 1080p.
+    void frame_sizes(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({ "width", "height" })->Args({ 1280, 720 })->Args({ 1920, 1080 })->Unit(benchmark::kMicrosecond);
+    }
+
+    /// @brief: Counts the pixels a kernel wrote, so the results show throughput as well as time.
+    void set_pixels_processed(benchmark::State& state, int width, int height)
+    {
+        state.SetItemsProcessed(state.iterations() * width * height);
+        state.SetBytesProcessed(state.iterations() * width * height * 4);
+    }
+
+    /// @brief: Builds a distortion mesh with a mild barrel, like the ones the calibration packages hold.
+    distortion_mesh make_distortion_mesh(int size)
+    {
+        std::shared_ptr<float> coordinates(new float[size * size * 2], std::default_delete<float[]>());
+
+        for (int row = 0; row < size; ++row)
+        {
+            for (int column = 0; column < size; ++column)
+            {
+                const float x = column / (float)(size - 1) * 2.0f - 1.0f;
+                const float y = row / (float)(size - 1) * 2.0f - 1.0f;
+                const float scale = 1.0f + 0.08f * (x * x + y * y);
+
+                coordinates.get()[(row * size + column) * 2 + 0] = (x * scale + 1.0f) * 0.5f;
+                coordinates.get()[(row * size + column) * 2 + 1] = (y * scale + 1.0f) * 0.5f;
+            }
+        }
+
+        distortion_mesh mesh;
+        mesh.columns = size;
+        mesh.rows = size;
+        mesh.coordinates = coordinates;
+
+        return mesh;
+    }
+
+    /// @brief: Builds a color lookup table that lifts the shadows, so that every lookup blends different entries.
+    color_lut make_color_lut(int size)
+    {
+        std::shared_ptr<float> entries(new float[size * size * size * 4], std::default_delete<float[]>());
+        float* entry = entries.get();
+
+        for (int b = 0; b < size; ++b)
+        {
+            for (int g = 0; g < size; ++g)
+            {
+                for (int r = 0; r < size; ++r, entry += 4)
+                {
+                    entry[0] = std::sqrt(r / (float)(size - 1));
+                    entry[1] = std::sqrt(g / (float)(size - 1));
+                    entry[2] = std::sqrt(b / (float)(size - 1));
+                    entry[3] = 0.0f;
+                }
+            }
+        }
+
+        color_lut lut;
+        lut.size = size;
+        lut.entries = entries;
+
+        return lut;
+    }
+
+    /// @brief: Measures filling out the render and culling passes of a frame.
+    /// @remarks: The first argument is the number of eyes, the second is 1 if a camera matrix was set, otherwise 0 for half angles,
+    /// and the third is 1 if the eyes share a double-wide texture, otherwise 0 for a texture each.
+    void BM_PopulateRenderPasses(benchmark::State& state)
+    {
+        const int passEyes[eye_count] = { main_eye, ryz_eye };
+        const bool shared = state.range(2) != 0;
+        eye_pass_target targets[eye_count] = {};
+        UnityXRNextFrameDesc nextFrame = {};
+
+        for (int eye = 0; eye < eye_count; ++eye)
+        {
+            targets[eye].textureId = (UnityXRRenderTextureId)(shared ? 1 : eye + 1);
+            targets[eye].occlusionMeshId = (UnityXROcclusionMeshId)(eye + 1);
+            targets[eye].occludedFraction = 0.2f;
+            targets[eye].viewport = shared ? UnityXRRectf{ eye * 0.5f, 0.0f, 0.45f, 0.9f } : UnityXRRectf{ 0.0f, 0.0f, 0.9f, 0.9f };
+            targets[eye].textureWidth = shared ? 3840 : 1920;
+            targets[eye].textureHeight = 1080;
+        }
+
+        projectionType = state.range(1) != 0 ? kUnityXRProjectionTypeMatrix : kUnityXRProjectionTypeHalfAngles;
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(populate_render_passes(passEyes, (int)state.range(0), targets, 2436.0f, 1125.0f, &nextFrame));
+            benchmark::ClobberMemory();
+        }
+
+        projectionType = kUnityXRProjectionTypeHalfAngles;
+    }
+
+    BENCHMARK(BM_PopulateRenderPasses)->ArgNames({ "eyes", "matrix", "shared" })->Args({ 1, 0, 0 })->Args({ 2, 0, 0 })->Args({ 2, 1, 0 })->Args({ 2, 0, 1 })->Args({ 2, 1, 1 });
+
+    /// @brief: Measures calculating the projection of an eye.
+    /// @remarks: The argument is 1 if a camera matrix was set, otherwise 0 for half angles.
+    void BM_EyeProjection(benchmark::State& state)
+    {
+        projectionType = state.range(0) != 0 ? kUnityXRProjectionTypeMatrix : kUnityXRProjectionTypeHalfAngles;
+
+        int eye = 0;
+
+        for (auto _ : state)
+        {
+            UnityXRProjection projection = get_eye_projection(eye, 2436.0f, 1125.0f);
+            benchmark::DoNotOptimize(projection);
+
+            eye ^= 1;
+        }
+
+        projectionType = kUnityXRProjectionTypeHalfAngles;
+    }
+
+    BENCHMARK(BM_EyeProjection)->ArgName("matrix")->Arg(0)->Arg(1);
+
+    /// @brief: Measures publishing a camera matrix from C#.
+    /// @remarks: The argument is 1 to measure it while an input trace is being recorded, otherwise 0.
+    /// The iterations are fixed, so that the trace stays a known size.
+    void BM_SetCameraMatrix(benchmark::State& state)
+    {
+        const bool traced = state.range(0) != 0;
+
+        if (traced && !start_input_trace(benchmarkTracePath, 256 * 1024 * 1024))
+        {
+            state.SkipWithError("couldn't create the input trace");
+            return;
+        }
+
+        float value = 1.0f;
+
+        for (auto _ : state)
+        {
+            ikinRyzSetCameraMatrix(2, value, 0.0f, 0.0f, 0.0f, 0.0f, value, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, -0.2f, 0.0f, 0.0f, -1.0f, 0.0f);
+            benchmark::ClobberMemory();
+
+            value += 1.0f / 1024.0f;
+        }
+
+        if (traced)
+        {
+            stop_input_trace();
+            unlink(benchmarkTracePath);
+        }
+    }
+
+    BENCHMARK(BM_SetCameraMatrix)->ArgName("traced")->Arg(0)->Arg(1)->Iterations(1 << 20);
+
+    /// @brief: Measures notifying the subscribers of a display event.
+    /// @remarks: The argument is the number of subscribers.
+    void BM_DisplayEventDispatch(benchmark::State& state)
+    {
+        std::vector<int> ids;
+        long delivered = 0;
+
+        for (int i = 0; i < state.range(0); ++i)
+        {
+            ids.push_back(ikinRyzAddOnDisplayEvent([&delivered](display_event) { ++delivered; }));
+        }
+
+        display_event value = connected;
+
+        for (auto _ : state)
+        {
+            ikinRyzOnDisplayEvent(value);
+
+            value = value == connected ? disconnected : connected;
+        }
+
+        for (int id : ids)
+        {
+            ikinRyzRemoveOnDisplayEvent(id);
+        }
+
+        benchmark::DoNotOptimize(delivered);
+        state.SetItemsProcessed(delivered);
+    }
+
+    BENCHMARK(BM_DisplayEventDispatch)->ArgName("subscribers")->Arg(1)->Arg(4)->Arg(16);
+
+    /// @brief: Measures appending a record to the flight recorder, which every frame does a few times whether or not anything reads it.
+    void BM_RecordFlight(benchmark::State& state)
+    {
+        uint32_t value = 0;
+
+        for (auto _ : state)
+        {
+            record_flight(flight_frame_presented, value++);
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    BENCHMARK(BM_RecordFlight)->ThreadRange(1, 4);
+
+    /// @brief: Measures flushing a line through the Android plugin's log buffer, which ends in android::logbuffer::sync.
+    /// @remarks: The argument is the length of the line.
+    void BM_LogbufferSync(benchmark::State& state)
+    {
+        android::logbuffer buffer(ANDROID_LOG_INFO, "Benchmark");
+        std::ostream stream(&buffer);
+        const std::string line((size_t)state.range(0), 'x');
+
+        for (auto _ : state)
+        {
+            stream << line << std::flush;
+        }
+
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    BENCHMARK(BM_LogbufferSync)->ArgName("length")->Arg(16)->Arg(256)->Arg(2000);
+
+    /// @brief: Measures correcting the optics distortion of a frame.
+    void BM_KernelWarpImage(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image source(width, height);
+        benchmark_image destination(width, height);
+        const distortion_mesh mesh = make_distortion_mesh(33);
+
+        for (auto _ : state)
+        {
+            warp_image(source.data(), width, height, source.bytesPerRow, destination.data(), width, height, destination.bytesPerRow, mesh);
+            benchmark::ClobberMemory();
+        }
+
+        set_pixels_processed(state, width, height);
+    }
+
+    BENCHMARK(BM_KernelWarpImage)->Apply(frame_sizes);
+
+    /// @brief: Measures applying the color calibration to a frame.
+    void BM_KernelApplyColorLut(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image source(width, height);
+        benchmark_image image(width, height);
+        const color_lut lut = make_color_lut(33);
+
+        for (auto _ : state)
+        {
+            // The table is applied in place, so each iteration starts from the same image.
+            state.PauseTiming();
+            memcpy(image.data(), source.data(), source.pixels.size());
+            state.ResumeTiming();
+
+            apply_color_lut(image.data(), width, height, image.bytesPerRow, lut);
+            benchmark::ClobberMemory();
+        }
+
+        set_pixels_processed(state, width, height);
+    }
+
+    BENCHMARK(BM_KernelApplyColorLut)->Apply(frame_sizes);
+
+    /// @brief: Measures upscaling a frame rendered at three quarters of the resolution.
+    void BM_KernelUpscaleEasu(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image source(width * 3 / 4, height * 3 / 4);
+        benchmark_image destination(width, height);
+
+        for (auto _ : state)
+        {
+            upscale_easu(source.data(), source.width, source.height, source.bytesPerRow, destination.data(), width, height, destination.bytesPerRow);
+            benchmark::ClobberMemory();
+        }
+
+        set_pixels_processed(state, width, height);
+    }
+
+    BENCHMARK(BM_KernelUpscaleEasu)->Apply(frame_sizes);
+
+    /// @brief: Measures sharpening an upscaled frame.
+    void BM_KernelSharpenRcas(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image source(width, height);
+        benchmark_image destination(width, height);
+
+        for (auto _ : state)
+        {
+            sharpen_rcas(source.data(), width, height, source.bytesPerRow, destination.data(), destination.bytesPerRow, defaultUpscaleSharpness);
+            benchmark::ClobberMemory();
+        }
+
+        set_pixels_processed(state, width, height);
+    }
+
+    BENCHMARK(BM_KernelSharpenRcas)->Apply(frame_sizes);
+
+    /// @brief: Measures synthesizing a frame by extrapolating from the last two.
+    void BM_KernelExtrapolateFrame(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image previous(width, height, 1);
+        const benchmark_image current(width, height, 2);
+        benchmark_image output(width, height);
+
+        for (auto _ : state)
+        {
+            extrapolate_frame(previous.data(), current.data(), output.data(), width, height, output.bytesPerRow, frameSynthesisExtrapolation);
+            benchmark::ClobberMemory();
+        }
+
+        set_pixels_processed(state, width, height);
+    }
+
+    BENCHMARK(BM_KernelExtrapolateFrame)->Apply(frame_sizes);
+
+    /// @brief: Measures synthesizing a frame by moving the last one along its motion vectors.
+    void BM_KernelReprojectFrame(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image current(width, height);
+        benchmark_image output(width, height);
+        std::vector<float> motionVectors((size_t)width * height * 2);
+
+        // A slow pan to the right with a little vertical drift, so most samples land between pixels.
+        for (size_t i = 0; i < motionVectors.size(); i += 2)
+        {
+            motionVectors[i] = 1.37f / width;
+            motionVectors[i + 1] = 0.41f / height;
+        }
+
+        for (auto _ : state)
+        {
+            reproject_frame(current.data(), motionVectors.data(), output.data(), width, height, output.bytesPerRow, 1.0f);
+            benchmark::ClobberMemory();
+        }
+
+        set_pixels_processed(state, width, height);
+    }
+
+    BENCHMARK(BM_KernelReprojectFrame)->Apply(frame_sizes);
+
+    /// @brief: Measures hashing the tiles of a frame.
+    /// @remarks: The third argument is 1 to measure the scalar version, otherwise 0 for the vector version.
+    void BM_KernelHashTiles(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image image(width, height);
+        std::vector<uint32_t> hashes((size_t)tile_hash_count(width, height));
+
+        for (auto _ : state)
+        {
+            if (state.range(2) != 0)
+            {
+                hash_tiles_scalar(image.data(), width, height, image.bytesPerRow, hashes.data());
+            }
+            else
+            {
+                hash_tiles(image.data(), width, height, image.bytesPerRow, hashes.data());
+            }
+
+            benchmark::ClobberMemory();
+        }
+
+        set_pixels_processed(state, width, height);
+    }
+
+    BENCHMARK(BM_KernelHashTiles)->ArgNames({ "width", "height", "scalar" })->Args({ 1280, 720, 0 })->Args({ 1280, 720, 1 })->Args({ 1920, 1080, 0 })->Args({ 1920, 1080, 1 })->Unit(benchmark::kMicrosecond);
+
+    /// @brief: Measures finding the damage of a frame from its tile hashes and copying the damaged regions.
+    void BM_KernelDamageCopy(benchmark::State& state)
+    {
+        const int width = (int)state.range(0);
+        const int height = (int)state.range(1);
+        const benchmark_image previous(width, height);
+        benchmark_image current(width, height);
+        benchmark_image presentation(width, height);
+        std::vector<uint32_t> previousHashes((size_t)tile_hash_count(width, height));
+        std::vector<uint32_t> hashes(previousHashes.size());
+        std::vector<damage_rect> rects;
+
+        // Change a cursor-sized patch and a status bar, the kind of damage a mostly static UI has.
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                if ((x > width / 2 && x < width / 2 + 48 && y > height / 2 && y < height / 2 + 48) || y < 40)
+                {
+                    current.data()[y * current.bytesPerRow + x * 4] ^= 0xFF;
+                }
+            }
+        }
+
+        hash_tiles(previous.data(), width, height, previous.bytesPerRow, previousHashes.data());
+        hash_tiles(current.data(), width, height, current.bytesPerRow, hashes.data());
+
+        for (auto _ : state)
+        {
+            damage_rects_from_tile_hashes(previousHashes.data(), hashes.data(), width, height, rects);
+            copy_damage_rects(current.data(), current.bytesPerRow, presentation.data(), presentation.bytesPerRow, 4, rects);
+            benchmark::ClobberMemory();
+        }
+
+        state.counters["rects"] = (double)rects.size();
+    }
+
+    BENCHMARK(BM_KernelDamageCopy)->Apply(frame_sizes);
+}
+
+BENCHMARK_MAIN();
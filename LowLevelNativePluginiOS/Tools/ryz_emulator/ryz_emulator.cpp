@@ -0,0 +1,269 @@
+//
+//  ryz_emulator.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Emulates a Ryz display on Linux, so that presentation can be measured without one plugged in.
+//  It hands a shared-memory ring of frames to a producer, latches the newest frame at each emulated vsync,
+//  and reports back when each frame was shown. The pixels are scanned out in place, so they are never copied.
+//
+//  Build from this directory:
+//      c++ -O2 -std=c++14 -pthread ryz_emulator.cpp ryz_emulator_ring.cpp -o ryz_emulator
+//
+//  Run:
+//      ./ryz_emulator [--width 1280] [--height 720] [--refresh 60] [--jitter-us 250]
+//                     [--hotplug-seconds 0] [--seconds 0] [--socket /tmp/ryz_emulator.sock] [--dump last_frame.ppm]
+//
+//  --hotplug-seconds disconnects and reconnects the display every that many seconds, and --seconds stops the emulator after that many.
+//  ryz_emulator_feed.cpp is a producer that drives it.
+//
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ryz_emulator_ring.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The settings of the emulated display.
+    struct emulator_options
+    {
+        uint32_t width = 1280;
+        uint32_t height = 720;
+        double refreshRate = 60.0;
+        double jitterMicroseconds = 250.0;
+        double hotplugSeconds = 0.0;
+        double runSeconds = 0.0;
+        std::string socketPath = defaultEmulatorSocketPath;
+        std::string dumpPath;
+    };
+
+    /// @brief: Set by SIGINT or SIGTERM to stop the emulator.
+    volatile sig_atomic_t stopRequested = 0;
+
+    void request_stop(int)
+    {
+        stopRequested = 1;
+    }
+
+    /// @brief: Reads the options from the command line.
+    /// @returns: True if every option was understood, otherwise false.
+    bool parse_options(int argc, char** argv, emulator_options& options)
+    {
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string name = argv[i];
+            const char* value = argv[i + 1];
+
+            if (name == "--width") options.width = (uint32_t)atoi(value);
+            else if (name == "--height") options.height = (uint32_t)atoi(value);
+            else if (name == "--refresh") options.refreshRate = atof(value);
+            else if (name == "--jitter-us") options.jitterMicroseconds = atof(value);
+            else if (name == "--hotplug-seconds") options.hotplugSeconds = atof(value);
+            else if (name == "--seconds") options.runSeconds = atof(value);
+            else if (name == "--socket") options.socketPath = value;
+            else if (name == "--dump") options.dumpPath = value;
+            else return false;
+        }
+
+        return argc % 2 == 1 && options.width > 0 && options.height > 0 && options.refreshRate > 0.0;
+    }
+
+    /// @brief: Sleeps until a time on CLOCK_MONOTONIC.
+    void sleep_until(uint64_t nanoseconds)
+    {
+        const timespec wakeTime = { (time_t)(nanoseconds / 1000000000ull), (long)(nanoseconds % 1000000000ull) };
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, nullptr) != 0 && !stopRequested)
+        {
+        }
+    }
+
+    /// @brief: Hands the ring to each producer that connected since the last vsync.
+    void accept_producers(int listenSocket, int ringFd)
+    {
+        int producerSocket;
+
+        while ((producerSocket = accept(listenSocket, nullptr, nullptr)) >= 0)
+        {
+            printf("producer connected%s\n", send_ring_fd(producerSocket, ringFd) ? "" : ", but the ring couldn't be sent");
+            close(producerSocket);
+        }
+    }
+
+    /// @brief: Saves the pixels of a slot as a binary PPM.
+    bool write_ppm(const char* path, const emulator_ring& ring, int slot)
+    {
+        FILE* file = fopen(path, "wb");
+
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        const emulator_ring_header* header = ring.get_header();
+
+        fprintf(file, "P6\n%u %u\n255\n", header->width, header->height);
+
+        for (uint32_t row = 0; row < header->height; ++row)
+        {
+            const uint8_t* pixel = ring.get_pixels(slot) + (size_t)row * header->bytesPerRow;
+
+            for (uint32_t column = 0; column < header->width; ++column, pixel += 4)
+            {
+                const uint8_t rgb[3] = { pixel[2], pixel[1], pixel[0] };
+                fwrite(rgb, 1, sizeof(rgb), file);
+            }
+        }
+
+        return fclose(file) == 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    emulator_options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s [--width N] [--height N] [--refresh Hz] [--jitter-us N] [--hotplug-seconds N] [--seconds N] [--socket path] [--dump path.ppm]\n", argv[0]);
+        return 2;
+    }
+
+    emulator_ring ring;
+
+    if (!ring.create(options.width, options.height, (uint32_t)(options.refreshRate * 1000.0 + 0.5)))
+    {
+        perror("couldn't create the ring");
+        return 1;
+    }
+
+    const int listenSocket = listen_for_producers(options.socketPath.c_str());
+
+    if (listenSocket < 0)
+    {
+        perror("couldn't listen for producers");
+        return 1;
+    }
+
+    signal(SIGINT, request_stop);
+    signal(SIGTERM, request_stop);
+
+    printf("emulating a %ux%u Ryz at %.3f Hz with %.0f us of vsync jitter on %s\n",
+           options.width, options.height, options.refreshRate, options.jitterMicroseconds, options.socketPath.c_str());
+
+    emulator_ring_header* header = ring.get_header();
+    const uint64_t period = (uint64_t)(1000000000.0 / options.refreshRate);
+    const uint64_t hotplugPeriod = (uint64_t)(options.hotplugSeconds * 1000000000.0);
+    const uint64_t start = emulator_now_nanoseconds();
+    const uint64_t stop = options.runSeconds > 0.0 ? start + (uint64_t)(options.runSeconds * 1000000000.0) : UINT64_MAX;
+
+    // The jitter moves each vsync off its ideal time without the error building up, as a panel's clock does.
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int64_t> jitter(-(int64_t)(options.jitterMicroseconds * 1000.0), (int64_t)(options.jitterMicroseconds * 1000.0));
+
+    int scanningSlot = -1;
+    uint64_t lastLatchVsync = 0;
+    uint64_t nextHotplug = hotplugPeriod > 0 ? start + hotplugPeriod : UINT64_MAX;
+    uint64_t nextReport = start + 1000000000ull;
+    uint64_t vsync = 0;
+    uint64_t secondPresented = 0;
+    uint64_t secondRepeated = 0;
+    uint64_t secondLatencyNanoseconds = 0;
+
+    while (!stopRequested)
+    {
+        ++vsync;
+
+        const uint64_t vsyncTime = start + vsync * period + jitter(random);
+
+        sleep_until(vsyncTime);
+
+        const uint64_t now = emulator_now_nanoseconds();
+
+        if (now >= stop)
+        {
+            break;
+        }
+
+        accept_producers(listenSocket, ring.get_fd());
+
+        // If it is time to unplug or plug the display, then let the producer know.
+        // The vsyncs while it is unplugged aren't missed frames.
+        if (now >= nextHotplug)
+        {
+            const uint32_t connected = header->connected.load() ^ 1u;
+
+            header->connected.store(connected);
+            lastLatchVsync = 0;
+            emulator_ring::signal(header->displayEvents);
+            nextHotplug += hotplugPeriod;
+
+            printf("display %s\n", connected != 0 ? "connected" : "disconnected");
+        }
+
+        // Latch the newest frame, if there is one, and report when it was shown.
+        if (header->connected.load() != 0)
+        {
+            if (ring.latch(scanningSlot))
+            {
+                const emulator_slot& slot = header->slots[scanningSlot];
+
+                emulator_presentation presentation = {};
+                presentation.frameId = slot.frameId;
+                presentation.submitNanoseconds = slot.submitNanoseconds;
+                presentation.vsyncNanoseconds = now;
+                presentation.vsyncsSinceLastFrame = lastLatchVsync != 0 ? (uint32_t)(vsync - lastLatchVsync) : 1;
+
+                ring.report_presentation(presentation);
+
+                lastLatchVsync = vsync;
+                ++secondPresented;
+                secondLatencyNanoseconds += now - slot.submitNanoseconds;
+            }
+            else if (scanningSlot >= 0)
+            {
+                ++secondRepeated;
+            }
+        }
+        else
+        {
+            // Frames that are published while the display is unplugged are never shown.
+            ring.discard_pending();
+        }
+
+        header->lastVsyncNanoseconds.store(now);
+        emulator_ring::signal(header->vsyncCount);
+
+        if (now >= nextReport)
+        {
+            printf("%llu frames presented, %llu vsyncs repeated a frame, %.2f ms from submit to vsync\n",
+                   (unsigned long long)secondPresented, (unsigned long long)secondRepeated,
+                   secondPresented > 0 ? secondLatencyNanoseconds / 1e6 / secondPresented : 0.0);
+
+            secondPresented = secondRepeated = secondLatencyNanoseconds = 0;
+            nextReport += 1000000000ull;
+        }
+    }
+
+    close(listenSocket);
+    unlink(options.socketPath.c_str());
+
+    if (!options.dumpPath.empty() && scanningSlot >= 0 && !write_ppm(options.dumpPath.c_str(), ring, scanningSlot))
+    {
+        perror("couldn't write the last frame");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+//
+//  ryz_emulator_feed.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Feeds frames to ryz_emulator.cpp the way a host build of the display provider would, and summarizes the presentation timing it reports back.
+//  Each frame is drawn straight into a slot of the emulator's ring, so nothing is copied on either side.
+//
+//  Build from this directory:
+//      c++ -O2 -std=c++14 -pthread ryz_emulator_feed.cpp ryz_emulator_ring.cpp -o ryz_emulator_feed
+//
+//  Run while the emulator is running:
+//      ./ryz_emulator_feed [--frames 600] [--draw-us 2000] [--unpaced 0] [--socket /tmp/ryz_emulator.sock]
+//
+//  --draw-us is how long each frame takes to draw. Without --unpaced 1, each frame is started at a vsync, as a provider paced by the display would.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ryz_emulator_ring.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: How long to wait for the emulator before deciding it has gone, in milliseconds.
+    const int feedTimeoutMilliseconds = 1000;
+
+    /// @brief: The settings of the feed.
+    struct feed_options
+    {
+        long frames = 600;
+        long drawMicroseconds = 2000;
+        bool unpaced = false;
+        std::string socketPath = defaultEmulatorSocketPath;
+    };
+
+    /// @brief: Reads the options from the command line.
+    /// @returns: True if every option was understood, otherwise false.
+    bool parse_options(int argc, char** argv, feed_options& options)
+    {
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string name = argv[i];
+            const char* value = argv[i + 1];
+
+            if (name == "--frames") options.frames = atol(value);
+            else if (name == "--draw-us") options.drawMicroseconds = atol(value);
+            else if (name == "--unpaced") options.unpaced = atoi(value) != 0;
+            else if (name == "--socket") options.socketPath = value;
+            else return false;
+        }
+
+        return argc % 2 == 1 && options.frames > 0;
+    }
+
+    /// @brief: Draws a bar that moves one column a frame, so that repeated or dropped frames show when the last frame is dumped.
+    void draw_frame(uint8_t* pixels, const emulator_ring_header& header, uint64_t frameId)
+    {
+        const uint32_t barColumn = (uint32_t)(frameId * 8 % header.width);
+
+        for (uint32_t row = 0; row < header.height; ++row)
+        {
+            uint8_t* rowPixels = pixels + (size_t)row * header.bytesPerRow;
+
+            memset(rowPixels, (int)(frameId & 0x3F), header.bytesPerRow);
+            memset(rowPixels + barColumn * 4, 0xFF, std::min<uint32_t>(8, header.width - barColumn) * 4);
+        }
+    }
+
+    /// @brief: Spins until a time on CLOCK_MONOTONIC, standing in for the work of drawing a frame.
+    void busy_until(uint64_t nanoseconds)
+    {
+        while (emulator_now_nanoseconds() < nanoseconds)
+        {
+        }
+    }
+
+    /// @brief: Gets a percentile of sorted values.
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5))];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    feed_options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s [--frames N] [--draw-us N] [--unpaced 0|1] [--socket path]\n", argv[0]);
+        return 2;
+    }
+
+    const int ringFd = connect_to_emulator(options.socketPath.c_str());
+    emulator_ring ring;
+
+    if (ringFd < 0 || !ring.attach(ringFd))
+    {
+        fprintf(stderr, "couldn't attach to the emulator on %s\n", options.socketPath.c_str());
+        return 1;
+    }
+
+    emulator_ring_header* header = ring.get_header();
+
+    printf("attached to a %ux%u Ryz at %.3f Hz\n", header->width, header->height, header->refreshMillihertz / 1000.0);
+
+    std::vector<emulator_presentation> presentations(emulatorPresentationCount);
+    std::vector<double> latencies;
+    std::vector<double> intervals;
+    uint64_t presentationCursor = header->presentationCount.load();
+    uint64_t lastVsync = 0;
+    uint32_t displayEvents = header->displayEvents.load();
+    long replaced = 0;
+    long missedVsyncs = 0;
+    long hotplugs = 0;
+
+    for (long frame = 1; frame <= options.frames; ++frame)
+    {
+        // If the display is unplugged, then wait for it to come back rather than drawing frames nobody sees.
+        while (true)
+        {
+            const uint32_t events = header->displayEvents.load();
+
+            // The gap while the display was unplugged isn't a presentation interval.
+            if (events != displayEvents)
+            {
+                hotplugs += events - displayEvents;
+                displayEvents = events;
+                lastVsync = 0;
+            }
+
+            if (header->connected.load() != 0)
+            {
+                break;
+            }
+
+            if (!emulator_ring::wait_for_change(header->displayEvents, displayEvents, feedTimeoutMilliseconds * 10))
+            {
+                fprintf(stderr, "the display didn't come back\n");
+                return 1;
+            }
+        }
+
+        // Start the frame at a vsync, as a provider that the display paces does.
+        if (!options.unpaced && !emulator_ring::wait_for_change(header->vsyncCount, header->vsyncCount.load(), feedTimeoutMilliseconds))
+        {
+            fprintf(stderr, "the emulator stopped\n");
+            break;
+        }
+
+        const int slot = ring.acquire_slot(feedTimeoutMilliseconds);
+
+        if (slot < 0)
+        {
+            fprintf(stderr, "the emulator didn't give a slot back\n");
+            break;
+        }
+
+        const uint64_t drawEnd = emulator_now_nanoseconds() + (uint64_t)options.drawMicroseconds * 1000ull;
+
+        draw_frame(ring.get_pixels(slot), *header, (uint64_t)frame);
+        busy_until(drawEnd);
+
+        if (ring.publish_slot(slot, (uint64_t)frame))
+        {
+            ++replaced;
+        }
+
+        // Collect when the frames were shown.
+        const size_t count = ring.read_presentations(presentationCursor, presentations.data(), presentations.size());
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const emulator_presentation& presentation = presentations[i];
+
+            latencies.push_back((presentation.vsyncNanoseconds - presentation.submitNanoseconds) / 1e6);
+
+            if (lastVsync != 0)
+            {
+                intervals.push_back((presentation.vsyncNanoseconds - lastVsync) / 1e6);
+            }
+
+            missedVsyncs += presentation.vsyncsSinceLastFrame - 1;
+            lastVsync = presentation.vsyncNanoseconds;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(intervals.begin(), intervals.end());
+
+    printf("%zu frames presented, %ld replaced before a vsync, %ld vsyncs missed, %ld hotplug events\n", latencies.size(), replaced, missedVsyncs, hotplugs);
+    printf("submit to vsync: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms\n", percentile(latencies, 0.5), percentile(latencies, 0.95), percentile(latencies, 0.99));
+    printf("present interval: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           percentile(intervals, 0.5), percentile(intervals, 0.95), percentile(intervals, 0.99), intervals.empty() ? 0.0 : intervals.back());
+
+    return 0;
+}
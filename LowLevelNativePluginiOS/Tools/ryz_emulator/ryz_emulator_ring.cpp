@@ -0,0 +1,454 @@
+//
+//  ryz_emulator_ring.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+
+#include "ryz_emulator_ring.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: Rounds a size up to a multiple of the page size.
+    uint64_t round_to_pages(uint64_t size)
+    {
+        const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+
+        return (size + pageSize - 1) / pageSize * pageSize;
+    }
+
+    /// @brief: Gets the futex word behind an atomic counter.
+    /// @remarks: The word is shared between processes, so the private futex operations can't be used.
+    uint32_t* futex_word(std::atomic<uint32_t>& word)
+    {
+        return reinterpret_cast<uint32_t*>(&word);
+    }
+
+    /// @brief: Fills in the address of a Unix socket.
+    /// @returns: True if the path fits, otherwise false.
+    bool unix_address(const char* path, sockaddr_un& address)
+    {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+
+        if (strlen(path) >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+
+        strcpy(address.sun_path, path);
+
+        return true;
+    }
+}
+
+/// @brief: Gets the time on CLOCK_MONOTONIC, which both sides of the ring share.
+/// @returns: The time in nanoseconds.
+uint64_t emulator_now_nanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+/// @brief: Unmaps the ring and closes its memfd.
+emulator_ring::~emulator_ring()
+{
+    if (header != nullptr)
+    {
+        munmap(header, header->size);
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/// @brief: Creates a ring for an emulated display. Called by the emulator.
+/// @param width The width of the display in pixels.
+/// @param height The height of the display in pixels.
+/// @param refreshMillihertz The refresh rate of the display, in thousandths of a hertz.
+/// @returns: True if the ring was created, otherwise false.
+bool emulator_ring::create(uint32_t width, uint32_t height, uint32_t refreshMillihertz)
+{
+    const uint64_t slotOffset = round_to_pages(sizeof(emulator_ring_header));
+    const uint64_t slotStride = round_to_pages((uint64_t)width * 4 * height);
+    const uint64_t size = slotOffset + slotStride * emulatorSlotCount;
+
+    fd = (int)syscall(SYS_memfd_create, "ryz_emulator_ring", 0);
+
+    if (fd < 0 || ftruncate(fd, (off_t)size) != 0)
+    {
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // The memfd starts zeroed, which is how every counter and slot starts.
+    header = new (mapping) emulator_ring_header();
+    header->magic = emulatorRingMagic;
+    header->version = emulatorRingVersion;
+    header->width = width;
+    header->height = height;
+    header->bytesPerRow = width * 4;
+    header->refreshMillihertz = refreshMillihertz;
+    header->slotOffset = slotOffset;
+    header->slotStride = slotStride;
+    header->size = size;
+    header->connected = 1;
+
+    return true;
+}
+
+/// @brief: Maps a ring that the emulator created. Called by the producer.
+/// @param ringFd The ring's memfd, which the mapping takes ownership of.
+/// @returns: True if the ring was mapped and is of this version, otherwise false.
+bool emulator_ring::attach(int ringFd)
+{
+    fd = ringFd;
+
+    struct stat status;
+
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(emulator_ring_header))
+    {
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    header = static_cast<emulator_ring_header*>(mapping);
+
+    // If the ring is of another layout, then don't touch it.
+    if (header->magic != emulatorRingMagic || header->version != emulatorRingVersion || header->size != (uint64_t)status.st_size)
+    {
+        munmap(mapping, (size_t)status.st_size);
+        header = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+/// @brief: Gets the pixels of a slot, which are drawn and scanned out in place.
+uint8_t* emulator_ring::get_pixels(int slot) const
+{
+    return reinterpret_cast<uint8_t*>(header) + header->slotOffset + header->slotStride * slot;
+}
+
+/// @brief: Takes a free slot to draw the next frame into. Called by the producer.
+/// @param timeoutMilliseconds How long to wait for the emulator to give a slot back.
+/// @returns: The slot, or -1 if none was given back in time.
+int emulator_ring::acquire_slot(int timeoutMilliseconds)
+{
+    const uint64_t deadline = emulator_now_nanoseconds() + (uint64_t)timeoutMilliseconds * 1000000ull;
+
+    while (true)
+    {
+        // Read the counter before looking at the slots, so that a slot given back in between still wakes the wait.
+        const uint32_t released = header->slotsReleased.load(std::memory_order_acquire);
+
+        for (int slot = 0; slot < emulatorSlotCount; ++slot)
+        {
+            uint32_t expected = emulator_slot_free;
+
+            if (header->slots[slot].state.compare_exchange_strong(expected, emulator_slot_drawing, std::memory_order_acq_rel))
+            {
+                return slot;
+            }
+        }
+
+        const uint64_t now = emulator_now_nanoseconds();
+
+        if (now >= deadline || !wait_for_change(header->slotsReleased, released, (int)((deadline - now + 999999) / 1000000)))
+        {
+            return -1;
+        }
+    }
+}
+
+/// @brief: Hands a drawn slot to the emulator for the next vsync. Called by the producer.
+/// @param slot The slot from @see acquire_slot.
+/// @param frameId The number of the frame, which the emulator reports back.
+/// @returns: True if a frame that was still waiting for a vsync was replaced, otherwise false.
+bool emulator_ring::publish_slot(int slot, uint64_t frameId)
+{
+    header->slots[slot].frameId = frameId;
+    header->slots[slot].submitNanoseconds = emulator_now_nanoseconds();
+    header->slots[slot].state.store(emulator_slot_pending, std::memory_order_release);
+
+    // Whichever side takes the pending slot owns it, so if this takes back a frame the emulator never latched, then it is free again.
+    const uint32_t replaced = header->pendingSlot.exchange(slot + 1, std::memory_order_acq_rel);
+
+    if (replaced == 0)
+    {
+        return false;
+    }
+
+    header->slots[replaced - 1].state.store(emulator_slot_free, std::memory_order_release);
+    signal(header->slotsReleased);
+
+    return true;
+}
+
+/// @brief: Waits for a futex word to move on from a value.
+/// @param word One of the counters in the header.
+/// @param seen The value the caller last saw.
+/// @param timeoutMilliseconds How long to wait.
+/// @returns: True if the word moved on, otherwise false if the wait timed out.
+bool emulator_ring::wait_for_change(std::atomic<uint32_t>& word, uint32_t seen, int timeoutMilliseconds)
+{
+    const uint64_t deadline = emulator_now_nanoseconds() + (uint64_t)timeoutMilliseconds * 1000000ull;
+
+    // The futex can wake without the word changing, so wait again until it does or the time is up.
+    while (word.load(std::memory_order_acquire) == seen)
+    {
+        const uint64_t now = emulator_now_nanoseconds();
+
+        if (now >= deadline)
+        {
+            return false;
+        }
+
+        const timespec timeout = { (time_t)((deadline - now) / 1000000000ull), (long)((deadline - now) % 1000000000ull) };
+
+        syscall(SYS_futex, futex_word(word), FUTEX_WAIT, seen, &timeout, nullptr, 0);
+    }
+
+    return true;
+}
+
+/// @brief: Bumps a futex word and wakes the other side.
+void emulator_ring::signal(std::atomic<uint32_t>& word)
+{
+    word.fetch_add(1, std::memory_order_acq_rel);
+
+    syscall(SYS_futex, futex_word(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/// @brief: Takes the pending slot at a vsync, and gives the slot that was being scanned out back. Called by the emulator.
+/// @param scanningSlot The slot that was being scanned out, or -1; updated to the slot that is scanned out from now on.
+/// @returns: True if a new frame was latched, otherwise false if the last one is shown again.
+bool emulator_ring::latch(int& scanningSlot)
+{
+    const uint32_t pending = header->pendingSlot.exchange(0, std::memory_order_acq_rel);
+
+    if (pending == 0)
+    {
+        return false;
+    }
+
+    header->slots[pending - 1].state.store(emulator_slot_scanning, std::memory_order_release);
+
+    if (scanningSlot >= 0)
+    {
+        header->slots[scanningSlot].state.store(emulator_slot_free, std::memory_order_release);
+        signal(header->slotsReleased);
+    }
+
+    scanningSlot = (int)pending - 1;
+
+    return true;
+}
+
+/// @brief: Gives the pending slot back without showing it, such as when the display is unplugged. Called by the emulator.
+/// @returns: True if a frame was pending, otherwise false.
+bool emulator_ring::discard_pending()
+{
+    const uint32_t pending = header->pendingSlot.exchange(0, std::memory_order_acq_rel);
+
+    if (pending == 0)
+    {
+        return false;
+    }
+
+    header->slots[pending - 1].state.store(emulator_slot_free, std::memory_order_release);
+    signal(header->slotsReleased);
+
+    return true;
+}
+
+/// @brief: Reports the presentation of a frame. Called by the emulator.
+void emulator_ring::report_presentation(const emulator_presentation& presentation)
+{
+    const uint64_t count = header->presentationCount.load(std::memory_order_relaxed);
+
+    header->presentations[count % emulatorPresentationCount] = presentation;
+    header->presentationCount.store(count + 1, std::memory_order_release);
+}
+
+/// @brief: Copies the presentations that were reported since the last call. Called by the producer.
+/// @param cursor The number of presentations that were read, which is moved on past the ones that are copied.
+/// @param presentations The presentations that are copied into.
+/// @param maxCount The most presentations that are copied.
+/// @returns: The number of presentations that were copied. Presentations that were overwritten before they were read are skipped.
+size_t emulator_ring::read_presentations(uint64_t& cursor, emulator_presentation* presentations, size_t maxCount) const
+{
+    const uint64_t count = header->presentationCount.load(std::memory_order_acquire);
+
+    if (count - cursor > (uint64_t)emulatorPresentationCount)
+    {
+        cursor = count - emulatorPresentationCount;
+    }
+
+    size_t copied = 0;
+
+    for (; cursor < count && copied < maxCount; ++cursor)
+    {
+        presentations[copied] = header->presentations[cursor % emulatorPresentationCount];
+
+        // If the emulator lapped the copy while it was made, then the copy may be torn, so leave it out.
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (header->presentationCount.load(std::memory_order_relaxed) - cursor <= (uint64_t)emulatorPresentationCount)
+        {
+            ++copied;
+        }
+    }
+
+    return copied;
+}
+
+/// @brief: Listens on a Unix socket for producers to hand the ring to.
+/// @param path The path of the socket, which is replaced if it exists.
+/// @returns: The listening socket, which doesn't block, or -1.
+int listen_for_producers(const char* path)
+{
+    sockaddr_un address;
+
+    if (!unix_address(path, address))
+    {
+        return -1;
+    }
+
+    const int listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    unlink(path);
+
+    if (listenSocket < 0 || bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 4) != 0)
+    {
+        if (listenSocket >= 0)
+        {
+            close(listenSocket);
+        }
+
+        return -1;
+    }
+
+    return listenSocket;
+}
+
+/// @brief: Hands the ring's memfd to a producer that connected.
+/// @param connectedSocket The connected socket.
+/// @param ringFd The memfd.
+/// @returns: True if the memfd was sent, otherwise false.
+bool send_ring_fd(int connectedSocket, int ringFd)
+{
+    char byte = 'R';
+    iovec data = { &byte, 1 };
+
+    union
+    {
+        cmsghdr header;
+        char bytes[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    memset(&control, 0, sizeof(control));
+
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.bytes;
+    message.msg_controllen = sizeof(control.bytes);
+
+    cmsghdr* rights = CMSG_FIRSTHDR(&message);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(rights), &ringFd, sizeof(int));
+
+    return sendmsg(connectedSocket, &message, MSG_NOSIGNAL) == 1;
+}
+
+/// @brief: Connects to an emulator and receives its ring's memfd.
+/// @param path The path of the emulator's socket.
+/// @returns: The memfd, or -1.
+int connect_to_emulator(const char* path)
+{
+    sockaddr_un address;
+
+    if (!unix_address(path, address))
+    {
+        return -1;
+    }
+
+    const int connectedSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (connectedSocket < 0)
+    {
+        return -1;
+    }
+
+    if (connect(connectedSocket, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(connectedSocket);
+        return -1;
+    }
+
+    char byte;
+    iovec data = { &byte, 1 };
+
+    union
+    {
+        cmsghdr header;
+        char bytes[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control.bytes;
+    message.msg_controllen = sizeof(control.bytes);
+
+    int ringFd = -1;
+
+    if (recvmsg(connectedSocket, &message, MSG_CMSG_CLOEXEC) == 1)
+    {
+        cmsghdr* rights = CMSG_FIRSTHDR(&message);
+
+        if (rights != nullptr && rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS)
+        {
+            memcpy(&ringFd, CMSG_DATA(rights), sizeof(int));
+        }
+    }
+
+    close(connectedSocket);
+
+    return ringFd;
+}
@@ -0,0 +1,232 @@
+//
+//  ryz_emulator_ring.h
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  The shared-memory ring that frames are handed to the Ryz emulator through, see ryz_emulator.cpp.
+//  Linux only: the ring lives in a memfd, which the emulator passes to a producer over a Unix socket,
+//  and each side sleeps on futexes in it rather than polling.
+//
+
+#ifndef RYZ_EMULATOR_RING_H
+#define RYZ_EMULATOR_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "The ring's atomics are shared between processes, so they have to be lock-free.");
+
+/// @brief: The value of the first four bytes of the ring, which read "RYZE".
+const uint32_t emulatorRingMagic = 0x455A5952;
+
+/// @brief: The version of the ring's layout, which a producer checks before it uses the ring.
+const uint32_t emulatorRingVersion = 1;
+
+/// @brief: The number of frames the ring holds: one being scanned out, one waiting for the next vsync, and one being drawn.
+const int emulatorSlotCount = 3;
+
+/// @brief: The number of presentations the emulator reports before it overwrites the oldest.
+const int emulatorPresentationCount = 256;
+
+/// @brief: The path of the socket the emulator hands the ring out on, when none is given.
+const char* const defaultEmulatorSocketPath = "/tmp/ryz_emulator.sock";
+
+/// @brief: The owner of a slot.
+enum emulator_slot_state : uint32_t
+{
+    /// @brief: The producer can take the slot.
+    emulator_slot_free = 0,
+
+    /// @brief: The producer is drawing into the slot.
+    emulator_slot_drawing = 1,
+
+    /// @brief: The slot holds the frame that is latched at the next vsync.
+    emulator_slot_pending = 2,
+
+    /// @brief: The emulator is scanning the slot out.
+    emulator_slot_scanning = 3
+};
+
+/// @brief: The frame a slot holds.
+struct emulator_slot
+{
+    std::atomic<uint32_t> state;
+    uint32_t reserved;
+
+    /// @brief: The number the producer gave the frame.
+    uint64_t frameId;
+
+    /// @brief: The time the producer published the frame, in nanoseconds on CLOCK_MONOTONIC.
+    uint64_t submitNanoseconds;
+};
+
+/// @brief: When the emulator showed a frame, which it reports back to the producer.
+struct emulator_presentation
+{
+    /// @brief: The number the producer gave the frame.
+    uint64_t frameId;
+
+    /// @brief: The time the producer published the frame, in nanoseconds on CLOCK_MONOTONIC.
+    uint64_t submitNanoseconds;
+
+    /// @brief: The time of the vsync that latched the frame, in nanoseconds on CLOCK_MONOTONIC.
+    uint64_t vsyncNanoseconds;
+
+    /// @brief: The number of vsyncs since the last frame was latched, which is 1 when no vsync was missed.
+    uint32_t vsyncsSinceLastFrame;
+
+    uint32_t reserved;
+};
+
+/// @brief: The start of the ring. The slots' pixels follow it, each at a multiple of the page size.
+/// @remarks: The 32-bit counters are futex words, which are bumped and woken whenever they change.
+struct emulator_ring_header
+{
+    uint32_t magic;
+    uint32_t version;
+
+    /// @brief: The size of the emulated display, in pixels.
+    uint32_t width;
+    uint32_t height;
+
+    /// @brief: The distance between the starts of two rows of a slot, in bytes. The pixels are 8-bit BGRA.
+    uint32_t bytesPerRow;
+
+    /// @brief: The refresh rate of the emulated display, in thousandths of a hertz.
+    uint32_t refreshMillihertz;
+
+    /// @brief: The offset of the first slot's pixels from the start of the ring, and the distance between two slots' pixels, in bytes.
+    uint64_t slotOffset;
+    uint64_t slotStride;
+
+    /// @brief: The size of the ring, in bytes.
+    uint64_t size;
+
+    /// @brief: Counts the vsyncs.
+    std::atomic<uint32_t> vsyncCount;
+
+    /// @brief: Counts the slots that were given back to the producer.
+    std::atomic<uint32_t> slotsReleased;
+
+    /// @brief: Counts the times the emulated display was connected or disconnected.
+    std::atomic<uint32_t> displayEvents;
+
+    /// @brief: 1 while the emulated display is connected, otherwise 0. Frames aren't latched while it is disconnected.
+    std::atomic<uint32_t> connected;
+
+    /// @brief: The slot that is latched at the next vsync, plus one, or 0 if there is none.
+    std::atomic<uint32_t> pendingSlot;
+
+    uint32_t reserved;
+
+    /// @brief: The time of the last vsync, in nanoseconds on CLOCK_MONOTONIC.
+    std::atomic<uint64_t> lastVsyncNanoseconds;
+
+    /// @brief: Counts the presentations that were reported. The last one is at index (count - 1) % @see emulatorPresentationCount.
+    std::atomic<uint64_t> presentationCount;
+
+    emulator_slot slots[emulatorSlotCount];
+
+    emulator_presentation presentations[emulatorPresentationCount];
+};
+
+/// @brief: Gets the time on CLOCK_MONOTONIC, which both sides of the ring share.
+/// @returns: The time in nanoseconds.
+uint64_t emulator_now_nanoseconds();
+
+/// @brief: A mapping of the ring, from either side.
+class emulator_ring
+{
+public:
+    emulator_ring() = default;
+    emulator_ring(const emulator_ring&) = delete;
+    emulator_ring& operator=(const emulator_ring&) = delete;
+
+    /// @brief: Unmaps the ring and closes its memfd.
+    ~emulator_ring();
+
+    /// @brief: Creates a ring for an emulated display. Called by the emulator.
+    /// @param width The width of the display in pixels.
+    /// @param height The height of the display in pixels.
+    /// @param refreshMillihertz The refresh rate of the display, in thousandths of a hertz.
+    /// @returns: True if the ring was created, otherwise false.
+    bool create(uint32_t width, uint32_t height, uint32_t refreshMillihertz);
+
+    /// @brief: Maps a ring that the emulator created. Called by the producer.
+    /// @param ringFd The ring's memfd, which the mapping takes ownership of.
+    /// @returns: True if the ring was mapped and is of this version, otherwise false.
+    bool attach(int ringFd);
+
+    /// @brief: Gets the memfd of the ring, which is handed to the producer.
+    int get_fd() const { return fd; }
+
+    /// @brief: Gets the start of the ring.
+    emulator_ring_header* get_header() const { return header; }
+
+    /// @brief: Gets the pixels of a slot, which are drawn and scanned out in place.
+    uint8_t* get_pixels(int slot) const;
+
+    /// @brief: Takes a free slot to draw the next frame into. Called by the producer.
+    /// @param timeoutMilliseconds How long to wait for the emulator to give a slot back.
+    /// @returns: The slot, or -1 if none was given back in time.
+    int acquire_slot(int timeoutMilliseconds);
+
+    /// @brief: Hands a drawn slot to the emulator for the next vsync. Called by the producer.
+    /// @param slot The slot from @see acquire_slot.
+    /// @param frameId The number of the frame, which the emulator reports back.
+    /// @returns: True if a frame that was still waiting for a vsync was replaced, otherwise false.
+    bool publish_slot(int slot, uint64_t frameId);
+
+    /// @brief: Waits for a futex word to move on from a value.
+    /// @param word One of the counters in the header.
+    /// @param seen The value the caller last saw.
+    /// @param timeoutMilliseconds How long to wait.
+    /// @returns: True if the word moved on, otherwise false if the wait timed out.
+    static bool wait_for_change(std::atomic<uint32_t>& word, uint32_t seen, int timeoutMilliseconds);
+
+    /// @brief: Bumps a futex word and wakes the other side.
+    static void signal(std::atomic<uint32_t>& word);
+
+    /// @brief: Takes the pending slot at a vsync, and gives the slot that was being scanned out back. Called by the emulator.
+    /// @param scanningSlot The slot that was being scanned out, or -1; updated to the slot that is scanned out from now on.
+    /// @returns: True if a new frame was latched, otherwise false if the last one is shown again.
+    bool latch(int& scanningSlot);
+
+    /// @brief: Gives the pending slot back without showing it, such as when the display is unplugged. Called by the emulator.
+    /// @returns: True if a frame was pending, otherwise false.
+    bool discard_pending();
+
+    /// @brief: Reports the presentation of a frame. Called by the emulator.
+    void report_presentation(const emulator_presentation& presentation);
+
+    /// @brief: Copies the presentations that were reported since the last call. Called by the producer.
+    /// @param cursor The number of presentations that were read, which is moved on past the ones that are copied.
+    /// @param presentations The presentations that are copied into.
+    /// @param maxCount The most presentations that are copied.
+    /// @returns: The number of presentations that were copied. Presentations that were overwritten before they were read are skipped.
+    size_t read_presentations(uint64_t& cursor, emulator_presentation* presentations, size_t maxCount) const;
+
+private:
+    int fd = -1;
+    emulator_ring_header* header = nullptr;
+};
+
+/// @brief: Listens on a Unix socket for producers to hand the ring to.
+/// @param path The path of the socket, which is replaced if it exists.
+/// @returns: The listening socket, which doesn't block, or -1.
+int listen_for_producers(const char* path);
+
+/// @brief: Hands the ring's memfd to a producer that connected.
+/// @param connectedSocket The connected socket.
+/// @param ringFd The memfd.
+/// @returns: True if the memfd was sent, otherwise false.
+bool send_ring_fd(int connectedSocket, int ringFd);
+
+/// @brief: Connects to an emulator and receives its ring's memfd.
+/// @param path The path of the emulator's socket.
+/// @returns: The memfd, or -1.
+int connect_to_emulator(const char* path);
+
+#endif
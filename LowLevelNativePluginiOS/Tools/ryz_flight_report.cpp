@@ -0,0 +1,302 @@
+//
+//  ryz_flight_report.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Summarizes a dump of the plugin's flight recorder, see ikin_ryz_flight_recorder.h.
+//  It prints the percentiles of the intervals between frames, counts what happened to the frames,
+//  and lists the worst intervals with what the plugin recorded during them, which is usually why they were long.
+//
+//  Build on Linux or macOS from this directory:
+//      U="../External Headers/Unity"
+//      c++ -O2 -std=c++14 -I../LowLevelNativePlugin -I"$U" -I"$U/XR" -I"$U/XR/Subsystems" -I"$U/XR/Subsystems/Display" ryz_flight_report.cpp -o ryz_flight_report
+//
+//  Run:
+//      ./ryz_flight_report ryz_flight_hitch_0.bin [--worst 10]
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ikin_ryz_flight_recorder.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The number of worst intervals that are listed when no other is given.
+    const int defaultWorstFrames = 10;
+
+    /// @brief: The share of an interval the render thread has to have been busy for before it is named as a cause.
+    const double busyRenderThreadShare = 0.5;
+
+    /// @brief: The interval from one frame to the next, and the records between them.
+    struct frame_interval
+    {
+        /// @brief: The time the later frame started, in nanoseconds.
+        uint64_t start;
+
+        /// @brief: The interval, in microseconds.
+        double microseconds;
+
+        /// @brief: The records from the start of the earlier frame to the start of the later one, as indexes into the dump.
+        size_t firstRecord;
+        size_t endRecord;
+    };
+
+    /// @brief: Gets a percentile of values that are sorted.
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        if (sorted.empty())
+        {
+            return 0.0;
+        }
+
+        return sorted[std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5))];
+    }
+
+    /// @brief: Gets the name of the reason for a dump.
+    const char* reason_name(uint16_t reason)
+    {
+        switch (reason)
+        {
+            case flight_dump_requested: return "requested";
+            case flight_dump_hitch: return "severe hitch";
+            case flight_dump_shutdown: return "shutdown";
+            default: return "unknown";
+        }
+    }
+
+    /// @brief: Gets the time the render thread started on a frame, from the record of its submission.
+    uint64_t frame_start(const flight_record& record)
+    {
+        return record.timestamp - (uint64_t)record.value * 1000;
+    }
+
+    /// @brief: Describes what the plugin recorded during an interval.
+    /// @param records The records of the dump.
+    /// @param interval The interval.
+    /// @returns: The causes, or a note that the plugin recorded none.
+    std::string describe_causes(const std::vector<flight_record>& records, const frame_interval& interval)
+    {
+        std::string causes;
+        char text[128];
+
+        const auto add = [&causes](const char* cause)
+        {
+            causes += causes.empty() ? "" : ", ";
+            causes += cause;
+        };
+
+        for (size_t i = interval.firstRecord; i < interval.endRecord; ++i)
+        {
+            const flight_record& record = records[i];
+
+            switch (record.type)
+            {
+                case flight_frame_submitted:
+                    if (record.value >= interval.microseconds * busyRenderThreadShare)
+                    {
+                        snprintf(text, sizeof(text), "render thread busy %.2f ms", record.value / 1e3);
+                        add(text);
+                    }
+                    break;
+
+                case flight_frame_dropped:
+                    add("no drawable");
+                    break;
+
+                case flight_hotplug:
+                    add(record.value == connected ? "Ryz connected" : "Ryz disconnected");
+                    break;
+
+                case flight_lock_wait:
+                    snprintf(text, sizeof(text), record.detail != 0 ? "view lock not taken after %.2f ms" : "view lock wait %.2f ms", record.value / 1e3);
+                    add(text);
+                    break;
+
+                case flight_drawable_wait:
+                    snprintf(text, sizeof(text), "drawable wait %.2f ms", record.value / 1e3);
+                    add(text);
+                    break;
+
+                case flight_hitch:
+                    if (record.detail != 0)
+                    {
+                        add("app paused");
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        return causes.empty() ? "nothing in the plugin (Unity's main thread, the GPU or the system)" : causes;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s dump.bin [--worst N]\n", argv[0]);
+        return 2;
+    }
+
+    int worstFrames = defaultWorstFrames;
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (std::string(argv[i]) == "--worst")
+        {
+            worstFrames = std::max(atoi(argv[i + 1]), 0);
+        }
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+
+    if (file == nullptr)
+    {
+        fprintf(stderr, "couldn't open %s\n", argv[1]);
+        return 1;
+    }
+
+    flight_dump_header header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != flightRecorderMagic ||
+        header.version != flightRecorderVersion ||
+        header.recordSize != sizeof(flight_record))
+    {
+        fprintf(stderr, "%s isn't a flight recorder dump of version %d\n", argv[1], (int)flightRecorderVersion);
+        fclose(file);
+        return 1;
+    }
+
+    std::vector<flight_record> records(header.recordCount);
+
+    const size_t recordsRead = records.empty() ? 0 : fread(records.data(), sizeof(flight_record), records.size(), file);
+    fclose(file);
+
+    // If the dump was cut short, then summarize the records it has.
+    records.resize(recordsRead);
+
+    // Count what happened, and find the frames.
+    long counts[flight_hitch + 1] = {};
+    long lockFailures = 0;
+    long pauses = 0;
+    std::vector<size_t> frames;
+    std::vector<double> renderThreadTimes;
+
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        const flight_record& record = records[i];
+
+        if (record.type <= flight_hitch)
+        {
+            ++counts[record.type];
+        }
+
+        if (record.type == flight_frame_submitted)
+        {
+            frames.push_back(i);
+            renderThreadTimes.push_back(record.value);
+        }
+        else if (record.type == flight_lock_wait && record.detail != 0)
+        {
+            ++lockFailures;
+        }
+        else if (record.type == flight_hitch && record.detail != 0)
+        {
+            ++pauses;
+        }
+    }
+
+    // Each interval runs from the start of a frame to the start of the next, and holds the records in between.
+    std::vector<frame_interval> intervals;
+
+    for (size_t i = 1; i < frames.size(); ++i)
+    {
+        const uint64_t previousStart = frame_start(records[frames[i - 1]]);
+        const uint64_t start = frame_start(records[frames[i]]);
+
+        // The records of the earlier frame come before its submission record, which is written once it is done.
+        // The later frame's own waits come after it starts, so they belong to the next interval.
+        const auto compare = [](const flight_record& record, uint64_t timestamp) { return record.timestamp < timestamp; };
+
+        const size_t firstRecord = std::lower_bound(records.begin(), records.begin() + frames[i - 1], previousStart, compare) - records.begin();
+        const size_t endRecord = std::lower_bound(records.begin() + frames[i - 1], records.begin() + frames[i], start, compare) - records.begin();
+
+        intervals.push_back({ start, (double)(start - previousStart) / 1e3, firstRecord, endRecord });
+    }
+
+    const double seconds = records.empty() ? 0.0 : (double)(header.timestamp - records.front().timestamp) / 1e9;
+
+    printf("%s: %s dump, %zu records over the last %.1f s, %u older records not kept\n",
+           argv[1], reason_name(header.reason), records.size(), seconds, header.olderRecords);
+
+    if (header.hitchMicroseconds != 0)
+    {
+        printf("severe hitch threshold: %.1f ms\n", header.hitchMicroseconds / 1e3);
+    }
+
+    printf("frames: %ld submitted, %ld presented, %ld skipped as unchanged, %ld dropped without a drawable\n",
+           counts[flight_frame_submitted], counts[flight_frame_presented], counts[flight_frame_skipped], counts[flight_frame_dropped]);
+
+    printf("events: %ld hotplugs, %ld view lock waits (%ld not taken), %ld drawable waits, %ld severe hitches, %ld pauses\n",
+           counts[flight_hotplug], counts[flight_lock_wait], lockFailures, counts[flight_drawable_wait], counts[flight_hitch] - pauses, pauses);
+
+    if (intervals.empty())
+    {
+        printf("no frame intervals to summarize\n");
+        return 0;
+    }
+
+    std::vector<double> sortedIntervals;
+
+    for (const frame_interval& interval : intervals)
+    {
+        sortedIntervals.push_back(interval.microseconds / 1e3);
+    }
+
+    std::sort(sortedIntervals.begin(), sortedIntervals.end());
+    std::sort(renderThreadTimes.begin(), renderThreadTimes.end());
+
+    printf("frame interval: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           percentile(sortedIntervals, 0.5), percentile(sortedIntervals, 0.95), percentile(sortedIntervals, 0.99), sortedIntervals.back());
+
+    printf("render thread:  p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           percentile(renderThreadTimes, 0.5) / 1e3, percentile(renderThreadTimes, 0.95) / 1e3, percentile(renderThreadTimes, 0.99) / 1e3, renderThreadTimes.back() / 1e3);
+
+    // List the longest intervals, with when they ended before the dump and what was recorded during them.
+    std::vector<const frame_interval*> worst;
+
+    for (const frame_interval& interval : intervals)
+    {
+        worst.push_back(&interval);
+    }
+
+    const size_t listed = std::min(worst.size(), (size_t)worstFrames);
+    std::partial_sort(worst.begin(), worst.begin() + listed, worst.end(), [](const frame_interval* a, const frame_interval* b) { return a->microseconds > b->microseconds; });
+
+    if (listed > 0)
+    {
+        printf("\nworst %zu frame intervals:\n", listed);
+    }
+
+    for (size_t i = 0; i < listed; ++i)
+    {
+        const frame_interval& interval = *worst[i];
+
+        printf("  %8.2f ms at -%.3f s: %s\n",
+               interval.microseconds / 1e3,
+               (double)(header.timestamp - interval.start) / 1e9,
+               describe_causes(records, interval).c_str());
+    }
+
+    return 0;
+}
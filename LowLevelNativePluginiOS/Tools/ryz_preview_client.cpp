@@ -0,0 +1,160 @@
+//
+//  ryz_preview_client.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Connects to the preview server of the plugin, see ikin_ryz_preview_server.h, and decodes the Ryz eye it streams.
+//  It prints what it receives each second, and saves the last frame it decoded as a PPM image when it exits.
+//
+//  Build on Linux or macOS from this directory:
+//      c++ -O2 -std=c++14 -I../LowLevelNativePlugin ryz_preview_client.cpp ../LowLevelNativePlugin/ikin_ryz_preview_codec.cpp ../LowLevelNativePlugin/ikin_ryz_tile_hash.cpp -o ryz_preview_client
+//
+//  Reach a device over USB by forwarding the port first, such as with "iproxy 7878 7878", then:
+//      ./ryz_preview_client 127.0.0.1 7878 [frame count] [output.ppm]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ikin_ryz_preview_codec.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: Reads exactly a number of bytes.
+    /// @returns: True if they were read, otherwise false if the server closed the connection.
+    bool read_exactly(int socket, uint8_t* bytes, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t result = recv(socket, bytes, size, 0);
+
+            if (result <= 0)
+            {
+                return false;
+            }
+
+            bytes += result;
+            size -= result;
+        }
+
+        return true;
+    }
+
+    /// @brief: Saves an image as a binary PPM.
+    /// @returns: True if the file was written, otherwise false.
+    bool write_ppm(const char* path, const preview_decoder& decoder)
+    {
+        FILE* file = fopen(path, "wb");
+
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        fprintf(file, "P6\n%d %d\n255\n", decoder.get_width(), decoder.get_height());
+
+        const std::vector<uint8_t>& pixels = decoder.get_pixels();
+
+        for (size_t i = 0; i < pixels.size(); i += 4)
+        {
+            const uint8_t rgb[3] = { pixels[i + 2], pixels[i + 1], pixels[i] };
+            fwrite(rgb, 1, sizeof(rgb), file);
+        }
+
+        return fclose(file) == 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s host port [frame count] [output.ppm]\n", argv[0]);
+        return 2;
+    }
+
+    const long frameLimit = argc > 3 ? atol(argv[3]) : 0;
+    const char* outputPath = argc > 4 ? argv[4] : nullptr;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)atoi(argv[2]));
+
+    const int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (inet_pton(AF_INET, argv[1], &address.sin_addr) != 1 || connect(serverSocket, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        fprintf(stderr, "couldn't connect to %s:%s\n", argv[1], argv[2]);
+        return 1;
+    }
+
+    preview_decoder decoder;
+    std::vector<uint8_t> payload;
+    uint8_t headerBytes[previewHeaderSize];
+    long frames = 0;
+    long secondFrames = 0;
+    long secondTiles = 0;
+    long secondBytes = 0;
+    std::chrono::steady_clock::time_point secondStart = std::chrono::steady_clock::now();
+
+    while (frameLimit == 0 || frames < frameLimit)
+    {
+        preview_header header;
+
+        if (!read_exactly(serverSocket, headerBytes, sizeof(headerBytes)))
+        {
+            break;
+        }
+
+        if (!read_preview_header(headerBytes, header))
+        {
+            fprintf(stderr, "not a preview stream of version %d\n", previewVersion);
+            return 1;
+        }
+
+        payload.resize(header.payloadSize);
+
+        if (!read_exactly(serverSocket, payload.data(), payload.size()) || !decoder.decode(header, payload.data()))
+        {
+            fprintf(stderr, "frame %u couldn't be decoded\n", header.frameIndex);
+            return 1;
+        }
+
+        ++frames;
+        ++secondFrames;
+        secondTiles += header.tileCount;
+        secondBytes += previewHeaderSize + header.payloadSize;
+
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - secondStart).count();
+
+        if (elapsed >= 1.0)
+        {
+            printf("%dx%d frame %u: %.1f fps, %.0f tiles/frame, %.1f KB/s\n", decoder.get_width(), decoder.get_height(), header.frameIndex,
+                   secondFrames / elapsed, (double)secondTiles / secondFrames, secondBytes / elapsed / 1024.0);
+
+            secondFrames = secondTiles = secondBytes = 0;
+            secondStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    close(serverSocket);
+
+    printf("received %ld frames\n", frames);
+
+    if (outputPath != nullptr && decoder.get_width() > 0 && !write_ppm(outputPath, decoder))
+    {
+        fprintf(stderr, "couldn't write %s\n", outputPath);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,434 @@
+//
+//  ryz_replay.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Replays a trace of the inputs of the display provider, see ikin_ryz_input_trace.h, on a host machine.
+//  The camera matrices and display events are replayed through the plugin's own exports, in the order and at the times they were recorded,
+//  and each submitted frame is published to ryz_emulator.cpp when one is running, so a session from a device can be rerun under a profiler.
+//  It ends with a hash of the state the inputs left behind, which is the same on every replay of the same trace.
+//
+//  Build on Linux from this directory:
+//      U="../External Headers/Unity"
+//      c++ -O2 -std=c++14 -pthread -I../LowLevelNativePlugin -I"$U" -I"$U/XR" -I"$U/XR/Subsystems" -I"$U/XR/Subsystems/Display" ryz_replay.cpp ../LowLevelNativePlugin/ikin_ryz_input_trace.cpp ../LowLevelNativePlugin/ikin_ryz_flight_recorder.cpp ../LowLevelNativePlugin/ikin_ryz_timeline.cpp ../LowLevelNativePlugin/native_to_unity_notifiers.cpp ryz_emulator/ryz_emulator_ring.cpp -o ryz_replay
+//
+//  Run:
+//      ./ryz_replay trace.bin [--speed 1] [--loops 1] [--emulator /tmp/ryz_emulator.sock] [--timeline replay_timeline.json] [--flight replay_flight.bin]
+//
+//  --speed 2 replays twice as fast as the trace was recorded, and --speed 0 replays without waiting between inputs.
+//  --timeline records the replay on the plugin's timeline, see ikin_ryz_timeline.h, and exports it when the replay ends or the tool receives SIGUSR1.
+//  --flight dumps the flight recorder, which the replay feeds the way the provider does, when the replay ends. ryz_flight_report summarizes the dump.
+//
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <time.h>
+
+#include "IUnityXRDisplay.h"
+#include "ikin_ryz_input_trace.h"
+#include "ikin_ryz_flight_recorder.h"
+#include "ikin_ryz_timeline.h"
+#include "native_to_unity_notifiers.h"
+#include "ryz_emulator/ryz_emulator_ring.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: How long to wait for the emulator to give a slot back, in milliseconds.
+    const int replayTimeoutMilliseconds = 1000;
+
+    /// @brief: The number of kinds of record, counting the end marker.
+    const int recordTypeCount = input_trace_submit + 1;
+
+    /// @brief: The names of the kinds of record, for the summary.
+    const char* const recordTypeNames[recordTypeCount] = { "end", "frame hints", "camera matrix", "display event", "submit" };
+
+    /// @brief: The settings of the replay.
+    struct replay_options
+    {
+        std::string tracePath;
+        double speed = 1.0;
+        long loops = 1;
+        std::string emulatorSocketPath;
+        std::string timelinePath;
+        std::string flightPath;
+    };
+
+    /// @brief: What was measured while the inputs were replayed.
+    struct replay_measurements
+    {
+        /// @brief: How late each input was replayed relative to its recorded time, in microseconds.
+        std::vector<double> lateness;
+
+        /// @brief: How long the provider took to handle each input, in microseconds, by kind.
+        std::vector<double> callTimes[recordTypeCount];
+
+        long displayEventsDelivered = 0;
+        long resolutionScaleChanges = 0;
+        long viewportChanges = 0;
+        long framesPublished = 0;
+        long framesReplaced = 0;
+        long framesPresented = 0;
+        long missedVsyncs = 0;
+    };
+
+    /// @brief: Reads the options from the command line.
+    /// @returns: True if every option was understood, otherwise false.
+    bool parse_options(int argc, char** argv, replay_options& options)
+    {
+        if (argc < 2 || argc % 2 != 0)
+        {
+            return false;
+        }
+
+        options.tracePath = argv[1];
+
+        for (int i = 2; i + 1 < argc; i += 2)
+        {
+            const std::string name = argv[i];
+            const char* value = argv[i + 1];
+
+            if (name == "--speed") options.speed = atof(value);
+            else if (name == "--loops") options.loops = atol(value);
+            else if (name == "--emulator") options.emulatorSocketPath = value;
+            else if (name == "--timeline") options.timelinePath = value;
+            else if (name == "--flight") options.flightPath = value;
+            else return false;
+        }
+
+        return options.speed >= 0.0 && options.loops > 0;
+    }
+
+    /// @brief: Sleeps until a time on CLOCK_MONOTONIC.
+    void sleep_until(uint64_t nanoseconds)
+    {
+        const timespec wakeTime = { (time_t)(nanoseconds / 1000000000ull), (long)(nanoseconds % 1000000000ull) };
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTime, nullptr) != 0)
+        {
+        }
+    }
+
+    /// @brief: Gets a percentile of sorted values.
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(fraction * (sorted.size() - 1) + 0.5))];
+    }
+
+    /// @brief: Folds bytes into an FNV-1a hash.
+    uint64_t hash_bytes(uint64_t hash, const void* bytes, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ ((const uint8_t*)bytes)[i]) * 0x100000001B3ull;
+        }
+
+        return hash;
+    }
+
+    /// @brief: Draws a frame whose shade is its number, so that the emulator's dump shows which frame was last.
+    void draw_frame(uint8_t* pixels, const emulator_ring_header& header, uint64_t frameIndex)
+    {
+        memset(pixels, (int)(frameIndex & 0xFF), (size_t)header.bytesPerRow * header.height);
+    }
+
+    /// @brief: Replays the inputs of the trace once.
+    /// @returns: True if every record was understood, otherwise false.
+    bool replay_trace(input_trace_reader& reader, const replay_options& options, emulator_ring* ring, replay_measurements& measurements)
+    {
+        UnityXRFrameSetupHints lastHints = {};
+        bool hasHints = false;
+        uint64_t presentationCursor = ring != nullptr ? ring->get_header()->presentationCount.load() : 0;
+        std::vector<emulator_presentation> presentations(emulatorPresentationCount);
+        const uint64_t start = emulator_now_nanoseconds();
+        input_trace_record record;
+
+        reader.rewind();
+
+        while (reader.next(record))
+        {
+            // Each input is replayed at its recorded time, or straight away if replaying is behind.
+            if (options.speed > 0.0)
+            {
+                const uint64_t deadline = start + (uint64_t)(record.timestamp / options.speed);
+
+                if (emulator_now_nanoseconds() < deadline)
+                {
+                    sleep_until(deadline);
+                }
+
+                measurements.lateness.push_back((double)(int64_t)(emulator_now_nanoseconds() - deadline) / 1e3);
+            }
+
+            const uint64_t callStart = emulator_now_nanoseconds();
+
+            timeline_begin(recordTypeNames[std::min<int>(record.type, recordTypeCount - 1)]);
+
+            switch (record.type)
+            {
+                case input_trace_frame_hints:
+                {
+                    // If the trace was recorded against other Unity headers, then its hints can't be read.
+                    if (record.size != sizeof(UnityXRFrameSetupHints))
+                    {
+                        fprintf(stderr, "the frame hints are %u bytes, but these headers make them %zu\n", record.size, sizeof(UnityXRFrameSetupHints));
+                        return false;
+                    }
+
+                    UnityXRFrameSetupHints hints;
+                    memcpy(&hints, record.payload, sizeof(hints));
+
+                    // The textures are recreated whenever the resolution scale changes, which is the costly part of a hint.
+                    if (hasHints && hints.appSetup.textureResolutionScale != lastHints.appSetup.textureResolutionScale)
+                    {
+                        ++measurements.resolutionScaleChanges;
+                    }
+
+                    if (hasHints && memcmp(&hints.appSetup.renderViewport, &lastHints.appSetup.renderViewport, sizeof(UnityXRRectf)) != 0)
+                    {
+                        ++measurements.viewportChanges;
+                    }
+
+                    lastHints = hints;
+                    hasHints = true;
+                    break;
+                }
+
+                case input_trace_camera_matrix:
+                {
+                    int32_t stereoTargetMask;
+                    float m[16];
+
+                    memcpy(&stereoTargetMask, record.payload, sizeof(stereoTargetMask));
+                    memcpy(m, record.payload + sizeof(stereoTargetMask), sizeof(m));
+
+                    ikinRyzSetCameraMatrix(stereoTargetMask, m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15]);
+                    break;
+                }
+
+                case input_trace_display_event:
+                {
+                    int32_t value;
+                    memcpy(&value, record.payload, sizeof(value));
+
+                    ikinRyzOnDisplayEvent((display_event)value);
+                    break;
+                }
+
+                case input_trace_submit:
+                {
+                    uint64_t frameIndex;
+                    memcpy(&frameIndex, record.payload, sizeof(frameIndex));
+
+                    timeline_flow(timeline_flow_start, frameIndex);
+
+                    const uint64_t flightFrameStart = flight_recorder_now();
+
+                    // If an emulator is attached and showing frames, then hand it the frame the way the provider would.
+                    if (ring != nullptr && ring->get_header()->connected.load() != 0)
+                    {
+                        const int slot = ring->acquire_slot(replayTimeoutMilliseconds);
+
+                        if (slot < 0)
+                        {
+                            fprintf(stderr, "the emulator didn't give a slot back\n");
+                            return false;
+                        }
+
+                        record_flight_wait(flight_drawable_wait, flightFrameStart);
+
+                        draw_frame(ring->get_pixels(slot), *ring->get_header(), frameIndex);
+
+                        record_flight(flight_frame_presented, 0);
+
+                        if (ring->publish_slot(slot, frameIndex))
+                        {
+                            ++measurements.framesReplaced;
+                        }
+
+                        ++measurements.framesPublished;
+                    }
+
+                    record_flight_frame(flightFrameStart);
+
+                    break;
+                }
+
+                default:
+                    fprintf(stderr, "the trace holds a record of an unknown kind %d\n", (int)record.type);
+                    return false;
+            }
+
+            timeline_end(recordTypeNames[record.type]);
+
+            measurements.callTimes[record.type].push_back((emulator_now_nanoseconds() - callStart) / 1e3);
+
+            if (ring != nullptr)
+            {
+                const size_t count = ring->read_presentations(presentationCursor, presentations.data(), presentations.size());
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    ++measurements.framesPresented;
+                    measurements.missedVsyncs += presentations[i].vsyncsSinceLastFrame - 1;
+
+                    timeline_milestone("On emulated display", timeline_flow_end, presentations[i].frameId);
+                }
+            }
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    replay_options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        fprintf(stderr, "usage: %s trace.bin [--speed N] [--loops N] [--emulator socket] [--timeline path.json] [--flight path.bin]\n", argv[0]);
+        return 2;
+    }
+
+    input_trace_reader reader;
+
+    if (!reader.open(options.tracePath.c_str()))
+    {
+        fprintf(stderr, "%s isn't a trace of this version\n", options.tracePath.c_str());
+        return 1;
+    }
+
+    // Summarize the trace before replaying it.
+    long recordCounts[recordTypeCount] = {};
+    uint64_t traceDuration = 0;
+    input_trace_record record;
+
+    while (reader.next(record))
+    {
+        ++recordCounts[std::min<int>(record.type, recordTypeCount - 1)];
+        traceDuration = std::max(traceDuration, record.timestamp);
+    }
+
+    printf("%s: %.3f s, %ld frame hints, %ld camera matrices, %ld display events, %ld submits\n", options.tracePath.c_str(), traceDuration / 1e9,
+           recordCounts[input_trace_frame_hints], recordCounts[input_trace_camera_matrix], recordCounts[input_trace_display_event], recordCounts[input_trace_submit]);
+
+    if (reader.get_dropped_records() > 0)
+    {
+        printf("warning: %llu inputs didn't fit in the trace and are missing from the end\n", (unsigned long long)reader.get_dropped_records());
+    }
+
+    emulator_ring ring;
+    emulator_ring* attachedRing = nullptr;
+
+    if (!options.emulatorSocketPath.empty())
+    {
+        const int ringFd = connect_to_emulator(options.emulatorSocketPath.c_str());
+
+        if (ringFd < 0 || !ring.attach(ringFd))
+        {
+            fprintf(stderr, "couldn't attach to the emulator on %s\n", options.emulatorSocketPath.c_str());
+            return 1;
+        }
+
+        attachedRing = &ring;
+    }
+
+    // If the replay is put on the timeline, then it can also be exported while it runs, with "kill -USR1".
+    if (!options.timelinePath.empty())
+    {
+        start_timeline(defaultTimelineEventCount);
+        name_timeline_thread("Replay");
+        export_timeline_on_signal(SIGUSR1, options.timelinePath.c_str());
+    }
+
+    replay_measurements measurements;
+
+    ikinRyzAddOnDisplayEvent([&measurements](display_event) { ++measurements.displayEventsDelivered; });
+
+    const uint64_t replayStart = emulator_now_nanoseconds();
+
+    for (long loop = 0; loop < options.loops; ++loop)
+    {
+        if (!replay_trace(reader, options, attachedRing, measurements))
+        {
+            return 1;
+        }
+    }
+
+    const double replaySeconds = (emulator_now_nanoseconds() - replayStart) / 1e9;
+
+    // The state the provider is left in only depends on the inputs and their order, so it hashes the same on every replay.
+    uint64_t stateHash = 0xCBF29CE484222325ull;
+    const int32_t lastDisplayEvent = (int32_t)ikinRyzGetDisplayEvent();
+    const int32_t lastProjectionType = (int32_t)projectionType;
+
+    stateHash = hash_bytes(stateHash, &leftProjectionMatrix, sizeof(leftProjectionMatrix));
+    stateHash = hash_bytes(stateHash, &rightProjectionMatrix, sizeof(rightProjectionMatrix));
+    stateHash = hash_bytes(stateHash, &lastProjectionType, sizeof(lastProjectionType));
+    stateHash = hash_bytes(stateHash, &lastDisplayEvent, sizeof(lastDisplayEvent));
+
+    printf("replayed %ld time(s) in %.3f s, %ld display events delivered, %ld resolution scale changes, %ld viewport changes\n",
+           options.loops, replaySeconds, measurements.displayEventsDelivered, measurements.resolutionScaleChanges, measurements.viewportChanges);
+
+    if (!measurements.lateness.empty())
+    {
+        std::sort(measurements.lateness.begin(), measurements.lateness.end());
+
+        printf("lateness against the trace: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+               percentile(measurements.lateness, 0.5), percentile(measurements.lateness, 0.99), measurements.lateness.back());
+    }
+
+    for (int type = input_trace_frame_hints; type < recordTypeCount; ++type)
+    {
+        std::vector<double>& times = measurements.callTimes[type];
+
+        if (!times.empty())
+        {
+            std::sort(times.begin(), times.end());
+
+            printf("%-14s p50 %.2f us, p99 %.2f us, max %.2f us\n", recordTypeNames[type], percentile(times, 0.5), percentile(times, 0.99), times.back());
+        }
+    }
+
+    if (attachedRing != nullptr)
+    {
+        printf("emulator: %ld frames published, %ld replaced before a vsync, %ld presented, %ld vsyncs missed\n",
+               measurements.framesPublished, measurements.framesReplaced, measurements.framesPresented, measurements.missedVsyncs);
+    }
+
+    printf("state hash: %016llx\n", (unsigned long long)stateHash);
+
+    if (!options.timelinePath.empty())
+    {
+        stop_timeline();
+
+        if (!export_timeline(options.timelinePath.c_str()))
+        {
+            fprintf(stderr, "couldn't export the timeline to %s\n", options.timelinePath.c_str());
+            return 1;
+        }
+
+        printf("timeline exported to %s\n", options.timelinePath.c_str());
+    }
+
+    if (!options.flightPath.empty())
+    {
+        if (!dump_flight_recorder(options.flightPath.c_str(), flight_dump_requested))
+        {
+            fprintf(stderr, "couldn't dump the flight recorder to %s\n", options.flightPath.c_str());
+            return 1;
+        }
+
+        printf("flight recorder dumped to %s\n", options.flightPath.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,347 @@
+//
+//  ryz_color_lut_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Checks the color calibration's CPU reference, see ikin_ryz_color_lut.h: .cube files are loaded with their titles,
+//  comments and default domains, and rejected whole when malformed, an identity table leaves every color as it is, a
+//  known .cube that inverts colors maps each pixel to its inverse, colors inside a cell are blended from the four corners
+//  of the tetrahedron that holds them, greys stay grey, and the pixels are read and written in BGRA order with alpha kept.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin
+//      c++ -O2 -std=c++14 -Wall -Wextra -I$P ryz_color_lut_test.cpp $P/ikin_ryz_color_lut.cpp -o ryz_color_lut_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_color_lut_test [directory for the .cube files, /tmp by default]
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ikin_ryz_color_lut.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: Writes a text file.
+    bool write_file(const std::string& path, const std::string& text)
+    {
+        FILE* file = fopen(path.c_str(), "w");
+
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        fputs(text.c_str(), file);
+        fclose(file);
+        return true;
+    }
+
+    /// @brief: Gets the text of a .cube file whose entries are a function of their red, green and blue inputs.
+    template <typename Function>
+    std::string cube_text(int size, Function function)
+    {
+        std::string text = "TITLE \"ryz_color_lut_test\"\n# Generated.\nLUT_3D_SIZE " + std::to_string(size) + "\nDOMAIN_MIN 0 0 0\nDOMAIN_MAX 1 1 1\n";
+
+        for (int blue = 0; blue < size; ++blue)
+        {
+            for (int green = 0; green < size; ++green)
+            {
+                for (int red = 0; red < size; ++red)
+                {
+                    float output[3];
+                    function((float)red / (size - 1), (float)green / (size - 1), (float)blue / (size - 1), output);
+
+                    char line[64];
+                    snprintf(line, sizeof(line), "%.6f %.6f %.6f\n", output[0], output[1], output[2]);
+                    text += line;
+                }
+            }
+        }
+
+        return text;
+    }
+
+    /// @brief: Gets a table from its red, green and blue entries, with red changing fastest.
+    color_lut make_lut(int size, const std::vector<float>& rgb)
+    {
+        std::shared_ptr<std::vector<float>> entries = std::make_shared<std::vector<float>>();
+
+        for (size_t entry = 0; entry < rgb.size() / 3; ++entry)
+        {
+            entries->insert(entries->end(), { rgb[entry * 3], rgb[entry * 3 + 1], rgb[entry * 3 + 2], 1.0f });
+        }
+
+        color_lut lut;
+        lut.size = size;
+        lut.entries = std::shared_ptr<const float>(entries, entries->data());
+
+        return lut;
+    }
+
+    /// @brief: Gets a BGRA image of random pixels, including the padding at the end of its rows.
+    std::vector<uint8_t> random_image(int height, size_t bytesPerRow, unsigned seed)
+    {
+        std::vector<uint8_t> pixels(bytesPerRow * height);
+        srand(seed);
+
+        for (uint8_t& byte : pixels)
+        {
+            byte = (uint8_t)(rand() & 0xFF);
+        }
+
+        return pixels;
+    }
+
+    /// @brief: Gets the byte a normalized value is written as.
+    uint8_t to_byte(float value)
+    {
+        return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    /// @brief: .cube files are loaded with their titles, comments and domains, and malformed ones are rejected without changing the table.
+    void test_load(const std::string& directory)
+    {
+        const char* test = "load";
+
+        const std::string path = directory + "/ryz_color_lut_test.cube";
+        color_lut lut = {};
+
+        write_file(path, cube_text(3, [](float red, float green, float blue, float* output)
+        {
+            output[0] = red * 0.5f;
+            output[1] = green;
+            output[2] = blue;
+        }));
+
+        check(load_color_lut(path.c_str(), lut), test, "a valid table wasn't loaded");
+        check(lut.size == 3 && lut.entries && lut.entries.get()[2 * 4] == 0.5f && lut.entries.get()[2 * 4 + 3] == 1.0f, test, "the table was loaded wrongly");
+
+        // Each of these is rejected, and leaves the loaded table as it was.
+        const char* malformed[] =
+        {
+            "LUT_3D_SIZE 2\n0 0 0\n1 0 0\n0 1 0\n",                                                    // Entries are missing.
+            "LUT_3D_SIZE 2\n0 0 0\n1 0 0\n0 1 0\n1 1 0\n0 0 1\n1 0 1\n0 1 1\n1 1 1\n1 1 1\n",        // An entry too many.
+            "LUT_1D_SIZE 2\n0 0 0\n1 1 1\n",                                                           // A 1D table.
+            "0 0 0\nLUT_3D_SIZE 2\n",                                                                  // An entry before the size.
+            "LUT_3D_SIZE 1\n0 0 0\n",                                                                  // Too few entries along each axis.
+            "LUT_3D_SIZE 66\n",                                                                        // Too many entries along each axis.
+            "LUT_3D_SIZE 2\nDOMAIN_MAX 2 2 2\n",                                                       // A domain other than the default.
+            "LUT_3D_SIZE 2\n0 0 0\n1 0 0\n0 1 0\n1 1 0\n0 0 1\n1 0 1\n0 1 1\n1 1\n",                  // An entry without blue.
+        };
+
+        for (const char* text : malformed)
+        {
+            write_file(path, text);
+            check(!load_color_lut(path.c_str(), lut), test, "a malformed table was loaded");
+        }
+
+        check(lut.size == 3, test, "a rejected file changed the table");
+        check(!load_color_lut((directory + "/ryz_color_lut_test_missing.cube").c_str(), lut), test, "a missing file was loaded");
+
+        remove(path.c_str());
+    }
+
+    /// @brief: An identity table leaves every pixel as it is, whatever its size.
+    void test_identity(const std::string& directory)
+    {
+        const char* test = "identity";
+
+        const std::string path = directory + "/ryz_color_lut_test.cube";
+
+        for (int size : { 2, 17, 33 })
+        {
+            color_lut lut = {};
+
+            write_file(path, cube_text(size, [](float red, float green, float blue, float* output)
+            {
+                output[0] = red;
+                output[1] = green;
+                output[2] = blue;
+            }));
+
+            check(load_color_lut(path.c_str(), lut), test, "the identity table wasn't loaded");
+
+            const int width = 61;
+            const int height = 13;
+            const size_t bytesPerRow = width * 4 + 8;
+            const std::vector<uint8_t> original = random_image(height, bytesPerRow, (unsigned)size);
+            std::vector<uint8_t> pixels = original;
+
+            apply_color_lut(pixels.data(), width, height, bytesPerRow, lut);
+
+            check(pixels == original, test, "an identity table changed the image");
+        }
+
+        remove(path.c_str());
+    }
+
+    /// @brief: A known .cube file that inverts colors maps each pixel to its inverse, leaving alpha as it is.
+    void test_known_cube(const std::string& directory)
+    {
+        const char* test = "known cube";
+
+        const std::string path = directory + "/ryz_color_lut_test.cube";
+        color_lut lut = {};
+
+        // Red changes fastest, so the entries run from white to black in this order.
+        write_file(path,
+                   "# Inverts colors.\n"
+                   "LUT_3D_SIZE 2\n"
+                   "1 1 1\n0 1 1\n1 0 1\n0 0 1\n"
+                   "1 1 0\n0 1 0\n1 0 0\n0 0 0\n");
+
+        check(load_color_lut(path.c_str(), lut), test, "the table wasn't loaded");
+
+        const int width = 16;
+        const int height = 16;
+        const size_t bytesPerRow = width * 4;
+        const std::vector<uint8_t> original = random_image(height, bytesPerRow, 9);
+        std::vector<uint8_t> pixels = original;
+
+        apply_color_lut(pixels.data(), width, height, bytesPerRow, lut);
+
+        bool inverted = true;
+        bool alphaKept = true;
+
+        for (size_t pixel = 0; pixel < pixels.size(); pixel += 4)
+        {
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                inverted &= pixels[pixel + channel] == 255 - original[pixel + channel];
+            }
+
+            alphaKept &= pixels[pixel + 3] == original[pixel + 3];
+        }
+
+        check(inverted, test, "the colors weren't inverted");
+        check(alphaKept, test, "alpha was changed");
+
+        remove(path.c_str());
+    }
+
+    /// @brief: A color inside a cell is blended from the four corners of the tetrahedron that holds it, picked by the order of its fractions.
+    void test_tetrahedron()
+    {
+        const char* test = "tetrahedron";
+
+        // Corners with unrelated red outputs, so that blending the wrong corners gives the wrong value.
+        const float corners[8] = { 0.13f, 0.91f, 0.37f, 0.22f, 0.64f, 0.29f, 0.83f, 0.55f };
+        std::vector<float> rgb;
+
+        for (float corner : corners)
+        {
+            rgb.insert(rgb.end(), { corner, 0.0f, 0.0f });
+        }
+
+        const color_lut lut = make_lut(2, rgb);
+
+        // Each order of the red, green and blue fractions picks another tetrahedron. Inputs are in RGB order.
+        const int inputs[6][3] = { { 153, 102, 51 }, { 153, 51, 102 }, { 102, 51, 153 },
+                                   { 51, 102, 153 }, { 51, 153, 102 }, { 102, 153, 51 } };
+
+        bool blended = true;
+
+        for (const int* input : inputs)
+        {
+            const float fraction[3] = { input[0] / 255.0f, input[1] / 255.0f, input[2] / 255.0f };
+
+            // Step from black to white along the axes from the largest fraction to the smallest.
+            int order[3] = { 0, 1, 2 };
+            std::sort(order, order + 3, [&fraction](int a, int b) { return fraction[a] > fraction[b]; });
+
+            const int step[3] = { 1, 2, 4 };
+            const int second = step[order[0]];
+            const int third = second + step[order[1]];
+
+            const float expected = corners[0] * (1.0f - fraction[order[0]]) +
+                                   corners[second] * (fraction[order[0]] - fraction[order[1]]) +
+                                   corners[third] * (fraction[order[1]] - fraction[order[2]]) +
+                                   corners[7] * fraction[order[2]];
+
+            uint8_t pixel[4] = { (uint8_t)input[2], (uint8_t)input[1], (uint8_t)input[0], 77 };
+            apply_color_lut(pixel, 1, 1, 4, lut);
+
+            blended &= pixel[2] == to_byte(expected) && pixel[1] == 0 && pixel[0] == 0 && pixel[3] == 77;
+        }
+
+        check(blended, test, "a color wasn't blended from the corners of its tetrahedron");
+    }
+
+    /// @brief: A table that keeps greys grey at its entries keeps every grey between them grey too.
+    void test_greys()
+    {
+        const char* test = "greys";
+
+        // A table that darkens with a curve, and tints colors that aren't grey.
+        std::vector<float> rgb;
+        const int size = 5;
+
+        for (int blue = 0; blue < size; ++blue)
+        {
+            for (int green = 0; green < size; ++green)
+            {
+                for (int red = 0; red < size; ++red)
+                {
+                    const float grey = (red + green + blue) / (3.0f * (size - 1));
+                    const float curve = grey * grey;
+
+                    rgb.insert(rgb.end(), { curve + (red - green) * 0.05f, curve, curve + (blue - green) * 0.05f });
+                }
+            }
+        }
+
+        const color_lut lut = make_lut(size, rgb);
+
+        bool grey = true;
+
+        for (int value = 0; value < 256; ++value)
+        {
+            uint8_t pixel[4] = { (uint8_t)value, (uint8_t)value, (uint8_t)value, 255 };
+            apply_color_lut(pixel, 1, 1, 4, lut);
+
+            grey &= pixel[0] == pixel[1] && pixel[1] == pixel[2];
+        }
+
+        check(grey, test, "a grey input came out tinted");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::string directory = argc > 1 ? argv[1] : "/tmp";
+
+    test_load(directory);
+    test_identity(directory);
+    test_known_cube(directory);
+    test_tetrahedron();
+    test_greys();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,340 @@
+//
+//  ryz_damage_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Checks the damage rectangles that decide which regions of the Ryz eye are copied, see ikin_ryz_damage.h:
+//  rectangles are clipped to the image, overlapping and touching ones are merged, too many are merged down to few
+//  without leaving any damaged pixel out, more than 256 reported in one frame collapse into their bounds, changed
+//  tile hashes become rectangles, and copying the rectangles updates exactly the damaged pixels.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin; U="../../External Headers/Unity"
+//      c++ -O2 -std=c++14 -Wall -Wextra -pthread -I$P -I"$U" -I"$U/XR" -I"$U/XR/Subsystems" -I"$U/XR/Subsystems/Display" ryz_damage_test.cpp $P/ikin_ryz_damage.cpp -o ryz_damage_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_damage_test
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ikin_ryz_damage.h"
+#include "ikin_ryz_tile_hash.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: Gets a value indicating whether two rectangles are the same.
+    bool same_rect(const damage_rect& a, const damage_rect& b)
+    {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+    }
+
+    /// @brief: Gets a value indicating whether a rectangle covers a pixel.
+    bool covers(const damage_rect& rect, int x, int y)
+    {
+        return x >= rect.x && x < rect.x + rect.width && y >= rect.y && y < rect.y + rect.height;
+    }
+
+    /// @brief: Gets a value indicating whether any of the rectangles covers a pixel.
+    bool any_covers(const std::vector<damage_rect>& rects, int x, int y)
+    {
+        for (const damage_rect& rect : rects)
+        {
+            if (covers(rect, x, y))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// @brief: Gets a value indicating whether no two of the rectangles overlap.
+    bool none_overlap(const std::vector<damage_rect>& rects)
+    {
+        for (size_t first = 0; first < rects.size(); ++first)
+        {
+            for (size_t second = first + 1; second < rects.size(); ++second)
+            {
+                const damage_rect& a = rects[first];
+                const damage_rect& b = rects[second];
+
+                if (a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief: Rectangles are cut to the image, and the ones left empty are dropped.
+    void test_clip()
+    {
+        const char* test = "clip";
+
+        std::vector<damage_rect> rects =
+        {
+            { -10, -5, 30, 20 },    // Hangs off the top left.
+            { 90, 40, 50, 50 },     // Hangs off the bottom right.
+            { 100, 0, 10, 10 },     // Starts at the right edge.
+            { 10, 10, 0, 5 },       // Has no width.
+            { 30, 20, 5, 5 }        // Lies inside.
+        };
+
+        clip_damage_rects(rects, 100, 50);
+
+        check(rects.size() == 3, test, "empty rectangles weren't dropped");
+
+        if (rects.size() == 3)
+        {
+            check(same_rect(rects[0], { 0, 0, 20, 15 }), test, "the top left rectangle was clipped wrongly");
+            check(same_rect(rects[1], { 90, 40, 10, 10 }), test, "the bottom right rectangle was clipped wrongly");
+            check(same_rect(rects[2], { 30, 20, 5, 5 }), test, "a rectangle inside the image was changed");
+        }
+    }
+
+    /// @brief: Overlapping and touching rectangles become their bounds, including through a chain, and apart ones are left alone.
+    void test_merge()
+    {
+        const char* test = "merge";
+
+        std::vector<damage_rect> rects =
+        {
+            { 0, 0, 10, 10 },
+            { 10, 0, 10, 10 },      // Touches the first.
+            { 100, 100, 5, 5 },     // Lies apart.
+            { 15, 5, 10, 10 },      // Overlaps the second, so joins the first through it.
+        };
+
+        merge_damage_rects(rects, maxDamageRects);
+
+        check(rects.size() == 2, test, "wrong number of rectangles after merging");
+        check(none_overlap(rects), test, "merged rectangles overlap");
+
+        bool foundChain = false;
+        bool foundApart = false;
+
+        for (const damage_rect& rect : rects)
+        {
+            foundChain |= same_rect(rect, { 0, 0, 25, 15 });
+            foundApart |= same_rect(rect, { 100, 100, 5, 5 });
+        }
+
+        check(foundChain, test, "the chain wasn't merged into its bounds");
+        check(foundApart, test, "a rectangle apart from the rest was changed");
+    }
+
+    /// @brief: Too many rectangles are merged down to the limit, and still cover every pixel they did.
+    void test_merge_limit()
+    {
+        const char* test = "merge limit";
+
+        // A grid of small rectangles with gaps between them, so none merge on their own.
+        std::vector<damage_rect> rects;
+
+        for (int row = 0; row < 5; ++row)
+        {
+            for (int column = 0; column < 5; ++column)
+            {
+                rects.push_back({ column * 20, row * 20, 4 + column, 4 + row });
+            }
+        }
+
+        const std::vector<damage_rect> original = rects;
+
+        merge_damage_rects(rects, maxDamageRects);
+
+        check((int)rects.size() <= maxDamageRects && !rects.empty(), test, "the rectangles weren't merged down to the limit");
+
+        bool coversAll = true;
+
+        for (const damage_rect& rect : original)
+        {
+            for (int y = rect.y; y < rect.y + rect.height; ++y)
+            {
+                for (int x = rect.x; x < rect.x + rect.width; ++x)
+                {
+                    coversAll &= any_covers(rects, x, y);
+                }
+            }
+        }
+
+        check(coversAll, test, "a damaged pixel was left out");
+
+        // A limit below one still leaves one rectangle, which is the bounds of them all.
+        std::vector<damage_rect> one = original;
+        merge_damage_rects(one, 0);
+
+        check(one.size() == 1 && same_rect(one[0], { 0, 0, 80 + 4 + 4, 80 + 4 + 4 }), test, "the rectangles weren't merged into their bounds");
+    }
+
+    /// @brief: More than 256 reports in one frame collapse into their bounds, and taking them leaves none pending.
+    void test_pending_collapse()
+    {
+        const char* test = "pending collapse";
+
+        std::vector<damage_rect> rects;
+
+        // Start with nothing pending.
+        take_pending_damage_rects(rects);
+
+        // Empty reports are ignored.
+        ikinRyzAddDamageRect(5, 5, 0, 10);
+        ikinRyzAddDamageRect(5, 5, 10, -1);
+        take_pending_damage_rects(rects);
+
+        check(rects.empty(), test, "empty reports were kept");
+
+        // Up to the limit, every report is kept as it is.
+        for (int i = 0; i < maxPendingDamageRects; ++i)
+        {
+            ikinRyzAddDamageRect(i * 4, 2, 1, 1);
+        }
+
+        take_pending_damage_rects(rects);
+
+        check((int)rects.size() == maxPendingDamageRects, test, "reports up to the limit weren't kept apart");
+
+        // One more than the limit collapses all of them into one rectangle.
+        for (int i = 0; i <= maxPendingDamageRects; ++i)
+        {
+            ikinRyzAddDamageRect(i * 4, 2 + i % 3, 1, 1);
+        }
+
+        take_pending_damage_rects(rects);
+
+        check(rects.size() == 1 && same_rect(rects[0], { 0, 2, maxPendingDamageRects * 4 + 1, 3 }), test, "reports past the limit weren't collapsed into their bounds");
+
+        // Reports after the collapse are kept apart again.
+        ikinRyzAddDamageRect(1, 1, 1, 1);
+        take_pending_damage_rects(rects);
+
+        check(rects.size() == 1 && same_rect(rects[0], { 1, 1, 1, 1 }), test, "reports after taking them weren't started over");
+
+        take_pending_damage_rects(rects);
+
+        check(rects.empty(), test, "taking the reports left some pending");
+    }
+
+    /// @brief: Changed tiles become rectangles, clipped where the image ends part way through a tile.
+    void test_tile_hashes()
+    {
+        const char* test = "tile hashes";
+
+        const int width = tileHashTileSize * 3 + 5;
+        const int height = tileHashTileSize * 2;
+        const int tilesAcross = 4;
+
+        std::vector<uint32_t> previousHashes(tilesAcross * 2, 1);
+        std::vector<uint32_t> hashes = previousHashes;
+        std::vector<damage_rect> rects;
+
+        damage_rects_from_tile_hashes(previousHashes.data(), hashes.data(), width, height, rects);
+
+        check(rects.empty(), test, "unchanged tiles were damaged");
+
+        // The last two tiles of the first row, the last of which is clipped by the right edge.
+        hashes[2] = 2;
+        hashes[3] = 2;
+
+        damage_rects_from_tile_hashes(previousHashes.data(), hashes.data(), width, height, rects);
+
+        check(rects.size() == 1 && same_rect(rects[0], { tileHashTileSize * 2, 0, tileHashTileSize + 5, tileHashTileSize }), test, "changed tiles became the wrong rectangle");
+    }
+
+    /// @brief: Copying the rectangles updates the damaged pixels and only those, between rows of different lengths.
+    void test_copy()
+    {
+        const char* test = "copy";
+
+        const int width = 40;
+        const int height = 30;
+        const int bytesPerPixel = 4;
+        const size_t sourceBytesPerRow = width * bytesPerPixel + 12;
+        const size_t destinationBytesPerRow = width * bytesPerPixel + 64;
+
+        std::vector<uint8_t> source(sourceBytesPerRow * height);
+        std::vector<uint8_t> destination(destinationBytesPerRow * height, 0xEE);
+        srand(3);
+
+        for (uint8_t& byte : source)
+        {
+            byte = (uint8_t)(rand() & 0xFF);
+        }
+
+        const std::vector<damage_rect> rects = { { 0, 0, 3, 2 }, { 10, 7, 30, 5 }, { 39, 29, 1, 1 } };
+
+        copy_damage_rects(source.data(), sourceBytesPerRow, destination.data(), destinationBytesPerRow, bytesPerPixel, rects);
+
+        bool copied = true;
+        bool untouched = true;
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const uint8_t* from = &source[y * sourceBytesPerRow + x * bytesPerPixel];
+                const uint8_t* to = &destination[y * destinationBytesPerRow + x * bytesPerPixel];
+
+                for (int channel = 0; channel < bytesPerPixel; ++channel)
+                {
+                    if (any_covers(rects, x, y))
+                    {
+                        copied &= to[channel] == from[channel];
+                    }
+                    else
+                    {
+                        untouched &= to[channel] == 0xEE;
+                    }
+                }
+            }
+
+            // The padding at the end of each row is left alone too.
+            for (size_t padding = width * bytesPerPixel; padding < destinationBytesPerRow; ++padding)
+            {
+                untouched &= destination[y * destinationBytesPerRow + padding] == 0xEE;
+            }
+        }
+
+        check(copied, test, "a damaged pixel wasn't copied");
+        check(untouched, test, "a pixel outside the damage was written");
+    }
+}
+
+int main()
+{
+    test_clip();
+    test_merge();
+    test_merge_limit();
+    test_pending_collapse();
+    test_tile_hashes();
+    test_copy();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,264 @@
+//
+//  ryz_distortion_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Checks the distortion correction's CPU reference, see ikin_ryz_distortion.h: mesh files are loaded with their comments
+//  left out and rejected whole when malformed, points between the vertices are interpolated bilinearly, an identity mesh
+//  leaves an image as it is, a mirrored mesh mirrors it, scaling filters bilinearly, and points the optics show outside
+//  of the image are black.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin
+//      c++ -O2 -std=c++14 -Wall -Wextra -I$P ryz_distortion_test.cpp $P/ikin_ryz_distortion.cpp -o ryz_distortion_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_distortion_test [directory for the mesh files, /tmp by default]
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ikin_ryz_distortion.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: A 32-bit image, with rows that may be longer than the image is wide.
+    struct image
+    {
+        int width;
+        int height;
+        size_t bytesPerRow;
+        std::vector<uint8_t> bytes;
+
+        image(int width, int height, int paddingPixels = 0) :
+            width(width),
+            height(height),
+            bytesPerRow((size_t)(width + paddingPixels) * 4),
+            bytes(bytesPerRow * height, 0)
+        {
+        }
+
+        uint8_t* pixel(int x, int y)
+        {
+            return bytes.data() + y * bytesPerRow + x * 4;
+        }
+
+        void fill_random(unsigned seed)
+        {
+            srand(seed);
+
+            for (uint8_t& byte : bytes)
+            {
+                byte = (uint8_t)(rand() & 0xFF);
+            }
+        }
+    };
+
+    /// @brief: Writes a text file.
+    bool write_file(const std::string& path, const char* text)
+    {
+        FILE* file = fopen(path.c_str(), "w");
+
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        fputs(text, file);
+        fclose(file);
+        return true;
+    }
+
+    /// @brief: Gets a mesh from its vertices.
+    distortion_mesh make_mesh(int columns, int rows, const std::vector<float>& vertices)
+    {
+        std::shared_ptr<std::vector<float>> coordinates = std::make_shared<std::vector<float>>(vertices);
+
+        distortion_mesh mesh;
+        mesh.columns = columns;
+        mesh.rows = rows;
+        mesh.coordinates = std::shared_ptr<const float>(coordinates, coordinates->data());
+
+        return mesh;
+    }
+
+    /// @brief: Gets a mesh that maps every point of the display to the same point of the image.
+    distortion_mesh identity_mesh()
+    {
+        return make_mesh(2, 2, { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f });
+    }
+
+    /// @brief: Warps an image into a new image of the given size.
+    image warp(image& source, int width, int height, const distortion_mesh& mesh)
+    {
+        image destination(width, height, 3);
+
+        warp_image(source.bytes.data(), source.width, source.height, source.bytesPerRow,
+                   destination.bytes.data(), destination.width, destination.height, destination.bytesPerRow, mesh);
+
+        return destination;
+    }
+
+    /// @brief: Mesh files are loaded with their comments left out, and malformed ones are rejected without changing the mesh.
+    void test_load(const std::string& directory)
+    {
+        const char* test = "load";
+
+        const std::string path = directory + "/ryz_distortion_test.txt";
+        distortion_mesh mesh = {};
+
+        check(write_file(path, "# A 2x3 mesh.\n2 3\n0 0  1 0\n# The middle row.\n0 0.5  1 0.5\n0 1  1 1\n"), test, "couldn't write the mesh file");
+        check(load_distortion_mesh(path.c_str(), mesh), test, "a valid mesh wasn't loaded");
+        check(mesh.columns == 2 && mesh.rows == 3 && mesh.coordinates && mesh.coordinates.get()[9] == 1.0f, test, "the mesh was loaded wrongly");
+
+        // Each of these is rejected, and leaves the loaded mesh as it was.
+        const char* malformed[] =
+        {
+            "1 2\n0 0\n0 1\n",                              // Too few columns.
+            "2 2\n0 0  1 0  0 1\n",                         // A vertex is missing.
+            "2 2\n0 0  1 0  0 1  nan 1\n",                  // A coordinate isn't a number.
+            "2 2\n0 0  1 0  0 1  x 1\n",                    // A coordinate isn't a value.
+            "257 2\n",                                      // Too many columns.
+        };
+
+        for (const char* text : malformed)
+        {
+            write_file(path, text);
+            check(!load_distortion_mesh(path.c_str(), mesh), test, "a malformed mesh was loaded");
+        }
+
+        check(mesh.columns == 2 && mesh.rows == 3, test, "a rejected file changed the mesh");
+        check(!load_distortion_mesh((directory + "/ryz_distortion_test_missing.txt").c_str(), mesh), test, "a missing file was loaded");
+
+        remove(path.c_str());
+    }
+
+    /// @brief: Points between the vertices are interpolated bilinearly, and points off the display take its edge.
+    void test_sample()
+    {
+        const char* test = "sample";
+
+        // A 3x2 mesh whose middle column bends to the right, and whose bottom row is pulled up.
+        const distortion_mesh mesh = make_mesh(3, 2, { 0.0f, 0.0f, 0.7f, 0.0f, 1.0f, 0.0f,
+                                                       0.0f, 0.8f, 0.7f, 0.8f, 1.0f, 0.8f });
+
+        float imageX;
+        float imageY;
+
+        sample_distortion_mesh(mesh, 0.5f, 0.0f, imageX, imageY);
+        check(std::fabs(imageX - 0.7f) < 1e-6f && imageY == 0.0f, test, "a vertex wasn't mapped to its coordinates");
+
+        sample_distortion_mesh(mesh, 0.25f, 0.5f, imageX, imageY);
+        check(std::fabs(imageX - 0.35f) < 1e-6f && std::fabs(imageY - 0.4f) < 1e-6f, test, "a point between the vertices wasn't interpolated");
+
+        sample_distortion_mesh(mesh, 1.5f, -1.0f, imageX, imageY);
+        check(imageX == 1.0f && imageY == 0.0f, test, "a point off the display didn't take its edge");
+    }
+
+    /// @brief: An identity mesh leaves an image as it is, and a mirrored one mirrors it.
+    void test_identity_and_mirror()
+    {
+        const char* test = "identity and mirror";
+
+        image source(37, 21, 5);
+        source.fill_random(1);
+
+        image same = warp(source, source.width, source.height, identity_mesh());
+        image mirrored = warp(source, source.width, source.height, make_mesh(2, 2, { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f }));
+
+        bool identical = true;
+        bool mirroredExactly = true;
+
+        for (int y = 0; y < source.height; ++y)
+        {
+            for (int x = 0; x < source.width; ++x)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    identical &= same.pixel(x, y)[channel] == source.pixel(x, y)[channel];
+                    mirroredExactly &= mirrored.pixel(x, y)[channel] == source.pixel(source.width - 1 - x, y)[channel];
+                }
+            }
+        }
+
+        check(identical, test, "an identity mesh changed the image");
+        check(mirroredExactly, test, "a mirrored mesh didn't mirror the image");
+    }
+
+    /// @brief: Scaling an image up filters it bilinearly between pixel centers, clamping at its edges.
+    void test_bilinear()
+    {
+        const char* test = "bilinear";
+
+        // Two pixels, dark then bright, drawn four pixels wide.
+        image source(2, 1);
+        source.pixel(0, 0)[0] = 0;
+        source.pixel(1, 0)[0] = 255;
+
+        image scaled = warp(source, 4, 1, identity_mesh());
+
+        check(scaled.pixel(0, 0)[0] == 0 && scaled.pixel(1, 0)[0] == 64 && scaled.pixel(2, 0)[0] == 191 && scaled.pixel(3, 0)[0] == 255,
+              test, "scaling didn't filter between the pixels");
+    }
+
+    /// @brief: Points that the optics show outside of the image are drawn opaque black.
+    void test_outside()
+    {
+        const char* test = "outside";
+
+        image source(8, 8);
+
+        for (uint8_t& byte : source.bytes)
+        {
+            byte = 200;
+        }
+
+        // The image is shrunk into the middle of the display, so the display's border maps outside of it.
+        image warped = warp(source, 16, 16, make_mesh(2, 2, { -0.5f, -0.5f, 1.5f, -0.5f, -0.5f, 1.5f, 1.5f, 1.5f }));
+
+        const uint8_t* corner = warped.pixel(0, 0);
+        const uint8_t* middle = warped.pixel(8, 8);
+
+        check(corner[0] == 0 && corner[1] == 0 && corner[2] == 0 && corner[3] == 255, test, "a point outside of the image wasn't opaque black");
+        check(middle[0] == 200 && middle[3] == 200, test, "a point inside of the image wasn't drawn from it");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::string directory = argc > 1 ? argv[1] : "/tmp";
+
+    test_load(directory);
+    test_sample();
+    test_identity_and_mirror();
+    test_bilinear();
+    test_outside();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+//
+//  ryz_frame_descriptor_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Fills out frame descriptors with populate_render_passes, see ikin_ryz_frame_descriptor.h, and checks how the eyes are split
+//  into passes: eyes that share a texture are rendered side by side in a single pass with one culling pass, eyes with textures
+//  of their own get a pass and a culling pass each, and an eye rendered on its own gets a pass of its own either way.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin; U="../../External Headers/Unity"
+//      c++ -O2 -std=c++14 -Wall -Wextra -I$P -I"$U" -I"$U/XR" -I"$U/XR/Subsystems" -I"$U/XR/Subsystems/Display" ryz_frame_descriptor_test.cpp $P/ikin_ryz_frame_descriptor.cpp -o ryz_frame_descriptor_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_frame_descriptor_test
+//
+
+#include <cstdio>
+
+#include "ikin_ryz_frame_descriptor.h"
+#include "ikin_ryz_settings.h"
+
+// The projection that ikinRyzSetCameraMatrix would set, which lives with the rest of the C# bindings in the plugin.
+UnityXRProjectionType projectionType = kUnityXRProjectionTypeHalfAngles;
+UnityXRMatrix4x4 leftProjectionMatrix = {};
+UnityXRMatrix4x4 rightProjectionMatrix = {};
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The size of the display the projections fit, in points.
+    const float displayWidth = 1280.0f;
+    const float displayHeight = 720.0f;
+
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: Gets a value indicating whether two rects are the same.
+    bool same_rect(const UnityXRRectf& a, const UnityXRRectf& b)
+    {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+    }
+
+    /// @brief: Describes the eyes the way the displayer does when they share a double-wide texture, rendered into the lower left of each half.
+    void shared_targets(eye_pass_target* targets)
+    {
+        for (int eye = 0; eye < eye_count; ++eye)
+        {
+            targets[eye].textureId = 7;
+            targets[eye].occlusionMeshId = 0;
+            targets[eye].occludedFraction = 0.0f;
+            targets[eye].viewport = { eye * 0.5f, 0.0f, 0.25f, 0.5f };
+            targets[eye].textureWidth = 2560;
+            targets[eye].textureHeight = 720;
+        }
+    }
+
+    /// @brief: Eyes that share a texture are rendered in one pass, side by side, with one culling pass that covers both.
+    void test_shared_texture()
+    {
+        const char* test = "shared texture";
+
+        eye_pass_target targets[eye_count];
+        shared_targets(targets);
+
+        const int passEyes[] = { main_eye, ryz_eye };
+        UnityXRNextFrameDesc nextFrame = {};
+
+        populate_render_passes(passEyes, 2, targets, displayWidth, displayHeight, &nextFrame);
+
+        const auto& renderPass = nextFrame.renderPasses[0];
+
+        check(nextFrame.renderPassesCount == 1, test, "the eyes weren't rendered in a single pass");
+        check(renderPass.textureId == 7 && renderPass.renderParamsCount == 2, test, "the pass doesn't render both eyes into the texture");
+        check(renderPass.cullingPassIndex == 0 && nextFrame.cullingPasses[0].separation > 0.0f, test, "the culling pass doesn't cover both eyes");
+        check(same_rect(renderPass.renderParams[0].viewportRect, targets[main_eye].viewport) &&
+              same_rect(renderPass.renderParams[1].viewportRect, targets[ryz_eye].viewport),
+              test, "the eyes weren't rendered into their halves");
+    }
+
+    /// @brief: Eyes with textures of their own, such as when they are in different formats, get a pass and a culling pass each.
+    void test_separate_textures()
+    {
+        const char* test = "separate textures";
+
+        eye_pass_target targets[eye_count];
+        shared_targets(targets);
+
+        targets[ryz_eye].textureId = 8;
+        targets[ryz_eye].viewport = { 0.0f, 0.0f, 1.0f, 1.0f };
+        targets[ryz_eye].textureWidth = 1280;
+
+        const int passEyes[] = { main_eye, ryz_eye };
+        UnityXRNextFrameDesc nextFrame = {};
+
+        populate_render_passes(passEyes, 2, targets, displayWidth, displayHeight, &nextFrame);
+
+        check(nextFrame.renderPassesCount == 2, test, "the eyes weren't rendered in a pass each");
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            const auto& renderPass = nextFrame.renderPasses[pass];
+
+            check(renderPass.renderParamsCount == 1, test, "a pass renders more than one eye");
+            check(renderPass.cullingPassIndex == (uint32_t)pass && nextFrame.cullingPasses[pass].separation == 0.0f, test, "a pass doesn't have a culling pass of its own");
+        }
+
+        check(nextFrame.renderPasses[0].textureId == 7 && nextFrame.renderPasses[1].textureId == 8, test, "an eye was rendered into the wrong texture");
+        check(same_rect(nextFrame.renderPasses[1].renderParams[0].viewportRect, targets[ryz_eye].viewport), test, "the Ryz eye wasn't rendered into its texture");
+    }
+
+    /// @brief: An eye rendered on its own gets a pass of its own, and no eyes get no passes, so Unity renders nothing.
+    void test_single_eye()
+    {
+        const char* test = "single eye";
+
+        eye_pass_target targets[eye_count];
+        shared_targets(targets);
+
+        const int passEyes[] = { ryz_eye };
+        UnityXRNextFrameDesc nextFrame = {};
+
+        populate_render_passes(passEyes, 1, targets, displayWidth, displayHeight, &nextFrame);
+
+        check(nextFrame.renderPassesCount == 1 && nextFrame.renderPasses[0].renderParamsCount == 1, test, "the eye didn't get one pass");
+        check(nextFrame.cullingPasses[0].separation == 0.0f, test, "a single eye was culled as a pair");
+        check(same_rect(nextFrame.renderPasses[0].renderParams[0].viewportRect, targets[ryz_eye].viewport), test, "the eye wasn't rendered into its half");
+
+        populate_render_passes(passEyes, 0, targets, displayWidth, displayHeight, &nextFrame);
+
+        check(nextFrame.renderPassesCount == 0, test, "a frame without eyes has passes");
+    }
+
+    /// @brief: The occluded pixels are counted within each eye's viewport, whether or not the eyes share a texture.
+    void test_occluded_pixels()
+    {
+        const char* test = "occluded pixels";
+
+        eye_pass_target targets[eye_count];
+        shared_targets(targets);
+
+        targets[ryz_eye].occlusionMeshId = 3;
+        targets[ryz_eye].occludedFraction = 0.5f;
+
+        const int passEyes[] = { main_eye, ryz_eye };
+        UnityXRNextFrameDesc nextFrame = {};
+
+        // Half of a quarter of the texture's width and half of its height.
+        const uint64_t occludedPixels = populate_render_passes(passEyes, 2, targets, displayWidth, displayHeight, &nextFrame);
+
+        check(occludedPixels == 640 * 360 / 2, test, "wrong number of occluded pixels");
+        check(nextFrame.renderPasses[0].renderParams[0].occlusionMeshId == 0 &&
+              nextFrame.renderPasses[0].renderParams[1].occlusionMeshId == 3,
+              test, "the occlusion mesh was given to the wrong eye");
+    }
+}
+
+int main()
+{
+    test_shared_texture();
+    test_separate_textures();
+    test_single_eye();
+    test_occluded_pixels();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
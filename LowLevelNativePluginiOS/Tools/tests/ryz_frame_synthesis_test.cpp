@@ -0,0 +1,328 @@
+//
+//  ryz_frame_synthesis_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Checks the CPU references of the frame synthesizer's passes, see ikin_ryz_frame_synthesis.h: the blend leaves a still
+//  image as it is, pushes changing channels further along their change and clamps them to the byte range, and the motion
+//  vector pass leaves an image without motion as it is, moves pixels by whole and half pixels along their vectors for as
+//  many frames as asked, and clamps to the edge of the image where a pixel comes from outside it.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin
+//      c++ -O2 -std=c++14 -Wall -Wextra -I$P ryz_frame_synthesis_test.cpp $P/ikin_ryz_frame_synthesis.cpp -o ryz_frame_synthesis_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_frame_synthesis_test
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ikin_ryz_frame_synthesis.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The size of the frames the passes are run on, in pixels, and the padding at the end of each row, in bytes.
+    const int width = 24;
+    const int height = 10;
+    const int rowPadding = 16;
+    const size_t bytesPerRow = width * 4 + rowPadding;
+
+    /// @brief: The value the padding at the end of each row of a synthesized frame is filled with, which the passes must leave alone.
+    const uint8_t paddingValue = 0xEE;
+
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: Gets a frame of random pixels.
+    std::vector<uint8_t> random_frame(unsigned seed)
+    {
+        std::vector<uint8_t> frame(bytesPerRow * height);
+        srand(seed);
+
+        for (uint8_t& byte : frame)
+        {
+            byte = (uint8_t)(rand() & 0xFF);
+        }
+
+        return frame;
+    }
+
+    /// @brief: Gets a frame to synthesize into, with every byte set to the padding value.
+    std::vector<uint8_t> output_frame()
+    {
+        return std::vector<uint8_t>(bytesPerRow * height, paddingValue);
+    }
+
+    /// @brief: Gets a channel of a pixel of a frame.
+    uint8_t channel_at(const std::vector<uint8_t>& frame, int x, int y, int channel)
+    {
+        return frame[y * bytesPerRow + x * 4 + channel];
+    }
+
+    /// @brief: Gets a value indicating whether the pixels of two frames are the same, leaving out the padding.
+    bool same_pixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (int byte = 0; byte < width * 4; ++byte)
+            {
+                if (a[y * bytesPerRow + byte] != b[y * bytesPerRow + byte])
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief: Gets a value indicating whether the padding at the end of each row of a synthesized frame was left alone.
+    bool padding_untouched(const std::vector<uint8_t>& frame)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (size_t byte = width * 4; byte < bytesPerRow; ++byte)
+            {
+                if (frame[y * bytesPerRow + byte] != paddingValue)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief: Gets motion vectors that move every pixel by the same number of pixels.
+    std::vector<float> uniform_motion(float pixelsX, float pixelsY)
+    {
+        std::vector<float> motion((size_t)width * height * 2);
+
+        for (size_t pixel = 0; pixel < (size_t)width * height; ++pixel)
+        {
+            motion[pixel * 2] = pixelsX / width;
+            motion[pixel * 2 + 1] = pixelsY / height;
+        }
+
+        return motion;
+    }
+
+    /// @brief: Blending a frame that didn't change gives the same frame, however far it extrapolates.
+    void test_blend_still()
+    {
+        const char* test = "blend still";
+
+        const std::vector<uint8_t> frame = random_frame(1);
+        std::vector<uint8_t> output = output_frame();
+
+        extrapolate_frame(frame.data(), frame.data(), output.data(), width, height, bytesPerRow, frameSynthesisExtrapolation * maxSynthesizedFrames);
+
+        check(same_pixels(output, frame), test, "a still frame was changed");
+        check(padding_untouched(output), test, "the padding at the end of the rows was written");
+
+        // Not extrapolating at all gives the latest frame, whatever the one before it was.
+        const std::vector<uint8_t> previous = random_frame(2);
+        extrapolate_frame(previous.data(), frame.data(), output.data(), width, height, bytesPerRow, 0.0f);
+
+        check(same_pixels(output, frame), test, "no extrapolation didn't give the latest frame");
+    }
+
+    /// @brief: Each channel continues along its own change, rounded to the nearest value and clamped to the byte range.
+    void test_blend_values()
+    {
+        const char* test = "blend values";
+
+        std::vector<uint8_t> previous(bytesPerRow * height, 0);
+        std::vector<uint8_t> current(bytesPerRow * height, 0);
+        std::vector<uint8_t> output = output_frame();
+
+        // One pixel with a channel that rises, one that falls, one that overshoots and one that undershoots.
+        const uint8_t before[4] = { 100, 120, 50, 200 };
+        const uint8_t after[4] = { 120, 101, 250, 10 };
+        const uint8_t expected[4] = { 130, 92, 255, 0 };
+
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            previous[3 * bytesPerRow + 5 * 4 + channel] = before[channel];
+            current[3 * bytesPerRow + 5 * 4 + channel] = after[channel];
+        }
+
+        extrapolate_frame(previous.data(), current.data(), output.data(), width, height, bytesPerRow, 0.5f);
+
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            check(channel_at(output, 5, 3, channel) == expected[channel], test, "a channel was extrapolated to the wrong value");
+        }
+
+        check(channel_at(output, 4, 3, 0) == 0 && channel_at(output, 6, 3, 0) == 0, test, "the pixels around the change were changed");
+    }
+
+    /// @brief: Without motion, every pixel stays where it is.
+    void test_reproject_still()
+    {
+        const char* test = "reproject still";
+
+        const std::vector<uint8_t> frame = random_frame(3);
+        const std::vector<float> motion = uniform_motion(0.0f, 0.0f);
+        std::vector<uint8_t> output = output_frame();
+
+        reproject_frame(frame.data(), motion.data(), output.data(), width, height, bytesPerRow, 1.0f);
+
+        check(same_pixels(output, frame), test, "pixels without motion moved");
+        check(padding_untouched(output), test, "the padding at the end of the rows was written");
+    }
+
+    /// @brief: Pixels move by their motion times the number of frames, and those that come from outside the image take its edge.
+    void test_reproject_whole_pixels()
+    {
+        const char* test = "reproject whole pixels";
+
+        const std::vector<uint8_t> frame = random_frame(4);
+        std::vector<uint8_t> output = output_frame();
+
+        // Two pixels right and one pixel down per frame, for two frames.
+        const std::vector<float> motion = uniform_motion(2.0f, 1.0f);
+        reproject_frame(frame.data(), motion.data(), output.data(), width, height, bytesPerRow, 2.0f);
+
+        bool moved = true;
+        bool clamped = true;
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const int sourceX = x - 4;
+                const int sourceY = y - 2;
+
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    const uint8_t value = channel_at(output, x, y, channel);
+
+                    if (sourceX >= 0 && sourceY >= 0)
+                    {
+                        moved &= value == channel_at(frame, sourceX, sourceY, channel);
+                    }
+                    else
+                    {
+                        clamped &= value == channel_at(frame, sourceX < 0 ? 0 : sourceX, sourceY < 0 ? 0 : sourceY, channel);
+                    }
+                }
+            }
+        }
+
+        check(moved, test, "pixels didn't move along their motion for both frames");
+        check(clamped, test, "pixels from outside the image didn't take its edge");
+    }
+
+    /// @brief: A motion of half a pixel blends the two pixels it lands between evenly, the same as a bilinear sampler.
+    void test_reproject_half_pixel()
+    {
+        const char* test = "reproject half pixel";
+
+        // Columns that alternate between dark and bright.
+        std::vector<uint8_t> frame(bytesPerRow * height, 0);
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    frame[y * bytesPerRow + x * 4 + channel] = x % 2 == 0 ? 20 : 220;
+                }
+            }
+        }
+
+        // Half a pixel left, so each pixel comes from halfway between itself and the pixel to its right.
+        const std::vector<float> motion = uniform_motion(-0.5f, 0.0f);
+        std::vector<uint8_t> output = output_frame();
+
+        reproject_frame(frame.data(), motion.data(), output.data(), width, height, bytesPerRow, 1.0f);
+
+        bool blended = true;
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width - 1; ++x)
+            {
+                blended &= channel_at(output, x, y, 0) == 120;
+            }
+        }
+
+        check(blended, test, "half a pixel of motion didn't blend the pixels evenly");
+        check(channel_at(output, width - 1, 0, 0) == channel_at(frame, width - 1, 0, 0), test, "the right edge wasn't clamped");
+    }
+
+    /// @brief: Each pixel follows its own motion vector, rather than the whole image moving together.
+    void test_reproject_per_pixel()
+    {
+        const char* test = "reproject per pixel";
+
+        const std::vector<uint8_t> frame = random_frame(5);
+        std::vector<float> motion = uniform_motion(0.0f, 0.0f);
+
+        // Only the pixel at (10, 4) moves, and it takes the pixel three to its left.
+        motion[(4 * width + 10) * 2] = 3.0f / width;
+
+        std::vector<uint8_t> output = output_frame();
+        reproject_frame(frame.data(), motion.data(), output.data(), width, height, bytesPerRow, 1.0f);
+
+        bool movedOne = true;
+        bool keptRest = true;
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    if (x == 10 && y == 4)
+                    {
+                        movedOne &= channel_at(output, x, y, channel) == channel_at(frame, 7, 4, channel);
+                    }
+                    else
+                    {
+                        keptRest &= channel_at(output, x, y, channel) == channel_at(frame, x, y, channel);
+                    }
+                }
+            }
+        }
+
+        check(movedOne, test, "the moving pixel didn't follow its motion vector");
+        check(keptRest, test, "pixels without motion moved along with another pixel");
+    }
+}
+
+int main()
+{
+    test_blend_still();
+    test_blend_values();
+    test_reproject_still();
+    test_reproject_whole_pixels();
+    test_reproject_half_pixel();
+    test_reproject_per_pixel();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,252 @@
+//
+//  ryz_occlusion_mesh_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Checks the occlusion mesh that keeps the pixels the Ryz optics can't show from being shaded, see ikin_ryz_occlusion_mesh.h:
+//  radii of zero or less and ellipses that cover the whole viewport build no mesh, radii that reach the outer edge are
+//  rejected, the ring has a vertex on the ellipse and on the outer edge for each segment, none of its triangles fold over
+//  even for an ellipse just inside the outer edge, it covers every point of the viewport outside the ellipse and none
+//  inside, and the fraction it reports covering matches the area outside the ellipse.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin; U="../../External Headers/Unity"
+//      c++ -O2 -std=c++14 -Wall -Wextra -I$P -I"$U/XR/Subsystems" ryz_occlusion_mesh_test.cpp $P/ikin_ryz_occlusion_mesh.cpp -o ryz_occlusion_mesh_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_occlusion_mesh_test
+//
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#include "ikin_ryz_occlusion_mesh.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: Gets twice the signed area of a triangle of the mesh, which is positive if it winds counterclockwise.
+    float signed_area(const occlusion_mesh& mesh, size_t triangle)
+    {
+        const UnityXRVector2& a = mesh.vertices[mesh.indices[triangle * 3]];
+        const UnityXRVector2& b = mesh.vertices[mesh.indices[triangle * 3 + 1]];
+        const UnityXRVector2& c = mesh.vertices[mesh.indices[triangle * 3 + 2]];
+
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    /// @brief: Gets a value indicating whether every triangle of the mesh winds the same way, without any of them being flat.
+    bool consistently_wound(const occlusion_mesh& mesh)
+    {
+        const size_t triangleCount = mesh.indices.size() / 3;
+        const bool counterclockwise = signed_area(mesh, 0) > 0.0f;
+
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            const float area = signed_area(mesh, triangle);
+
+            if (area == 0.0f || (area > 0.0f) != counterclockwise)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief: Gets a value indicating whether a point of the viewport is inside any triangle of the mesh.
+    bool covers(const occlusion_mesh& mesh, float x, float y)
+    {
+        for (size_t triangle = 0; triangle < mesh.indices.size() / 3; ++triangle)
+        {
+            const UnityXRVector2* corners[3] =
+            {
+                &mesh.vertices[mesh.indices[triangle * 3]],
+                &mesh.vertices[mesh.indices[triangle * 3 + 1]],
+                &mesh.vertices[mesh.indices[triangle * 3 + 2]]
+            };
+
+            bool anyNegative = false;
+            bool anyPositive = false;
+
+            for (int edge = 0; edge < 3; ++edge)
+            {
+                const UnityXRVector2& from = *corners[edge];
+                const UnityXRVector2& to = *corners[(edge + 1) % 3];
+                const float side = (to.x - from.x) * (y - from.y) - (to.y - from.y) * (x - from.x);
+
+                anyNegative |= side < 0.0f;
+                anyPositive |= side > 0.0f;
+            }
+
+            if (!(anyNegative && anyPositive))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// @brief: Radii of zero or less turn the mesh off, and an ellipse that covers the whole viewport needs no mesh.
+    void test_nothing_to_occlude()
+    {
+        const char* test = "nothing to occlude";
+
+        occlusion_mesh mesh;
+
+        check(!mesh.build(0.0f, 0.4f) && mesh.vertices.empty() && mesh.indices.empty(), test, "a zero radius built a mesh");
+        check(!mesh.build(-1.0f, -1.0f) && mesh.vertices.empty(), test, "negative radii built a mesh");
+
+        // The corners of the viewport are about 0.71 from its center.
+        check(!mesh.build(0.75f, 0.75f) && mesh.vertices.empty() && mesh.occludedFraction == 0.0f, test, "an ellipse past the corners built a mesh");
+    }
+
+    /// @brief: Radii that reach the outer edge of the mesh, or aren't numbers, are rejected rather than folding the ring over.
+    void test_out_of_range()
+    {
+        const char* test = "out of range";
+
+        occlusion_mesh mesh;
+        mesh.build(0.45f, 0.4f);
+
+        check(!mesh.build(occlusionMeshOuterRadius, 0.3f) && mesh.vertices.empty() && mesh.indices.empty(), test, "a radius at the outer edge built a mesh");
+        check(!mesh.build(0.3f, 1.5f) && mesh.vertices.empty(), test, "a radius past the outer edge built a mesh");
+        check(!mesh.build(std::numeric_limits<float>::quiet_NaN(), 0.3f) && mesh.vertices.empty(), test, "a radius that isn't a number built a mesh");
+        check(!mesh.build(0.3f, std::numeric_limits<float>::infinity()) && mesh.vertices.empty(), test, "an infinite radius built a mesh");
+    }
+
+    /// @brief: The ring joins a vertex on the ellipse to one on the outer edge for each segment, with triangles that all wind the same way.
+    void test_ring()
+    {
+        const char* test = "ring";
+
+        occlusion_mesh mesh;
+
+        check(mesh.build(0.45f, 0.4f), test, "a visible ellipse didn't build a mesh");
+        check(mesh.vertices.size() == occlusion_mesh::segmentCount * 2 && mesh.indices.size() == occlusion_mesh::segmentCount * 6,
+              test, "the mesh has the wrong number of vertices or indices");
+
+        bool indicesInRange = true;
+
+        for (uint32_t index : mesh.indices)
+        {
+            indicesInRange &= index < mesh.vertices.size();
+        }
+
+        check(indicesInRange, test, "an index is past the last vertex");
+
+        if (!indicesInRange || mesh.vertices.size() != occlusion_mesh::segmentCount * 2)
+        {
+            return;
+        }
+
+        bool onEllipse = true;
+        bool onOuterEdge = true;
+
+        for (int segment = 0; segment < occlusion_mesh::segmentCount; ++segment)
+        {
+            const UnityXRVector2& inner = mesh.vertices[segment * 2];
+            const UnityXRVector2& outer = mesh.vertices[segment * 2 + 1];
+            const float innerX = (inner.x - 0.5f) / 0.45f;
+            const float innerY = (inner.y - 0.5f) / 0.4f;
+            const float outerDistance = std::hypot(outer.x - 0.5f, outer.y - 0.5f);
+
+            onEllipse &= std::fabs(innerX * innerX + innerY * innerY - 1.0f) < 1e-4f;
+            onOuterEdge &= std::fabs(outerDistance - occlusionMeshOuterRadius) < 1e-4f;
+        }
+
+        check(onEllipse, test, "an inner vertex isn't on the ellipse");
+        check(onOuterEdge, test, "an outer vertex isn't on the outer edge");
+        check(consistently_wound(mesh), test, "a triangle is folded over or flat");
+
+        // The ellipse covers pi times the product of its radii, and the mesh the rest of the viewport.
+        const float expected = 1.0f - (float)M_PI * 0.45f * 0.4f;
+
+        check(std::fabs(mesh.occludedFraction - expected) < 0.01f, test, "the occluded fraction doesn't match the area outside the ellipse");
+    }
+
+    /// @brief: An ellipse just inside the outer edge still builds a ring whose triangles don't fold over.
+    void test_near_outer_edge()
+    {
+        const char* test = "near outer edge";
+
+        occlusion_mesh mesh;
+
+        check(mesh.build(occlusionMeshOuterRadius * 0.99f, 0.2f), test, "a wide ellipse inside the outer edge didn't build a mesh");
+        check(!mesh.indices.empty() && consistently_wound(mesh), test, "a triangle is folded over or flat");
+    }
+
+    /// @brief: Every point of the viewport outside of the ellipse is under the mesh, and every point well inside of it isn't.
+    void test_coverage()
+    {
+        const char* test = "coverage";
+
+        const float radiusX = 0.42f;
+        const float radiusY = 0.3f;
+
+        occlusion_mesh mesh;
+        mesh.build(radiusX, radiusY);
+
+        bool outsideCovered = true;
+        bool insideClear = true;
+
+        for (int row = 0; row <= 40; ++row)
+        {
+            for (int column = 0; column <= 40; ++column)
+            {
+                const float x = column / 40.0f;
+                const float y = row / 40.0f;
+                const float ellipseX = (x - 0.5f) / radiusX;
+                const float ellipseY = (y - 0.5f) / radiusY;
+                const float ellipse = ellipseX * ellipseX + ellipseY * ellipseY;
+
+                // The segments cut inside the ellipse a little between its vertices, so leave a margin on either side of it.
+                if (ellipse > 1.02f)
+                {
+                    outsideCovered &= covers(mesh, x, y);
+                }
+                else if (ellipse < 0.98f)
+                {
+                    insideClear &= !covers(mesh, x, y);
+                }
+            }
+        }
+
+        check(outsideCovered, test, "a point outside of the ellipse isn't covered, including the corners");
+        check(insideClear, test, "a point inside of the ellipse is covered");
+    }
+}
+
+int main()
+{
+    test_nothing_to_occlude();
+    test_out_of_range();
+    test_ring();
+    test_near_outer_edge();
+    test_coverage();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,357 @@
+//
+//  ryz_preview_loopback_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Encodes frames with the preview encoder, see ikin_ryz_preview_codec.h, sends them over a loopback TCP socket,
+//  and decodes them the way Tools/ryz_preview_client does. It checks that a keyframe round-trips, including the tiles
+//  clipped by the edges of the image, that an unchanged frame encodes no tiles, that a changed tile is the only one sent,
+//  and that runs and literals are split where their control bytes run out.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin
+//      c++ -O2 -std=c++14 -Wall -Wextra -pthread -I$P ryz_preview_loopback_test.cpp $P/ikin_ryz_preview_codec.cpp $P/ikin_ryz_tile_hash.cpp -o ryz_preview_loopback_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_preview_loopback_test
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ikin_ryz_preview_codec.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The size of the column, row and size that start each tile, in bytes.
+    const size_t tileHeaderSize = 8;
+
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: A connected pair of loopback TCP sockets, the server's end and the client's.
+    struct loopback
+    {
+        loopback()
+        {
+            const int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            // Let the system pick a free port.
+            socklen_t addressSize = sizeof(address);
+
+            if (listener < 0 ||
+                bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 ||
+                listen(listener, 1) != 0 ||
+                getsockname(listener, (sockaddr*)&address, &addressSize) != 0)
+            {
+                return;
+            }
+
+            client = socket(AF_INET, SOCK_STREAM, 0);
+
+            if (connect(client, (const sockaddr*)&address, sizeof(address)) == 0)
+            {
+                server = accept(listener, nullptr, nullptr);
+            }
+
+            close(listener);
+        }
+
+        ~loopback()
+        {
+            close(server);
+            close(client);
+        }
+
+        bool connected() const { return server >= 0 && client >= 0; }
+
+        int server = -1;
+        int client = -1;
+    };
+
+    /// @brief: Reads exactly a number of bytes.
+    /// @returns: True if they were read, otherwise false if the other end closed the connection.
+    bool read_exactly(int socket, uint8_t* bytes, size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t result = recv(socket, bytes, size, 0);
+
+            if (result <= 0)
+            {
+                return false;
+            }
+
+            bytes += result;
+            size -= result;
+        }
+
+        return true;
+    }
+
+    /// @brief: Sends a message from the server's end, and receives and decodes it at the client's, the way the preview client does.
+    /// @param connection The sockets.
+    /// @param message The message.
+    /// @param decoder The decoder the message is applied to.
+    /// @param header The header that was received.
+    /// @param payload The payload that was received.
+    /// @returns: True if the message arrived whole and was decoded, otherwise false.
+    bool send_and_decode(const loopback& connection, const std::vector<uint8_t>& message, preview_decoder& decoder, preview_header& header, std::vector<uint8_t>& payload)
+    {
+        // Send from a thread of its own, since a message can be larger than the socket holds.
+        std::thread sender([&]
+        {
+            size_t sent = 0;
+
+            while (sent < message.size())
+            {
+                const ssize_t result = send(connection.server, message.data() + sent, message.size() - sent, 0);
+
+                if (result <= 0)
+                {
+                    return;
+                }
+
+                sent += (size_t)result;
+            }
+        });
+
+        uint8_t headerBytes[previewHeaderSize];
+        bool decoded = read_exactly(connection.client, headerBytes, sizeof(headerBytes)) && read_preview_header(headerBytes, header);
+
+        if (decoded)
+        {
+            payload.resize(header.payloadSize);
+            decoded = read_exactly(connection.client, payload.data(), payload.size()) && decoder.decode(header, payload.data());
+        }
+
+        sender.join();
+
+        return decoded;
+    }
+
+    /// @brief: A tightly packed 32-bit image.
+    struct image
+    {
+        image(int width, int height) : width(width), height(height), pixels((size_t)width * height * 4, 0) {}
+
+        uint8_t* at(int x, int y) { return &pixels[((size_t)y * width + x) * 4]; }
+        size_t bytes_per_row() const { return (size_t)width * 4; }
+
+        /// @brief: Sets a pixel to a color, given as BGR in the low three bytes, with an alpha the encoder has to leave out.
+        void set(int x, int y, uint32_t color)
+        {
+            uint8_t* pixel = at(x, y);
+            pixel[0] = (uint8_t)color;
+            pixel[1] = (uint8_t)(color >> 8);
+            pixel[2] = (uint8_t)(color >> 16);
+            pixel[3] = 0x40;
+        }
+
+        int width;
+        int height;
+        std::vector<uint8_t> pixels;
+    };
+
+    /// @brief: Checks that the decoder's image is an image with opaque alpha.
+    bool decoded_matches(const preview_decoder& decoder, image& expected)
+    {
+        if (decoder.get_width() != expected.width || decoder.get_height() != expected.height)
+        {
+            return false;
+        }
+
+        const std::vector<uint8_t>& pixels = decoder.get_pixels();
+
+        for (size_t i = 0; i < pixels.size(); i += 4)
+        {
+            if (pixels[i] != expected.pixels[i] || pixels[i + 1] != expected.pixels[i + 1] || pixels[i + 2] != expected.pixels[i + 2] || pixels[i + 3] != 255)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief: A keyframe of an image whose edges clip its last tiles round-trips, an unchanged frame sends no tiles,
+    /// and a changed pixel sends only its tile.
+    void test_round_trip()
+    {
+        const char* test = "round trip";
+
+        loopback connection;
+        check(connection.connected(), test, "couldn't connect over loopback");
+
+        if (!connection.connected())
+        {
+            return;
+        }
+
+        // Three columns and three rows of tiles, the last of each clipped by the edge of the image.
+        image frame(previewTileSize * 2 + 13, previewTileSize * 2 + 7);
+        srand(7);
+
+        for (int y = 0; y < frame.height; ++y)
+        {
+            for (int x = 0; x < frame.width; ++x)
+            {
+                // Mix flat areas, which encode as runs, with noise, which encodes as literals.
+                frame.set(x, y, (x / 8 + y / 8) % 2 == 0 ? 0x204080u : (uint32_t)rand() & 0xFFFFFF);
+            }
+        }
+
+        preview_encoder encoder;
+        preview_decoder decoder;
+        preview_header header;
+        std::vector<uint8_t> message;
+        std::vector<uint8_t> payload;
+
+        // A delta can't be applied before the first keyframe.
+        preview_header delta = {};
+        delta.width = (uint16_t)frame.width;
+        delta.height = (uint16_t)frame.height;
+        delta.tileSize = (uint16_t)previewTileSize;
+        check(!decoder.decode(delta, nullptr), test, "a delta was applied before a keyframe");
+
+        const int tileCount = encoder.encode(frame.pixels.data(), frame.width, frame.height, frame.bytes_per_row(), 1, true, message);
+
+        check(tileCount == 9, test, "a keyframe didn't send every tile");
+        check(send_and_decode(connection, message, decoder, header, payload), test, "a keyframe couldn't be decoded");
+        check((header.flags & previewKeyframe) != 0 && header.frameIndex == 1 && header.tileCount == 9, test, "wrong keyframe header");
+        check(decoded_matches(decoder, frame), test, "a keyframe didn't round-trip");
+
+        // An unchanged frame has nothing to send, but still decodes.
+        check(encoder.encode(frame.pixels.data(), frame.width, frame.height, frame.bytes_per_row(), 2, false, message) == 0, test, "an unchanged frame sent tiles");
+        check(message.size() == previewHeaderSize, test, "an unchanged frame has a payload");
+        check(send_and_decode(connection, message, decoder, header, payload), test, "an unchanged frame couldn't be decoded");
+        check((header.flags & previewKeyframe) == 0 && header.tileCount == 0, test, "wrong header for an unchanged frame");
+
+        // A change to the clipped corner tile sends only that tile.
+        frame.set(frame.width - 1, frame.height - 1, 0xFFFFFF);
+
+        check(encoder.encode(frame.pixels.data(), frame.width, frame.height, frame.bytes_per_row(), 3, false, message) == 1, test, "a changed tile wasn't the only one sent");
+        check(send_and_decode(connection, message, decoder, header, payload), test, "a changed tile couldn't be decoded");
+        check(payload.size() >= 4 && payload[0] == 2 && payload[2] == 2, test, "the wrong tile was sent");
+        check(decoded_matches(decoder, frame), test, "a changed tile didn't round-trip");
+
+        // An image of another size is always a keyframe.
+        image smaller(previewTileSize, previewTileSize);
+
+        check(encoder.encode(smaller.pixels.data(), smaller.width, smaller.height, smaller.bytes_per_row(), 4, false, message) == 1, test, "a resized frame didn't send every tile");
+        check(send_and_decode(connection, message, decoder, header, payload), test, "a resized frame couldn't be decoded");
+        check((header.flags & previewKeyframe) != 0, test, "a resized frame wasn't a keyframe");
+        check(decoded_matches(decoder, smaller), test, "a resized frame didn't round-trip");
+    }
+
+    /// @brief: Runs and literals are split where their control bytes run out, and runs carry on across the rows of a tile.
+    void test_run_boundaries()
+    {
+        const char* test = "run boundaries";
+
+        loopback connection;
+        check(connection.connected(), test, "couldn't connect over loopback");
+
+        if (!connection.connected())
+        {
+            return;
+        }
+
+        // One tile, read a row at a time as one sequence of pixels.
+        image frame(previewTileSize, previewTileSize);
+        std::vector<uint32_t> sequence;
+
+        const auto append = [&sequence](int count, uint32_t color) { sequence.insert(sequence.end(), count, color); };
+
+        // The longest run, a run one longer that splits into the longest run and a lone pixel, and the shortest run.
+        append(129, 0x111111);
+        append(130, 0x222222);
+        append(2, 0x333333);
+
+        // Pixels that differ from their neighbours, one more than two of the longest literals.
+        for (int i = 0; i < 257; ++i)
+        {
+            sequence.push_back(0x010000u + (uint32_t)i * 0x000101u);
+        }
+
+        // A run to the end of the tile, which needs several packets.
+        append(previewTileSize * previewTileSize - (int)sequence.size(), 0x444444);
+
+        for (int i = 0; i < (int)sequence.size(); ++i)
+        {
+            frame.set(i % previewTileSize, i / previewTileSize, sequence[i]);
+        }
+
+        preview_encoder encoder;
+        preview_decoder decoder;
+        preview_header header;
+        std::vector<uint8_t> message;
+        std::vector<uint8_t> payload;
+
+        check(encoder.encode(frame.pixels.data(), frame.width, frame.height, frame.bytes_per_row(), 1, true, message) == 1, test, "wrong number of tiles");
+        check(send_and_decode(connection, message, decoder, header, payload), test, "the tile couldn't be decoded");
+        check(decoded_matches(decoder, frame), test, "the tile didn't round-trip");
+
+        // Walk the packets, as a run's length or a literal's negated length.
+        std::vector<int> packets;
+
+        for (size_t offset = tileHeaderSize; offset < payload.size();)
+        {
+            const uint8_t control = payload[offset];
+
+            if (control >= 128)
+            {
+                packets.push_back(control - 126);
+                offset += 4;
+            }
+            else
+            {
+                packets.push_back(-(control + 1));
+                offset += 1 + (size_t)(control + 1) * 3;
+            }
+        }
+
+        const std::vector<int> expected = { 129, 129, -1, 2, -128, -128, -1, 129, 129, 129, 119 };
+
+        check(packets == expected, test, "the runs and literals were split in the wrong places");
+    }
+}
+
+int main()
+{
+    test_round_trip();
+    test_run_boundaries();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
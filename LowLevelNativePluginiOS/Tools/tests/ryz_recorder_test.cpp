@@ -0,0 +1,300 @@
+//
+//  ryz_recorder_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Drives the recorder, see ikin_ryz_recorder.h, end to end through the capture thread, the way the GPU's completion handlers do.
+//  It checks the YUV4MPEG2 header, the number of frames, the size and values of their planes, that frames of another size are dropped,
+//  and that when the disk stops taking frames they are dropped instead of holding up the capture thread.
+//  The disk is stood in for by a pipe that isn't read until the frames have been delivered.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin; U="../../External Headers/Unity"
+//      c++ -O2 -std=c++14 -Wall -Wextra -pthread -I$P -I"$U" -I"$U/XR" -I"$U/XR/Subsystems" -I"$U/XR/Subsystems/Display" ryz_recorder_test.cpp $P/ikin_ryz_recorder.cpp $P/ikin_ryz_capture.cpp $P/ikin_ryz_frame_stats.cpp $P/ikin_ryz_timeline.cpp -o ryz_recorder_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_recorder_test [directory for the recordings, /tmp by default]
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ikin_ryz_capture.h"
+#include "ikin_ryz_frame_stats.h"
+#include "ikin_ryz_recorder.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The longest a check waits for the capture or writer thread, in milliseconds, before it counts as a stall.
+    const int stallMilliseconds = 2000;
+
+    /// @brief: The size of the frames of the recordings.
+    const int frameWidth = 64;
+    const int frameHeight = 48;
+    const int frameRate = 30;
+
+    /// @brief: The header the recorder writes for a recording of @see frameWidth by @see frameHeight at @see frameRate.
+    const char* expectedHeader = "YUV4MPEG2 W64 H48 F30:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+
+    /// @brief: The size of the frames that the disk can't keep up with, which are far larger than a pipe holds.
+    const int largeFrameWidth = 640;
+    const int largeFrameHeight = 480;
+
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: Waits for a condition to hold.
+    /// @returns: True if it held before @see stallMilliseconds passed, otherwise false.
+    template <typename Condition>
+    bool wait_for(Condition condition)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(stallMilliseconds);
+
+        while (!condition())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+
+    /// @brief: Gets the luma the recorder converts a grey to, with the BT.601 limited range matrix.
+    int grey_luma(int grey)
+    {
+        return ((66 * grey + 129 * grey + 25 * grey + 128) >> 8) + 16;
+    }
+
+    /// @brief: Hands a grey frame of the Ryz eye to the capture thread, and waits for the sinks to be done with it.
+    /// @returns: True if the capture thread was done with it before it counted as a stall, otherwise false.
+    bool deliver_grey_frame(int width, int height, int grey, uint64_t frameIndex)
+    {
+        // Pad the rows, the way the staging buffers are, so that the recorder has to follow bytesPerRow.
+        const size_t bytesPerRow = (size_t)width * 4 + 64;
+        std::vector<uint8_t> pixels(bytesPerRow * height, 0xEE);
+
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                uint8_t* pixel = &pixels[y * bytesPerRow + x * 4];
+                pixel[0] = pixel[1] = pixel[2] = (uint8_t)grey;
+                pixel[3] = 0xFF;
+            }
+        }
+
+        std::atomic<bool> done(false);
+
+        captured_frame frame = { ryz_eye, width, height, bytesPerRow, pixels.data(), frameIndex, 0.0 };
+        deliver_captured_frame(frame, [&done] { done = true; });
+
+        return wait_for([&done] { return done.load(); });
+    }
+
+    /// @brief: Reads a whole file.
+    std::vector<uint8_t> read_file(const std::string& path)
+    {
+        std::vector<uint8_t> bytes;
+        FILE* file = fopen(path.c_str(), "rb");
+
+        if (file == nullptr)
+        {
+            return bytes;
+        }
+
+        uint8_t buffer[4096];
+        size_t count;
+
+        while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + count);
+        }
+
+        fclose(file);
+        return bytes;
+    }
+
+    /// @brief: Checks that a plane holds one value.
+    bool plane_is(const uint8_t* plane, size_t size, int value)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (plane[i] != value)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief: Records grey frames, each one lighter than the last, and checks the file holds each of them in order.
+    /// @param directory The directory the recording is written to.
+    /// @param format The format of the recording. @see recording_format.
+    void test_recording(const std::string& directory, int format)
+    {
+        const char* test = format == recording_format_y4m ? "y4m recording" : "raw recording";
+        const std::string path = directory + (format == recording_format_y4m ? "/ryz_recorder_test.y4m" : "/ryz_recorder_test.yuv");
+        const int frameCount = 5;
+
+        const uint64_t writtenBefore = frameStatsCounters.recordingFramesWritten.load();
+        const uint64_t droppedBefore = frameStatsCounters.recordingFramesDropped.load();
+
+        check(start_recording(ryz_eye, path.c_str(), frameRate, format), test, "didn't start");
+        check((get_capture_eye_mask() & (1 << ryz_eye)) != 0, test, "the Ryz eye isn't captured while it is recorded");
+
+        for (int i = 0; i < frameCount; ++i)
+        {
+            check(deliver_grey_frame(frameWidth, frameHeight, 20 + i * 40, i + 1), test, "the capture thread stalled");
+
+            // Wait for each frame to be written, so that none of them is dropped for the disk being behind.
+            check(wait_for([&] { return frameStatsCounters.recordingFramesWritten.load() == writtenBefore + i + 1; }), test, "a frame wasn't written");
+        }
+
+        // A frame of another size is dropped, since a stream can't change size.
+        check(deliver_grey_frame(frameWidth / 2, frameHeight, 0, frameCount + 1), test, "the capture thread stalled");
+
+        stop_recording();
+
+        check(get_capture_eye_mask() == 0, test, "the Ryz eye is still captured once the recording stopped");
+        check(frameStatsCounters.recordingFramesWritten.load() - writtenBefore == frameCount, test, "wrong number of frames written");
+        check(frameStatsCounters.recordingFramesDropped.load() - droppedBefore == 1, test, "a frame of another size wasn't dropped");
+
+        const std::vector<uint8_t> bytes = read_file(path);
+        const size_t lumaSize = (size_t)frameWidth * frameHeight;
+        const size_t chromaSize = lumaSize / 4;
+        const std::string header = format == recording_format_y4m ? expectedHeader : "";
+        const std::string frameHeader = format == recording_format_y4m ? "FRAME\n" : "";
+
+        check(bytes.size() == header.size() + frameCount * (frameHeader.size() + lumaSize + chromaSize * 2), test, "wrong file size");
+
+        if (failures != 0 || bytes.size() < header.size())
+        {
+            return;
+        }
+
+        check(memcmp(bytes.data(), header.data(), header.size()) == 0, test, "wrong stream header");
+
+        size_t offset = header.size();
+
+        for (int i = 0; i < frameCount; ++i)
+        {
+            check(memcmp(&bytes[offset], frameHeader.data(), frameHeader.size()) == 0, test, "wrong frame header");
+            offset += frameHeader.size();
+
+            check(plane_is(&bytes[offset], lumaSize, grey_luma(20 + i * 40)), test, "wrong luma plane");
+            offset += lumaSize;
+
+            // Greys have no color, so both chroma planes sit at the middle of their range.
+            check(plane_is(&bytes[offset], chromaSize, 128), test, "wrong blue-difference plane");
+            offset += chromaSize;
+
+            check(plane_is(&bytes[offset], chromaSize, 128), test, "wrong red-difference plane");
+            offset += chromaSize;
+        }
+    }
+
+    /// @brief: Records to a pipe that isn't read, and checks that the frames past the queue are dropped without holding up the capture thread.
+    /// @param directory The directory the pipe is made in.
+    void test_drops(const std::string& directory)
+    {
+        const char* test = "drops";
+        const std::string path = directory + "/ryz_recorder_test.fifo";
+        const int frameCount = 12;
+
+        unlink(path.c_str());
+
+        if (mkfifo(path.c_str(), 0600) != 0)
+        {
+            check(false, test, "couldn't make the pipe");
+            return;
+        }
+
+        // Open the reading end first, without waiting, so that the recorder can open the other end.
+        const int reader = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+        check(reader >= 0, test, "couldn't open the pipe");
+
+        const uint64_t writtenBefore = frameStatsCounters.recordingFramesWritten.load();
+        const uint64_t droppedBefore = frameStatsCounters.recordingFramesDropped.load();
+
+        check(start_recording(ryz_eye, path.c_str(), frameRate, recording_format_y4m), test, "didn't start");
+
+        // The first frame fills the pipe, so the writer thread blocks on it and the rest wait for it, until the buffers run out.
+        for (int i = 0; i < frameCount; ++i)
+        {
+            check(deliver_grey_frame(largeFrameWidth, largeFrameHeight, 128, i + 1), test, "the capture thread stalled while the disk was behind");
+        }
+
+        check(frameStatsCounters.recordingFramesDropped.load() - droppedBefore == frameCount - maxQueuedRecordingFrames, test, "wrong number of frames dropped");
+
+        // Read the pipe until the recorder closes it, which it does once the frames it kept are written.
+        fcntl(reader, F_SETFL, 0);
+
+        size_t bytesRead = 0;
+
+        std::thread drain([&]
+        {
+            uint8_t buffer[65536];
+            ssize_t count;
+
+            while ((count = read(reader, buffer, sizeof(buffer))) > 0)
+            {
+                bytesRead += (size_t)count;
+            }
+        });
+
+        stop_recording();
+        drain.join();
+        close(reader);
+        unlink(path.c_str());
+
+        const size_t frameSize = strlen("FRAME\n") + (size_t)largeFrameWidth * largeFrameHeight * 3 / 2;
+        const size_t headerSize = strlen("YUV4MPEG2 W640 H480 F30:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n");
+
+        check(frameStatsCounters.recordingFramesWritten.load() - writtenBefore == maxQueuedRecordingFrames, test, "the queued frames weren't written once the disk caught up");
+        check(bytesRead == headerSize + maxQueuedRecordingFrames * frameSize, test, "wrong number of bytes written once the disk caught up");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::string directory = argc > 1 ? argv[1] : "/tmp";
+
+    test_recording(directory, recording_format_y4m);
+    test_recording(directory, recording_format_raw);
+    test_drops(directory);
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,291 @@
+//
+//  ryz_tile_hash_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Checks the tile hashes that decide whether a Ryz frame looks the same as the one before it, see ikin_ryz_tile_hash.h:
+//  the hash of a known image matches the formula the GPU kernel uses, the vectorized hash matches the scalar one for every
+//  size of partial tile, changing one pixel changes the hash of its tile and no other, reordering pixels changes the hash,
+//  the padding at the end of rows is ignored, and the changed tiles are counted the way the hasher decides a frame changed.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin
+//      c++ -O2 -std=c++14 -Wall -Wextra -I$P ryz_tile_hash_test.cpp $P/ikin_ryz_tile_hash.cpp -o ryz_tile_hash_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_tile_hash_test
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "ikin_ryz_tile_hash.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Checks a condition, and reports it if it doesn't hold.
+    void check(bool condition, const char* test, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "FAIL %s: %s\n", test, what);
+            ++failures;
+        }
+    }
+
+    /// @brief: A 32-bit image, with rows that may be longer than the image is wide.
+    struct image
+    {
+        int width;
+        int height;
+        size_t bytesPerRow;
+        std::vector<uint8_t> bytes;
+
+        image(int width, int height, int paddingPixels = 0) :
+            width(width),
+            height(height),
+            bytesPerRow((size_t)(width + paddingPixels) * 4),
+            bytes(bytesPerRow * height, 0)
+        {
+        }
+
+        uint32_t& pixel(int x, int y)
+        {
+            return ((uint32_t*)(bytes.data() + y * bytesPerRow))[x];
+        }
+
+        void fill_random(unsigned seed)
+        {
+            srand(seed);
+
+            for (uint8_t& byte : bytes)
+            {
+                byte = (uint8_t)(rand() & 0xFF);
+            }
+        }
+
+        std::vector<uint32_t> hashes()
+        {
+            std::vector<uint32_t> result((size_t)tile_hash_count(width, height));
+            hash_tiles(bytes.data(), width, height, bytesPerRow, result.data());
+            return result;
+        }
+
+        std::vector<uint32_t> scalar_hashes()
+        {
+            std::vector<uint32_t> result((size_t)tile_hash_count(width, height));
+            hash_tiles_scalar(bytes.data(), width, height, bytesPerRow, result.data());
+            return result;
+        }
+    };
+
+    /// @brief: Rotates the bits of a value to the left, the same as the kernel's rotate.
+    uint32_t rotate_left(uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    /// @brief: Tiles are counted up to the partial ones along the right and bottom edges.
+    void test_count()
+    {
+        const char* test = "count";
+
+        check(tile_hash_count(tileHashTileSize, tileHashTileSize) == 1, test, "one full tile wasn't counted as one");
+        check(tile_hash_count(tileHashTileSize + 1, 1) == 2, test, "a partial tile on the right wasn't counted");
+        check(tile_hash_count(1280, 720) == 40 * 23, test, "a 1280x720 image has the wrong number of tiles");
+    }
+
+    /// @brief: Small images hash to the values worked out by hand from the kernel's formula.
+    void test_known_values()
+    {
+        const char* test = "known values";
+
+        // One pixel lands in the first lane of the only group of the only row.
+        const uint32_t value = 0x80402010;
+        image single(1, 1);
+        single.pixel(0, 0) = value;
+
+        check(single.hashes()[0] == (value ^ rotate_left(value, 7)), test, "a single pixel hashed to the wrong value");
+
+        // Two rows of five pixels: the fifth pixel starts a second group in the first lane.
+        image twoRows(5, 2);
+        uint32_t expected = 0;
+
+        for (int y = 0; y < 2; ++y)
+        {
+            for (int x = 0; x < 5; ++x)
+            {
+                twoRows.pixel(x, y) = (uint32_t)(y * 5 + x + 1) * 0x01010101u;
+            }
+
+            const uint32_t first = twoRows.pixel(0, y);
+            const uint32_t fifth = twoRows.pixel(4, y);
+            const uint32_t sums[4] = { first + fifth, twoRows.pixel(1, y), twoRows.pixel(2, y), twoRows.pixel(3, y) };
+            const uint32_t sumsOfSums[4] = { first + (first + fifth), sums[1] * 2, sums[2] * 2, sums[3] * 2 };
+
+            const uint32_t rowHash = (sums[0] ^ rotate_left(sumsOfSums[0], 7)) +
+                                     (sums[1] ^ rotate_left(sumsOfSums[1], 11)) +
+                                     (sums[2] ^ rotate_left(sumsOfSums[2], 13)) +
+                                     (sums[3] ^ rotate_left(sumsOfSums[3], 17));
+
+            expected = rotate_left(expected, 5) ^ rowHash;
+        }
+
+        check(twoRows.hashes()[0] == expected, test, "two rows with a partial group hashed to the wrong value");
+        check(twoRows.scalar_hashes()[0] == expected, test, "the scalar hash of two rows is wrong");
+    }
+
+    /// @brief: The vectorized hash matches the scalar one for every width of partial group and tile, and for padded rows.
+    void test_vector_matches_scalar()
+    {
+        const char* test = "vector matches scalar";
+
+        bool matches = true;
+
+        for (int width = 1; width <= tileHashTileSize * 2 + 7; ++width)
+        {
+            for (int height : { 1, 3, tileHashTileSize + 5 })
+            {
+                image random(width, height, width % 3);
+                random.fill_random((unsigned)(width * 100 + height));
+
+                matches &= random.hashes() == random.scalar_hashes();
+            }
+        }
+
+        check(matches, test, "the vectorized hashes differ from the scalar ones");
+    }
+
+    /// @brief: Changing one pixel changes the hash of its tile and of no other, including in the partial tiles at the edges.
+    void test_single_pixel_change()
+    {
+        const char* test = "single pixel change";
+
+        image frame(tileHashTileSize * 3 + 9, tileHashTileSize * 2 + 3);
+        frame.fill_random(7);
+
+        const std::vector<uint32_t> before = frame.hashes();
+        const int tilesAcross = (frame.width + tileHashTileSize - 1) / tileHashTileSize;
+
+        bool onlyItsTile = true;
+        bool counted = true;
+
+        for (int y = 0; y < frame.height; y += 5)
+        {
+            for (int x = 0; x < frame.width; x += 3)
+            {
+                const uint32_t original = frame.pixel(x, y);
+                frame.pixel(x, y) = original ^ 0x00000100;
+
+                const std::vector<uint32_t> after = frame.hashes();
+                const int tile = (y / tileHashTileSize) * tilesAcross + x / tileHashTileSize;
+
+                for (size_t other = 0; other < after.size(); ++other)
+                {
+                    onlyItsTile &= (after[other] != before[other]) == ((int)other == tile);
+                }
+
+                counted &= count_changed_tiles(before.data(), (int)before.size(), after.data(), (int)after.size()) == 1;
+
+                frame.pixel(x, y) = original;
+            }
+        }
+
+        check(onlyItsTile, test, "a changed pixel didn't change exactly its own tile's hash");
+        check(counted, test, "a changed pixel wasn't counted as one changed tile");
+        check(frame.hashes() == before, test, "restoring the pixels didn't restore the hashes");
+    }
+
+    /// @brief: Moving pixels around changes the hash, even where the sums of the pixels stay the same.
+    void test_order()
+    {
+        const char* test = "order";
+
+        image frame(16, 4);
+        frame.fill_random(11);
+
+        // Make the pixels distinct, so that swapping them is a change.
+        frame.pixel(0, 0) = 0x11111111;
+        frame.pixel(4, 0) = 0x22222222;
+        frame.pixel(1, 0) = 0x33333333;
+        frame.pixel(1, 1) = 0x44444444;
+
+        const uint32_t before = frame.hashes()[0];
+
+        // Two pixels in the same lane of one row, which add to the same sum either way.
+        std::swap(frame.pixel(0, 0), frame.pixel(4, 0));
+        check(frame.hashes()[0] != before, test, "swapping pixels within a lane didn't change the hash");
+        std::swap(frame.pixel(0, 0), frame.pixel(4, 0));
+
+        // Two pixels in the same column of different rows.
+        std::swap(frame.pixel(1, 0), frame.pixel(1, 1));
+        check(frame.hashes()[0] != before, test, "swapping pixels between rows didn't change the hash");
+    }
+
+    /// @brief: The padding at the end of each row isn't part of the image, so it doesn't change the hashes.
+    void test_padding()
+    {
+        const char* test = "padding";
+
+        image padded(40, 10, 8);
+        padded.fill_random(5);
+
+        const std::vector<uint32_t> before = padded.hashes();
+
+        for (int y = 0; y < padded.height; ++y)
+        {
+            for (int x = padded.width; x < padded.width + 8; ++x)
+            {
+                padded.pixel(x, y) = ~padded.pixel(x, y);
+            }
+        }
+
+        check(padded.hashes() == before, test, "the padding at the end of the rows changed the hashes");
+    }
+
+    /// @brief: Changed tiles are counted only between frames of the same size, and a frame without a previous one changed entirely.
+    void test_changed_tiles()
+    {
+        const char* test = "changed tiles";
+
+        const std::vector<uint32_t> previous = { 1, 2, 3, 4, 5, 6 };
+        std::vector<uint32_t> hashes = previous;
+
+        check(count_changed_tiles(previous.data(), 6, hashes.data(), 6) == 0, test, "identical frames have changed tiles");
+
+        hashes[0] = 9;
+        hashes[5] = 9;
+
+        check(count_changed_tiles(previous.data(), 6, hashes.data(), 6) == 2, test, "changed tiles were miscounted");
+        check(count_changed_tiles(nullptr, 0, hashes.data(), 6) == 6, test, "a first frame didn't change every tile");
+        check(count_changed_tiles(previous.data(), 4, hashes.data(), 6) == 6, test, "a frame of another size didn't change every tile");
+        check(count_changed_tiles(nullptr, 0, nullptr, 0) == 0, test, "an empty frame has changed tiles");
+    }
+}
+
+int main()
+{
+    test_count();
+    test_known_values();
+    test_vector_matches_scalar();
+    test_single_pixel_change();
+    test_order();
+    test_padding();
+    test_changed_tiles();
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,218 @@
+//
+//  ryz_upscale_test.cpp
+//  LowLevelNativePlugin
+//
+//  Copyright © 2019 Unity Technologies. All rights reserved.
+//
+//  Checks the CPU reference of the upscale and sharpen passes, see ikin_ryz_upscale.h, against images whose result is known:
+//  a constant image stays constant, an image that isn't scaled is copied as it is, and a step edge stays monotonic
+//  after it is upscaled and sharpened, without ringing past either side of it.
+//
+//  Build on Linux or macOS from this directory:
+//      P=../../LowLevelNativePlugin
+//      c++ -O2 -std=c++14 -Wall -Wextra -I$P ryz_upscale_test.cpp $P/ikin_ryz_upscale.cpp -o ryz_upscale_test
+//
+//  Run, which prints each check that fails and exits with 1 if any did:
+//      ./ryz_upscale_test
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ikin_ryz_upscale.h"
+
+// Placed in an anonymous namespace to avoid these values being accessed outside this file
+namespace
+{
+    /// @brief: The furthest a channel may be from what was expected, since the passes round each channel to 8 bits.
+    const int channelTolerance = 1;
+
+    /// @brief: The number of checks that failed.
+    int failures = 0;
+
+    /// @brief: Reports a check that failed.
+    void fail(const char* test, const char* what, int x, int y, int channel, int value, int expected)
+    {
+        fprintf(stderr, "FAIL %s: %s at (%d, %d) channel %d: %d, expected %d\n", test, what, x, y, channel, value, expected);
+        ++failures;
+    }
+
+    /// @brief: A tightly packed 32-bit image.
+    struct image
+    {
+        image(int width, int height) : width(width), height(height), pixels((size_t)width * height * 4) {}
+
+        uint8_t* at(int x, int y) { return &pixels[((size_t)y * width + x) * 4]; }
+        size_t bytes_per_row() const { return (size_t)width * 4; }
+
+        int width;
+        int height;
+        std::vector<uint8_t> pixels;
+    };
+
+    /// @brief: Upscales an image with the edge-adaptive filter.
+    image upscale(image& source, int width, int height)
+    {
+        image destination(width, height);
+        upscale_easu(source.pixels.data(), source.width, source.height, source.bytes_per_row(),
+                     destination.pixels.data(), width, height, destination.bytes_per_row());
+        return destination;
+    }
+
+    /// @brief: Sharpens an image.
+    image sharpen(image& source, float sharpness)
+    {
+        image destination(source.width, source.height);
+        sharpen_rcas(source.pixels.data(), source.width, source.height, source.bytes_per_row(),
+                     destination.pixels.data(), destination.bytes_per_row(), sharpness);
+        return destination;
+    }
+
+    /// @brief: Checks that every pixel of an image is a color.
+    void check_constant(const char* test, image& result, const uint8_t* color)
+    {
+        for (int y = 0; y < result.height; ++y)
+        {
+            for (int x = 0; x < result.width; ++x)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    const int value = result.at(x, y)[channel];
+
+                    if (abs(value - color[channel]) > channelTolerance)
+                    {
+                        fail(test, "changed", x, y, channel, value, color[channel]);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief: A constant image stays constant, whatever it is scaled to and however much it is sharpened.
+    void test_constant()
+    {
+        const uint8_t color[4] = { 0x80, 0x40, 0xC0, 0xFF };
+        image source(16, 12);
+
+        for (int y = 0; y < source.height; ++y)
+        {
+            for (int x = 0; x < source.width; ++x)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    source.at(x, y)[channel] = color[channel];
+                }
+            }
+        }
+
+        image upscaled = upscale(source, 27, 21);
+        check_constant("constant upscale", upscaled, color);
+
+        image sharpened = sharpen(upscaled, 0.0f);
+        check_constant("constant sharpen", sharpened, color);
+    }
+
+    /// @brief: An image that isn't scaled is copied as it is, even where it has strong edges.
+    void test_identity()
+    {
+        image source(32, 24);
+        srand(1);
+
+        for (uint8_t& value : source.pixels)
+        {
+            value = (uint8_t)(rand() & 0xFF);
+        }
+
+        image result = upscale(source, source.width, source.height);
+
+        for (int y = 0; y < source.height; ++y)
+        {
+            for (int x = 0; x < source.width; ++x)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    if (result.at(x, y)[channel] != source.at(x, y)[channel])
+                    {
+                        fail("identity", "changed", x, y, channel, result.at(x, y)[channel], source.at(x, y)[channel]);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief: A step from one grey to another stays monotonic once it is upscaled and sharpened, and doesn't ring past either grey.
+    /// @param dark The grey on the left of the step.
+    /// @param light The grey on the right of the step.
+    /// @param sharpness How much weaker than the strongest sharpening to sharpen, in stops.
+    void test_step(uint8_t dark, uint8_t light, float sharpness)
+    {
+        image source(16, 8);
+
+        for (int y = 0; y < source.height; ++y)
+        {
+            for (int x = 0; x < source.width; ++x)
+            {
+                uint8_t* pixel = source.at(x, y);
+                pixel[0] = pixel[1] = pixel[2] = x < source.width / 2 ? dark : light;
+                pixel[3] = 0xFF;
+            }
+        }
+
+        image upscaled = upscale(source, 40, 20);
+        image result = sharpen(upscaled, sharpness);
+
+        char test[64];
+        snprintf(test, sizeof(test), "step %d to %d, sharpness %.1f", dark, light, sharpness);
+
+        for (int y = 0; y < result.height; ++y)
+        {
+            for (int x = 0; x < result.width; ++x)
+            {
+                for (int channel = 0; channel < 3; ++channel)
+                {
+                    const int value = result.at(x, y)[channel];
+
+                    if (value < dark)
+                    {
+                        fail(test, "rings below the dark side", x, y, channel, value, dark);
+                        return;
+                    }
+
+                    if (value > light)
+                    {
+                        fail(test, "rings above the light side", x, y, channel, value, light);
+                        return;
+                    }
+
+                    if (x > 0 && value < result.at(x - 1, y)[channel])
+                    {
+                        fail(test, "not monotonic", x, y, channel, value, result.at(x - 1, y)[channel]);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    test_constant();
+    test_identity();
+
+    test_step(0x00, 0xFF, 0.0f);
+    test_step(0x28, 0xC8, 0.0f);
+    test_step(0x28, 0xC8, defaultUpscaleSharpness);
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -18,6 +18,9 @@ public class ikinRyzCamera : MonoBehaviour
 #endif
 		cam = GetComponent<Camera>();
 
+		/// On iOS the native display provider flips the Ryz image as it presents it (see ikinRyzSettings.SetEyeOrientation),
+		/// so the scene is rendered as usual there and none of the projection flipping or culling inversion below is needed.
+#if !UNITY_IOS
 		/// If we found our camera just flip the projection matrix here so it's cached for either pipeline
 		if (cam)
 		{
@@ -29,8 +32,10 @@ public class ikinRyzCamera : MonoBehaviour
 
 			cam.projectionMatrix = cam.projectionMatrix * Matrix4x4.Scale(new Vector3(1f, -1f, 1f));
 		}
+#endif
 	}
 
+#if !UNITY_IOS
 	/// BEGIN UNIVERSAL RENDER PIPELINE LOGIC
 	/// UNITY_URP is defined by the pressence of the URP unity package as laid out in a rule in the ikinRyz package Runtime asmdef
 	/// This define helps limit the code compiled based on which render pipeline is being used to make sure no extraneous render pipeline delegates are subscribed
@@ -97,4 +102,5 @@ public class ikinRyzCamera : MonoBehaviour
 	}
 	/// END BUILT IN RENDER PIPELINE LOGIC
 #endif
+#endif
 }
\ No newline at end of file
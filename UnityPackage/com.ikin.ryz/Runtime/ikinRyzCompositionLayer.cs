@@ -0,0 +1,271 @@
+﻿using System.Runtime.InteropServices;
+using UnityEngine;
+
+/// <summary>
+/// Draws a camera, such as one that only sees a UI canvas, into its own texture that the native plugin blends over the Ryz image as it presents it.
+/// </summary>
+/// <remarks>
+/// The camera is only rendered when the layer is marked dirty, or at its own update rate, instead of with the scene every frame.
+/// UI that hasn't changed then isn't rendered again, and the scene and the UI can be updated at different rates.
+/// Point the camera at the layers the UI is on, and leave them out of the Ryz camera's culling mask.
+/// </remarks>
+[AddComponentMenu("IKIN/Ryz Composition Layer")]
+public class ikinRyzCompositionLayer : MonoBehaviour
+{
+    #region Types
+    /// <summary>
+    /// The shapes a composition layer can have.
+    /// </summary>
+    /// <remarks>The values match <c>composition_layer_shape</c> in the native plugin.</remarks>
+    public enum Shape
+    {
+        /// <summary>
+        /// The layer covers <see cref="rect"/> of the Ryz image.
+        /// </summary>
+        Quad = 0,
+
+        /// <summary>
+        /// The layer covers the whole Ryz image.
+        /// </summary>
+        Overlay = 1
+    }
+    #endregion
+
+    #region Fields
+    [SerializeField]
+    [Tooltip("The camera that is rendered into the layer. It is disabled, so that it is only rendered when the layer is updated.")]
+    private Camera layerCamera;
+
+    [SerializeField]
+    [Tooltip("Whether the layer covers a region of the Ryz image or all of it.")]
+    private Shape shape = Shape.Overlay;
+
+    [SerializeField]
+    [Tooltip("The region of the Ryz image that a quad layer covers, in normalized coordinates from the bottom left.")]
+    private Rect rect = new Rect(0f, 0f, 1f, 1f);
+
+    [SerializeField]
+    [Tooltip("The size of the layer's texture in pixels.")]
+    private Vector2Int resolution = new Vector2Int(1280, 720);
+
+    [SerializeField]
+    [Range(0f, 1f)]
+    [Tooltip("How opaque the layer is.")]
+    private float opacity = 1f;
+
+    [SerializeField]
+    [Tooltip("The order the layers are drawn in. A layer covers the layers with a lower order.")]
+    private int order;
+
+    [SerializeField]
+    [Min(0f)]
+    [Tooltip("How many times a second the layer is rendered. Zero to only render it when it is marked dirty.")]
+    private float updateRate;
+
+    private RenderTexture texture;
+
+    private int layerId;
+
+    private bool dirty;
+
+    private float lastUpdateTime;
+    #endregion
+
+    #region Properties
+    /// <summary>
+    /// Gets or sets how opaque the layer is, from 0 to 1.
+    /// </summary>
+    public float Opacity
+    {
+        get => opacity;
+        set
+        {
+            opacity = Mathf.Clamp01(value);
+            ApplySettings();
+        }
+    }
+
+    /// <summary>
+    /// Gets or sets the region of the Ryz image that a quad layer covers, in normalized coordinates from the bottom left.
+    /// </summary>
+    public Rect Rect
+    {
+        get => rect;
+        set
+        {
+            rect = value;
+            ApplySettings();
+        }
+    }
+
+    /// <summary>
+    /// Gets or sets the order the layers are drawn in. A layer covers the layers with a lower order.
+    /// </summary>
+    public int Order
+    {
+        get => order;
+        set
+        {
+            order = value;
+            ApplySettings();
+        }
+    }
+    #endregion
+
+    #region Methods
+    /// <summary>
+    /// Renders the layer again at the end of this frame, such as after the UI it shows has changed.
+    /// </summary>
+    public void MarkDirty()
+    {
+        dirty = true;
+    }
+
+    private void OnEnable()
+    {
+#if UNITY_IOS && !UNITY_EDITOR
+        if (layerCamera == null)
+        {
+            return;
+        }
+
+        layerId = ikinRyzCreateCompositionLayer((int)shape);
+
+        if (layerId == 0)
+        {
+            Debug.LogWarning("No more iKin Ryz composition layers can be created.");
+            return;
+        }
+
+        // Clear to transparent, so that only what the camera draws covers the Ryz image.
+        texture = new RenderTexture(resolution.x, resolution.y, 24, RenderTextureFormat.ARGB32);
+        texture.Create();
+
+        layerCamera.targetTexture = texture;
+        layerCamera.clearFlags = CameraClearFlags.SolidColor;
+        layerCamera.backgroundColor = Color.clear;
+        layerCamera.enabled = false;
+
+        ikinRyzSetCompositionLayerTexture(layerId, texture.GetNativeTexturePtr());
+        ApplySettings();
+
+        dirty = true;
+#endif
+    }
+
+    private void OnDisable()
+    {
+#if UNITY_IOS && !UNITY_EDITOR
+        if (layerId != 0)
+        {
+            ikinRyzDestroyCompositionLayer(layerId);
+            layerId = 0;
+        }
+
+        if (texture != null)
+        {
+            layerCamera.targetTexture = null;
+            texture.Release();
+            Destroy(texture);
+            texture = null;
+        }
+#endif
+    }
+
+    private void LateUpdate()
+    {
+        if (layerId == 0)
+        {
+            return;
+        }
+
+        // Render on demand, and at the update rate if there is one.
+        if (!dirty && (updateRate <= 0f || Time.unscaledTime - lastUpdateTime < 1f / updateRate))
+        {
+            return;
+        }
+
+        dirty = false;
+        lastUpdateTime = Time.unscaledTime;
+
+#if TRACE
+        Debug.Log($"Updating iKin Ryz composition layer. layerId:{layerId}");
+#endif
+        layerCamera.Render();
+
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzUpdateCompositionLayer(layerId);
+#endif
+    }
+
+    private void ApplySettings()
+    {
+#if UNITY_IOS && !UNITY_EDITOR
+        if (layerId == 0)
+        {
+            return;
+        }
+
+        // The native plugin places layers from the top left of the Ryz image.
+        ikinRyzSetCompositionLayerRect(layerId, rect.x, 1f - rect.y - rect.height, rect.width, rect.height);
+        ikinRyzSetCompositionLayerOpacity(layerId, opacity);
+        ikinRyzSetCompositionLayerOrder(layerId, order);
+#endif
+    }
+    #endregion
+
+    #region Static Methods
+#if UNITY_IOS && !UNITY_EDITOR
+    #region External
+    /// <summary>
+    /// Creates a composition layer.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzCreateCompositionLayer(int shape);
+
+    /// <summary>
+    /// Destroys a composition layer.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzDestroyCompositionLayer(int layerId);
+
+    /// <summary>
+    /// Sets the texture that a composition layer is drawn from.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetCompositionLayerTexture(int layerId, System.IntPtr texture);
+
+    /// <summary>
+    /// Sets the region of the Ryz image that a quad layer covers.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetCompositionLayerRect(int layerId, float x, float y, float width, float height);
+
+    /// <summary>
+    /// Sets how opaque a composition layer is.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetCompositionLayerOpacity(int layerId, float opacity);
+
+    /// <summary>
+    /// Sets the order a composition layer is drawn in.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetCompositionLayerOrder(int layerId, int order);
+
+    /// <summary>
+    /// Tells the native plugin that the texture of a composition layer has been redrawn.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzUpdateCompositionLayer(int layerId);
+    #endregion
+#endif
+    #endregion
+}
@@ -0,0 +1,193 @@
+﻿using System.Runtime.InteropServices;
+
+/// <summary>
+/// A snapshot of the counters the native plugin keeps about the frames it has handled.
+/// </summary>
+/// <remarks>The layout must match <c>frame_stats</c> in the native plugin.</remarks>
+[StructLayout(LayoutKind.Sequential)]
+public struct ikinRyzFrameStats
+{
+    #region Fields
+    /// <summary>
+    /// The number of frames that have been submitted by Unity.
+    /// </summary>
+    public ulong framesSubmitted;
+
+    /// <summary>
+    /// The number of frames that have been presented on the Ryz.
+    /// </summary>
+    public ulong framesPresented;
+
+    /// <summary>
+    /// The number of frames that were not presented on the Ryz because they looked the same as the last presented frame.
+    /// </summary>
+    public ulong framesSkipped;
+
+    /// <summary>
+    /// The total number of bytes read to present the Ryz eye.
+    /// </summary>
+    /// <remarks>When damage is tracked, this counts both the changed regions copied out of the eye texture and the read of their copy as it is presented.</remarks>
+    public ulong ryzBytesCopied;
+
+    /// <summary>
+    /// The number of bytes read to present the Ryz eye in the last frame, by the damage copy and by the present.
+    /// </summary>
+    public ulong ryzBytesLastFrame;
+
+    /// <summary>
+    /// The total number of eye texture pixels that were covered by occlusion meshes, and so not shaded.
+    /// </summary>
+    public ulong occludedPixels;
+
+    /// <summary>
+    /// The number of eye texture pixels that were covered by occlusion meshes in the last frame.
+    /// </summary>
+    public ulong occludedPixelsLastFrame;
+
+    /// <summary>
+    /// The number of frames in which the Ryz eye was not rendered, and its last image was used again.
+    /// </summary>
+    /// <remarks>See <see cref="ikinRyzSettings.SetRyzFrameRateDivisor"/>.</remarks>
+    public ulong ryzFramesRepeated;
+
+    /// <summary>
+    /// The number of frames in which the main eye was not rendered, because only the Ryz eye is.
+    /// </summary>
+    /// <remarks>See <see cref="ikinRyzSettings.SetRyzOnly"/>.</remarks>
+    public ulong mainFramesDropped;
+
+    /// <summary>
+    /// The number of frames that were synthesized for the Ryz display because Unity missed them.
+    /// </summary>
+    /// <remarks>See <see cref="ikinRyzSettings.SetFrameSynthesis"/>.</remarks>
+    public ulong framesSynthesized;
+
+    /// <summary>
+    /// The number of external surface frames that were blended over the Ryz image, at their presentation times.
+    /// </summary>
+    public ulong surfaceFramesPresented;
+
+    /// <summary>
+    /// The number of external surface frames that were never shown, because a later frame was due by the time they could be.
+    /// </summary>
+    public ulong surfaceFramesDropped;
+
+    /// <summary>
+    /// The number of frames that were copied off the GPU for the capture sinks.
+    /// </summary>
+    /// <remarks>See <see cref="ikinRyzSettings.CaptureScreenshot"/>.</remarks>
+    public ulong captureFrames;
+
+    /// <summary>
+    /// The number of frames that weren't captured because every staging buffer was still waiting for the GPU or the capture thread.
+    /// </summary>
+    public ulong captureFramesDropped;
+
+    /// <summary>
+    /// The number of bytes that were copied off the GPU for the capture sinks in the last frame.
+    /// </summary>
+    public ulong captureBytesLastFrame;
+
+    /// <summary>
+    /// The time the render thread spent encoding the capture copies of the last frame, in microseconds.
+    /// </summary>
+    public ulong captureRenderMicrosecondsLastFrame;
+
+    /// <summary>
+    /// The time the capture sinks spent on the last captured frame, in microseconds.
+    /// </summary>
+    public ulong captureWorkerMicrosecondsLastFrame;
+
+    /// <summary>
+    /// The number of frames that were written to the recording.
+    /// </summary>
+    public ulong recordingFramesWritten;
+
+    /// <summary>
+    /// The number of frames that weren't recorded because the disk had fallen behind, or the frame changed size.
+    /// </summary>
+    public ulong recordingFramesDropped;
+
+    /// <summary>
+    /// The number of frames that were sent to the preview client.
+    /// </summary>
+    public ulong previewFramesSent;
+
+    /// <summary>
+    /// The number of bytes that were sent to the preview client.
+    /// </summary>
+    public ulong previewBytesSent;
+
+    /// <summary>
+    /// The number of frames that were replaced by newer ones before the preview server could send them.
+    /// </summary>
+    public ulong previewFramesSkipped;
+    #endregion
+
+    #region Profiler Counters
+    /// <summary>
+    /// The Unity Profiler category of the native plugin's counters, which Unity 2021.2 and later show in the Profiler.
+    /// </summary>
+    /// <remarks>
+    /// The counters hold each frame's values, and are available in release builds too.
+    /// Read one with <c>ProfilerRecorder.StartNew(new ProfilerCategory(ikinRyzFrameStats.ProfilerCategoryName), ikinRyzFrameStats.FramesPresentedCounter)</c>.
+    /// </remarks>
+    public const string ProfilerCategoryName = "iKin Ryz";
+
+    /// <summary>
+    /// The counter of the frames presented on the Ryz in the last frame.
+    /// </summary>
+    public const string FramesPresentedCounter = "Ryz Frames Presented";
+
+    /// <summary>
+    /// The counter of the frames that were not presented on the Ryz in the last frame because they looked the same as the last presented frame.
+    /// </summary>
+    public const string FramesSkippedCounter = "Ryz Frames Skipped";
+
+    /// <summary>
+    /// The counter of the bytes read to present the Ryz eye in the last frame, by the damage copy and by the present.
+    /// </summary>
+    public const string RyzBlitBytesCounter = "Ryz Blit Bytes";
+
+    /// <summary>
+    /// The counter of the Ryz frames that have been presented but that the GPU hasn't finished.
+    /// </summary>
+    public const string FramesInFlightCounter = "Ryz Frames In Flight";
+
+    /// <summary>
+    /// The counter of Unity's eye texture resolution scale, which dynamic resolution changes.
+    /// </summary>
+    public const string ResolutionScaleCounter = "Ryz Resolution Scale";
+
+    /// <summary>
+    /// The counter of the bytes held by the textures and buffers that the plugin allocates: the eye textures, the Ryz presentation texture, the upscaler's intermediate texture, the frame synthesizer's images, the distortion mesh, the color lookup table and the capture staging buffers.
+    /// </summary>
+    public const string TextureMemoryCounter = "Ryz Texture Memory";
+    #endregion
+
+    #region Static Methods
+#if UNITY_IOS && !UNITY_EDITOR
+    #region External
+    /// <summary>
+    /// Copies the current frame counters.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzGetFrameStats(out ikinRyzFrameStats stats);
+    #endregion
+#endif
+
+    /// <summary>
+    /// Gets the current frame counters.
+    /// </summary>
+    /// <returns>The counters. All zero on platforms without the native display provider.</returns>
+    public static ikinRyzFrameStats Get()
+    {
+        ikinRyzFrameStats stats = default(ikinRyzFrameStats);
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzGetFrameStats(out stats);
+#endif
+        return stats;
+    }
+    #endregion
+}
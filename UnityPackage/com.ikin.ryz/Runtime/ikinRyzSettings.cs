@@ -0,0 +1,872 @@
+﻿#undef TRACE
+
+using System;
+using System.Runtime.InteropServices;
+using UnityEngine;
+
+/// <summary>
+/// Identifies the display that an eye texture is presented on.
+/// </summary>
+public enum RyzEye
+{
+    /// <summary>
+    /// The phone display. Rendered by cameras that target the left eye.
+    /// </summary>
+    Main = 0,
+
+    /// <summary>
+    /// The Ryz display. Rendered by cameras that target the right eye.
+    /// </summary>
+    Ryz = 1
+}
+
+/// <summary>
+/// The color formats that an eye texture can be rendered in.
+/// </summary>
+public enum RyzColorFormat
+{
+    /// <summary>
+    /// 8 bits per channel. 4 bytes per pixel.
+    /// </summary>
+    BGRA32 = 0,
+
+    /// <summary>
+    /// 8 bits per channel with sRGB encoding. 4 bytes per pixel.
+    /// </summary>
+    BGRA32sRGB = 1,
+
+    /// <summary>
+    /// 5 bits red, 6 bits green and 5 bits blue. 2 bytes per pixel.
+    /// </summary>
+    RGB565 = 2,
+
+    /// <summary>
+    /// Whichever of the formats above the project's color space and 16-bit color buffer settings ask for. sRGB wins over 16-bit.
+    /// </summary>
+    Default = 3
+}
+
+/// <summary>
+/// The depth formats that an eye texture can be rendered with.
+/// </summary>
+public enum RyzDepthFormat
+{
+    /// <summary>
+    /// A 24 bit or greater depth buffer.
+    /// </summary>
+    Depth24 = 0,
+
+    /// <summary>
+    /// A 16 bit depth buffer.
+    /// </summary>
+    Depth16 = 1,
+
+    /// <summary>
+    /// No depth buffer.
+    /// </summary>
+    None = 2
+}
+
+/// <summary>
+/// How an eye texture is oriented when it is presented on its display.
+/// </summary>
+public enum RyzOrientation
+{
+    /// <summary>
+    /// The texture is presented as it was rendered.
+    /// </summary>
+    None = 0,
+
+    /// <summary>
+    /// The texture is flipped top to bottom. This is the default for the Ryz eye.
+    /// </summary>
+    FlipVertical = 1,
+
+    /// <summary>
+    /// The texture is flipped left to right.
+    /// </summary>
+    FlipHorizontal = 2,
+
+    /// <summary>
+    /// The texture is rotated half a turn, which flips it both ways.
+    /// </summary>
+    Rotate180 = 3
+}
+
+/// <summary>
+/// How the regions of the Ryz eye that changed since the last frame are found.
+/// </summary>
+public enum RyzDamageTracking
+{
+    /// <summary>
+    /// The whole Ryz eye is treated as changed every frame. This is the default.
+    /// </summary>
+    Off = 0,
+
+    /// <summary>
+    /// The application reports the regions it changed with <see cref="ikinRyzSettings.AddDamageRect"/>.
+    /// Frames without any reported regions are treated as unchanged.
+    /// </summary>
+    Application = 1,
+
+    /// <summary>
+    /// The regions are found by comparing the tiles of the Ryz eye on the GPU.
+    /// </summary>
+    Tiles = 2
+}
+
+/// <summary>
+/// The file formats a recording can be written in.
+/// </summary>
+public enum RyzRecordingFormat
+{
+    /// <summary>
+    /// A YUV4MPEG2 stream, which players and encoders read without being told the size or frame rate.
+    /// </summary>
+    Y4M = 0,
+
+    /// <summary>
+    /// The I420 planes of each frame back to back, without any headers.
+    /// </summary>
+    Raw = 1
+}
+
+/// <summary>
+/// Configures how the native plugin renders and presents each display.
+/// </summary>
+public static class ikinRyzSettings
+{
+    #region Constants
+    /// <summary>
+    /// The mirror blit mode that shows the main eye with a picture of the Ryz eye inset in it.
+    /// Select it with XRDisplaySubsystem.SetPreferredMirrorBlitMode. The built-in left eye, right eye and side by side modes are also supported.
+    /// </summary>
+    public const int MirrorBlitPictureInPicture = 1;
+    #endregion
+
+    #region Static Methods
+#if UNITY_IOS && !UNITY_EDITOR
+    #region External
+    /// <summary>
+    /// Sets the formats that an eye texture is created with.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetEyeFormat(int eye, int colorFormat, int depthFormat);
+
+    /// <summary>
+    /// Sets the orientation that an eye texture is presented with.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetEyeOrientation(int eye, int orientation);
+
+    /// <summary>
+    /// Sets the region of an eye texture that can be seen on its display.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetEyeOcclusion(int eye, float radiusX, float radiusY);
+
+    /// <summary>
+    /// Sets whether Ryz frames that look the same as the last presented frame are skipped.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetSkipStaticFrames(int enabled);
+
+    /// <summary>
+    /// Sets how the regions of the Ryz eye that changed since the last frame are found.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetDamageTracking(int mode);
+
+    /// <summary>
+    /// Reports a region of the Ryz eye that changed in the frame being rendered.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzAddDamageRect(int x, int y, int width, int height);
+
+    /// <summary>
+    /// Sets how often the Ryz eye is rendered, relative to the main eye.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetRyzFrameRateDivisor(int divisor);
+
+    /// <summary>
+    /// Sets whether only the Ryz eye is rendered.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetRyzOnly(int enabled);
+
+    /// <summary>
+    /// Sets whether a frame is synthesized for the Ryz display when Unity misses one.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetFrameSynthesis(int enabled);
+
+    /// <summary>
+    /// Sets the texture that holds the motion vectors of the Ryz eye.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetMotionVectorTexture(IntPtr texture);
+
+    /// <summary>
+    /// Sets the scale the Ryz eye is rendered at, relative to the size of the Ryz display.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetRyzRenderScale(float scale);
+
+    /// <summary>
+    /// Sets whether a Ryz eye rendered smaller than the display is upscaled with edge reconstruction and sharpening.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetUpscaling(int enabled, float sharpness);
+
+    /// <summary>
+    /// Loads the distortion mesh of the Ryz optics from a calibration file.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzLoadDistortionMesh(string path);
+
+    /// <summary>
+    /// Loads the color lookup table of the Ryz panel from a calibration file.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzLoadColorLut(string path);
+
+    /// <summary>
+    /// Sets the calibration package that the Ryz display is calibrated from when it is connected.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetCalibrationPackage(string path);
+
+    /// <summary>
+    /// Gets the physical size of the connected Ryz display from its calibration package.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzGetDisplayGeometry(out float width, out float height);
+
+    /// <summary>
+    /// Saves the next frame of an eye to a PNG file.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzCaptureScreenshot(int eye, string path);
+
+    /// <summary>
+    /// Starts recording the frames of an eye to a YUV4MPEG2 or raw I420 file.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzStartRecording(int eye, string path, int frameRate, int format);
+
+    /// <summary>
+    /// Stops recording and closes the file.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzStopRecording();
+
+    /// <summary>
+    /// Starts a server that streams the Ryz eye to a preview client over TCP.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzStartPreviewServer(int port, int maxFramesPerSecond, int maxBytesPerSecond, int allowRemote);
+
+    /// <summary>
+    /// Stops the preview server and disconnects its client.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzStopPreviewServer();
+
+    /// <summary>
+    /// Starts recording the inputs of the display provider to a trace file.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzStartInputTrace(string path, int maxBytes);
+
+    /// <summary>
+    /// Stops recording the inputs of the display provider.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzStopInputTrace();
+
+    /// <summary>
+    /// Starts recording the plugin's markers and frame lifecycle to an in-memory timeline.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzStartTimeline(int eventCount);
+
+    /// <summary>
+    /// Stops recording the timeline.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzStopTimeline();
+
+    /// <summary>
+    /// Writes the timeline to a file as Chrome trace JSON.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzExportTimeline(string path);
+
+    /// <summary>
+    /// Sets where the flight recorder writes its dumps when a severe hitch happens or the display shuts down.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzConfigureFlightRecorder(string directory, int seconds, int hitchMilliseconds);
+
+    /// <summary>
+    /// Writes the flight recorder's last seconds to a file.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern int ikinRyzDumpFlightRecorder(string path);
+
+    /// <summary>
+    /// Sets the region of the mirror view that the Ryz eye is drawn into in picture in picture mode.
+    /// This is bound to the method defined in the native plugin.
+    /// </summary>
+    [DllImport("__Internal")]
+    private static extern void ikinRyzSetMirrorPictureInPictureRect(float x, float y, float width, float height);
+    #endregion
+#endif
+
+    /// <summary>
+    /// Sets the formats that an eye texture is created with.
+    /// </summary>
+    /// <param name="eye">The eye to configure.</param>
+    /// <param name="colorFormat">The format of the color texture.</param>
+    /// <param name="depthFormat">The format of the depth texture.</param>
+    /// <remarks>
+    /// The eye textures are recreated before the next frame is rendered.
+    /// When both eyes end up in the same formats, they are rendered side by side into one texture in a single pass.
+    /// </remarks>
+    public static void SetEyeFormat(RyzEye eye, RyzColorFormat colorFormat, RyzDepthFormat depthFormat)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz eye format. eye:{eye}, color:{colorFormat}, depth:{depthFormat}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetEyeFormat((int)eye, (int)colorFormat, (int)depthFormat);
+#endif
+    }
+
+    /// <summary>
+    /// Sets the orientation that an eye texture is presented with.
+    /// </summary>
+    /// <param name="eye">The eye to configure.</param>
+    /// <param name="orientation">The orientation of the image on the display.</param>
+    /// <remarks>The image is flipped or rotated as it is presented, so cameras render the scene as usual.</remarks>
+    public static void SetEyeOrientation(RyzEye eye, RyzOrientation orientation)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz eye orientation. eye:{eye}, orientation:{orientation}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetEyeOrientation((int)eye, (int)orientation);
+#endif
+    }
+
+    /// <summary>
+    /// Sets the region of an eye texture that can be seen on its display. Pixels outside of it are covered by an occlusion mesh and not shaded.
+    /// </summary>
+    /// <param name="eye">The eye to configure.</param>
+    /// <param name="radiusX">The horizontal radius of the visible ellipse, where 0.5 reaches the left and right edges.</param>
+    /// <param name="radiusY">The vertical radius of the visible ellipse, where 0.5 reaches the top and bottom edges.</param>
+    /// <remarks>Pass zero for either radius to stop occluding the eye.</remarks>
+    public static void SetEyeOcclusion(RyzEye eye, float radiusX, float radiusY)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz eye occlusion. eye:{eye}, radiusX:{radiusX}, radiusY:{radiusY}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetEyeOcclusion((int)eye, radiusX, radiusY);
+#endif
+    }
+
+    /// <summary>
+    /// Sets whether Ryz frames that look the same as the last presented frame are skipped instead of presented.
+    /// Saves the copy and present of static content such as menus and paused states. Off by default.
+    /// </summary>
+    /// <param name="enabled">True to skip static frames, false to present every frame.</param>
+    /// <remarks>The first changed frame after a static period is shown a frame or two late. <see cref="ikinRyzFrameStats.framesSkipped"/> counts the skipped frames.</remarks>
+    public static void SetSkipStaticFrames(bool enabled)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz skip static frames. enabled:{enabled}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetSkipStaticFrames(enabled ? 1 : 0);
+#endif
+    }
+
+    /// <summary>
+    /// Sets how the regions of the Ryz eye that changed since the last frame are found.
+    /// Only the changed regions are copied into the buffer that the Ryz display is presented from.
+    /// </summary>
+    /// <param name="mode">How the changed regions are found.</param>
+    /// <remarks>Only 32-bit Ryz eye formats are tracked. <see cref="ikinRyzFrameStats.ryzBytesCopied"/> counts the copied bytes, along with the bytes read to present their copy.</remarks>
+    public static void SetDamageTracking(RyzDamageTracking mode)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz damage tracking. mode:{mode}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetDamageTracking((int)mode);
+#endif
+    }
+
+    /// <summary>
+    /// Reports a region of the Ryz eye that changed in the frame being rendered, when <see cref="RyzDamageTracking.Application"/> is selected.
+    /// </summary>
+    /// <param name="rect">The region in pixels of the Ryz eye texture, from its top left.</param>
+    /// <remarks>Regions reported before the frame is submitted are copied for that frame. Regions are merged, so reporting a few large ones is cheaper than many small ones.</remarks>
+    public static void AddDamageRect(RectInt rect)
+    {
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzAddDamageRect(rect.x, rect.y, rect.width, rect.height);
+#endif
+    }
+
+    /// <summary>
+    /// Sets how often the Ryz eye is rendered, relative to the main eye, which is always rendered every frame.
+    /// The frames in between present the last rendered Ryz image again, without rendering the scene for it.
+    /// </summary>
+    /// <param name="divisor">The Ryz eye is rendered once every this many frames. 1 renders it every frame, 2 at half rate, and so on.</param>
+    /// <remarks><see cref="ikinRyzFrameStats.ryzFramesRepeated"/> counts the frames that repeat the last Ryz image.</remarks>
+    public static void SetRyzFrameRateDivisor(int divisor)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz frame rate divisor. divisor:{divisor}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetRyzFrameRateDivisor(divisor);
+#endif
+    }
+
+    /// <summary>
+    /// Sets whether only the Ryz eye is rendered, for installs where the phone display can't be seen.
+    /// The phone display keeps showing the last image of the main eye, so almost all GPU time goes to the Ryz.
+    /// </summary>
+    /// <param name="enabled">True to stop rendering the main eye, false to render both eyes.</param>
+    /// <remarks>If the main eye has never been rendered, it is rendered once first, so that the phone display has a picture of the scene to show.</remarks>
+    public static void SetRyzOnly(bool enabled)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz only. enabled:{enabled}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetRyzOnly(enabled ? 1 : 0);
+#endif
+    }
+
+    /// <summary>
+    /// Sets whether a frame is synthesized for the Ryz display when Unity misses one, instead of the last frame being shown again.
+    /// </summary>
+    /// <param name="enabled">True to synthesize frames, false to let the display stutter.</param>
+    /// <remarks>
+    /// The synthesized frame is extrapolated from the last two presented frames, or moved along the motion vectors set with <see cref="SetMotionVectorTexture"/>.
+    /// At most two frames are synthesized in a row. <see cref="ikinRyzFrameStats.framesSynthesized"/> counts them.
+    /// </remarks>
+    public static void SetFrameSynthesis(bool enabled)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz frame synthesis. enabled:{enabled}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetFrameSynthesis(enabled ? 1 : 0);
+#endif
+    }
+
+    /// <summary>
+    /// Sets the texture that holds the motion vectors of the Ryz eye, which make synthesized frames more accurate.
+    /// </summary>
+    /// <param name="texture">A texture laid out like the Ryz eye, holding the change in texture coordinates of each pixel since the previous frame in its red and green channels. Null to stop using motion vectors.</param>
+    public static void SetMotionVectorTexture(Texture texture)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz motion vector texture. texture:{texture}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetMotionVectorTexture(texture != null ? texture.GetNativeTexturePtr() : IntPtr.Zero);
+#endif
+    }
+
+    /// <summary>
+    /// Sets the scale the Ryz eye is rendered at, relative to the size of the Ryz display.
+    /// </summary>
+    /// <param name="scale">The scale, greater than 0 and at most 1. Other values are ignored.</param>
+    /// <remarks>
+    /// The eye textures are recreated before the next frame is rendered.
+    /// Damage rectangles passed to <see cref="AddDamageRect"/> are in pixels of the scaled eye texture.
+    /// </remarks>
+    public static void SetRyzRenderScale(float scale)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz render scale. scale:{scale}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetRyzRenderScale(scale);
+#endif
+    }
+
+    /// <summary>
+    /// Sets whether a Ryz eye rendered smaller than the display is upscaled with edge reconstruction and sharpening, rather than stretched with bilinear filtering.
+    /// </summary>
+    /// <param name="enabled">True to upscale, false to stretch.</param>
+    /// <param name="sharpness">How much weaker than the strongest sharpening to sharpen, in stops. 0 is the strongest, 2 is barely sharpened. Negative values keep the current sharpness.</param>
+    /// <remarks>Pairs with <see cref="SetRyzRenderScale"/>, at a scale of 0.6 to 0.75.</remarks>
+    public static void SetUpscaling(bool enabled, float sharpness = 0.2f)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz upscaling. enabled:{enabled} sharpness:{sharpness}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetUpscaling(enabled ? 1 : 0, sharpness);
+#endif
+    }
+
+    /// <summary>
+    /// Loads the distortion mesh of the connected Ryz optics from a calibration file, and corrects the Ryz image with it from the next frame.
+    /// </summary>
+    /// <param name="path">The path of the calibration file. Null or empty to stop correcting distortion.</param>
+    /// <returns>True if the mesh was loaded or cleared, false if the file couldn't be loaded, in which case the current mesh is kept.</returns>
+    /// <remarks>
+    /// The correction is applied as the Ryz eye is presented, so Ryz cameras should render the undistorted scene rather than pre-warp it.
+    /// The file is text: the number of columns and rows of the mesh, followed by the image coordinates of each vertex, row by row from the top left of the display.
+    /// Lines starting with # are comments.
+    /// </remarks>
+    public static bool LoadDistortionMesh(string path)
+    {
+#if TRACE
+        Debug.Log($"Loading iKin Ryz distortion mesh. path:{path}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzLoadDistortionMesh(path) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Loads the color lookup table of the connected Ryz panel from a calibration file, and calibrates the Ryz image with it from the next frame.
+    /// </summary>
+    /// <param name="path">The path of the .cube calibration file. Null or empty to stop calibrating colors.</param>
+    /// <returns>True if the table was loaded or cleared, false if the file couldn't be loaded, in which case the current table is kept.</returns>
+    /// <remarks>
+    /// The table is applied in the same pass that presents the Ryz eye, so the Ryz camera doesn't need a color grading post-process for panel calibration.
+    /// Only 3D tables over the default domain of 0 to 1 are supported, with up to 65 entries along each axis.
+    /// </remarks>
+    public static bool LoadColorLut(string path)
+    {
+#if TRACE
+        Debug.Log($"Loading iKin Ryz color lookup table. path:{path}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzLoadColorLut(path) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Sets the calibration package that the Ryz display is calibrated from when it is connected.
+    /// </summary>
+    /// <param name="path">The path of the binary calibration package. Null or empty to stop using one.</param>
+    /// <remarks>
+    /// The package isn't read until a Ryz display is connected. It is then memory-mapped, and the calibration of the model that matches the display
+    /// replaces the distortion mesh, color lookup table and Ryz eye occlusion that were set before, until the display is disconnected.
+    /// Set the package before the display connects, such as when the app starts.
+    /// </remarks>
+    public static void SetCalibrationPackage(string path)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz calibration package. path:{path}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetCalibrationPackage(string.IsNullOrEmpty(path) ? null : path);
+#endif
+    }
+
+    /// <summary>
+    /// Gets the physical size of the connected Ryz display, from its calibration package.
+    /// </summary>
+    /// <param name="size">The width and height of the display in millimetres.</param>
+    /// <returns>True if the size is known, false if no display is connected or its calibration doesn't include a size.</returns>
+    public static bool TryGetDisplayGeometry(out Vector2 size)
+    {
+        size = Vector2.zero;
+#if UNITY_IOS && !UNITY_EDITOR
+        if (ikinRyzGetDisplayGeometry(out float width, out float height) == 0)
+        {
+            return false;
+        }
+
+        size = new Vector2(width, height);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Saves the next frame of an eye to a PNG file, without stalling the render thread.
+    /// </summary>
+    /// <param name="eye">The eye that is captured.</param>
+    /// <param name="path">The path of the file, such as one under <see cref="Application.persistentDataPath"/>.</param>
+    /// <returns>True if the capture was requested, otherwise false.</returns>
+    /// <remarks>
+    /// The Ryz eye is captured as the Ryz display shows it, with its orientation, calibration and composition layers applied.
+    /// The main eye is captured as it was rendered, and only while it is rendered in an 8-bit format.
+    /// The file is written on a thread of its own a few frames later. The capture cost is reported in <see cref="ikinRyzFrameStats"/>.
+    /// </remarks>
+    public static bool CaptureScreenshot(RyzEye eye, string path)
+    {
+#if TRACE
+        Debug.Log($"Capturing iKin Ryz screenshot. eye:{eye}, path:{path}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzCaptureScreenshot((int)eye, path) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Starts recording the frames of an eye to a file, without stalling the render thread.
+    /// </summary>
+    /// <param name="eye">The eye that is recorded.</param>
+    /// <param name="path">The path of the file, such as one under <see cref="Application.persistentDataPath"/>.</param>
+    /// <param name="frameRate">The frame rate written into the file's header.</param>
+    /// <param name="format">The format of the file.</param>
+    /// <returns>True if the recording started, otherwise false.</returns>
+    /// <remarks>
+    /// The frames are converted to YUV on a pool of threads and written on a thread of their own, with a few frames of memory between them.
+    /// When the disk falls behind, frames are dropped rather than waited on. The written and dropped frames are reported in <see cref="ikinRyzFrameStats"/>.
+    /// A recording that is already running is stopped first.
+    /// </remarks>
+    public static bool StartRecording(RyzEye eye, string path, int frameRate = 60, RyzRecordingFormat format = RyzRecordingFormat.Y4M)
+    {
+#if TRACE
+        Debug.Log($"Starting iKin Ryz recording. eye:{eye}, path:{path}, frameRate:{frameRate}, format:{format}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzStartRecording((int)eye, path, frameRate, (int)format) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Stops recording, once the frames that are waiting have been written, and closes the file.
+    /// </summary>
+    public static void StopRecording()
+    {
+#if TRACE
+        Debug.Log("Stopping iKin Ryz recording.");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzStopRecording();
+#endif
+    }
+
+    /// <summary>
+    /// Starts a server that streams the Ryz eye to a workstation, where Tools/ryz_preview_client shows it.
+    /// </summary>
+    /// <param name="port">The TCP port the server listens on, or 0 for the default of 7878.</param>
+    /// <param name="maxFramesPerSecond">The most frames that are sent each second, or 0 for the default of 15.</param>
+    /// <param name="maxBytesPerSecond">The most bytes that are sent each second, or 0 for the default of 4 MB.</param>
+    /// <param name="allowRemote">True to accept clients on any network, otherwise only through a USB port forward such as iproxy.</param>
+    /// <returns>True if the server is listening, otherwise false.</returns>
+    /// <remarks>
+    /// Only the tiles that changed since the last frame are sent. The Ryz eye is only captured while a client is connected,
+    /// and frames that the caps or a slow network don't allow are skipped rather than waited on.
+    /// The sent and skipped frames are reported in <see cref="ikinRyzFrameStats"/>.
+    /// </remarks>
+    public static bool StartPreviewServer(int port = 0, int maxFramesPerSecond = 0, int maxBytesPerSecond = 0, bool allowRemote = false)
+    {
+#if TRACE
+        Debug.Log($"Starting iKin Ryz preview server. port:{port}, maxFramesPerSecond:{maxFramesPerSecond}, maxBytesPerSecond:{maxBytesPerSecond}, allowRemote:{allowRemote}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzStartPreviewServer(port, maxFramesPerSecond, maxBytesPerSecond, allowRemote ? 1 : 0) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Stops the preview server and disconnects its client.
+    /// </summary>
+    public static void StopPreviewServer()
+    {
+#if TRACE
+        Debug.Log("Stopping iKin Ryz preview server.");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzStopPreviewServer();
+#endif
+    }
+
+    /// <summary>
+    /// Starts recording everything that crosses into the display provider to a trace file:
+    /// the frame setup hints, the camera matrices, the display events and the times frames are submitted.
+    /// </summary>
+    /// <param name="path">The path of the file, such as one under <see cref="Application.persistentDataPath"/>.</param>
+    /// <param name="maxBytes">The most bytes the file can hold, or 0 for 64 MB. The inputs after that are left out.</param>
+    /// <returns>True if recording started, otherwise false.</returns>
+    /// <remarks>
+    /// The file is written through a memory mapping, so recording costs a copy per input,
+    /// and the inputs that were recorded are kept if the app is killed.
+    /// The ryz_replay tool replays a trace with its original timing.
+    /// </remarks>
+    public static bool StartInputTrace(string path, int maxBytes = 0)
+    {
+#if TRACE
+        Debug.Log($"Starting iKin Ryz input trace. path:{path}, maxBytes:{maxBytes}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzStartInputTrace(path, maxBytes) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Stops recording the inputs of the display provider and closes the trace file.
+    /// </summary>
+    public static void StopInputTrace()
+    {
+#if TRACE
+        Debug.Log("Stopping iKin Ryz input trace.");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzStopInputTrace();
+#endif
+    }
+
+    /// <summary>
+    /// Starts recording the plugin's markers and the life of each frame, from submission through GPU completion to the Ryz display, to an in-memory timeline.
+    /// </summary>
+    /// <param name="eventCount">The number of events to keep, or 0 for 65536. Older events are overwritten by newer ones.</param>
+    /// <remarks>
+    /// Each thread gets its own track, and each frame's stages are joined by flow arrows,
+    /// so a hitch can be followed from the render thread to the display.
+    /// </remarks>
+    public static void StartTimeline(int eventCount = 0)
+    {
+#if TRACE
+        Debug.Log($"Starting iKin Ryz timeline. eventCount:{eventCount}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzStartTimeline(eventCount);
+#endif
+    }
+
+    /// <summary>
+    /// Stops recording the timeline. The events that were recorded can still be exported.
+    /// </summary>
+    public static void StopTimeline()
+    {
+#if TRACE
+        Debug.Log("Stopping iKin Ryz timeline.");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzStopTimeline();
+#endif
+    }
+
+    /// <summary>
+    /// Writes the timeline to a file as Chrome trace JSON, which opens in Perfetto (ui.perfetto.dev) and chrome://tracing.
+    /// </summary>
+    /// <param name="path">The path of the file, such as one under <see cref="Application.persistentDataPath"/>.</param>
+    /// <returns>True if the file was written, otherwise false.</returns>
+    /// <remarks>
+    /// Timestamps are on the monotonic clock, so the timeline can be lined up with a system trace of the same device.
+    /// </remarks>
+    public static bool ExportTimeline(string path)
+    {
+#if TRACE
+        Debug.Log($"Exporting iKin Ryz timeline. path:{path}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzExportTimeline(path) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Sets where the flight recorder writes its dumps when nobody asks for them: when a severe hitch happens, and when the display shuts down or the app terminates.
+    /// </summary>
+    /// <param name="directory">The directory, such as <see cref="Application.persistentDataPath"/>, or null to only write dumps that are asked for.</param>
+    /// <param name="seconds">The seconds of records a dump keeps, or 0 for 30.</param>
+    /// <param name="hitchMilliseconds">The interval between two frames that counts as a severe hitch, 0 for 250, or -1 to not dump on hitches.</param>
+    /// <remarks>
+    /// The flight recorder is always on. It keeps the frame timings, hotplugs, skipped frames and waits of about the last minute and a half in a fixed amount of memory.
+    /// Hitch dumps are named ryz_flight_hitch_0.bin to ryz_flight_hitch_7.bin, and the shutdown dump ryz_flight_shutdown.bin.
+    /// The ryz_flight_report tool summarizes a dump.
+    /// </remarks>
+    public static void ConfigureFlightRecorder(string directory, int seconds = 0, int hitchMilliseconds = 0)
+    {
+#if TRACE
+        Debug.Log($"Configuring iKin Ryz flight recorder. directory:{directory}, seconds:{seconds}, hitchMilliseconds:{hitchMilliseconds}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzConfigureFlightRecorder(directory, seconds, hitchMilliseconds);
+#endif
+    }
+
+    /// <summary>
+    /// Writes the flight recorder's last seconds of frame timings, hotplugs, skipped frames and waits to a file, such as when a player reports a stutter.
+    /// </summary>
+    /// <param name="path">The path of the file.</param>
+    /// <returns>True if the file was written, otherwise false.</returns>
+    public static bool DumpFlightRecorder(string path)
+    {
+#if TRACE
+        Debug.Log($"Dumping iKin Ryz flight recorder. path:{path}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        return ikinRyzDumpFlightRecorder(path) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Sets the region of the mirror view that the Ryz eye is drawn into when <see cref="MirrorBlitPictureInPicture"/> is selected.
+    /// </summary>
+    /// <param name="rect">The region in normalized coordinates, from the bottom left of the mirror view.</param>
+    public static void SetMirrorPictureInPictureRect(Rect rect)
+    {
+#if TRACE
+        Debug.Log($"Setting iKin Ryz mirror picture in picture rect. rect:{rect}");
+#endif
+#if UNITY_IOS && !UNITY_EDITOR
+        ikinRyzSetMirrorPictureInPictureRect(rect.x, rect.y, rect.width, rect.height);
+#endif
+    }
+    #endregion
+}